@@ -0,0 +1,1055 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "btree.h"
+#include "bitmapscan.h"
+#include "filescan.h"
+#include "log_mgr.h"
+#include "crc32c.h"
+#include "range_filter.h"
+#include "file.h"
+#include "file_iterator.h"
+#include "page_iterator.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Benchmarks of the B+Tree index. Run as: badgerdb_bench [numKeys]
+// -----------------------------------------------------------------------------
+
+const std::string relationName = "benchRel";
+const int bufferFrames = 4000;
+const int threadCounts[] = {1, 2, 4, 8};
+const int heapFrames = 256;
+const int insertFrames = 128;
+const int insertBufferSizes[] = {0, 4096, INSERTBUFFERSIZE};
+const int searchRounds = 5;
+const double selectivities[] = {0.001, 0.01, 0.05, 0.2};
+const int checksumRounds = 5;
+const int layoutPasses = 2;
+
+/*
+	Records of the relation of heapFetchBench, laid out like those of the tests.
+*/
+struct BenchRecord {
+	int i;
+	double d;
+	char s[64];
+};
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+	RecordId standing in for the record holding key. The benchmarks never read the relation.
+*/
+static RecordId ridFor(int key)
+{
+	RecordId rid;
+	rid.page_number = key / 100 + 1;
+	rid.slot_number = key % 100;
+	rid.padding = 0;
+	return rid;
+}
+
+static double secondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void report(const std::string& phase, int threads, long ops, double seconds)
+{
+	std::cout << std::left << std::setw(8) << phase << " threads=" << threads
+		<< " ops=" << ops << " time=" << std::fixed << std::setprecision(3) << seconds << "s"
+		<< " ops/sec=" << std::setprecision(0) << ops / seconds << std::endl;
+}
+
+static void removeFile(const std::string& name)
+{
+	try
+	{
+		File::remove(name);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+}
+
+/*
+	Number of entries a full scan of the index returns.
+*/
+static long countEntries(BTreeIndex& index)
+{
+	int low = INT_MIN + 1;
+	int high = INT_MAX;
+	long count = 0;
+	index.startScan(&low, GTE, &high, LTE);
+	try
+	{
+		RecordId rid;
+		while (true)
+		{
+			index.scanNext(rid);
+			count++;
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	index.endScan();
+	return count;
+}
+
+/*
+	Prints the node cache hits and misses of every tree level a phase went through, leaves being level 0.
+*/
+static void reportNodeCache(const BTreeIndex& index)
+{
+	NodeCacheStats stats = index.getNodeCacheStats();
+	std::cout << "  node cache pages=" << stats.pages << "/" << stats.budget;
+	for (int level = 0; level < NodeCacheStats::MAX_LEVELS; level++) {
+		if (stats.hits[level] + stats.misses[level] > 0) {
+			std::cout << " L" << level << " hits=" << stats.hits[level] << " misses=" << stats.misses[level];
+		}
+	}
+	std::cout << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+// concurrencyBench
+// -----------------------------------------------------------------------------
+
+/*
+	T threads insert disjoint shares of numKeys distinct keys into an empty index, then look all of them
+	up, then run a mix of 95% lookups and 5% inserts of fresh keys. Reports the throughput of every phase
+	and checks that a scan afterwards sees every inserted key exactly once.
+*/
+static bool concurrencyBench(int threads, int numKeys)
+{
+	std::vector<int> keys(numKeys * 2);
+	for (int i = 0; i < numKeys * 2; i++) {
+		keys[i] = i;
+	}
+	std::mt19937 gen(threads);
+	std::shuffle(keys.begin(), keys.end(), gen);
+
+	removeFile(relationName);
+	{
+		PageFile relation = PageFile::create(relationName);
+	}
+	BufMgr* bufMgr = new BufMgr(bufferFrames);
+	std::string indexName;
+	bool ok = true;
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, 0, INTEGER);
+		std::vector<std::thread> workers;
+
+		// insert keys[0, numKeys)
+		Clock::time_point start = Clock::now();
+		for (int t = 0; t < threads; t++) {
+			workers.push_back(std::thread([&, t]() {
+				for (int i = t; i < numKeys; i += threads) {
+					index.insertEntry(&keys[i], ridFor(keys[i]));
+				}
+			}));
+		}
+		for (size_t t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+		report("insert", threads, numKeys, secondsSince(start));
+
+		// look up every inserted key
+		std::vector<int> misses(threads, 0);
+		workers.clear();
+		index.clearNodeCacheStats();
+		start = Clock::now();
+		for (int t = 0; t < threads; t++) {
+			workers.push_back(std::thread([&, t]() {
+				std::vector<RecordId> rids;
+				for (int i = t; i < numKeys; i += threads) {
+					if (index.lookup(&keys[i], rids) != 1 || rids[0] != ridFor(keys[i])) {
+						misses[t]++;
+					}
+				}
+			}));
+		}
+		for (size_t t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+		report("lookup", threads, numKeys, secondsSince(start));
+		reportNodeCache(index);
+
+		// look every inserted key up again with lookupMany, a sorted batch of 256 keys per call
+		workers.clear();
+		start = Clock::now();
+		for (int t = 0; t < threads; t++) {
+			workers.push_back(std::thread([&, t]() {
+				std::vector<int> share;
+				for (int i = t; i < numKeys; i += threads) {
+					share.push_back(keys[i]);
+				}
+				std::sort(share.begin(), share.end());
+				std::vector<const void*> batch;
+				std::vector<RecordId> rids;
+				std::vector<int> offsets;
+				for (size_t i = 0; i < share.size(); i += 256) {
+					batch.clear();
+					for (size_t j = i; j < share.size() && j < i + 256; j++) {
+						batch.push_back(&share[j]);
+					}
+					if (index.lookupMany(batch.data(), batch.size(), rids, offsets) != (int)batch.size()) {
+						misses[t]++;
+					}
+				}
+			}));
+		}
+		for (size_t t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+		report("probe", threads, numKeys, secondsSince(start));
+
+		// top 10 queries: the 10 largest keys at or below a random bound, from a descending scan
+		const int queries = numKeys / 16;
+		workers.clear();
+		start = Clock::now();
+		for (int t = 0; t < threads; t++) {
+			workers.push_back(std::thread([&, t]() {
+				std::mt19937 local(t);
+				int low = 0;
+				RecordId top[10];
+				for (int i = t; i < queries; i += threads) {
+					int high = numKeys / 8 + local() % (2 * numKeys - numKeys / 8);
+					IndexScanCursor* cursor = index.openReverseScan(&low, GTE, &high, LTE);
+					int got = cursor->scanNextBatch(top, 10);
+					delete cursor;
+					int last = high + 1;
+					for (int j = 0; j < got; j++) {
+						int key = (top[j].page_number - 1) * 100 + top[j].slot_number;
+						if (key >= last) {
+							got = -1;
+							break;
+						}
+						last = key;
+					}
+					if (got != 10) {
+						misses[t]++;
+					}
+				}
+			}));
+		}
+		for (size_t t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+		report("top10", threads, queries, secondsSince(start));
+
+		// 95% lookups of old keys, 5% inserts from keys[numKeys, 2 * numKeys)
+		std::vector<int> inserted(threads, 0);
+		workers.clear();
+		start = Clock::now();
+		for (int t = 0; t < threads; t++) {
+			workers.push_back(std::thread([&, t]() {
+				std::vector<RecordId> rids;
+				std::mt19937 local(t);
+				int next = numKeys + t;
+				for (int i = t; i < numKeys; i += threads) {
+					if (local() % 100 < 5 && next < 2 * numKeys) {
+						index.insertEntry(&keys[next], ridFor(keys[next]));
+						next += threads;
+						inserted[t]++;
+					} else if (index.lookup(&keys[local() % numKeys], rids) != 1) {
+						misses[t]++;
+					}
+				}
+			}));
+		}
+		for (size_t t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+		report("mixed", threads, numKeys, secondsSince(start));
+
+		long expected = numKeys;
+		for (int t = 0; t < threads; t++) {
+			expected += inserted[t];
+			if (misses[t] != 0) {
+				std::cout << "thread " << t << " missed " << misses[t] << " keys" << std::endl;
+				ok = false;
+			}
+		}
+		long found = countEntries(index);
+		if (found != expected) {
+			std::cout << "scan found " << found << " entries, expected " << expected << std::endl;
+			ok = false;
+		}
+	}
+	delete bufMgr;
+	removeFile(indexName);
+	removeFile(relationName);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// heapFetchBench
+// -----------------------------------------------------------------------------
+
+/*
+	Fills the relation with records for keys 0 to numKeys - 1, stored in random order.
+*/
+static void createRandomRelation(int numKeys)
+{
+	std::vector<int> keys(numKeys);
+	for (int i = 0; i < numKeys; i++) {
+		keys[i] = i;
+	}
+	std::mt19937 gen(numKeys);
+	std::shuffle(keys.begin(), keys.end(), gen);
+
+	removeFile(relationName);
+	PageFile relation = PageFile::create(relationName);
+	BenchRecord record;
+	memset(&record, ' ', sizeof(record));
+	PageId pageNo;
+	Page page = relation.allocatePage(pageNo);
+	for (int i = 0; i < numKeys; i++) {
+		record.i = keys[i];
+		record.d = keys[i];
+		std::string data(reinterpret_cast<char*>(&record), sizeof(record));
+		try {
+			page.insertRecord(data);
+		} catch (const InsufficientSpaceException &e) {
+			relation.writePage(pageNo, page);
+			page = relation.allocatePage(pageNo);
+			page.insertRecord(data);
+		}
+	}
+	relation.writePage(pageNo, page);
+}
+
+static void reportFetch(const std::string& phase, double selectivity, long records, double seconds, int diskReads)
+{
+	std::cout << std::left << std::setw(9) << phase << " selectivity=" << std::setprecision(3) << selectivity
+		<< " records=" << records << " time=" << std::fixed << std::setprecision(3) << seconds << "s"
+		<< " diskreads=" << diskReads << std::defaultfloat << std::endl;
+}
+
+/*
+	Fetches the records of index ranges of growing selectivity over a relation stored in random key order,
+	with a buffer pool much smaller than the relation: once in key order, reading the page of each RecordId
+	as the index returns it, and once with a BitmapHeapScan. Reports the time and disk reads of both and
+	checks that they sum up the same keys.
+*/
+static bool heapFetchBench(int numKeys)
+{
+	createRandomRelation(numKeys);
+	BufMgr* bufMgr = new BufMgr(heapFrames);
+	std::string indexName;
+	bool ok = true;
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, offsetof(BenchRecord, i), INTEGER);
+		PageFile* heap = new PageFile(relationName, false);
+		for (size_t s = 0; s < sizeof(selectivities) / sizeof(selectivities[0]); s++) {
+			int width = (int)(numKeys * selectivities[s]);
+			int low = numKeys / 3;
+			int high = low + width - 1;
+
+			// key order: every RecordId reads its page, which is most likely evicted by then
+			bufMgr->clearBufStats();
+			Clock::time_point start = Clock::now();
+			IndexScanCursor* cursor = index.openScan(&low, GTE, &high, LTE);
+			RecordId rids[256];
+			long records = 0;
+			long keySum = 0;
+			int got;
+			do {
+				got = cursor->scanNextBatch(rids, 256);
+				for (int i = 0; i < got; i++) {
+					Page* page;
+					bufMgr->readPage(heap, rids[i].page_number, page);
+					std::string record = page->getRecord(rids[i]);
+					keySum += ((const BenchRecord*)record.data())->i;
+					bufMgr->unPinPage(heap, rids[i].page_number, false);
+				}
+				records += got;
+			} while (got == 256);
+			delete cursor;
+			reportFetch("keyorder", selectivities[s], records, secondsSince(start), bufMgr->getBufStats().diskreads);
+
+			// heap order: every page is read once
+			bufMgr->clearBufStats();
+			start = Clock::now();
+			long bitmapRecords = 0;
+			long bitmapSum = 0;
+			{
+				BitmapHeapScan scan(relationName, bufMgr, &index, &low, GTE, &high, LTE);
+				try {
+					RecordId rid;
+					while (true) {
+						scan.scanNext(rid);
+						std::string record = scan.getRecord();
+						bitmapSum += ((const BenchRecord*)record.data())->i;
+						bitmapRecords++;
+					}
+				} catch (const EndOfFileException &e) {
+				}
+			}
+			reportFetch("bitmap", selectivities[s], bitmapRecords, secondsSince(start), bufMgr->getBufStats().diskreads);
+
+			if (records != width || bitmapRecords != records || bitmapSum != keySum) {
+				std::cout << "bitmap scan found " << bitmapRecords << " records, key order " << records
+					<< ", expected " << width << std::endl;
+				ok = false;
+			}
+		}
+		bufMgr->flushFile(heap);
+		delete heap;
+	}
+	delete bufMgr;
+	removeFile(indexName);
+	removeFile(relationName);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// insertBufferBench
+// -----------------------------------------------------------------------------
+
+/*
+	Inserts numKeys distinct keys in random order into an empty index with a buffer pool too small for its
+	leaves, once straight into the tree and once for every insert buffer size. Reports the time and disk
+	I/O of each, the writes of the pages still dirty when the index is closed included, and checks that a
+	scan afterwards sees every key.
+*/
+static bool insertBufferBench(int numKeys)
+{
+	std::vector<int> keys(numKeys);
+	for (int i = 0; i < numKeys; i++) {
+		keys[i] = i;
+	}
+	std::mt19937 gen(numKeys);
+	std::shuffle(keys.begin(), keys.end(), gen);
+	removeFile(relationName);
+	{
+		PageFile relation = PageFile::create(relationName);
+	}
+
+	bool ok = true;
+	for (size_t s = 0; s < sizeof(insertBufferSizes) / sizeof(insertBufferSizes[0]); s++) {
+		BufMgr* bufMgr = new BufMgr(insertFrames);
+		std::string indexName;
+		long count;
+		double seconds;
+		{
+			BTreeIndex index(relationName, indexName, bufMgr, offsetof(BenchRecord, i), INTEGER);
+			index.enableInsertBuffer(insertBufferSizes[s]);
+			bufMgr->clearBufStats();
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < numKeys; i++) {
+				index.insertEntry(&keys[i], ridFor(keys[i]));
+			}
+			index.flushInsertBuffer();
+			seconds = secondsSince(start);
+			count = countEntries(index);
+		}
+		BufStats stats = bufMgr->getBufStats();
+		std::cout << "insert   buffer=" << std::setw(6) << insertBufferSizes[s] << " ops=" << numKeys
+			<< " time=" << std::fixed << std::setprecision(3) << seconds << "s"
+			<< " diskreads=" << stats.diskreads << " diskwrites=" << stats.diskwrites << std::defaultfloat << std::endl;
+		if (count != numKeys) {
+			std::cout << "scan found " << count << " entries, expected " << numKeys << std::endl;
+			ok = false;
+		}
+		delete bufMgr;
+		removeFile(indexName);
+	}
+	removeFile(relationName);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// searchLayoutBench
+// -----------------------------------------------------------------------------
+
+/*
+	Looks up numKeys distinct keys, searchRounds times each in random order, in an index that fits in the
+	buffer pool, searching the non-leaf nodes by their sorted keys and through their Eytzinger copies in turn,
+	layoutPasses times each, with 1 and with 4 threads. Reports the throughput of every pass and checks that
+	every lookup finds its key.
+*/
+static bool searchLayoutBench(int numKeys)
+{
+	std::vector<int> keys(numKeys);
+	for (int i = 0; i < numKeys; i++) {
+		keys[i] = i;
+	}
+	std::mt19937 gen(numKeys);
+	std::shuffle(keys.begin(), keys.end(), gen);
+	removeFile(relationName);
+	{
+		PageFile relation = PageFile::create(relationName);
+	}
+
+	BufMgr* bufMgr = new BufMgr(bufferFrames);
+	std::string indexName;
+	bool ok = true;
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, 0, INTEGER);
+		for (int i = 0; i < numKeys; i++) {
+			index.insertEntry(&keys[i], ridFor(keys[i]));
+		}
+		const int searchThreads[] = {1, 4};
+		// the layouts take turns, so that neither gets all the warm caches or all the noise
+		for (int run = 0; run < 2 * layoutPasses; run++) {
+			const int layout = run % 2;
+			index.enableEytzingerSearch(layout == 1);
+			for (size_t n = 0; n < sizeof(searchThreads) / sizeof(searchThreads[0]); n++) {
+				int threads = searchThreads[n];
+				std::vector<int> misses(threads, 0);
+				std::vector<std::thread> workers;
+				Clock::time_point start = Clock::now();
+				for (int t = 0; t < threads; t++) {
+					workers.push_back(std::thread([&, t]() {
+						std::vector<RecordId> rids;
+						for (int round = 0; round < searchRounds; round++) {
+							for (int i = t; i < numKeys; i += threads) {
+								if (index.lookup(&keys[(i + round * 7919) % numKeys], rids) != 1) {
+									misses[t]++;
+								}
+							}
+						}
+					}));
+				}
+				for (size_t t = 0; t < workers.size(); t++) {
+					workers[t].join();
+				}
+				report(layout == 1 ? "eytz" : "sorted", threads, (long)numKeys * searchRounds, secondsSince(start));
+				for (int t = 0; t < threads; t++) {
+					if (misses[t] > 0) {
+						std::cout << misses[t] << " lookups missed their key" << std::endl;
+						ok = false;
+					}
+				}
+			}
+		}
+	}
+	delete bufMgr;
+	removeFile(indexName);
+	removeFile(relationName);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// learnedModelBench
+// -----------------------------------------------------------------------------
+
+/*
+	Looks up numKeys keys, inserted in key order, searchRounds times each in random order: first by
+	descending from the root, then through the learned model of the leaf level, with 1 and with 4 threads.
+	Reports the throughput of both and checks that every lookup finds its key.
+*/
+static bool learnedModelBench(int numKeys)
+{
+	std::vector<int> keys(numKeys);
+	for (int i = 0; i < numKeys; i++) {
+		keys[i] = i;
+	}
+	removeFile(relationName);
+	{
+		PageFile relation = PageFile::create(relationName);
+	}
+
+	BufMgr* bufMgr = new BufMgr(bufferFrames);
+	std::string indexName;
+	bool ok = true;
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, 0, INTEGER);
+		for (int i = 0; i < numKeys; i++) {
+			index.insertEntry(&keys[i], ridFor(keys[i]));
+		}
+		std::mt19937 gen(numKeys);
+		std::shuffle(keys.begin(), keys.end(), gen);
+		const int searchThreads[] = {1, 4};
+		for (int model = 0; model < 2; model++) {
+			if (model == 1) {
+				std::cout << "learned model of " << index.enableLearnedModel() << " pieces" << std::endl;
+			}
+			for (size_t n = 0; n < sizeof(searchThreads) / sizeof(searchThreads[0]); n++) {
+				int threads = searchThreads[n];
+				std::vector<int> misses(threads, 0);
+				std::vector<std::thread> workers;
+				Clock::time_point start = Clock::now();
+				for (int t = 0; t < threads; t++) {
+					workers.push_back(std::thread([&, t]() {
+						std::vector<RecordId> rids;
+						for (int round = 0; round < searchRounds; round++) {
+							for (int i = t; i < numKeys; i += threads) {
+								if (index.lookup(&keys[(i + round * 7919) % numKeys], rids) != 1) {
+									misses[t]++;
+								}
+							}
+						}
+					}));
+				}
+				for (size_t t = 0; t < workers.size(); t++) {
+					workers[t].join();
+				}
+				report(model == 1 ? "learned" : "descent", threads, (long)numKeys * searchRounds, secondsSince(start));
+				for (int t = 0; t < threads; t++) {
+					if (misses[t] > 0) {
+						std::cout << misses[t] << " lookups missed their key" << std::endl;
+						ok = false;
+					}
+				}
+			}
+		}
+	}
+	delete bufMgr;
+	removeFile(indexName);
+	removeFile(relationName);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// writeAheadLogBench
+// -----------------------------------------------------------------------------
+
+/*
+	Inserts numKeys distinct keys in random order into an empty index with a buffer pool too small for its
+	leaves: without a log, with a write-ahead log, and with the log and a checkpoint every twentieth of the
+	keys. Reports the time of each and the records, bytes and forced writes of the log, and what the
+	checkpoints cost; then replays a copy of the log over the closed index and reports how long recovery
+	took.
+*/
+static bool writeAheadLogBench(int numKeys)
+{
+	std::vector<int> keys(numKeys);
+	for (int i = 0; i < numKeys; i++) {
+		keys[i] = i;
+	}
+	std::mt19937 gen(numKeys);
+	std::shuffle(keys.begin(), keys.end(), gen);
+	removeFile(relationName);
+	{
+		PageFile relation = PageFile::create(relationName);
+	}
+	const std::string logName = relationName + ".log";
+	const std::string logCopy = logName + ".copy";
+
+	const char* modes[] = {"none", "log", "checkpoint"};
+	const int checkpointEvery = std::max(numKeys / 20, 1);
+	bool ok = true;
+	for (int mode = 0; mode < 3; mode++) {
+		const bool logged = mode > 0;
+		std::remove(logName.c_str());
+		LogMgr log(logName);
+		BufMgr* bufMgr = new BufMgr(insertFrames, logged ? &log : nullptr);
+		std::string indexName;
+		long count;
+		double seconds;
+		{
+			BTreeIndex index(relationName, indexName, bufMgr, offsetof(BenchRecord, i), INTEGER);
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < numKeys; i++) {
+				index.insertEntry(&keys[i], ridFor(keys[i]));
+				if (mode == 2 && (i + 1) % checkpointEvery == 0) {
+					bufMgr->checkpoint();
+				}
+			}
+			seconds = secondsSince(start);
+			count = countEntries(index);
+		}
+		LogStats stats = log.getStats();
+		std::cout << "insert   log=" << modes[mode] << " ops=" << numKeys
+			<< " time=" << std::fixed << std::setprecision(3) << seconds << "s"
+			<< " records=" << stats.records << " logMB=" << std::setprecision(1) << stats.bytes / 1048576.0
+			<< " forced=" << stats.flushes << std::defaultfloat << std::endl;
+		if (mode == 2) {
+			CheckpointStats checkpoints = bufMgr->getCheckpointStats();
+			std::cout << "checkpoint count=" << checkpoints.checkpoints
+				<< " time=" << std::fixed << std::setprecision(3) << checkpoints.microseconds / 1e6 << "s"
+				<< " last=" << checkpoints.lastMicroseconds / 1e3 << "ms"
+				<< " writtenMB=" << std::setprecision(1) << checkpoints.bytesWritten / 1048576.0
+				<< " droppedMB=" << checkpoints.bytesTruncated / 1048576.0
+				<< " pages=" << checkpoints.pagesWritten << std::defaultfloat << std::endl;
+		}
+		if (count != numKeys) {
+			std::cout << "scan found " << count << " entries, expected " << numKeys << std::endl;
+			ok = false;
+		}
+		if (logged) {
+			// keep the log as a crash would, before closing the pool empties it
+			log.flush();
+			std::ifstream in(logName.c_str(), std::ios::binary);
+			std::ofstream out(logCopy.c_str(), std::ios::binary | std::ios::trunc);
+			out << in.rdbuf();
+		}
+		delete bufMgr;
+		if (logged) {
+			std::rename(logCopy.c_str(), logName.c_str());
+			LogMgr crashed(logName);
+			Clock::time_point start = Clock::now();
+			std::uint64_t pages = crashed.recover();
+			std::cout << "recover  pages=" << pages << " time=" << std::fixed << std::setprecision(3)
+				<< secondsSince(start) << "s" << std::defaultfloat << std::endl;
+		}
+		removeFile(indexName);
+	}
+	std::remove(logName.c_str());
+	removeFile(relationName);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// pageChecksumBench
+// -----------------------------------------------------------------------------
+
+/*
+	Times CRC32C over pages with the crc32 instruction and with the tables, then reads a heap file of one
+	page per hundred keys in each checksum mode: checksumRounds passes straight from the file, and as many
+	through a buffer pool that holds the whole file, so only the first pass reads it.
+*/
+static bool pageChecksumBench(int numKeys)
+{
+	const int numPages = std::max(numKeys / 100, 1);
+	std::vector<char> bytes(Page::SIZE * 64);
+	for (size_t i = 0; i < bytes.size(); i++) {
+		bytes[i] = (char)(i * 131 + i / 7);
+	}
+	const int pageRounds = numPages * checksumRounds;
+	std::uint32_t sink = 0;
+	for (int hardware = 1; hardware >= 0; hardware--) {
+		if (hardware && !Crc32c::hardwareSupported()) {
+			continue;
+		}
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < pageRounds; i++) {
+			const char* page = &bytes[(i % 64) * Page::SIZE];
+			sink ^= hardware ? Crc32c::extend(0, page, Page::SIZE) : Crc32c::extendSoftware(0, page, Page::SIZE);
+		}
+		double seconds = secondsSince(start);
+		std::cout << "crc32c   " << (hardware ? "sse4.2" : "table ") << " pages=" << pageRounds
+			<< " time=" << std::fixed << std::setprecision(3) << seconds << "s"
+			<< " MB/s=" << std::setprecision(0) << pageRounds * (double)Page::SIZE / 1048576.0 / seconds
+			<< std::defaultfloat << std::endl;
+	}
+
+	const std::string heapName = relationName + ".heap";
+	removeFile(heapName);
+	std::vector<PageId> pageNos;
+	{
+		PageFile heap = PageFile::create(heapName);
+		for (int i = 0; i < numPages; i++) {
+			PageId pageNo;
+			Page page = heap.allocatePage(pageNo);
+			while (page.hasSpaceForRecord(std::string(64, 'x'))) {
+				page.insertRecord(std::string(64, (char)('a' + i % 26)));
+			}
+			heap.writePage(pageNo, page);
+			pageNos.push_back(pageNo);
+		}
+	}
+
+	const ChecksumMode modes[] = {CHECKSUM_ON_READ, CHECKSUM_ON_POOL_READ, CHECKSUM_OFF};
+	const char* modeNames[] = {"read", "pool", "off"};
+	bool ok = true;
+	for (int m = 0; m < 3; m++) {
+		PageFile::setChecksumMode(modes[m]);
+		PageFile heap = PageFile::open(heapName);
+		long slots = 0;
+		Clock::time_point start = Clock::now();
+		for (int round = 0; round < checksumRounds; round++) {
+			for (int i = 0; i < numPages; i++) {
+				slots += heap.readPage(pageNos[i]).getFreeSpace();
+			}
+		}
+		double fileSeconds = secondsSince(start);
+
+		BufMgr* bufMgr = new BufMgr(numPages + 1);
+		start = Clock::now();
+		for (int round = 0; round < checksumRounds; round++) {
+			for (int i = 0; i < numPages; i++) {
+				Page* page;
+				bufMgr->readPage(&heap, pageNos[i], page);
+				slots += page->getFreeSpace();
+				bufMgr->unPinPage(&heap, pageNos[i], false);
+			}
+		}
+		double poolSeconds = secondsSince(start);
+		bufMgr->flushFile(&heap);
+		delete bufMgr;
+		std::cout << "checksum mode=" << std::left << std::setw(4) << modeNames[m] << std::right
+			<< " pages=" << numPages * checksumRounds << std::fixed << std::setprecision(3)
+			<< " file=" << fileSeconds << "s pool=" << poolSeconds << "s" << std::defaultfloat << std::endl;
+		if (slots < 0) {
+			ok = false;
+		}
+	}
+	PageFile::setChecksumMode(CHECKSUM_ON_READ);
+	removeFile(heapName);
+	return ok && sink != 1;
+}
+
+// -----------------------------------------------------------------------------
+// compressedFileBench
+// -----------------------------------------------------------------------------
+
+/*
+	Writes the relation of heapFetchBench, its string field padded with spaces, to a plain and to a
+	compressed file, then reads every page of each checksumRounds times. Reports the time of both and the
+	size of each file.
+*/
+static bool compressedFileBench(int numKeys)
+{
+	const FileFormat formats[] = {FORMAT_PLAIN, FORMAT_COMPRESSED};
+	const char* formatNames[] = {"plain", "compressed"};
+	const std::string fileName = relationName + ".packed";
+	bool ok = true;
+	for (int f = 0; f < 2; f++) {
+		removeFile(fileName);
+		Clock::time_point start = Clock::now();
+		{
+			PageFile relation = PageFile::create(fileName, formats[f]);
+			BenchRecord record;
+			memset(&record, ' ', sizeof(record));
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			for (int i = 0; i < numKeys; i++) {
+				record.i = i;
+				record.d = i;
+				std::string data(reinterpret_cast<char*>(&record), sizeof(record));
+				try {
+					page.insertRecord(data);
+				} catch (const InsufficientSpaceException &e) {
+					relation.writePage(pageNo, page);
+					page = relation.allocatePage(pageNo);
+					page.insertRecord(data);
+				}
+			}
+			relation.writePage(pageNo, page);
+		}
+		double writeSeconds = secondsSince(start);
+
+		std::ifstream in(fileName.c_str(), std::ios::binary | std::ios::ate);
+		long bytes = in.tellg();
+		PageFile relation = PageFile::open(fileName);
+		long records = 0;
+		start = Clock::now();
+		for (int round = 0; round < checksumRounds; round++) {
+			for (FileIterator it = relation.begin(); it != relation.end(); ++it) {
+				Page page = *it;
+				for (PageIterator rec = page.begin(); rec != page.end(); ++rec) {
+					records++;
+				}
+			}
+		}
+		double readSeconds = secondsSince(start);
+		std::cout << "file " << std::left << std::setw(10) << formatNames[f] << std::right
+			<< " pages=" << relation.getNumPages() << " bytes=" << bytes << std::fixed << std::setprecision(3)
+			<< " write=" << writeSeconds << "s read=" << readSeconds << "s" << std::defaultfloat << std::endl;
+		if (records != (long)numKeys * checksumRounds) {
+			std::cout << "read " << records << " records, expected " << (long)numKeys * checksumRounds << std::endl;
+			ok = false;
+		}
+	}
+	removeFile(fileName);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// paxScanBench
+// -----------------------------------------------------------------------------
+
+/*
+	Stores the relation of heapFetchBench in slotted pages and in PAX pages, then sums its integer field
+	searchRounds times through a buffer pool that holds the whole relation: with FileScan over the slotted
+	pages, with FileScan over the PAX pages, which puts every record back together, and with a ColumnScan
+	of the integer column alone.
+*/
+static bool paxScanBench(int numKeys)
+{
+	const std::string names[] = {relationName + ".rows", relationName + ".pax"};
+	std::vector<PaxAttribute> schema(3);
+	schema[0].offset = offsetof(BenchRecord, i);
+	schema[0].length = sizeof(int);
+	schema[1].offset = offsetof(BenchRecord, d);
+	schema[1].length = sizeof(double);
+	schema[2].offset = offsetof(BenchRecord, s);
+	schema[2].length = sizeof(((BenchRecord*)0)->s);
+	int numPages[2];
+	for (int f = 0; f < 2; f++) {
+		removeFile(names[f]);
+		PageFile relation = PageFile::create(names[f]);
+		BenchRecord record;
+		memset(&record, ' ', sizeof(record));
+		PageId pageNo;
+		Page page = relation.allocatePage(pageNo);
+		if (f == 1) {
+			page.formatPax(schema, sizeof(BenchRecord));
+		}
+		numPages[f] = 1;
+		for (int i = 0; i < numKeys; i++) {
+			record.i = i;
+			record.d = i;
+			std::string data(reinterpret_cast<char*>(&record), sizeof(record));
+			if (!page.hasSpaceForRecord(data)) {
+				relation.writePage(pageNo, page);
+				page = relation.allocatePage(pageNo);
+				if (f == 1) {
+					page.formatPax(schema, sizeof(BenchRecord));
+				}
+				numPages[f]++;
+			}
+			page.insertRecord(data);
+		}
+		relation.writePage(pageNo, page);
+	}
+
+	const long long expected = (long long)numKeys * (numKeys - 1) / 2 * searchRounds;
+	const char* scanNames[] = {"rows", "pax rows", "columns"};
+	bool ok = true;
+	for (int scan = 0; scan < 3; scan++) {
+		const std::string& name = names[scan == 0 ? 0 : 1];
+		BufMgr* bufMgr = new BufMgr(numPages[scan == 0 ? 0 : 1] + 1);
+		long long sum = 0;
+		Clock::time_point start = Clock::now();
+		for (int round = 0; round < searchRounds; round++) {
+			if (scan < 2) {
+				FileScan fscan(name, bufMgr);
+				try {
+					RecordId rid;
+					while (true) {
+						fscan.scanNext(rid);
+						std::string data = fscan.getRecord();
+						sum += *reinterpret_cast<const int*>(data.data() + offsetof(BenchRecord, i));
+					}
+				} catch (const EndOfFileException &e) {
+				}
+			} else {
+				ColumnScan cscan(name, bufMgr, std::vector<int>(1, 0));
+				try {
+					std::vector<const char*> columns;
+					while (true) {
+						SlotId records = cscan.scanNext(columns);
+						const int* keys = reinterpret_cast<const int*>(columns[0]);
+						for (SlotId j = 0; j < records; j++) {
+							sum += keys[j];
+						}
+					}
+				} catch (const EndOfFileException &e) {
+				}
+			}
+		}
+		double seconds = secondsSince(start);
+		delete bufMgr;
+		std::cout << "scan " << std::left << std::setw(8) << scanNames[scan] << std::right
+			<< " pages=" << numPages[scan == 0 ? 0 : 1] << " records=" << (long)numKeys * searchRounds
+			<< " time=" << std::fixed << std::setprecision(3) << seconds << "s" << std::defaultfloat << std::endl;
+		if (sum != expected) {
+			std::cout << "sum " << sum << ", expected " << expected << std::endl;
+			ok = false;
+		}
+	}
+	removeFile(names[0]);
+	removeFile(names[1]);
+	return ok;
+}
+
+// -----------------------------------------------------------------------------
+// filteredScanBench
+// -----------------------------------------------------------------------------
+
+/*
+	Counts the records of a range of the integer field, at the selectivities of heapFetchBench, searchRounds
+	times through a buffer pool that holds the whole relation: once fetching every record from FileScan and
+	testing it, and once with the range pushed into FileScan as its predicate.
+*/
+static bool filteredScanBench(int numKeys)
+{
+	createRandomRelation(numKeys);
+	int numPages;
+	{
+		PageFile relation = PageFile::open(relationName);
+		numPages = relation.getNumPages();
+	}
+	BufMgr* bufMgr = new BufMgr(numPages + 1);
+	bool ok = true;
+	for (size_t s = 0; s < sizeof(selectivities) / sizeof(selectivities[0]); s++) {
+		int width = (int)(numKeys * selectivities[s]);
+		int low = numKeys / 3;
+		int high = low + width - 1;
+		long counts[2] = {0, 0};
+		double seconds[2];
+		for (int pushed = 0; pushed < 2; pushed++) {
+			Clock::time_point start = Clock::now();
+			for (int round = 0; round < searchRounds; round++) {
+				FileScan fscan(relationName, bufMgr);
+				if (pushed) {
+					fscan.setPredicate(offsetof(BenchRecord, i), INTEGER, &low, GTE, &high, LTE);
+				}
+				try {
+					RecordId rid;
+					while (true) {
+						fscan.scanNext(rid);
+						if (pushed) {
+							counts[pushed]++;
+							continue;
+						}
+						std::string data = fscan.getRecord();
+						int key = *reinterpret_cast<const int*>(data.data() + offsetof(BenchRecord, i));
+						if (key >= low && key <= high) {
+							counts[pushed]++;
+						}
+					}
+				} catch (const EndOfFileException &e) {
+				}
+			}
+			seconds[pushed] = secondsSince(start);
+		}
+		std::cout << "filter   selectivity=" << std::setprecision(3) << selectivities[s]
+			<< " records=" << counts[1] << std::fixed << std::setprecision(3)
+			<< " fetch=" << seconds[0] << "s pushed=" << seconds[1] << "s"
+			<< (RangeFilter::avx2Supported() ? " avx2" : "") << std::defaultfloat << std::endl;
+		if (counts[0] != counts[1] || counts[1] != (long)width * searchRounds) {
+			std::cout << "pushed scan found " << counts[1] << ", fetching " << counts[0] << ", expected "
+				<< (long)width * searchRounds << std::endl;
+			ok = false;
+		}
+	}
+	delete bufMgr;
+	removeFile(relationName);
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	int numKeys = argc > 1 ? atoi(argv[1]) : 200000;
+	bool ok = true;
+	for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+		ok = concurrencyBench(threadCounts[i], numKeys) && ok;
+	}
+	ok = heapFetchBench(numKeys) && ok;
+	ok = insertBufferBench(numKeys) && ok;
+	ok = searchLayoutBench(numKeys) && ok;
+	ok = learnedModelBench(numKeys) && ok;
+	ok = writeAheadLogBench(numKeys) && ok;
+	ok = pageChecksumBench(numKeys) && ok;
+	ok = compressedFileBench(numKeys) && ok;
+	ok = paxScanBench(numKeys) && ok;
+	ok = filteredScanBench(numKeys) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "bitmapscan.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+namespace badgerdb {
+
+/*
+	Order of RecordIds in the relation: by page, then by slot within the page.
+*/
+static bool heapOrder(const RecordId& a, const RecordId& b)
+{
+  if (a.page_number != b.page_number)
+  {
+    return a.page_number < b.page_number;
+  }
+  return a.slot_number < b.slot_number;
+}
+
+BitmapHeapScan::BitmapHeapScan(const std::string &name, BufMgr *bufferMgr, BTreeIndex *index,
+                               const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp)
+{
+  // collect the whole range first, on a cursor of its own so the built-in scan of the index stays free
+  IndexScanCursor* cursor = NULL;
+  try
+  {
+    cursor = index->openScan(lowVal, lowOp, highVal, highOp);
+  }
+  catch(const NoSuchKeyFoundException &e)
+  {
+    // nothing in the range
+  }
+  if (cursor != NULL)
+  {
+    const int batchSize = 256;
+    RecordId batch[batchSize];
+    int got;
+    do
+    {
+      got = cursor->scanNextBatch(batch, batchSize);
+      rids.insert(rids.end(), batch, batch + got);
+    } while (got == batchSize);
+    delete cursor;
+  }
+  std::sort(rids.begin(), rids.end(), heapOrder);
+
+  file = new PageFile(name, false);	//dont create new file
+	bufMgr = bufferMgr;
+  nextRid = 0;
+  curPage = NULL;
+  curPageNo = Page::INVALID_NUMBER;
+  pagesRead = 0;
+}
+
+BitmapHeapScan::~BitmapHeapScan()
+{
+  // unpin the page of the last record returned, unless the scan ran off the end
+  if (curPage != NULL)
+  {
+    bufMgr->unPinPage(file, curPageNo, false);
+    curPage = NULL;
+  }
+  bufMgr->flushFile(file);
+  delete file;
+}
+
+void BitmapHeapScan::scanNext(RecordId& outRid)
+{
+  if (nextRid == rids.size())
+  {
+    if (curPage != NULL)
+    {
+      bufMgr->unPinPage(file, curPageNo, false);
+      curPage = NULL;
+    }
+		throw EndOfFileException();
+  }
+
+  // the records of a page come one after the other, so each page is read once
+  const RecordId& rid = rids[nextRid++];
+  if (curPage == NULL || rid.page_number != curPageNo)
+  {
+    if (curPage != NULL)
+    {
+      bufMgr->unPinPage(file, curPageNo, false);
+      curPage = NULL;
+    }
+    bufMgr->readPage(file, rid.page_number, curPage);
+    curPageNo = rid.page_number;
+    pagesRead++;
+  }
+	outRid = rid;
+}
+
+std::string BitmapHeapScan::getRecord()
+{
+  return curPage->getRecord(rids[nextRid - 1]);
+}
+
+int BitmapHeapScan::getNumRecords() const
+{
+  return rids.size();
+}
+
+int BitmapHeapScan::getPagesRead() const
+{
+  return pagesRead;
+}
+
+}
@@ -0,0 +1,111 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "types.h"
+#include "page.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb {
+
+/**
+ * @brief This class is used to fetch the records of an index range scan in the order they are stored in the relation.
+ *
+ * An index range scan returns RecordIds in key order. In a relation not clustered on the key, fetching the records
+ * in that order hops between heap pages and reads the same page again every time one of its records comes up.
+ * A bitmap heap scan first collects all RecordIds of the range from the index and sorts them by page and slot, then
+ * reads every heap page holding a match once, returning its matching records before moving on to the next page.
+ */
+class BitmapHeapScan
+{
+ public:
+
+  /**
+   * Collect the RecordIds of every index entry in the range and open the relation. The bounds and operators are
+   * those of BTreeIndex::openScan; an empty range makes an empty scan.
+   *
+   * @param name      Name of the relation the index is built on
+   * @param bufMgr    Buffer Manager instance the heap pages are read through
+   * @param index     Index over the relation
+   * @param lowVal    Low value of the range, pointer to integer / double / char string
+   * @param lowOp     Low operator (GT/GTE)
+   * @param highVal   High value of the range, pointer to integer / double / char string
+   * @param highOp    High operator (LT/LTE)
+   * @throws BadOpcodesException     If lowOp and highOp do not contain one of their valid values
+   * @throws BadScanrangeException   If lowVal > highval
+   */
+  BitmapHeapScan(const std::string &name, BufMgr *bufMgr, BTreeIndex *index,
+                 const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  ~BitmapHeapScan();
+
+  /**
+   * Fetch the RecordId of the next matching record, in page and slot order.
+   *
+   * @param outRid  RecordId of the next record returned in this
+   * @throws EndOfFileException  If every matching record has been returned
+   */
+  void scanNext(RecordId& outRid);
+
+  /**
+   * Read the record scanNext returned last. Its page stays pinned until the scan moves past it.
+   */
+  std::string getRecord();
+
+  /**
+   * Get the number of matching records, known once the scan is constructed.
+   */
+  int getNumRecords() const;
+
+  /**
+   * Get the number of heap pages the scan has read so far. Every page is read once.
+   */
+  int getPagesRead() const;
+
+ private:
+  /**
+   * File which is being scanned.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read pages into the buffer pool.
+   */
+  BufMgr        *bufMgr;
+
+  /**
+   * RecordIds of the matching records, sorted by page number and then slot number.
+   */
+  std::vector<RecordId> rids;
+
+  /**
+   * Position in rids of the record scanNext returns next.
+   */
+  size_t        nextRid;
+
+  /**
+   * Page holding the record returned last, pinned, or NULL before the first record and after the last one.
+   */
+  Page*         curPage;
+
+  /**
+   * Page number of curPage.
+   */
+  PageId        curPageNo;
+
+  /**
+   * Number of heap pages read so far.
+   */
+  int           pagesRead;
+};
+
+}
@@ -0,0 +1,196 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+/**
+ * @brief Blocked Bloom filter over the keys of one index.
+ *
+ * A probe for a key that is not in the index still costs a descent and a leaf read. The filter answers
+ * most of those probes from memory: a key it says is absent is certainly absent, while a key it lets
+ * through may still turn out to be missing. Keys are never removed, so deleted keys keep letting probes
+ * through until the filter is built again.
+ *
+ * Each key sets PROBES bits inside one block of 512 bits, a cache line, chosen by its hash, so a probe
+ * touches a single cache line. Bits are set with atomic operations; adding keys and probing may go on
+ * from several threads at once. Resizing may not.
+ */
+class BloomFilter {
+ public:
+  /**
+   * Number of bytes in a block.
+   */
+  static const int BLOCK_BYTES = 64;
+
+  /**
+   * Number of bits a key sets in its block.
+   */
+  static const int PROBES = 7;
+
+  /**
+   * Constructs a filter without blocks, which lets every key through.
+   */
+  BloomFilter()
+      : words_(nullptr),
+        blocks_(0) {
+  }
+
+  ~BloomFilter() {
+    delete [] words_;
+  }
+
+  /**
+   * Drops all keys and resizes the filter. Must not be called while other threads use it.
+   *
+   * @param blocks  Number of blocks, 0 to let every key through
+   */
+  void reset(const std::uint32_t blocks) {
+    delete [] words_;
+    words_ = nullptr;
+    blocks_ = blocks;
+    if (blocks > 0) {
+      words_ = new std::atomic<std::uint64_t>[blocks * WORDS_PER_BLOCK];
+      for (std::uint32_t i = 0; i < blocks * WORDS_PER_BLOCK; i++) {
+        words_[i].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Returns the number of blocks, 0 if the filter lets every key through.
+   */
+  std::uint32_t numBlocks() const {
+    return blocks_;
+  }
+
+  /**
+   * Adds a key.
+   *
+   * @param hash  Hash of the key, see hash
+   */
+  void add(const std::uint64_t hash) {
+    if (blocks_ == 0) {
+      return;
+    }
+    std::atomic<std::uint64_t>* block = words_ + blockOf(hash) * WORDS_PER_BLOCK;
+    std::uint32_t bit = (std::uint32_t)hash;
+    std::uint32_t step = stepOf(hash);
+    for (int i = 0; i < PROBES; i++, bit += step) {
+      block[(bit % 512) / 64].fetch_or(std::uint64_t(1) << (bit % 64), std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Checks whether a key may have been added.
+   *
+   * @param hash  Hash of the key, see hash
+   * @return  False if the key was certainly never added, true if it may have been or the filter has no blocks.
+   */
+  bool mayContain(const std::uint64_t hash) const {
+    if (blocks_ == 0) {
+      return true;
+    }
+    const std::atomic<std::uint64_t>* block = words_ + blockOf(hash) * WORDS_PER_BLOCK;
+    std::uint32_t bit = (std::uint32_t)hash;
+    std::uint32_t step = stepOf(hash);
+    for (int i = 0; i < PROBES; i++, bit += step) {
+      if ((block[(bit % 512) / 64].load(std::memory_order_relaxed) & (std::uint64_t(1) << (bit % 64))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Copies blocks out of the filter, to be written to a page.
+   *
+   * @param first  First block to copy
+   * @param count  Number of blocks
+   * @param out    count * BLOCK_BYTES bytes the blocks are copied to
+   */
+  void readBlocks(const std::uint32_t first, const std::uint32_t count, char* out) const {
+    for (std::uint32_t i = 0; i < count * WORDS_PER_BLOCK; i++) {
+      std::uint64_t word = words_[first * WORDS_PER_BLOCK + i].load(std::memory_order_relaxed);
+      std::memcpy(out + i * sizeof(word), &word, sizeof(word));
+    }
+  }
+
+  /**
+   * Copies blocks into the filter, as read from a page. Must not be called while other threads use it.
+   *
+   * @param first  First block to copy
+   * @param count  Number of blocks
+   * @param in     count * BLOCK_BYTES bytes the blocks are copied from
+   */
+  void writeBlocks(const std::uint32_t first, const std::uint32_t count, const char* in) {
+    for (std::uint32_t i = 0; i < count * WORDS_PER_BLOCK; i++) {
+      std::uint64_t word;
+      std::memcpy(&word, in + i * sizeof(word), sizeof(word));
+      words_[first * WORDS_PER_BLOCK + i].store(word, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Hashes the bytes of a key: FNV-1a, with the bits mixed afterwards so that keys differing only in their
+   * last bytes still spread over all blocks.
+   *
+   * @param data    Key bytes
+   * @param length  Number of bytes
+   */
+  static std::uint64_t hash(const void* data, const std::size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    std::uint64_t h = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < length; i++) {
+      h = (h ^ bytes[i]) * 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+ private:
+  /**
+   * Number of 64-bit words in a block.
+   */
+  static const std::uint32_t WORDS_PER_BLOCK = BLOCK_BYTES / sizeof(std::uint64_t);
+
+  /**
+   * Block of a key: the high half of its hash scaled to the number of blocks.
+   */
+  std::uint32_t blockOf(const std::uint64_t hash) const {
+    return (std::uint32_t)(((hash >> 32) * blocks_) >> 32);
+  }
+
+  /**
+   * Distance between the bits a key sets, odd so that they differ.
+   */
+  static std::uint32_t stepOf(const std::uint64_t hash) {
+    return (std::uint32_t)(hash >> 17) | 1;
+  }
+
+  /**
+   * Bits of the filter, blocks_ * WORDS_PER_BLOCK words.
+   */
+  std::atomic<std::uint64_t>* words_;
+
+  /**
+   * Number of blocks.
+   */
+  std::uint32_t blocks_;
+};
+
+}
@@ -17,6 +17,9 @@
 #include "exceptions/end_of_file_exception.h"
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/page_pinned_exception.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 
 //#define DEBUG
@@ -24,965 +27,4916 @@
 namespace badgerdb
 {
 
+// -----------------------------------------------------------------------------
+// STRING key helpers
+// -----------------------------------------------------------------------------
+
+/*
+	Cut an attribute value or scan bound down to the key stored in the tree: stop at the first NUL
+	or after STRINGSIZE bytes and drop trailing blanks, so space padded CHAR values compare as expected.
+*/
+static std::string makeStringKey(const char* value)
+{
+	size_t len = strnlen(value, STRINGSIZE);
+	while (len > 0 && value[len - 1] == ' ') {
+		len--;
+	}
+	return std::string(value, len);
+}
+
+/*
+	Number of leading bytes a and b have in common.
+*/
+static int commonPrefixLength(const std::string& a, const std::string& b)
+{
+	size_t n = std::min(a.size(), b.size());
+	size_t i = 0;
+	while (i < n && a[i] == b[i]) {
+		i++;
+	}
+	return (int)i;
+}
+
+/*
+	Shortest separator s with left < s <= right, ie. right cut just after the first byte where it
+	differs from left. If a run of duplicates straddles the split (left == right) no such string
+	exists and right itself is used.
+*/
+static std::string shortestSeparator(const std::string& left, const std::string& right)
+{
+	int common = commonPrefixLength(left, right);
+	if (common >= (int)right.size()) {
+		return right;
+	}
+	return right.substr(0, common + 1);
+}
+
+/*
+	Compare the key made of prefix[0, prefixLength) followed by suffix[0, suffixLength) with key,
+	without putting the stored key back together. Returns <0, 0 or >0 like memcmp.
+*/
+static int compareStoredKey(const char* prefix, int prefixLength, const char* suffix, int suffixLength, const std::string& key)
+{
+	int keyLength = (int)key.size();
+	int cmp = memcmp(prefix, key.data(), std::min(prefixLength, keyLength));
+	if (cmp != 0) {
+		return cmp;
+	}
+	if (keyLength < prefixLength) {
+		return 1;
+	}
+	int rest = keyLength - prefixLength;
+	cmp = memcmp(suffix, key.data() + prefixLength, std::min(suffixLength, rest));
+	if (cmp != 0) {
+		return cmp;
+	}
+	return suffixLength - rest;
+}
+
+static std::uint16_t* slotArray(char* data)
+{
+	return reinterpret_cast<std::uint16_t*>(data);
+}
+
+static const std::uint16_t* slotArray(const char* data)
+{
+	return reinterpret_cast<const std::uint16_t*>(data);
+}
+
+static void initLeafString(LeafNodeString* node)
+{
+	node->numKeys = 0;
+	node->prefixLength = 0;
+	node->heapOffset = STRINGLEAFDATASIZE;
+	node->rightSibPageNo = Page::INVALID_NUMBER;
+	node->leftSibPageNo = Page::INVALID_NUMBER;
+}
+
+static void initNonLeafString(NonLeafNodeString* node, int level, PageId leftmostPageNo)
+{
+	node->level = level;
+	node->numKeys = 0;
+	node->prefixLength = 0;
+	node->heapOffset = STRINGNONLEAFDATASIZE;
+	node->leftmostPageNo = leftmostPageNo;
+}
+
+static int compareLeafStringKey(const LeafNodeString* node, int i, const std::string& key)
+{
+	const char* entry = node->data + slotArray(node->data)[i];
+	return compareStoredKey(node->prefix, node->prefixLength, entry + 1, (std::uint8_t)entry[0], key);
+}
+
+static std::string leafStringKey(const LeafNodeString* node, int i)
+{
+	const char* entry = node->data + slotArray(node->data)[i];
+	return std::string(node->prefix, node->prefixLength) + std::string(entry + 1, (std::uint8_t)entry[0]);
+}
+
+static RecordId leafStringRid(const LeafNodeString* node, int i)
+{
+	const char* entry = node->data + slotArray(node->data)[i];
+	RecordId rid;
+	memcpy(&rid, entry + 1 + (std::uint8_t)entry[0], sizeof(RecordId));
+	return rid;
+}
+
+static int compareNonLeafStringKey(const NonLeafNodeString* node, int i, const std::string& key)
+{
+	const char* entry = node->data + slotArray(node->data)[i];
+	return compareStoredKey(node->prefix, node->prefixLength, entry + 1, (std::uint8_t)entry[0], key);
+}
+
+/*
+	Page number of child i, where child 0 is left of the first separator and child i (i > 0) is
+	stored in the entry of separator i-1.
+*/
+static PageId nonLeafStringChild(const NonLeafNodeString* node, int i)
+{
+	if (i == 0) {
+		return node->leftmostPageNo;
+	}
+	const char* entry = node->data + slotArray(node->data)[i - 1];
+	PageId pageNo;
+	memcpy(&pageNo, entry + 1 + (std::uint8_t)entry[0], sizeof(PageId));
+	return pageNo;
+}
+
+/*
+	Index of the first key in the leaf that is >= key, or > key when strict is set.
+	Returns numKeys if there is none.
+*/
+static int leafStringLowerBound(const LeafNodeString* node, const std::string& key, bool strict)
+{
+	int lo = 0;
+	int hi = node->numKeys;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		int cmp = compareLeafStringKey(node, mid, key);
+		if (cmp < 0 || (strict && cmp == 0)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+	Index of the child to follow for key: the first child whose separator is >= key. Going left on
+	equality finds the leftmost copy of a duplicated key; scans then walk right along the leaves.
+*/
+static int nonLeafStringChildIndex(const NonLeafNodeString* node, const std::string& key)
+{
+	int lo = 0;
+	int hi = node->numKeys;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (compareNonLeafStringKey(node, mid, key) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static void readLeafString(const LeafNodeString* node, std::vector<RIDKeyPair<std::string> >& entries)
+{
+	entries.resize(node->numKeys);
+	for (int i = 0; i < node->numKeys; i++) {
+		entries[i].set(leafStringRid(node, i), leafStringKey(node, i));
+	}
+}
+
+static void readNonLeafString(const NonLeafNodeString* node, std::vector<PageKeyPair<std::string> >& entries)
+{
+	entries.resize(node->numKeys);
+	for (int i = 0; i < node->numKeys; i++) {
+		const char* entry = node->data + slotArray(node->data)[i];
+		std::string key = std::string(node->prefix, node->prefixLength) + std::string(entry + 1, (std::uint8_t)entry[0]);
+		entries[i].set(nonLeafStringChild(node, i + 1), key);
+	}
+}
+
+/*
+	Rebuild a leaf from the sorted entries[begin, end), recomputing the page prefix. Since the entries
+	are sorted the prefix shared by all of them is the one shared by the first and the last.
+	Returns false, leaving the node untouched, if they do not fit on one page.
+*/
+static bool writeLeafString(LeafNodeString* node, const std::vector<RIDKeyPair<std::string> >& entries, int begin, int end)
+{
+	int prefixLength = 0;
+	if (end > begin) {
+		prefixLength = commonPrefixLength(entries[begin].key, entries[end - 1].key);
+	}
+	int bytes = 0;
+	for (int i = begin; i < end; i++) {
+		bytes += sizeof(std::uint16_t) + 1 + entries[i].key.size() - prefixLength + sizeof(RecordId);
+	}
+	if (bytes > STRINGLEAFDATASIZE) {
+		return false;
+	}
+
+	node->numKeys = end - begin;
+	node->prefixLength = prefixLength;
+	if (end > begin) {
+		memcpy(node->prefix, entries[begin].key.data(), prefixLength);
+	}
+	int heap = STRINGLEAFDATASIZE;
+	for (int i = begin; i < end; i++) {
+		int suffixLength = entries[i].key.size() - prefixLength;
+		heap -= 1 + suffixLength + sizeof(RecordId);
+		node->data[heap] = (char)suffixLength;
+		memcpy(node->data + heap + 1, entries[i].key.data() + prefixLength, suffixLength);
+		memcpy(node->data + heap + 1 + suffixLength, &entries[i].rid, sizeof(RecordId));
+		slotArray(node->data)[i - begin] = heap;
+	}
+	node->heapOffset = heap;
+	return true;
+}
+
+/*
+	Rebuild a non-leaf from leftmostPageNo and the sorted separators entries[begin, end).
+	Returns false, leaving the node untouched, if they do not fit on one page.
+*/
+static bool writeNonLeafString(NonLeafNodeString* node, PageId leftmostPageNo, const std::vector<PageKeyPair<std::string> >& entries, int begin, int end)
+{
+	int prefixLength = 0;
+	if (end > begin) {
+		prefixLength = commonPrefixLength(entries[begin].key, entries[end - 1].key);
+	}
+	int bytes = 0;
+	for (int i = begin; i < end; i++) {
+		bytes += sizeof(std::uint16_t) + 1 + entries[i].key.size() - prefixLength + sizeof(PageId);
+	}
+	if (bytes > STRINGNONLEAFDATASIZE) {
+		return false;
+	}
+
+	node->numKeys = end - begin;
+	node->prefixLength = prefixLength;
+	node->leftmostPageNo = leftmostPageNo;
+	if (end > begin) {
+		memcpy(node->prefix, entries[begin].key.data(), prefixLength);
+	}
+	int heap = STRINGNONLEAFDATASIZE;
+	for (int i = begin; i < end; i++) {
+		int suffixLength = entries[i].key.size() - prefixLength;
+		heap -= 1 + suffixLength + sizeof(PageId);
+		node->data[heap] = (char)suffixLength;
+		memcpy(node->data + heap + 1, entries[i].key.data() + prefixLength, suffixLength);
+		memcpy(node->data + heap + 1 + suffixLength, &entries[i].pageNo, sizeof(PageId));
+		slotArray(node->data)[i - begin] = heap;
+	}
+	node->heapOffset = heap;
+	return true;
+}
+
+/*
+	Add one entry to the heap of a node and put its slot at position pos, without rebuilding the page.
+	Only possible when the key starts with the page prefix and there is room for the slot and the entry;
+	returns false otherwise so the caller can rebuild (and possibly split) the node.
+*/
+static bool insertStringEntry(char* data, int& numKeys, int& heapOffset, const char* prefix, int prefixLength,
+		const std::string& key, const void* value, int valueSize, int pos)
+{
+	if (numKeys == 0 || (int)key.size() < prefixLength || memcmp(key.data(), prefix, prefixLength) != 0) {
+		return false;
+	}
+	int suffixLength = key.size() - prefixLength;
+	int entrySize = 1 + suffixLength + valueSize;
+	if (heapOffset - entrySize < (int)((numKeys + 1) * sizeof(std::uint16_t))) {
+		return false;
+	}
+	heapOffset -= entrySize;
+	data[heapOffset] = (char)suffixLength;
+	memcpy(data + heapOffset + 1, key.data() + prefixLength, suffixLength);
+	memcpy(data + heapOffset + 1 + suffixLength, value, valueSize);
+
+	std::uint16_t* slots = slotArray(data);
+	memmove(slots + pos + 1, slots + pos, (numKeys - pos) * sizeof(std::uint16_t));
+	slots[pos] = heapOffset;
+	numKeys++;
+	return true;
+}
+
+/*
+	Where to split an overflowing STRING node: the first entry at which the encoded bytes to its left
+	reach half of the total. The entry returned is never the first one, so both halves are non-empty.
+*/
+template <class T>
+static int splitPoint(const std::vector<T>& entries)
+{
+	int n = entries.size();
+	size_t total = 0;
+	for (int i = 0; i < n; i++) {
+		total += entries[i].key.size() + sizeof(std::uint16_t) + 1 + sizeof(RecordId);
+	}
+	size_t left = 0;
+	for (int i = 0; i < n - 1; i++) {
+		left += entries[i].key.size() + sizeof(std::uint16_t) + 1 + sizeof(RecordId);
+		if (2 * left >= total) {
+			return i + 1;
+		}
+	}
+	return n - 1;
+}
+
+// -----------------------------------------------------------------------------
+// INTEGER key helpers
+// -----------------------------------------------------------------------------
+
+/*
+	Used key slots of INTEGER nodes form a prefix of keyArray and the rest hold MYNULL, so the
+	number of keys is the first MYNULL slot.
+*/
+static int countKeys(const int* keyArray, int size)
+{
+	int lo = 0;
+	int hi = size;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (keyArray[mid] != MYNULL) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+	Index of the first of the numKeys keys that is >= key, or > key when strict is set.
+	Returns numKeys if there is none.
+*/
+static int intLowerBound(const int* keyArray, int numKeys, int key, bool strict)
+{
+	int lo = 0;
+	int hi = numKeys;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (keyArray[mid] < key || (strict && keyArray[mid] == key)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+	Where to split n sorted INTEGER leaf keys so that no key ends up on both sides: the boundary between
+	two different keys nearest to middle. Returns middle if all keys are equal.
+*/
+static int intSplitPoint(const int* keys, int n, int middle)
+{
+	for (int distance = 0; distance < n; distance++) {
+		int below = middle - distance;
+		if (below > 0 && below < n && keys[below - 1] != keys[below]) {
+			return below;
+		}
+		int above = middle + distance;
+		if (above > 0 && above < n && keys[above - 1] != keys[above]) {
+			return above;
+		}
+	}
+	return middle;
+}
+
+static void initLeafInt(LeafNodeInt* node)
+{
+	for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
+		node->keyArray[i] = MYNULL;
+	}
+	node->rightSibPageNo = Page::INVALID_NUMBER;
+	node->leftSibPageNo = Page::INVALID_NUMBER;
+}
+
+static void initNonLeafInt(NonLeafNodeInt* node, int level, PageId leftmostPageNo)
+{
+	node->level = level;
+	for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
+		node->keyArray[i] = MYNULL;
+		node->pageNoArray[i + 1] = Page::INVALID_NUMBER;
+		node->countArray[i + 1] = 0;
+	}
+	node->pageNoArray[0] = leftmostPageNo;
+	node->countArray[0] = 0;
+}
+
+/*
+	Entry count of child i of a non-leaf. Inserts and deletes that do not split or merge adjust counts
+	under a shared latch, so they are read and changed atomically.
+*/
+static int loadCountInt(const NonLeafNodeInt* node, int i)
+{
+	return __atomic_load_n(&node->countArray[i], __ATOMIC_RELAXED);
+}
+
+/*
+	Number of entries below a non-leaf, the sum of the counts of its children.
+*/
+static long sumCountsInt(const NonLeafNodeInt* node)
+{
+	int numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+	long total = 0;
+	for (int i = 0; i <= numKeys; i++) {
+		total += loadCountInt(node, i);
+	}
+	return total;
+}
+
+/*
+	Number of entries an INTEGER leaf holds when each carries payloadSize bytes of included columns:
+	RecordIds and payloads share ridArray.
+*/
+static int leafCapacityInt(int payloadSize)
+{
+	return INTARRAYLEAFSIZE * sizeof(RecordId) / (sizeof(RecordId) + payloadSize);
+}
+
+/*
+	Payload of entry i of a leaf. The payloads follow each other in entry order right after the
+	RecordIds of a full leaf.
+*/
+static char* leafPayload(LeafNodeInt* node, int payloadSize, int i)
+{
+	return (char*)(node->ridArray + leafCapacityInt(payloadSize)) + i * payloadSize;
+}
+
+/*
+	Put (key, rid) and its payload at position pos of a leaf that has room for it.
+*/
+static void insertLeafInt(LeafNodeInt* node, int numKeys, int pos, int key, const RecordId& rid, const char* payload,
+		int payloadSize)
+{
+	memmove(node->keyArray + pos + 1, node->keyArray + pos, (numKeys - pos) * sizeof(int));
+	memmove(node->ridArray + pos + 1, node->ridArray + pos, (numKeys - pos) * sizeof(RecordId));
+	memmove(leafPayload(node, payloadSize, pos + 1), leafPayload(node, payloadSize, pos), (numKeys - pos) * payloadSize);
+	node->keyArray[pos] = key;
+	node->ridArray[pos] = rid;
+	memcpy(leafPayload(node, payloadSize, pos), payload, payloadSize);
+}
+
+/*
+	Remove the entry at position pos of a leaf holding numKeys entries.
+*/
+static void removeLeafInt(LeafNodeInt* node, int numKeys, int pos, int payloadSize)
+{
+	memmove(node->keyArray + pos, node->keyArray + pos + 1, (numKeys - pos - 1) * sizeof(int));
+	memmove(node->ridArray + pos, node->ridArray + pos + 1, (numKeys - pos - 1) * sizeof(RecordId));
+	memmove(leafPayload(node, payloadSize, pos), leafPayload(node, payloadSize, pos + 1), (numKeys - pos - 1) * payloadSize);
+	node->keyArray[numKeys - 1] = MYNULL;
+}
+
+/*
+	Remove key pos and the child right of it from a non-leaf holding numKeys keys.
+*/
+static void removeNonLeafInt(NonLeafNodeInt* node, int numKeys, int pos)
+{
+	memmove(node->keyArray + pos, node->keyArray + pos + 1, (numKeys - pos - 1) * sizeof(int));
+	memmove(node->pageNoArray + pos + 1, node->pageNoArray + pos + 2, (numKeys - pos - 1) * sizeof(PageId));
+	memmove(node->countArray + pos + 1, node->countArray + pos + 2, (numKeys - pos - 1) * sizeof(int));
+	node->keyArray[numKeys - 1] = MYNULL;
+	node->pageNoArray[numKeys] = Page::INVALID_NUMBER;
+	node->countArray[numKeys] = 0;
+}
+
+/*
+	Even out the leaves left and right, children sep and sep + 1 of parent, after a delete left one of them
+	underfull: merge them into left if all entries fit, otherwise share the entries evenly between them.
+	Returns true if they were merged; right is then empty and no longer in the tree.
+*/
+static bool rebalanceLeafInt(NonLeafNodeInt* parent, int sep, LeafNodeInt* left, LeafNodeInt* right, int payloadSize)
+{
+	int numLeft = countKeys(left->keyArray, INTARRAYLEAFSIZE);
+	int numRight = countKeys(right->keyArray, INTARRAYLEAFSIZE);
+	int total = numLeft + numRight;
+	if (total <= leafCapacityInt(payloadSize)) {
+		memcpy(left->keyArray + numLeft, right->keyArray, numRight * sizeof(int));
+		memcpy(left->ridArray + numLeft, right->ridArray, numRight * sizeof(RecordId));
+		memcpy(leafPayload(left, payloadSize, numLeft), leafPayload(right, payloadSize, 0), numRight * payloadSize);
+		left->rightSibPageNo = right->rightSibPageNo;
+		initLeafInt(right);
+		removeNonLeafInt(parent, countKeys(parent->keyArray, INTARRAYNONLEAFSIZE), sep);
+		return true;
+	}
+
+	// no key may end up on both leaves
+	std::vector<int> keys(left->keyArray, left->keyArray + numLeft);
+	keys.insert(keys.end(), right->keyArray, right->keyArray + numRight);
+	int middle = intSplitPoint(keys.data(), total, total / 2);
+	if (numLeft < middle) {
+		// move the first entries of right to the end of left
+		int move = middle - numLeft;
+		memcpy(left->keyArray + numLeft, right->keyArray, move * sizeof(int));
+		memcpy(left->ridArray + numLeft, right->ridArray, move * sizeof(RecordId));
+		memcpy(leafPayload(left, payloadSize, numLeft), leafPayload(right, payloadSize, 0), move * payloadSize);
+		memmove(right->keyArray, right->keyArray + move, (numRight - move) * sizeof(int));
+		memmove(right->ridArray, right->ridArray + move, (numRight - move) * sizeof(RecordId));
+		memmove(leafPayload(right, payloadSize, 0), leafPayload(right, payloadSize, move), (numRight - move) * payloadSize);
+		for (int i = numRight - move; i < numRight; i++) {
+			right->keyArray[i] = MYNULL;
+		}
+	} else {
+		// move the last entries of left to the front of right
+		int move = numLeft - middle;
+		memmove(right->keyArray + move, right->keyArray, numRight * sizeof(int));
+		memmove(right->ridArray + move, right->ridArray, numRight * sizeof(RecordId));
+		memmove(leafPayload(right, payloadSize, move), leafPayload(right, payloadSize, 0), numRight * payloadSize);
+		memcpy(right->keyArray, left->keyArray + middle, move * sizeof(int));
+		memcpy(right->ridArray, left->ridArray + middle, move * sizeof(RecordId));
+		memcpy(leafPayload(right, payloadSize, 0), leafPayload(left, payloadSize, middle), move * payloadSize);
+		for (int i = middle; i < numLeft; i++) {
+			left->keyArray[i] = MYNULL;
+		}
+	}
+	parent->keyArray[sep] = left->keyArray[middle - 1];
+	return false;
+}
+
+/*
+	Non-leaf counterpart of rebalanceLeafInt. The separator in parent moves down between the keys of the
+	two nodes, and when they are evened out the middle key of all of them moves up in its place.
+*/
+static bool rebalanceNonLeafInt(NonLeafNodeInt* parent, int sep, NonLeafNodeInt* left, NonLeafNodeInt* right)
+{
+	int numLeft = countKeys(left->keyArray, INTARRAYNONLEAFSIZE);
+	int numRight = countKeys(right->keyArray, INTARRAYNONLEAFSIZE);
+	std::vector<int> keys(left->keyArray, left->keyArray + numLeft);
+	keys.push_back(parent->keyArray[sep]);
+	keys.insert(keys.end(), right->keyArray, right->keyArray + numRight);
+	std::vector<PageId> children(left->pageNoArray, left->pageNoArray + numLeft + 1);
+	children.insert(children.end(), right->pageNoArray, right->pageNoArray + numRight + 1);
+	std::vector<int> counts(left->countArray, left->countArray + numLeft + 1);
+	counts.insert(counts.end(), right->countArray, right->countArray + numRight + 1);
+	int total = keys.size();
+	if (total <= INTARRAYNONLEAFSIZE) {
+		for (int i = numLeft; i < total; i++) {
+			left->keyArray[i] = keys[i];
+			left->pageNoArray[i + 1] = children[i + 1];
+			left->countArray[i + 1] = counts[i + 1];
+		}
+		initNonLeafInt(right, right->level, Page::INVALID_NUMBER);
+		removeNonLeafInt(parent, countKeys(parent->keyArray, INTARRAYNONLEAFSIZE), sep);
+		return true;
+	}
+
+	int middle = total / 2;
+	initNonLeafInt(left, left->level, children[0]);
+	left->countArray[0] = counts[0];
+	for (int i = 0; i < middle; i++) {
+		left->keyArray[i] = keys[i];
+		left->pageNoArray[i + 1] = children[i + 1];
+		left->countArray[i + 1] = counts[i + 1];
+	}
+	initNonLeafInt(right, right->level, children[middle + 1]);
+	right->countArray[0] = counts[middle + 1];
+	for (int i = middle + 1; i < total; i++) {
+		right->keyArray[i - middle - 1] = keys[i];
+		right->pageNoArray[i - middle] = children[i + 1];
+		right->countArray[i - middle] = counts[i + 1];
+	}
+	parent->keyArray[sep] = keys[middle];
+	return false;
+}
+
+/*
+	Position just after the entry (key, rid) in a STRING leaf, used by a scan to find its place again after
+	the leaf changed between two calls. found tells whether the entry is still on this leaf; if it is not,
+	the result is the first entry with a larger key, or numKeys.
+*/
+static int leafStringResume(const LeafNodeString* node, const std::string& key, const RecordId& rid, bool& found)
+{
+	int i = leafStringLowerBound(node, key, false);
+	for (; i < node->numKeys && compareLeafStringKey(node, i, key) == 0; i++) {
+		if (leafStringRid(node, i) == rid) {
+			found = true;
+			return i + 1;
+		}
+	}
+	found = false;
+	return i;
+}
+
+/*
+	True if any insert into the STRING node can be done without splitting it, even one that has to
+	rebuild the page because the new key does not share the page prefix.
+*/
+static bool stringNodeSafe(int numKeys, int prefixLength, int heapOffset, int dataSize, int valueSize)
+{
+	int used = numKeys * sizeof(std::uint16_t) + dataSize - heapOffset;
+	int worst = numKeys * prefixLength + sizeof(std::uint16_t) + 1 + STRINGSIZE + valueSize;
+	return used + worst <= dataSize;
+}
+
+/*
+	Bytes entry i of a STRING node takes up, its slot included.
+*/
+static int stringEntryBytes(const char* data, int i, int valueSize)
+{
+	return sizeof(std::uint16_t) + 1 + (std::uint8_t)data[slotArray(data)[i]] + valueSize;
+}
+
+/*
+	Bytes the numKeys entries of a STRING node take up. Space left in the heap by removed entries does
+	not count; it is reclaimed the next time the page is rebuilt.
+*/
+static int stringNodeBytes(const char* data, int numKeys, int valueSize)
+{
+	int bytes = 0;
+	for (int i = 0; i < numKeys; i++) {
+		bytes += stringEntryBytes(data, i, valueSize);
+	}
+	return bytes;
+}
+
+/*
+	Remove slot pos of a STRING node, leaving its entry in the heap. In a non-leaf this removes separator
+	pos and the child right of it.
+*/
+static void removeStringSlot(char* data, int& numKeys, int pos)
+{
+	std::uint16_t* slots = slotArray(data);
+	memmove(slots + pos, slots + pos + 1, (numKeys - pos - 1) * sizeof(std::uint16_t));
+	numKeys--;
+}
+
+/*
+	STRING counterpart of rebalanceLeafInt. When the leaves are evened out the separator in parent is
+	replaced by the shortest one between them; if that does not fit into parent nothing is changed.
+*/
+static bool rebalanceLeafString(NonLeafNodeString* parent, int sep, LeafNodeString* left, LeafNodeString* right)
+{
+	std::vector<RIDKeyPair<std::string> > entries;
+	std::vector<RIDKeyPair<std::string> > rightEntries;
+	readLeafString(left, entries);
+	readLeafString(right, rightEntries);
+	entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+	if (writeLeafString(left, entries, 0, entries.size())) {
+		left->rightSibPageNo = right->rightSibPageNo;
+		initLeafString(right);
+		removeStringSlot(parent->data, parent->numKeys, sep);
+		return true;
+	}
+
+	// lay out both halves and the new separator before anything is changed
+	int middle = splitPoint(entries);
+	LeafNodeString newLeft = *left;
+	LeafNodeString newRight = *right;
+	if (!writeLeafString(&newLeft, entries, 0, middle) || !writeLeafString(&newRight, entries, middle, entries.size())) {
+		return false;
+	}
+	std::vector<PageKeyPair<std::string> > separators;
+	readNonLeafString(parent, separators);
+	separators[sep].key = shortestSeparator(entries[middle - 1].key, entries[middle].key);
+	if (!writeNonLeafString(parent, parent->leftmostPageNo, separators, 0, separators.size())) {
+		return false;
+	}
+	*left = newLeft;
+	*right = newRight;
+	return false;
+}
+
+/*
+	STRING counterpart of rebalanceNonLeafInt, skipping a redistribution whose new separator does not fit
+	into parent like rebalanceLeafString.
+*/
+static bool rebalanceNonLeafString(NonLeafNodeString* parent, int sep, NonLeafNodeString* left, NonLeafNodeString* right)
+{
+	std::vector<PageKeyPair<std::string> > separators;
+	std::vector<PageKeyPair<std::string> > entries;
+	std::vector<PageKeyPair<std::string> > rightEntries;
+	readNonLeafString(parent, separators);
+	readNonLeafString(left, entries);
+	readNonLeafString(right, rightEntries);
+	PageKeyPair<std::string> down;
+	down.set(right->leftmostPageNo, separators[sep].key);
+	entries.push_back(down);
+	entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+	if (writeNonLeafString(left, left->leftmostPageNo, entries, 0, entries.size())) {
+		initNonLeafString(right, right->level, Page::INVALID_NUMBER);
+		removeStringSlot(parent->data, parent->numKeys, sep);
+		return true;
+	}
+
+	// entries[middle] moves up to the parent
+	int middle = splitPoint(entries);
+	NonLeafNodeString newLeft = *left;
+	NonLeafNodeString newRight = *right;
+	if (!writeNonLeafString(&newLeft, left->leftmostPageNo, entries, 0, middle)
+			|| !writeNonLeafString(&newRight, entries[middle].pageNo, entries, middle + 1, entries.size())) {
+		return false;
+	}
+	separators[sep].key = entries[middle].key;
+	if (!writeNonLeafString(parent, parent->leftmostPageNo, separators, 0, separators.size())) {
+		return false;
+	}
+	*left = newLeft;
+	*right = newRight;
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// Posting list helpers
+// -----------------------------------------------------------------------------
+
+static bool isPostingRid(const RecordId& rid)
+{
+	return rid.padding == POSTINGMARK;
+}
+
+/*
+	Order of RecordIds among the entries of one key, and the value posting lists encode.
+*/
+static std::uint64_t ridValue(const RecordId& rid)
+{
+	return ((std::uint64_t)rid.page_number << 16) | rid.slot_number;
+}
+
+/*
+	Place of the first RecordId of a posting list page, which is encoded against a RecordId of all zeros.
+*/
+static PostingPosition postingStart(PageId pageNo)
+{
+	PostingPosition position;
+	position.pageNo = pageNo;
+	position.next = 0;
+	position.offset = 0;
+	position.prev.page_number = 0;
+	position.prev.slot_number = 0;
+	position.prev.padding = 0;
+	return position;
+}
+
+static void initPosting(PostingNode* node)
+{
+	node->numRids = 0;
+	node->usedBytes = 0;
+	node->nextPageNo = Page::INVALID_NUMBER;
+	node->lastPageNo = Page::INVALID_NUMBER;
+	node->totalRids = 0;
+	node->lastRid = postingStart(Page::INVALID_NUMBER).prev;
+}
+
+/*
+	Append rid, which is not below any RecordId on the page, and its payload to a posting list page.
+	Returns false if the page has no room for them.
+*/
+static bool appendPostingRid(PostingNode* node, const RecordId& rid, const char* payload, int payloadSize)
+{
+	std::int64_t delta = (std::int64_t)(ridValue(rid) - ridValue(node->lastRid));
+	std::uint64_t zigzag = ((std::uint64_t)delta << 1) ^ (std::uint64_t)(delta >> 63);
+	char bytes[10];
+	int length = 0;
+	while (zigzag >= 0x80) {
+		bytes[length++] = (char)(zigzag | 0x80);
+		zigzag >>= 7;
+	}
+	bytes[length++] = (char)zigzag;
+	if (node->usedBytes + length + payloadSize > POSTINGDATASIZE) {
+		return false;
+	}
+	memcpy(node->data + node->usedBytes, bytes, length);
+	std::copy(payload, payload + payloadSize, node->data + node->usedBytes + length);
+	node->usedBytes += length + payloadSize;
+	node->numRids++;
+	node->lastRid = rid;
+	node->lastRid.padding = 0;
+	return true;
+}
+
+/*
+	Decode up to maxRids RecordIds of a posting list page into outRids, and their payloads into outPayloads
+	unless it is nullptr, starting at position, and move position past them. Returns their number.
+*/
+static int decodePostingRids(const PostingNode* node, PostingPosition& position, RecordId* outRids, char* outPayloads,
+		int maxRids, int payloadSize)
+{
+	std::uint64_t value = ridValue(position.prev);
+	int count = 0;
+	while (count < maxRids && position.next < node->numRids) {
+		std::uint64_t zigzag = 0;
+		int shift = 0;
+		unsigned char byte;
+		do {
+			byte = node->data[position.offset++];
+			zigzag |= (std::uint64_t)(byte & 0x7f) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+		value += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+		outRids[count].page_number = (PageId)(value >> 16);
+		outRids[count].slot_number = (SlotId)(value & 0xffff);
+		outRids[count].padding = 0;
+		if (outPayloads != nullptr) {
+			memcpy(outPayloads + count * payloadSize, node->data + position.offset, payloadSize);
+		}
+		position.offset += payloadSize;
+		count++;
+		position.next++;
+	}
+	if (count > 0) {
+		position.prev = outRids[count - 1];
+	}
+	return count;
+}
+
+/*
+	Every RecordId of a posting list page, and their payloads.
+*/
+static void readPostingPage(const PostingNode* node, std::vector<RecordId>& rids, std::vector<char>& payloads,
+		int payloadSize)
+{
+	rids.resize(node->numRids);
+	payloads.resize(node->numRids * payloadSize);
+	PostingPosition position = postingStart(Page::INVALID_NUMBER);
+	decodePostingRids(node, position, rids.data(), payloads.data(), node->numRids, payloadSize);
+}
+
+/*
+	Replace the RecordIds of a posting list page with rids[begin, end) and their payloads, keeping its links.
+	Returns false if they do not fit.
+*/
+static bool writePostingPage(PostingNode* node, const std::vector<RecordId>& rids, const std::vector<char>& payloads,
+		int payloadSize, size_t begin, size_t end)
+{
+	PageId nextPageNo = node->nextPageNo;
+	PageId lastPageNo = node->lastPageNo;
+	int totalRids = node->totalRids;
+	initPosting(node);
+	node->nextPageNo = nextPageNo;
+	node->lastPageNo = lastPageNo;
+	node->totalRids = totalRids;
+	for (size_t i = begin; i < end; i++) {
+		if (!appendPostingRid(node, rids[i], payloads.data() + i * payloadSize, payloadSize)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+	Position of the first of the numKeys entries of a leaf that comes after (key, rid) in key and
+	RecordId order, taking the entries of key to be plain ones.
+*/
+static int leafIntUpperBound(const LeafNodeInt* node, int numKeys, int key, const RecordId& rid)
+{
+	int lo = intLowerBound(node->keyArray, numKeys, key, false);
+	int hi = intLowerBound(node->keyArray, numKeys, key, true);
+	std::uint64_t value = ridValue(rid);
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (ridValue(node->ridArray[mid]) <= value) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+	Position of the first of the numKeys entries of a leaf that does not come before (key, rid), taking the
+	entries of key to be plain ones.
+*/
+static int leafIntLowerBound(const LeafNodeInt* node, int numKeys, int key, const RecordId& rid)
+{
+	int lo = intLowerBound(node->keyArray, numKeys, key, false);
+	int hi = intLowerBound(node->keyArray, numKeys, key, true);
+	std::uint64_t value = ridValue(rid);
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (ridValue(node->ridArray[mid]) < value) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::BTreeIndex -- Constructor
 // -----------------------------------------------------------------------------
 
-BTreeIndex::BTreeIndex(const std::string & relationName,
-		std::string & outIndexName,
-		BufMgr *bufMgrIn,
-		const int attrByteOffset,
-		const Datatype attrType)
+BTreeIndex::BTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType,
+		const std::vector<IncludedColumn>& included)
+
+{
+	std::ostringstream idxStr;
+	idxStr << relationName << "." << attrByteOffset;
+	outIndexName = idxStr.str();
+	// included columns are only kept in INTEGER leaves, and must fit next to their RecordIds
+	int totalIncluded = 0;
+	for (size_t i = 0; i < included.size(); i++) {
+		if (included[i].length <= 0 || included[i].byteOffset < 0) {
+			throw BadIndexInfoException(outIndexName);
+		}
+		totalIncluded += included[i].length;
+	}
+	if ((attrType != INTEGER && !included.empty()) || (int)included.size() > MAXINCLUDEDCOLUMNS
+			|| totalIncluded > MAXPAYLOADSIZE) {
+		throw BadIndexInfoException(outIndexName);
+	}
+	BTreeIndex::includedColumns = included;
+	BTreeIndex::payloadSize = totalIncluded;
+	BTreeIndex::leafOccupancy = leafCapacityInt(payloadSize);
+	BTreeIndex::leafMin = INTLEAFMIN * leafOccupancy / INTARRAYLEAFSIZE;
+	BTreeIndex::postingMin = INTPOSTINGMIN * leafOccupancy / INTARRAYLEAFSIZE;
+	BTreeIndex::insertBufferLimit = 0;
+	BTreeIndex::eytzingerSearch = false;
+	BTreeIndex::learnedMaxError = 0;
+	BTreeIndex::learnedFresh = false;
+	BTreeIndex::insertBufferFlushes = 0;
+	// check if the index file exists
+	if (!File::exists(outIndexName)) {
+		// create the index file if not already exists
+		// the index owns its File object for its whole lifetime; it is deleted in the destructor
+		BTreeIndex::file = new BlobFile(outIndexName, true);
+
+		// initialize metadata
+		BTreeIndex::bufMgr = bufMgrIn;
+		BTreeIndex::attributeType = attrType;
+		BTreeIndex::attrByteOffset = attrByteOffset;
+
+		// create header page
+		Page* headerPage;
+		bufMgr->allocPage(file, headerPageNum, headerPage); // file->writePage(headerPageNum, headerPage);
+		IndexMetaInfo* headerInfo = (IndexMetaInfo *)headerPage;
+		strcpy(headerInfo->relationName, relationName.c_str());
+		headerInfo->attrByteOffset = attrByteOffset;
+		headerInfo->attrType = attrType;
+		headerInfo->subtreeCounts = false;
+		BTreeIndex::subtreeCounts = false;
+		headerInfo->numIncluded = (int)included.size();
+		for (size_t i = 0; i < included.size(); i++) {
+			headerInfo->included[i] = included[i];
+		}
+		headerInfo->bloomBlocks = 0;
+		headerInfo->bloomClean = false;
+		headerInfo->numBloomPages = 0;
+		headerInfo->rootEpoch = 0;
+		// const IndexMetaInfo btreeHeader = {outIndexName[0], attrByteOffset, attrType, 2};
+		// Page headerPage = *(reinterpret_cast<const Page*>(&btreeHeader));
+		bufMgr->unPinPage(file, headerPageNum, true);
+
+		// create root page, it starts out with no keys and a single empty leaf below it
+		Page* rootPage;
+		PageId rootPid;
+		bufMgr->allocPage(file, rootPid, rootPage);
+		rootPageNum = rootPid;
+		Page* leafPage;
+		PageId leafPid;
+		bufMgr->allocPage(file, leafPid, leafPage);
+		if (attrType == STRING) {
+			initLeafString((LeafNodeString*)leafPage);
+			initNonLeafString((NonLeafNodeString*)rootPage, 1, leafPid);
+		} else {
+			initLeafInt((LeafNodeInt*)leafPage);
+			initNonLeafInt((NonLeafNodeInt*)rootPage, 1, leafPid);
+		}
+		bufMgr->unPinPage(file, leafPid, true);
+		bufMgr->unPinPage(file, rootPid, true);
+		bufMgr->flushPage(file, rootPid);
+		writeRootInfo(1);
+
+		// insert entries for every tuple in the base relation using FileScan class
+		FileScan fileScanner = FileScan(relationName, bufMgrIn);
+		try {
+			RecordId rid;
+			while (true) {
+				fileScanner.scanNext(rid);
+				std::string record = fileScanner.getRecord();
+				// get key from record 
+				const char *record_ptr = record.c_str();
+				
+				// std::cout << *((int*)key) << std::endl;
+				
+				// if (*((int*)key) == -320) {
+				// 	std::cout << "STOP" << std::endl;
+				// }
+				
+				insertRecord(record_ptr, rid);
+			}
+		} catch(EndOfFileException e) {
+			// end of file scan
+		}
+		// fileScanner.~FileScan();
+	} else {
+		// if exists, open the index file
+		BTreeIndex::file = new BlobFile(outIndexName, false);
+		// check if the metadata in header matches with the given values
+		BTreeIndex::bufMgr = bufMgrIn;
+		BTreeIndex::headerPageNum = file->getFirstPageNo(); // or 1
+		BTreeIndex::attributeType = attrType;
+		BTreeIndex::attrByteOffset = attrByteOffset;
+		Page* headerPage;
+		bufMgr->readPage(file, headerPageNum, headerPage); // Page headerPage = (*file).readPage(headerPageNum);
+		bufMgr->unPinPage(file, headerPageNum, true);
+		// convert char[](Page) to struct 
+		IndexMetaInfo* headerInfo = (IndexMetaInfo*)(headerPage);
+		// if not match, throw BadIndexInfoException
+		if (headerInfo->relationName != relationName || headerInfo->attrByteOffset != attrByteOffset 
+				|| headerInfo->attrType != attrType) {
+			throw new BadIndexInfoException(outIndexName);
+		}
+		// the leaves were laid out for the included columns the index was created with
+		bool sameIncluded = headerInfo->numIncluded == (int)included.size();
+		for (size_t i = 0; sameIncluded && i < included.size(); i++) {
+			sameIncluded = headerInfo->included[i].byteOffset == included[i].byteOffset
+				&& headerInfo->included[i].length == included[i].length;
+		}
+		if (!sameIncluded) {
+			bufMgr->flushFile(file);
+			delete file;
+			throw BadIndexInfoException(outIndexName);
+		}
+		BTreeIndex::rootPageNum = headerInfo->rootPageNo;
+		BTreeIndex::subtreeCounts = headerInfo->subtreeCounts;
+		// the root was written to the file before the meta page pointed to it; a root at another level
+		// than the meta page says means the two do not belong together
+		int rootLevel = headerInfo->rootLevel;
+		Page* rootPage;
+		bufMgr->readPage(file, rootPageNum, rootPage);
+		int level = attrType == STRING ? ((NonLeafNodeString*)rootPage)->level : ((NonLeafNodeInt*)rootPage)->level;
+		bufMgr->unPinPage(file, rootPageNum, false);
+		if (level != rootLevel) {
+			bufMgr->flushFile(file);
+			delete file;
+			throw BadIndexInfoException(outIndexName);
+		}
+	}
+	scanExecuting = false;
+	scanCursor = nullptr;
+	leafShifts = 0;
+	nodeCache.setBudget(bufMgr->getNumBufs() / NODECACHESHARE);
+
+	// load the Bloom filter, or build it again if the index was not closed since it was last written
+	Page* headerPage;
+	bufMgr->readPage(file, headerPageNum, headerPage);
+	IndexMetaInfo* headerInfo = (IndexMetaInfo*)headerPage;
+	std::uint32_t bloomBlocks = headerInfo->bloomBlocks;
+	bool bloomClean = headerInfo->bloomClean;
+	bloomPages.assign(headerInfo->bloomPages, headerInfo->bloomPages + headerInfo->numBloomPages);
+	bufMgr->unPinPage(file, headerPageNum, false);
+	if (bloomBlocks > 0 && bloomClean) {
+		bloomFilter.reset(bloomBlocks);
+		const std::uint32_t blocksPerPage = Page::SIZE / BloomFilter::BLOCK_BYTES;
+		for (size_t i = 0; i < bloomPages.size(); i++) {
+			Page* page;
+			bufMgr->readPage(file, bloomPages[i], page);
+			bloomFilter.writeBlocks(i * blocksPerPage, std::min(blocksPerPage, bloomBlocks - (std::uint32_t)i * blocksPerPage),
+					(const char*)page);
+			bufMgr->unPinPage(file, bloomPages[i], false);
+		}
+	} else if (bloomBlocks > 0) {
+		fillBloomFilter(bloomBlocks);
+	}
+	if (bloomBlocks > 0) {
+		markBloomFilter(false);
+	}
+	BTreeIndex::nodeOccupancy = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+}
+
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::~BTreeIndex -- destructor
+// -----------------------------------------------------------------------------
+
+BTreeIndex::~BTreeIndex()
+{
+	if (scanExecuting) {
+		try {
+			endScan();
+		} catch (PagePinnedException e) {
+
+		} catch (BadgerDbException e) {
+			// unpin all pages
+			// TODO
+		}
+	}
+	// assuming all pinned papges are unpinned as soon as the btree finishes using them.
+	try {
+		flushInsertBuffer();
+
+		// the Bloom filter is only marked clean once its pages are on disk
+		const std::uint32_t blocksPerPage = Page::SIZE / BloomFilter::BLOCK_BYTES;
+		for (size_t i = 0; i < bloomPages.size(); i++) {
+			Page* page;
+			bufMgr->readPage(file, bloomPages[i], page);
+			bloomFilter.readBlocks(i * blocksPerPage,
+					std::min(blocksPerPage, bloomFilter.numBlocks() - (std::uint32_t)i * blocksPerPage), (char*)page);
+			bufMgr->unPinPage(file, bloomPages[i], true);
+		}
+		std::vector<PageId> cachedPages;
+		nodeCache.removeAll(cachedPages);
+		for (size_t i = 0; i < cachedPages.size(); i++) {
+			bufMgr->unPinPage(file, cachedPages[i], false);
+		}
+		retirePages(std::vector<PageId>());
+		bufMgr->flushFile(file);
+		if (!bloomPages.empty()) {
+			markBloomFilter(true);
+			bufMgr->flushFile(file);
+		}
+	} catch (PagePinnedException e) {
+
+	} catch (BadgerDbException e) {
+		// unpin all pages
+		// TODO
+	} 
+	// delete bufMgr;
+	delete file;
+}
+
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::latchPage
+// -----------------------------------------------------------------------------
+
+Page* BTreeIndex::latchPage(const PageId pageNo, const bool exclusive)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	if (exclusive) {
+		latches.get(pageNo).lockExclusive();
+	} else {
+		latches.get(pageNo).lockShared();
+	}
+	return page;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::unlatchPage
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::unlatchPage(const PageId pageNo, const bool exclusive, const bool dirty)
+{
+	// a page changed under an exclusive latch is unpinned before the latch goes, so a write-ahead log
+	// records the change whole
+	if (exclusive) {
+		bufMgr->unPinPage(file, pageNo, dirty);
+		latches.get(pageNo).unlockExclusive();
+	} else {
+		latches.get(pageNo).unlockShared();
+		bufMgr->unPinPage(file, pageNo, dirty);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readNode
+// -----------------------------------------------------------------------------
+
+Page* BTreeIndex::readNode(const PageId pageNo, bool& cached)
+{
+	Page* page = nodeCache.get(pageNo);
+	cached = page != nullptr;
+	if (!cached) {
+		bufMgr->readPage(file, pageNo, page);
+	}
+	return page;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::releaseNode
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::releaseNode(const PageId pageNo, Page* page, const bool cached, const bool validated)
+{
+	// a node that leaves the tree right after it was validated may still get in here; retirePages takes
+	// it out again, and until then the pin of the cache keeps the page from being disposed of
+	if (cached || (validated && nodeCache.add(pageNo, page))) {
+		return;
+	}
+	bufMgr->unPinPage(file, pageNo, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::releasePath
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::releasePath(std::vector<PathEntry>& path)
+{
+	for (size_t i = 0; i < path.size(); i++) {
+		unlatchPage(path[i].pageNo, true, subtreeCounts);
+	}
+	path.clear();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::latchRoot
+// -----------------------------------------------------------------------------
+
+Page* BTreeIndex::latchRoot(PageId& rootPid, const bool exclusive)
+{
+	while (true) {
+		rootPid = rootPageNum;
+		Page* page = latchPage(rootPid, exclusive);
+		if (rootPageNum == rootPid) {
+			return page;
+		}
+		// the root changed while we waited for its latch
+		unlatchPage(rootPid, exclusive, false);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::latchCountPathInt
+// -----------------------------------------------------------------------------
+
+Page* BTreeIndex::latchCountPathInt(const int key, std::vector<PathEntry>& path, PageId& leafPid)
+{
+	// while counts are kept every split and merge holds the root exclusively, so under a shared root latch
+	// the nodes below change in nothing but their counts
+	PageId pid;
+	Page* page = latchRoot(pid, false);
+	while (true) {
+		NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+		PathEntry entry;
+		entry.pageNo = pid;
+		entry.page = page;
+		entry.child = intLowerBound(node->keyArray, countKeys(node->keyArray, INTARRAYNONLEAFSIZE), key, false);
+		path.push_back(entry);
+		int level = node->level;
+		pid = node->pageNoArray[entry.child];
+		if (level == 1) {
+			leafPid = pid;
+			return latchPage(pid, true);
+		}
+		bufMgr->readPage(file, pid, page);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::addPathCounts
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::addPathCounts(std::vector<PathEntry>& path, const size_t end, const int delta)
+{
+	if (!subtreeCounts) {
+		return;
+	}
+	for (size_t i = 0; i < end; i++) {
+		NonLeafNodeInt* node = (NonLeafNodeInt*)path[i].page;
+		__atomic_fetch_add(&node->countArray[path[i].child], delta, __ATOMIC_RELAXED);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::releaseCountPath
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::releaseCountPath(std::vector<PathEntry>& path, const int delta)
+{
+	addPathCounts(path, path.size(), delta);
+	for (size_t i = path.size(); i-- > 1;) {
+		bufMgr->unPinPage(file, path[i].pageNo, delta != 0);
+	}
+	if (!path.empty()) {
+		unlatchPage(path[0].pageNo, false, delta != 0);
+	}
+	path.clear();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::leafEntriesInt
+// -----------------------------------------------------------------------------
+
+long BTreeIndex::leafEntriesInt(const LeafNodeInt* leaf, const int begin, const int end)
+{
+	long count = 0;
+	for (int i = begin; i < end; i++) {
+		if (!isPostingRid(leaf->ridArray[i])) {
+			count++;
+			continue;
+		}
+		Page* headPage;
+		bufMgr->readPage(file, leaf->ridArray[i].page_number, headPage);
+		count += ((PostingNode*)headPage)->totalRids;
+		bufMgr->unPinPage(file, leaf->ridArray[i].page_number, false);
+	}
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::linkLeftSibling
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::linkLeftSibling(const PageId pageNo, const PageId leftPid)
+{
+	if (pageNo == Page::INVALID_NUMBER) {
+		return;
+	}
+	Page* page = latchPage(pageNo, true);
+	if (attributeType == STRING) {
+		((LeafNodeString*)page)->leftSibPageNo = leftPid;
+	} else {
+		((LeafNodeInt*)page)->leftSibPageNo = leftPid;
+	}
+	unlatchPage(pageNo, true, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::latchLeftLeaf
+// -----------------------------------------------------------------------------
+
+Page* BTreeIndex::latchLeftLeaf(const PageId pageNo, const PageId leftPid)
+{
+	// the pin keeps the left leaf from being disposed of while neither leaf is latched
+	std::uint32_t version = latches.get(pageNo).readVersion();
+	Page* leftPage;
+	bufMgr->readPage(file, leftPid, leftPage);
+	unlatchPage(pageNo, false, false);
+	latches.get(leftPid).lockShared();
+
+	// a split of the left leaf, or a merge on either side of it, relinks through this leaf exclusively
+	if (!latches.get(pageNo).validate(version)) {
+		unlatchPage(leftPid, false, false);
+		return nullptr;
+	}
+	return leftPage;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
+{
+	insertEntry(key, rid, nullptr);
+}
+
+void BTreeIndex::insertEntry(const void *key, const RecordId rid, const void *payload)
+{
+	// the filter learns the key before any lookup can find its entry
+	if (bloomFilter.numBlocks() > 0) {
+		bloomFilter.add(bloomHash(key));
+	}
+	if (attributeType == STRING) {
+		insertEntryString(makeStringKey((const char*)key), rid);
+		return;
+	}
+	// an entry inserted without its included columns carries zeros for them
+	const char zeros[MAXPAYLOADSIZE] = {};
+	const char* bytes = payload != nullptr ? (const char*)payload : zeros;
+	if (insertBufferLimit > 0) {
+		BufferedInsert entry;
+		entry.rid = rid;
+		entry.rid.padding = 0;
+		entry.payload.assign(bytes, payloadSize);
+		std::lock_guard<std::mutex> guard(insertBufferMutex);
+		insertBuffer.insert(std::make_pair(std::make_pair(*((int*)key), ridValue(rid)), entry));
+		if ((int)insertBuffer.size() >= insertBufferLimit) {
+			drainInsertBuffer();
+		}
+		return;
+	}
+	insertEntryInt(*((int*)key), rid, bytes);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertRecord
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::insertRecord(const char *record, const RecordId rid)
+{
+	char payload[MAXPAYLOADSIZE];
+	int offset = 0;
+	for (size_t i = 0; i < includedColumns.size(); i++) {
+		memcpy(payload + offset, record + includedColumns[i].byteOffset, includedColumns[i].length);
+		offset += includedColumns[i].length;
+	}
+	insertEntry(record + attrByteOffset, rid, payload);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::findLeafInt
+// -----------------------------------------------------------------------------
+
+Page* BTreeIndex::findLeafInt(const int key, PageId& leafPid, const bool exclusive)
+{
+	if (!exclusive) {
+		Page* page = findLearnedLeafInt(key, leafPid);
+		if (page != nullptr) {
+			return page;
+		}
+	}
+	while (true) {
+		// the root may split between reading rootPageNum and reading its version, check it is still the root
+		PageId pid = rootPageNum;
+		bool cached;
+		Page* page = readNode(pid, cached);
+		std::uint32_t version = latches.get(pid).readVersion();
+		if (rootPageNum != pid) {
+			releaseNode(pid, page, cached, false);
+			continue;
+		}
+		Page* leafPage = nullptr;
+		bool validated = false;
+		while (true) {
+			// nothing read from the node may be used before its version is checked
+			NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+			int level = node->level;
+			PageId childPid = node->pageNoArray[childIndexInt(node, pid, version, cached, key)];
+			if (!latches.get(pid).validate(version)) {
+				break;
+			}
+			nodeCache.count(level, cached);
+
+			if (level == 1) {
+				// latch the leaf, then make sure it was not split away from us meanwhile
+				Page* childPage = latchPage(childPid, exclusive);
+				if (latches.get(pid).validate(version)) {
+					leafPid = childPid;
+					leafPage = childPage;
+					validated = true;
+					nodeCache.count(0, false);
+				} else {
+					unlatchPage(childPid, exclusive, false);
+				}
+				break;
+			}
+
+			bool childCached;
+			Page* childPage = readNode(childPid, childCached);
+			std::uint32_t childVersion = latches.get(childPid).readVersion();
+			if (!latches.get(pid).validate(version)) {
+				releaseNode(childPid, childPage, childCached, false);
+				break;
+			}
+			releaseNode(pid, page, cached, true);
+			pid = childPid;
+			page = childPage;
+			cached = childCached;
+			version = childVersion;
+		}
+		releaseNode(pid, page, cached, validated);
+		if (leafPage != nullptr) {
+			return leafPage;
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::childIndexInt
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::childIndexInt(const NonLeafNodeInt* node, const PageId pageNo, const std::uint32_t version,
+		const bool cached, const int key)
+{
+	if (cached && eytzingerSearch) {
+		EytzingerKeys& keys = nodeCache.keys(pageNo, INTARRAYNONLEAFSIZE);
+		std::uint32_t tag = keys.tag();
+		if (tag == version) {
+			int child = keys.lowerBound(key);
+			if (keys.validate(tag)) {
+				return child;
+			}
+		} else if (keys.beginBuild(tag)) {
+			// the copy is only tagged with the version if the node did not change while it was copied
+			keys.build(node->keyArray, countKeys(node->keyArray, INTARRAYNONLEAFSIZE));
+			keys.endBuild(latches.get(pageNo).validate(version), version);
+		}
+	}
+	return intLowerBound(node->keyArray, countKeys(node->keyArray, INTARRAYNONLEAFSIZE), key, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntryInt
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::insertEntryInt(const int key, const RecordId recordId, const char* payload)
+{
+	// padding tells entries of records from those of posting lists
+	RecordId rid = recordId;
+	rid.padding = 0;
+
+	// most inserts only change their leaf: find it optimistically and latch nothing but the leaf;
+	// an entry that goes into a posting list needs no room in the leaf at all. With subtree counts the
+	// path down to the leaf is kept as well, its counts going up along with the leaf
+	std::vector<PathEntry> path;
+	PageId leafPid;
+	Page* page = subtreeCounts ? latchCountPathInt(key, path, leafPid) : findLeafInt(key, leafPid, true);
+	LeafNodeInt* leaf = (LeafNodeInt*)page;
+	int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+	bool done = insertPostingInt(leaf, numKeys, key, rid, payload);
+	if (!done && numKeys < leafOccupancy) {
+		insertLeafInt(leaf, numKeys, leafIntUpperBound(leaf, numKeys, key, rid), key, rid, payload, payloadSize);
+		done = true;
+	}
+	unlatchPage(leafPid, true, done);
+	releaseCountPath(path, done ? 1 : 0);
+	if (done) {
+		return;
+	}
+
+	// the leaf is full: descend again with exclusive latches; whenever a node has room for one more
+	// key no split can get past it, so the latches above it are let go. With subtree counts every node
+	// on the path gains an entry below it, so none is let go
+	PageId pid;
+	page = latchRoot(pid, true);
+	int rootLevel = ((NonLeafNodeInt*)page)->level;
+	while (true) {
+		NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+		numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+		if (numKeys < INTARRAYNONLEAFSIZE && !subtreeCounts) {
+			releasePath(path);
+		}
+		PathEntry entry;
+		entry.pageNo = pid;
+		entry.page = page;
+		entry.child = intLowerBound(node->keyArray, numKeys, key, false);
+		path.push_back(entry);
+		int level = node->level;
+		pid = node->pageNoArray[entry.child];
+		page = latchPage(pid, true);
+		if (level == 1) {
+			break;
+		}
+	}
+
+	// add the entry to the leaf, in RecordId order among any others of the key
+	leaf = (LeafNodeInt*)page;
+	leafPid = pid;
+	numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+	if (insertPostingInt(leaf, numKeys, key, rid, payload)) {
+		addPathCounts(path, path.size(), 1);
+		releasePath(path);
+		unlatchPage(leafPid, true, true);
+		return;
+	}
+	int pos = leafIntUpperBound(leaf, numKeys, key, rid);
+	bool split = false;
+	int sepKey = MYNULL;
+	PageId newPid = Page::INVALID_NUMBER;
+	if (numKeys < leafOccupancy) {
+		addPathCounts(path, path.size(), 1);
+		releasePath(path);
+		insertLeafInt(leaf, numKeys, pos, key, rid, payload, payloadSize);
+	} else {
+		newPid = splitLeafNode(leaf, leafPid, pos, key, rid, payload, sepKey);
+		split = true;
+	}
+
+	// with subtree counts, the number of entries left in the node that was split last; the rest of the
+	// entries of its subtree, the new one included, are in the new node
+	long leftCount = 0;
+	long rootCount = 0;
+	if (split && subtreeCounts) {
+		leftCount = leafEntriesInt(leaf, 0, countKeys(leaf->keyArray, INTARRAYLEAFSIZE));
+		rootCount = sumCountsInt((NonLeafNodeInt*)path[0].page);
+	}
+	unlatchPage(leafPid, true, true);
+
+	// walk back up the nodes still latched, adding the separator of each split to the parent
+	bool topDirty = false;
+	for (int level = path.size() - 1; level >= 0; level--) {
+		NonLeafNodeInt* node = (NonLeafNodeInt*)path[level].page;
+		int child = path[level].child;
+		bool dirty = split || subtreeCounts;
+		int newCount = 0;
+		if (subtreeCounts) {
+			if (split) {
+				newCount = node->countArray[child] + 1 - leftCount;
+				node->countArray[child] = leftCount;
+			} else {
+				node->countArray[child]++;
+			}
+		}
+		if (split) {
+			// the new node goes right after the child we came from
+			pos = child;
+			numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+			if (numKeys < INTARRAYNONLEAFSIZE) {
+				memmove(node->keyArray + pos + 1, node->keyArray + pos, (numKeys - pos) * sizeof(int));
+				memmove(node->pageNoArray + pos + 2, node->pageNoArray + pos + 1, (numKeys - pos) * sizeof(PageId));
+				memmove(node->countArray + pos + 2, node->countArray + pos + 1, (numKeys - pos) * sizeof(int));
+				node->keyArray[pos] = sepKey;
+				node->pageNoArray[pos + 1] = newPid;
+				node->countArray[pos + 1] = newCount;
+				split = false;
+			} else {
+				int upKey;
+				newPid = splitNonLeaf(node, pos, sepKey, newPid, newCount, upKey);
+				sepKey = upKey;
+				if (subtreeCounts) {
+					leftCount = sumCountsInt(node);
+				}
+			}
+		}
+		// the topmost node may be the root; it stays latched until a new root is in place
+		if (level > 0) {
+			unlatchPage(path[level].pageNo, true, dirty);
+		} else {
+			topDirty = dirty;
+		}
+	}
+
+	// the root itself was split, grow the tree by one level
+	if (split) {
+		Page* newRootPage;
+		PageId newRootPid;
+		bufMgr->allocPage(file, newRootPid, newRootPage);
+		NonLeafNodeInt* newRoot = (NonLeafNodeInt*)newRootPage;
+		initNonLeafInt(newRoot, rootLevel + 1, rootPageNum);
+		newRoot->keyArray[0] = sepKey;
+		newRoot->pageNoArray[1] = newPid;
+		if (subtreeCounts) {
+			newRoot->countArray[0] = leftCount;
+			newRoot->countArray[1] = rootCount + 1 - leftCount;
+		}
+		bufMgr->unPinPage(file, newRootPid, true);
+		bufMgr->flushPage(file, newRootPid);
+		rootPageNum = newRootPid;
+		writeRootInfo(rootLevel + 1);
+	}
+	if (!path.empty()) {
+		unlatchPage(path[0].pageNo, true, topDirty);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::splitLeafNode
+// -----------------------------------------------------------------------------
+
+PageId BTreeIndex::splitLeafNode(LeafNodeInt* cur, const PageId curPid, const int pos, const int key, const RecordId rid,
+		const char* payload, int& sepKey)
+{
+	learnedFresh = false;
+
+	// lay out all leafOccupancy + 1 entries in order, those from the key boundary nearest the middle on
+	// go to the new leaf
+	std::vector<int> keys(cur->keyArray, cur->keyArray + leafOccupancy);
+	std::vector<RecordId> rids(cur->ridArray, cur->ridArray + leafOccupancy);
+	const char* curPayloads = leafPayload(cur, payloadSize, 0);
+	std::vector<char> payloads(curPayloads, curPayloads + leafOccupancy * payloadSize);
+	keys.insert(keys.begin() + pos, key);
+	rids.insert(rids.begin() + pos, rid);
+	payloads.insert(payloads.begin() + pos * payloadSize, payload, payload + payloadSize);
+	int total = leafOccupancy + 1;
+	int middle = intSplitPoint(keys.data(), total, total / 2);
+
+	PageId newPid;
+	Page* newPage;
+	bufMgr->allocPage(file, newPid, newPage);
+	LeafNodeInt* newLeaf = (LeafNodeInt*)newPage;
+	initLeafInt(newLeaf);
+	for (int i = middle; i < total; i++) {
+		newLeaf->keyArray[i - middle] = keys[i];
+		newLeaf->ridArray[i - middle] = rids[i];
+	}
+	std::copy(payloads.begin() + middle * payloadSize, payloads.end(), leafPayload(newLeaf, payloadSize, 0));
+	for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
+		cur->keyArray[i] = i < middle ? keys[i] : MYNULL;
+		if (i < middle) {
+			cur->ridArray[i] = rids[i];
+		}
+	}
+	std::copy(payloads.begin(), payloads.begin() + middle * payloadSize, leafPayload(cur, payloadSize, 0));
+
+	// fix the linked list; the new leaf is complete before cur points at it
+	newLeaf->rightSibPageNo = cur->rightSibPageNo;
+	newLeaf->leftSibPageNo = curPid;
+	cur->rightSibPageNo = newPid;
+	linkLeftSibling(newLeaf->rightSibPageNo, newPid);
+	bufMgr->unPinPage(file, newPid, true);
+
+	sepKey = keys[middle - 1];
+	return newPid;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::splitNonLeaf
+// -----------------------------------------------------------------------------
+
+PageId BTreeIndex::splitNonLeaf(NonLeafNodeInt* cur, const int pos, const int key, const PageId child, const int childCount,
+		int& upKey)
+{
+	std::vector<int> keys(cur->keyArray, cur->keyArray + INTARRAYNONLEAFSIZE);
+	std::vector<PageId> children(cur->pageNoArray, cur->pageNoArray + INTARRAYNONLEAFSIZE + 1);
+	std::vector<int> counts(cur->countArray, cur->countArray + INTARRAYNONLEAFSIZE + 1);
+	keys.insert(keys.begin() + pos, key);
+	children.insert(children.begin() + pos + 1, child);
+	counts.insert(counts.begin() + pos + 1, childCount);
+	int total = INTARRAYNONLEAFSIZE + 1;
+	int middle = total / 2;
+
+	// keys[middle] moves up, the keys right of it and their children go to the new node
+	PageId newPid;
+	Page* newPage;
+	bufMgr->allocPage(file, newPid, newPage);
+	NonLeafNodeInt* newNode = (NonLeafNodeInt*)newPage;
+	initNonLeafInt(newNode, cur->level, children[middle + 1]);
+	newNode->countArray[0] = counts[middle + 1];
+	for (int i = middle + 1; i < total; i++) {
+		newNode->keyArray[i - middle - 1] = keys[i];
+		newNode->pageNoArray[i - middle] = children[i + 1];
+		newNode->countArray[i - middle] = counts[i + 1];
+	}
+	for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
+		cur->keyArray[i] = i < middle ? keys[i] : MYNULL;
+		cur->pageNoArray[i + 1] = i < middle ? children[i + 1] : Page::INVALID_NUMBER;
+		cur->countArray[i + 1] = i < middle ? counts[i + 1] : 0;
+	}
+	bufMgr->unPinPage(file, newPid, true);
+
+	upKey = keys[middle];
+	return newPid;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::deleteEntry(const void *key, const RecordId rid)
+{
+	if (attributeType == STRING) {
+		deleteEntryString(makeStringKey((const char*)key), rid);
+		return;
+	}
+	// an entry still in the insert buffer never reaches the tree
+	if (insertBufferLimit > 0) {
+		std::lock_guard<std::mutex> guard(insertBufferMutex);
+		std::pair<int, std::uint64_t> bufferKey(*((int*)key), ridValue(rid));
+		std::multimap<std::pair<int, std::uint64_t>, BufferedInsert>::iterator it = insertBuffer.find(bufferKey);
+		if (it != insertBuffer.end()) {
+			insertBuffer.erase(it);
+			return;
+		}
+	}
+	deleteEntryInt(*((int*)key), rid);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::seekEntryInt
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::seekEntryInt(Page*& page, PageId& leafPid, const int key, const RecordId rid, int& pos)
+{
+	while (true) {
+		LeafNodeInt* leaf = (LeafNodeInt*)page;
+		int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		bool found;
+		pos = locateEntryInt(leaf, numKeys, key, rid, found);
+		if (found) {
+			return true;
+		}
+		// duplicates of the key can continue on the right sibling
+		if (pos < numKeys || leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+			unlatchPage(leafPid, true, false);
+			return false;
+		}
+		PageId nextPid = leaf->rightSibPageNo;
+		page = latchPage(nextPid, true);
+		unlatchPage(leafPid, true, false);
+		leafPid = nextPid;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntryInt
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::deleteEntryInt(const int key, const RecordId rid)
+{
+	// most deletes leave their leaf at least a quarter full: find it optimistically and latch nothing but
+	// the leaf, or the leaves right of it while duplicates of the key go on. With subtree counts the path
+	// is kept as for inserts; all entries of a key are on one leaf, so there is no need to go right
+	std::vector<PathEntry> path;
+	PageId leafPid;
+	Page* page;
+	int pos;
+	if (subtreeCounts) {
+		page = latchCountPathInt(key, path, leafPid);
+		bool found;
+		pos = locateEntryInt((LeafNodeInt*)page, countKeys(((LeafNodeInt*)page)->keyArray, INTARRAYLEAFSIZE), key, rid, found);
+		if (!found) {
+			unlatchPage(leafPid, true, false);
+			releaseCountPath(path, 0);
+			throw NoSuchKeyFoundException();
+		}
+	} else {
+		page = findLeafInt(key, leafPid, true);
+		if (!seekEntryInt(page, leafPid, key, rid, pos)) {
+			throw NoSuchKeyFoundException();
+		}
+	}
+	LeafNodeInt* leaf = (LeafNodeInt*)page;
+	int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+	std::vector<PageId> freed;
+	if (isPostingRid(leaf->ridArray[pos])) {
+		// the entry stays, only its posting list shrinks
+		bool removed = removePosting(leaf, pos, rid, freed);
+		unlatchPage(leafPid, true, true);
+		releaseCountPath(path, removed ? -1 : 0);
+		retirePages(freed);
+		return;
+	}
+	if (numKeys > leafMin) {
+		removeLeafInt(leaf, numKeys, pos, payloadSize);
+		unlatchPage(leafPid, true, true);
+		releaseCountPath(path, -1);
+		return;
+	}
+	unlatchPage(leafPid, true, false);
+	releaseCountPath(path, 0);
+
+	// the leaf would underflow: descend again with exclusive latches; whenever a node can lose a key
+	// without underflowing no merge can get past it, so the latches above it are let go. With subtree
+	// counts every node on the path loses an entry below it, so none is let go
+	PageId pid;
+	page = latchRoot(pid, true);
+	bool isRoot = true;
+	while (true) {
+		NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+		numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+		// the root has no minimum; it only goes once it is down to a single child above the leaves
+		bool safe = isRoot ? (node->level == 1 || numKeys > 1) : numKeys > INTNONLEAFMIN;
+		isRoot = false;
+		if (safe && !subtreeCounts) {
+			releasePath(path);
+		}
+		PathEntry entry;
+		entry.pageNo = pid;
+		entry.page = page;
+		entry.child = intLowerBound(node->keyArray, numKeys, key, false);
+		path.push_back(entry);
+		if (node->level == 1) {
+			break;
+		}
+		pid = node->pageNoArray[entry.child];
+		page = latchPage(pid, true);
+	}
+
+	// find the entry among the children of the lowest node, duplicates of the key can go on into the
+	// children right of the one the key leads to
+	NonLeafNodeInt* parent = (NonLeafNodeInt*)path.back().page;
+	int parentKeys = countKeys(parent->keyArray, INTARRAYNONLEAFSIZE);
+	int child = path.back().child;
+	while (true) {
+		leafPid = parent->pageNoArray[child];
+		page = latchPage(leafPid, true);
+		leaf = (LeafNodeInt*)page;
+		numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		bool found;
+		pos = locateEntryInt(leaf, numKeys, key, rid, found);
+		if (found) {
+			path.back().child = child;
+			break;
+		}
+		if (pos == numKeys && child < parentKeys && parent->keyArray[child] == key) {
+			unlatchPage(leafPid, true, false);
+			child++;
+			continue;
+		}
+		// the entry is gone, or further along a run of duplicates that goes on under the next parent;
+		// there it is removed without rebalancing its leaf
+		releasePath(path);
+		if (subtreeCounts) {
+			unlatchPage(leafPid, true, false);
+			throw NoSuchKeyFoundException();
+		}
+		if (!seekEntryInt(page, leafPid, key, rid, pos)) {
+			throw NoSuchKeyFoundException();
+		}
+		leaf = (LeafNodeInt*)page;
+		if (isPostingRid(leaf->ridArray[pos])) {
+			removePosting(leaf, pos, rid, freed);
+		} else {
+			removeLeafInt(leaf, countKeys(leaf->keyArray, INTARRAYLEAFSIZE), pos, payloadSize);
+		}
+		unlatchPage(leafPid, true, true);
+		retirePages(freed);
+		return;
+	}
+
+	if (isPostingRid(leaf->ridArray[pos])) {
+		// the entry went into a posting list meanwhile
+		if (removePosting(leaf, pos, rid, freed)) {
+			addPathCounts(path, path.size(), -1);
+		}
+		unlatchPage(leafPid, true, true);
+		releasePath(path);
+		retirePages(freed);
+		return;
+	}
+	if (numKeys > leafMin || parentKeys == 0) {
+		// an insert made room meanwhile, or this is the only leaf of the tree
+		removeLeafInt(leaf, numKeys, pos, payloadSize);
+		addPathCounts(path, path.size(), -1);
+		unlatchPage(leafPid, true, true);
+		releasePath(path);
+		return;
+	}
+
+	// rebalance the leaf with its right sibling, or with its left one if it is the last child
+	int sep = child < parentKeys ? child : child - 1;
+	PageId leftPid = parent->pageNoArray[sep];
+	PageId rightPid = parent->pageNoArray[sep + 1];
+	Page* leftPage;
+	Page* rightPage;
+	if (sep == child) {
+		removeLeafInt(leaf, numKeys, pos, payloadSize);
+		leftPage = page;
+		rightPage = latchPage(rightPid, true);
+	} else {
+		// leaves are latched left to right like scans do, so let go of the leaf and take both in order;
+		// with the parent latched neither can split or merge meanwhile, but the entry may have been deleted
+		unlatchPage(leafPid, true, false);
+		leftPage = latchPage(leftPid, true);
+		rightPage = latchPage(rightPid, true);
+		leaf = (LeafNodeInt*)rightPage;
+		numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		bool found;
+		pos = locateEntryInt(leaf, numKeys, key, rid, found);
+		if (!found) {
+			unlatchPage(rightPid, true, false);
+			unlatchPage(leftPid, true, false);
+			releasePath(path);
+			throw NoSuchKeyFoundException();
+		}
+		if (isPostingRid(leaf->ridArray[pos])) {
+			if (removePosting(leaf, pos, rid, freed)) {
+				addPathCounts(path, path.size(), -1);
+			}
+			unlatchPage(rightPid, true, true);
+			unlatchPage(leftPid, true, false);
+			releasePath(path);
+			retirePages(freed);
+			return;
+		}
+		removeLeafInt(leaf, numKeys, pos, payloadSize);
+	}
+
+	// with subtree counts the nodes above the parent just lose the entry, while the pair of leaves gets
+	// the counts of whatever each of them holds once evened out
+	long pairCount = 0;
+	if (subtreeCounts) {
+		addPathCounts(path, path.size() - 1, -1);
+		pairCount = parent->countArray[sep] + parent->countArray[sep + 1] - 1;
+	}
+	learnedFresh = false;
+	bool merged = rebalanceLeafInt(parent, sep, (LeafNodeInt*)leftPage, (LeafNodeInt*)rightPage, payloadSize);
+	if (subtreeCounts) {
+		long leftCount = merged ? pairCount
+				: leafEntriesInt((LeafNodeInt*)leftPage, 0, countKeys(((LeafNodeInt*)leftPage)->keyArray, INTARRAYLEAFSIZE));
+		parent->countArray[sep] = leftCount;
+		if (!merged) {
+			parent->countArray[sep + 1] = pairCount - leftCount;
+		}
+	}
+	leafShifts++;
+	if (merged) {
+		// the leaf that followed right now follows left
+		linkLeftSibling(((LeafNodeInt*)leftPage)->rightSibPageNo, leftPid);
+	}
+	unlatchPage(rightPid, true, true);
+	unlatchPage(leftPid, true, true);
+	if (merged) {
+		freed.push_back(rightPid);
+	}
+
+	// walk back up the nodes still latched: a node that lost a key to a merge below it and underflows
+	// is rebalanced with a sibling in turn
+	std::vector<bool> dirty(path.size(), subtreeCounts);
+	dirty.back() = true;
+	int level = path.size() - 1;
+	while (merged && level > 0) {
+		NonLeafNodeInt* node = (NonLeafNodeInt*)path[level].page;
+		NonLeafNodeInt* grand = (NonLeafNodeInt*)path[level - 1].page;
+		int grandKeys = countKeys(grand->keyArray, INTARRAYNONLEAFSIZE);
+		if (countKeys(node->keyArray, INTARRAYNONLEAFSIZE) >= INTNONLEAFMIN || grandKeys == 0) {
+			break;
+		}
+		child = path[level - 1].child;
+		sep = child < grandKeys ? child : child - 1;
+		PageId sibPid = grand->pageNoArray[sep == child ? child + 1 : child - 1];
+		NonLeafNodeInt* sibling = (NonLeafNodeInt*)latchPage(sibPid, true);
+		pairCount = grand->countArray[sep] + grand->countArray[sep + 1];
+		if (sep == child) {
+			merged = rebalanceNonLeafInt(grand, sep, node, sibling);
+		} else {
+			merged = rebalanceNonLeafInt(grand, sep, sibling, node);
+		}
+		if (subtreeCounts) {
+			long leftCount = merged ? pairCount : sumCountsInt(sep == child ? node : sibling);
+			grand->countArray[sep] = leftCount;
+			if (!merged) {
+				grand->countArray[sep + 1] = pairCount - leftCount;
+			}
+		}
+		unlatchPage(sibPid, true, true);
+		if (merged) {
+			// the right node of the pair is the one emptied
+			freed.push_back(sep == child ? sibPid : path[level].pageNo);
+		}
+		dirty[level - 1] = true;
+		level--;
+	}
+
+	// the root lost its last key: its only child becomes the root
+	NonLeafNodeInt* top = (NonLeafNodeInt*)path[0].page;
+	if (merged && level == 0 && path[0].pageNo == rootPageNum && top->level > 1
+			&& countKeys(top->keyArray, INTARRAYNONLEAFSIZE) == 0) {
+		rootPageNum = top->pageNoArray[0];
+		writeRootInfo(top->level - 1);
+		freed.push_back(path[0].pageNo);
+	}
+
+	// the topmost node may be the root; it is let go last, once any new root is in place
+	for (int i = path.size() - 1; i >= 0; i--) {
+		unlatchPage(path[i].pageNo, true, dirty[i]);
+	}
+	retirePages(freed);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::retirePages
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::retirePages(const std::vector<PageId>& pages)
+{
+	std::lock_guard<std::mutex> guard(retiredMutex);
+	retiredPages.insert(retiredPages.end(), pages.begin(), pages.end());
+
+	// a thread that read the page number before the page left the tree may still have it pinned; it finds
+	// out once it validates the parent, so the page can go as soon as no pins are left
+	std::vector<PageId> pinned;
+	for (size_t i = 0; i < retiredPages.size(); i++) {
+		if (nodeCache.remove(retiredPages[i])) {
+			bufMgr->unPinPage(file, retiredPages[i], false);
+		}
+		try {
+			bufMgr->disposePage(file, retiredPages[i]);
+		} catch (const PagePinnedException &e) {
+			pinned.push_back(retiredPages[i]);
+		}
+	}
+	retiredPages.swap(pinned);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::locateEntryInt
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::locateEntryInt(const LeafNodeInt* node, const int numKeys, const int key, const RecordId rid, bool& found)
+{
+	int i = intLowerBound(node->keyArray, numKeys, key, false);
+	for (; i < numKeys && node->keyArray[i] == key; i++) {
+		if (isPostingRid(node->ridArray[i])) {
+			PostingPosition position;
+			RecordId atRid;
+			if (seekPosting(node->ridArray[i].page_number, rid, false, position, atRid) && atRid == rid) {
+				found = true;
+				return i;
+			}
+		} else if (node->ridArray[i] == rid) {
+			found = true;
+			return i;
+		}
+	}
+	found = false;
+	return i;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::resumeLeafInt
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::resumeLeafInt(const LeafNodeInt* node, const int numKeys, const int key, const RecordId rid,
+		PostingPosition& posting)
+{
+	posting.pageNo = Page::INVALID_NUMBER;
+	int first = intLowerBound(node->keyArray, numKeys, key, false);
+	if (first < numKeys && node->keyArray[first] == key && isPostingRid(node->ridArray[first])) {
+		// a key with a posting list has no other entry
+		RecordId atRid;
+		if (seekPosting(node->ridArray[first].page_number, rid, true, posting, atRid)) {
+			return first;
+		}
+		posting.pageNo = Page::INVALID_NUMBER;
+		return first + 1;
+	}
+	return leafIntUpperBound(node, numKeys, key, rid);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertPostingInt
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::insertPostingInt(LeafNodeInt* leaf, const int numKeys, const int key, const RecordId rid,
+		const char* payload)
+{
+	int first = intLowerBound(leaf->keyArray, numKeys, key, false);
+	int end = intLowerBound(leaf->keyArray, numKeys, key, true);
+	if (first < end && isPostingRid(leaf->ridArray[first])) {
+		insertPosting(leaf->ridArray[first].page_number, rid, payload);
+		return true;
+	}
+	if (end - first + 1 < postingMin) {
+		return false;
+	}
+
+	// gather the entries of key and rid, in order, into a new list
+	PageId headPid;
+	Page* headPage;
+	bufMgr->allocPage(file, headPid, headPage);
+	PostingNode* head = (PostingNode*)headPage;
+	initPosting(head);
+	head->lastPageNo = headPid;
+	bufMgr->unPinPage(file, headPid, true);
+	int pos = leafIntUpperBound(leaf, numKeys, key, rid);
+	for (int i = first; i < end; i++) {
+		if (i == pos) {
+			insertPosting(headPid, rid, payload);
+		}
+		insertPosting(headPid, leaf->ridArray[i], leafPayload(leaf, payloadSize, i));
+	}
+	if (pos == end) {
+		insertPosting(headPid, rid, payload);
+	}
+
+	leaf->ridArray[first].page_number = headPid;
+	leaf->ridArray[first].slot_number = 0;
+	leaf->ridArray[first].padding = POSTINGMARK;
+	int gone = end - first - 1;
+	memmove(leaf->keyArray + first + 1, leaf->keyArray + end, (numKeys - end) * sizeof(int));
+	memmove(leaf->ridArray + first + 1, leaf->ridArray + end, (numKeys - end) * sizeof(RecordId));
+	memmove(leafPayload(leaf, payloadSize, first + 1), leafPayload(leaf, payloadSize, end), (numKeys - end) * payloadSize);
+	for (int i = numKeys - gone; i < numKeys; i++) {
+		leaf->keyArray[i] = MYNULL;
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertPosting
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::insertPosting(const PageId headPid, const RecordId rid, const char* payload)
+{
+	Page* headPage;
+	bufMgr->readPage(file, headPid, headPage);
+	PostingNode* head = (PostingNode*)headPage;
+	head->totalRids++;
+	std::uint64_t value = ridValue(rid);
+
+	// RecordIds mostly come in order, so try the end of the list first
+	PageId pid = head->lastPageNo;
+	Page* page = headPage;
+	if (pid != headPid) {
+		bufMgr->readPage(file, pid, page);
+	}
+	PostingNode* node = (PostingNode*)page;
+	if (node->numRids == 0 || ridValue(node->lastRid) <= value) {
+		if (!appendPostingRid(node, rid, payload, payloadSize)) {
+			// the last page is full, the list goes on on a new one
+			PageId newPid;
+			Page* newPage;
+			bufMgr->allocPage(file, newPid, newPage);
+			initPosting((PostingNode*)newPage);
+			appendPostingRid((PostingNode*)newPage, rid, payload, payloadSize);
+			bufMgr->unPinPage(file, newPid, true);
+			node->nextPageNo = newPid;
+			head->lastPageNo = newPid;
+		}
+		if (pid != headPid) {
+			bufMgr->unPinPage(file, pid, true);
+		}
+		bufMgr->unPinPage(file, headPid, true);
+		return;
+	}
+	if (pid != headPid) {
+		bufMgr->unPinPage(file, pid, false);
+	}
+
+	// rid goes on the first page whose last RecordId is not below it
+	pid = headPid;
+	page = headPage;
+	node = head;
+	while (ridValue(node->lastRid) < value) {
+		PageId nextPid = node->nextPageNo;
+		if (pid != headPid) {
+			bufMgr->unPinPage(file, pid, false);
+		}
+		pid = nextPid;
+		bufMgr->readPage(file, pid, page);
+		node = (PostingNode*)page;
+	}
+	std::vector<RecordId> rids;
+	std::vector<char> payloads;
+	readPostingPage(node, rids, payloads, payloadSize);
+	size_t pos = 0;
+	while (pos < rids.size() && ridValue(rids[pos]) <= value) {
+		pos++;
+	}
+	rids.insert(rids.begin() + pos, rid);
+	payloads.insert(payloads.begin() + pos * payloadSize, payload, payload + payloadSize);
+	if (!writePostingPage(node, rids, payloads, payloadSize, 0, rids.size())) {
+		// split the page, the upper half moves to a new page after it
+		size_t middle = rids.size() / 2;
+		PageId newPid;
+		Page* newPage;
+		bufMgr->allocPage(file, newPid, newPage);
+		PostingNode* newNode = (PostingNode*)newPage;
+		initPosting(newNode);
+		newNode->nextPageNo = node->nextPageNo;
+		writePostingPage(newNode, rids, payloads, payloadSize, middle, rids.size());
+		bufMgr->unPinPage(file, newPid, true);
+		node->nextPageNo = newPid;
+		writePostingPage(node, rids, payloads, payloadSize, 0, middle);
+		if (head->lastPageNo == pid) {
+			head->lastPageNo = newPid;
+		}
+	}
+	if (pid != headPid) {
+		bufMgr->unPinPage(file, pid, true);
+	}
+	bufMgr->unPinPage(file, headPid, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::seekPosting
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::seekPosting(const PageId headPid, const RecordId rid, const bool after, PostingPosition& position,
+		RecordId& atRid)
+{
+	std::uint64_t value = ridValue(rid);
+	PageId pid = headPid;
+	while (pid != Page::INVALID_NUMBER) {
+		Page* page;
+		bufMgr->readPage(file, pid, page);
+		PostingNode* node = (PostingNode*)page;
+		std::uint64_t last = ridValue(node->lastRid);
+		if (after ? last > value : last >= value) {
+			// the RecordId is on this page, decode up to it
+			PostingPosition cur = postingStart(pid);
+			while (true) {
+				PostingPosition before = cur;
+				decodePostingRids(node, cur, &atRid, nullptr, 1, payloadSize);
+				std::uint64_t atValue = ridValue(atRid);
+				if (after ? atValue > value : atValue >= value) {
+					position = before;
+					bufMgr->unPinPage(file, pid, false);
+					return true;
+				}
+			}
+		}
+		PageId nextPid = node->nextPageNo;
+		bufMgr->unPinPage(file, pid, false);
+		pid = nextPid;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::removePosting
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::removePosting(LeafNodeInt* leaf, const int pos, const RecordId rid, std::vector<PageId>& freed)
+{
+	PageId headPid = leaf->ridArray[pos].page_number;
+	PageId prevPid = Page::INVALID_NUMBER;
+	PageId pid = headPid;
+	std::uint64_t value = ridValue(rid);
+	std::vector<RecordId> rids;
+	std::vector<char> payloads;
+	Page* page;
+	while (true) {
+		if (pid == Page::INVALID_NUMBER) {
+			return false;
+		}
+		bufMgr->readPage(file, pid, page);
+		PostingNode* node = (PostingNode*)page;
+		if (ridValue(node->lastRid) >= value) {
+			readPostingPage(node, rids, payloads, payloadSize);
+			std::vector<RecordId>::iterator it = std::find(rids.begin(), rids.end(), rid);
+			if (it == rids.end()) {
+				bufMgr->unPinPage(file, pid, false);
+				return false;
+			}
+			std::vector<char>::iterator at = payloads.begin() + (it - rids.begin()) * payloadSize;
+			payloads.erase(at, at + payloadSize);
+			rids.erase(it);
+			break;
+		}
+		PageId nextPid = node->nextPageNo;
+		bufMgr->unPinPage(file, pid, false);
+		prevPid = pid;
+		pid = nextPid;
+	}
+
+	PostingNode* node = (PostingNode*)page;
+	PageId nextPid = node->nextPageNo;
+	if (!rids.empty()) {
+		// dropping a RecordId never makes the encoding longer
+		writePostingPage(node, rids, payloads, payloadSize, 0, rids.size());
+		bufMgr->unPinPage(file, pid, true);
+	} else if (prevPid == Page::INVALID_NUMBER) {
+		// the first page is left empty, the next one takes over the list; a list always holds two
+		// RecordIds or more, so there is one
+		PageId lastPid = node->lastPageNo;
+		int totalRids = node->totalRids;
+		bufMgr->unPinPage(file, pid, false);
+		freed.push_back(pid);
+		Page* nextPage;
+		bufMgr->readPage(file, nextPid, nextPage);
+		((PostingNode*)nextPage)->lastPageNo = lastPid;
+		((PostingNode*)nextPage)->totalRids = totalRids;
+		bufMgr->unPinPage(file, nextPid, true);
+		headPid = nextPid;
+		leaf->ridArray[pos].page_number = headPid;
+	} else {
+		// unlink a page left empty further down the list
+		bufMgr->unPinPage(file, pid, false);
+		freed.push_back(pid);
+		Page* prevPage;
+		bufMgr->readPage(file, prevPid, prevPage);
+		((PostingNode*)prevPage)->nextPageNo = nextPid;
+		bufMgr->unPinPage(file, prevPid, true);
+		Page* headPage;
+		bufMgr->readPage(file, headPid, headPage);
+		if (((PostingNode*)headPage)->lastPageNo == pid) {
+			((PostingNode*)headPage)->lastPageNo = prevPid;
+		}
+		bufMgr->unPinPage(file, headPid, true);
+	}
+
+	// a list down to one RecordId goes back to being a plain entry
+	Page* headPage;
+	bufMgr->readPage(file, headPid, headPage);
+	PostingNode* head = (PostingNode*)headPage;
+	if (head->nextPageNo == Page::INVALID_NUMBER && head->numRids == 1) {
+		PostingPosition position = postingStart(headPid);
+		decodePostingRids(head, position, leaf->ridArray + pos, leafPayload(leaf, payloadSize, pos), 1, payloadSize);
+		bufMgr->unPinPage(file, headPid, false);
+		freed.push_back(headPid);
+	} else {
+		head->totalRids--;
+		bufMgr->unPinPage(file, headPid, true);
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readPosting
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::readPosting(const PageId headPid, std::vector<RecordId>& outRids, std::vector<char>* outPayloads)
+{
+	PageId pid = headPid;
+	std::vector<RecordId> rids;
+	std::vector<char> payloads;
+	while (pid != Page::INVALID_NUMBER) {
+		Page* page;
+		bufMgr->readPage(file, pid, page);
+		readPostingPage((PostingNode*)page, rids, payloads, payloadSize);
+		outRids.insert(outRids.end(), rids.begin(), rids.end());
+		if (outPayloads != nullptr) {
+			outPayloads->insert(outPayloads->end(), payloads.begin(), payloads.end());
+		}
+		PageId nextPid = ((PostingNode*)page)->nextPageNo;
+		bufMgr->unPinPage(file, pid, false);
+		pid = nextPid;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookup
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::lookup(const void* key, std::vector<RecordId>& outRids)
+{
+	outRids.clear();
+	if (bloomFilter.numBlocks() > 0 && !bloomFilter.mayContain(bloomHash(key))) {
+		return 0;
+	}
+	if (attributeType == STRING) {
+		return lookupString(makeStringKey((const char*)key), outRids);
+	}
+
+	int keyInt = *((int*)key);
+	if (insertBufferLimit > 0) {
+		lookupBufferedInt(keyInt, outRids, nullptr);
+		return outRids.size();
+	}
+	PageId leafPid;
+	Page* page = findLeafInt(keyInt, leafPid, false);
+	probeLeafInt(page, leafPid, keyInt, outRids, nullptr);
+	unlatchPage(leafPid, false, false);
+	return outRids.size();
+}
+
+int BTreeIndex::lookup(const void* key, std::vector<RecordId>& outRids, std::vector<char>& outPayloads)
+{
+	outRids.clear();
+	outPayloads.clear();
+	if (bloomFilter.numBlocks() > 0 && !bloomFilter.mayContain(bloomHash(key))) {
+		return 0;
+	}
+	if (attributeType == STRING) {
+		return lookupString(makeStringKey((const char*)key), outRids);
+	}
+
+	int keyInt = *((int*)key);
+	if (insertBufferLimit > 0) {
+		lookupBufferedInt(keyInt, outRids, &outPayloads);
+		return outRids.size();
+	}
+	PageId leafPid;
+	Page* page = findLeafInt(keyInt, leafPid, false);
+	probeLeafInt(page, leafPid, keyInt, outRids, &outPayloads);
+	unlatchPage(leafPid, false, false);
+	return outRids.size();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupBufferedInt
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::lookupBufferedInt(const int key, std::vector<RecordId>& outRids, std::vector<char>* outPayloads)
+{
+	while (true) {
+		// the buffered entries are copied first and the tree read after; a flush in between may have
+		// moved some of them into the tree, and then the lookup starts over
+		std::vector<std::pair<std::uint64_t, BufferedInsert> > buffered;
+		std::uint64_t flushes;
+		{
+			std::lock_guard<std::mutex> guard(insertBufferMutex);
+			std::multimap<std::pair<int, std::uint64_t>, BufferedInsert>::const_iterator it =
+					insertBuffer.lower_bound(std::make_pair(key, (std::uint64_t)0));
+			for (; it != insertBuffer.end() && it->first.first == key; ++it) {
+				buffered.push_back(std::make_pair(it->first.second, it->second));
+			}
+			flushes = insertBufferFlushes;
+		}
+
+		outRids.clear();
+		if (outPayloads != nullptr) {
+			outPayloads->clear();
+		}
+		PageId leafPid;
+		Page* page = findLeafInt(key, leafPid, false);
+		probeLeafInt(page, leafPid, key, outRids, outPayloads);
+		unlatchPage(leafPid, false, false);
+
+		{
+			std::lock_guard<std::mutex> guard(insertBufferMutex);
+			if (insertBufferFlushes != flushes) {
+				continue;
+			}
+		}
+		if (buffered.empty()) {
+			return;
+		}
+
+		// merge the buffered entries in among those of the tree, both being in RecordId order
+		std::vector<RecordId> rids;
+		std::vector<char> payloads;
+		size_t next = 0;
+		for (size_t i = 0; i <= outRids.size(); i++) {
+			for (; next < buffered.size() && (i == outRids.size() || buffered[next].first < ridValue(outRids[i])); next++) {
+				rids.push_back(buffered[next].second.rid);
+				payloads.insert(payloads.end(), buffered[next].second.payload.begin(), buffered[next].second.payload.end());
+			}
+			if (i < outRids.size()) {
+				rids.push_back(outRids[i]);
+				if (outPayloads != nullptr) {
+					payloads.insert(payloads.end(), outPayloads->begin() + i * payloadSize,
+							outPayloads->begin() + (i + 1) * payloadSize);
+				}
+			}
+		}
+		outRids.swap(rids);
+		if (outPayloads != nullptr) {
+			outPayloads->swap(payloads);
+		}
+		return;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::probeLeafInt
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::probeLeafInt(Page*& page, PageId& leafPid, const int key, std::vector<RecordId>& outRids,
+		std::vector<char>* outPayloads)
+{
+	LeafNodeInt* leaf = (LeafNodeInt*)page;
+	int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+	int entry = intLowerBound(leaf->keyArray, numKeys, key, false);
+	while (true) {
+		for (; entry < numKeys && leaf->keyArray[entry] == key; entry++) {
+			if (isPostingRid(leaf->ridArray[entry])) {
+				readPosting(leaf->ridArray[entry].page_number, outRids, outPayloads);
+			} else {
+				outRids.push_back(leaf->ridArray[entry]);
+				if (outPayloads != nullptr) {
+					const char* payload = leafPayload(leaf, payloadSize, entry);
+					outPayloads->insert(outPayloads->end(), payload, payload + payloadSize);
+				}
+			}
+		}
+		// duplicates of the key can continue on the right sibling
+		if (entry < numKeys || leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+			break;
+		}
+		PageId nextPid = leaf->rightSibPageNo;
+		page = latchPage(nextPid, false);
+		unlatchPage(leafPid, false, false);
+		leafPid = nextPid;
+		leaf = (LeafNodeInt*)page;
+		numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		entry = 0;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupMany
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::lookupMany(const void* const* keys, const int numKeys, std::vector<RecordId>& outRids,
+		std::vector<int>& outOffsets)
+{
+	outRids.clear();
+	outOffsets.clear();
+	flushInsertBuffer();
+	if (attributeType == STRING) {
+		lookupManyString(keys, numKeys, outRids, outOffsets);
+	} else {
+		lookupManyInt(keys, numKeys, outRids, outOffsets);
+	}
+	outOffsets.push_back(outRids.size());
+	return outRids.size();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupManyInt
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::lookupManyInt(const void* const* keys, const int numKeys, std::vector<RecordId>& outRids,
+		std::vector<int>& outOffsets)
+{
+	Page* page = nullptr;
+	PageId leafPid = Page::INVALID_NUMBER;
+	int prevKey = 0;
+	int lastKey = 0;
+	for (int i = 0; i < numKeys; i++) {
+		int key = *((const int*)keys[i]);
+		outOffsets.push_back(outRids.size());
+		if (i > 0 && key == lastKey) {
+			// a key probed twice in a row gets the same entries again
+			int begin = outOffsets[i - 1];
+			int end = outOffsets[i];
+			outRids.reserve(outRids.size() + end - begin);
+			for (int j = begin; j < end; j++) {
+				outRids.push_back(outRids[j]);
+			}
+			continue;
+		}
+		lastKey = key;
+		if (bloomFilter.numBlocks() > 0 && !bloomFilter.mayContain(BloomFilter::hash(&key, sizeof(int)))) {
+			continue;
+		}
+		if (page != nullptr) {
+			// every leaf left of the one the key probed before ended on only holds smaller keys, so a larger
+			// key that is not past the last key of this leaf starts on it
+			LeafNodeInt* leaf = (LeafNodeInt*)page;
+			int leafKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+			if (key < prevKey || leafKeys == 0 || leaf->keyArray[leafKeys - 1] < key) {
+				unlatchPage(leafPid, false, false);
+				page = nullptr;
+			}
+		}
+		if (page == nullptr) {
+			page = findLeafInt(key, leafPid, false);
+		}
+		probeLeafInt(page, leafPid, key, outRids, nullptr);
+		prevKey = key;
+	}
+	if (page != nullptr) {
+		unlatchPage(leafPid, false, false);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getPayloadSize
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getPayloadSize() const
+{
+	return payloadSize;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getNodeCacheStats
+// -----------------------------------------------------------------------------
+
+NodeCacheStats BTreeIndex::getNodeCacheStats() const
+{
+	return nodeCache.getStats();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::clearNodeCacheStats
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::clearNodeCacheStats()
+{
+	nodeCache.clearStats();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::enableSubtreeCounts
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::enableSubtreeCounts()
+{
+	if (attributeType == STRING) {
+		return false;
+	}
+	if (!subtreeCounts) {
+		flushInsertBuffer();
+		fillCountsInt(rootPageNum);
+		Page* headerPage;
+		bufMgr->readPage(file, headerPageNum, headerPage);
+		((IndexMetaInfo*)headerPage)->subtreeCounts = true;
+		bufMgr->unPinPage(file, headerPageNum, true);
+		subtreeCounts = true;
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::enableEytzingerSearch
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::enableEytzingerSearch(const bool enabled)
+{
+	if (attributeType == STRING) {
+		return false;
+	}
+	eytzingerSearch = enabled;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::enableLearnedModel
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::enableLearnedModel(const int maxError)
+{
+	if (attributeType == STRING) {
+		return 0;
+	}
+	flushInsertBuffer();
+	learnedFresh = false;
+	learnedSegments.clear();
+	learnedSeparators.clear();
+	learnedLeaves.clear();
+	learnedMaxError = std::max(maxError, 0);
+	collectLeavesInt(rootPageNum);
+
+	// greedy pieces: each takes separators as long as some slope keeps all of them within maxError of
+	// their rank; the slopes allowed so far narrow to a cone with every separator taken
+	size_t i = 0;
+	while (i < learnedSeparators.size()) {
+		LearnedSegment segment;
+		segment.firstKey = learnedSeparators[i];
+		segment.rank = i;
+		double lowSlope = 0;
+		double highSlope = std::numeric_limits<double>::infinity();
+		size_t j = i + 1;
+		for (; j < learnedSeparators.size(); j++) {
+			double dx = (double)learnedSeparators[j] - segment.firstKey;
+			double dy = (double)j - segment.rank;
+			if (dx == 0) {
+				if (dy > learnedMaxError) {
+					break;
+				}
+				continue;
+			}
+			double low = std::max(lowSlope, (dy - learnedMaxError) / dx);
+			double high = std::min(highSlope, (dy + learnedMaxError) / dx);
+			if (low > high) {
+				break;
+			}
+			lowSlope = low;
+			highSlope = high;
+		}
+		segment.slope = highSlope == std::numeric_limits<double>::infinity() ? lowSlope : (lowSlope + highSlope) / 2;
+		learnedSegments.push_back(segment);
+		i = j;
+	}
+	learnedFresh = true;
+	return learnedSegments.size();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getLearnedSegments
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getLearnedSegments() const
+{
+	return learnedFresh ? learnedSegments.size() : 0;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::collectLeavesInt
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::collectLeavesInt(const PageId pageNo)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+	int numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+	for (int i = 0; i <= numKeys; i++) {
+		if (i > 0) {
+			learnedSeparators.push_back(node->keyArray[i - 1]);
+		}
+		if (node->level == 1) {
+			learnedLeaves.push_back(node->pageNoArray[i]);
+		} else {
+			collectLeavesInt(node->pageNoArray[i]);
+		}
+	}
+	bufMgr->unPinPage(file, pageNo, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::findLearnedLeafInt
+// -----------------------------------------------------------------------------
+
+Page* BTreeIndex::findLearnedLeafInt(const int key, PageId& leafPid)
+{
+	if (!learnedFresh) {
+		return nullptr;
+	}
+
+	// the piece of the key, then the window of ranks its prediction allows
+	int lo = 0;
+	int hi = learnedSegments.size();
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (learnedSegments[mid].firstKey < key) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	const LearnedSegment& segment = learnedSegments[lo];
+	double predicted = segment.rank + segment.slope * ((double)key - segment.firstKey);
+	if (lo + 1 < (int)learnedSegments.size()) {
+		predicted = std::min(predicted, learnedSegments[lo + 1].rank);
+	}
+	int numSeparators = learnedSeparators.size();
+	double first = std::max(0.0, std::min((double)numSeparators, predicted - learnedMaxError - 1));
+	double last = std::max(0.0, std::min((double)numSeparators, predicted + learnedMaxError + 1));
+	int begin = (int)first;
+	int end = (int)std::ceil(last);
+	int rank = begin + intLowerBound(learnedSeparators.data() + begin, end - begin, key, false);
+
+	// the rank is right only if the separators around it bound the key
+	if ((rank > 0 && learnedSeparators[rank - 1] >= key) || (rank < numSeparators && learnedSeparators[rank] < key)) {
+		return nullptr;
+	}
+
+	// a split or merge of the leaf latches it exclusively and drops the model first, so a model still fresh
+	// once the latch is held means the leaf still holds the key range it had
+	PageId pid = learnedLeaves[rank];
+	Page* page = latchPage(pid, false);
+	if (!learnedFresh) {
+		unlatchPage(pid, false, false);
+		return nullptr;
+	}
+	nodeCache.count(0, false);
+	leafPid = pid;
+	return page;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::enableInsertBuffer
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::enableInsertBuffer(const int maxEntries)
+{
+	if (attributeType == STRING) {
+		return false;
+	}
+	flushInsertBuffer();
+	insertBufferLimit = std::max(maxEntries, 0);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::flushInsertBuffer
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::flushInsertBuffer()
+{
+	if (insertBufferLimit > 0) {
+		std::lock_guard<std::mutex> guard(insertBufferMutex);
+		drainInsertBuffer();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::drainInsertBuffer
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::drainInsertBuffer()
+{
+	if (insertBuffer.empty()) {
+		return;
+	}
+	std::multimap<std::pair<int, std::uint64_t>, BufferedInsert>::const_iterator it = insertBuffer.begin();
+	while (it != insertBuffer.end()) {
+		// descend as an insert of the first entry would, then keep adding to the leaf the entries whose keys
+		// it is certain to hold: that key again, or keys strictly between its first and last one
+		int key = it->first.first;
+		std::vector<PathEntry> path;
+		PageId leafPid;
+		Page* page = subtreeCounts ? latchCountPathInt(key, path, leafPid) : findLeafInt(key, leafPid, true);
+		LeafNodeInt* leaf = (LeafNodeInt*)page;
+		int added = 0;
+		for (; it != insertBuffer.end(); ++it, added++) {
+			int next = it->first.first;
+			int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+			if (next != key && (numKeys == 0 || next <= leaf->keyArray[0] || next >= leaf->keyArray[numKeys - 1])) {
+				break;
+			}
+			const RecordId& rid = it->second.rid;
+			const char* payload = it->second.payload.data();
+			if (!insertPostingInt(leaf, numKeys, next, rid, payload)) {
+				if (numKeys >= leafOccupancy) {
+					break;
+				}
+				insertLeafInt(leaf, numKeys, leafIntUpperBound(leaf, numKeys, next, rid), next, rid, payload, payloadSize);
+			}
+		}
+		unlatchPage(leafPid, true, added > 0);
+		releaseCountPath(path, added);
+
+		// the leaf is full: a plain insert splits it
+		if (added == 0) {
+			insertEntryInt(key, it->second.rid, it->second.payload.data());
+			++it;
+		}
+	}
+	insertBuffer.clear();
+	insertBufferFlushes++;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::enableBloomFilter
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::enableBloomFilter(const int bitsPerKey)
+{
+	// room for twice the keys there are now, so the filter stays useful while the index grows
+	flushInsertBuffer();
+	std::vector<std::uint64_t> hashes;
+	hashKeys(hashes);
+	const std::uint32_t blocksPerPage = Page::SIZE / BloomFilter::BLOCK_BYTES;
+	std::uint64_t bits = (std::uint64_t)std::max(hashes.size(), (size_t)1024) * 2 * std::max(bitsPerKey, 1);
+	std::uint64_t blocks = (bits + BloomFilter::BLOCK_BYTES * 8 - 1) / (BloomFilter::BLOCK_BYTES * 8);
+	blocks = std::min(blocks, (std::uint64_t)MAXBLOOMPAGES * blocksPerPage);
+	bloomFilter.reset(blocks);
+	for (size_t i = 0; i < hashes.size(); i++) {
+		bloomFilter.add(hashes[i]);
+	}
+
+	// the filter gets pages of its own size, written when the index is closed
+	for (size_t i = 0; i < bloomPages.size(); i++) {
+		bufMgr->disposePage(file, bloomPages[i]);
+	}
+	bloomPages.resize((blocks + blocksPerPage - 1) / blocksPerPage);
+	for (size_t i = 0; i < bloomPages.size(); i++) {
+		Page* page;
+		bufMgr->allocPage(file, bloomPages[i], page);
+		bufMgr->unPinPage(file, bloomPages[i], true);
+	}
+	Page* headerPage;
+	bufMgr->readPage(file, headerPageNum, headerPage);
+	IndexMetaInfo* headerInfo = (IndexMetaInfo*)headerPage;
+	headerInfo->bloomBlocks = blocks;
+	headerInfo->bloomClean = false;
+	headerInfo->numBloomPages = bloomPages.size();
+	std::copy(bloomPages.begin(), bloomPages.end(), headerInfo->bloomPages);
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getBloomFilterBits
+// -----------------------------------------------------------------------------
+
+std::uint64_t BTreeIndex::getBloomFilterBits() const
+{
+	return (std::uint64_t)bloomFilter.numBlocks() * BloomFilter::BLOCK_BYTES * 8;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::hashKeys
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::hashKeys(std::vector<std::uint64_t>& outHashes)
+{
+	PageId leafPid;
+	if (attributeType == STRING) {
+		LeafNodeString* leaf = (LeafNodeString*)findLeafString(std::string(), leafPid, false);
+		std::string last;
+		while (true) {
+			for (int i = 0; i < leaf->numKeys; i++) {
+				std::string key = leafStringKey(leaf, i);
+				if (outHashes.empty() || key != last) {
+					outHashes.push_back(BloomFilter::hash(key.data(), key.size()));
+					last = key;
+				}
+			}
+			PageId nextPid = leaf->rightSibPageNo;
+			if (nextPid == Page::INVALID_NUMBER) {
+				break;
+			}
+			leaf = (LeafNodeString*)latchPage(nextPid, false);
+			unlatchPage(leafPid, false, false);
+			leafPid = nextPid;
+		}
+	} else {
+		LeafNodeInt* leaf = (LeafNodeInt*)findLeafInt(INT_MIN, leafPid, false);
+		int last = 0;
+		while (true) {
+			int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+			for (int i = 0; i < numKeys; i++) {
+				if (outHashes.empty() || leaf->keyArray[i] != last) {
+					last = leaf->keyArray[i];
+					outHashes.push_back(BloomFilter::hash(&last, sizeof(int)));
+				}
+			}
+			PageId nextPid = leaf->rightSibPageNo;
+			if (nextPid == Page::INVALID_NUMBER) {
+				break;
+			}
+			leaf = (LeafNodeInt*)latchPage(nextPid, false);
+			unlatchPage(leafPid, false, false);
+			leafPid = nextPid;
+		}
+	}
+	unlatchPage(leafPid, false, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::fillBloomFilter
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::fillBloomFilter(const std::uint32_t blocks)
+{
+	std::vector<std::uint64_t> hashes;
+	hashKeys(hashes);
+	bloomFilter.reset(blocks);
+	for (size_t i = 0; i < hashes.size(); i++) {
+		bloomFilter.add(hashes[i]);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::markBloomFilter
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::markBloomFilter(const bool clean)
+{
+	Page* headerPage;
+	bufMgr->readPage(file, headerPageNum, headerPage);
+	((IndexMetaInfo*)headerPage)->bloomClean = clean;
+	bufMgr->unPinPage(file, headerPageNum, true);
+	bufMgr->flushPage(file, headerPageNum);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::writeRootInfo
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::writeRootInfo(const int rootLevel)
+{
+	Page* headerPage;
+	bufMgr->readPage(file, headerPageNum, headerPage);
+	IndexMetaInfo* headerInfo = (IndexMetaInfo*)headerPage;
+	headerInfo->rootPageNo = rootPageNum;
+	headerInfo->rootLevel = rootLevel;
+	headerInfo->rootEpoch++;
+	bufMgr->unPinPage(file, headerPageNum, true);
+	bufMgr->flushPage(file, headerPageNum);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getRootEpoch
+// -----------------------------------------------------------------------------
+
+std::uint32_t BTreeIndex::getRootEpoch() const
+{
+	Page* headerPage;
+	bufMgr->readPage(file, headerPageNum, headerPage);
+	std::uint32_t epoch = ((IndexMetaInfo*)headerPage)->rootEpoch;
+	bufMgr->unPinPage(file, headerPageNum, false);
+	return epoch;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getRootLevel
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getRootLevel() const
+{
+	Page* headerPage;
+	bufMgr->readPage(file, headerPageNum, headerPage);
+	int level = ((IndexMetaInfo*)headerPage)->rootLevel;
+	bufMgr->unPinPage(file, headerPageNum, false);
+	return level;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bloomHash
+// -----------------------------------------------------------------------------
+
+std::uint64_t BTreeIndex::bloomHash(const void* key) const
+{
+	if (attributeType == STRING) {
+		std::string stringKey = makeStringKey((const char*)key);
+		return BloomFilter::hash(stringKey.data(), stringKey.size());
+	}
+	return BloomFilter::hash(key, sizeof(int));
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::fillCountsInt
+// -----------------------------------------------------------------------------
+
+long BTreeIndex::fillCountsInt(const PageId pageNo)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+	int numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+	long total = 0;
+	for (int i = 0; i <= numKeys; i++) {
+		PageId childPid = node->pageNoArray[i];
+		long count;
+		if (node->level == 1) {
+			Page* leafPage;
+			bufMgr->readPage(file, childPid, leafPage);
+			LeafNodeInt* leaf = (LeafNodeInt*)leafPage;
+			count = leafEntriesInt(leaf, 0, countKeys(leaf->keyArray, INTARRAYLEAFSIZE));
+			bufMgr->unPinPage(file, childPid, false);
+		} else {
+			count = fillCountsInt(childPid);
+		}
+		node->countArray[i] = count;
+		total += count;
+	}
+	bufMgr->unPinPage(file, pageNo, true);
+	return total;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countRange
+// -----------------------------------------------------------------------------
+
+long BTreeIndex::countRange(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	if ((lowOpParm != GTE && lowOpParm != GT) || (highOpParm != LT && highOpParm != LTE)) {
+		throw BadOpcodesException();
+	}
+	flushInsertBuffer();
+	if (attributeType == STRING) {
+		std::string low = makeStringKey((const char*)lowValParm);
+		std::string high = makeStringKey((const char*)highValParm);
+		if (high < low) {
+			throw BadScanrangeException();
+		}
+		return countLeavesString(low, lowOpParm, high, highOpParm);
+	}
+
+	// bounds are made inclusive as in startScanInt
+	long long low = *((const int*)lowValParm);
+	long long high = *((const int*)highValParm);
+	if (high < low) {
+		throw BadScanrangeException();
+	}
+	low += lowOpParm == GT ? 1 : 0;
+	high -= highOpParm == LT ? 1 : 0;
+	if (high < low) {
+		return 0;
+	}
+	if (!subtreeCounts) {
+		return countLeavesInt(low, high);
+	}
+
+	// the shared root latch keeps splits and merges out until the count is done
+	PageId rootPid;
+	Page* rootPage = latchRoot(rootPid, false);
+	long count = countSubtreeInt(rootPid, ((NonLeafNodeInt*)rootPage)->level, low, high, true, true);
+	unlatchPage(rootPid, false, false);
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countSubtreeInt
+// -----------------------------------------------------------------------------
+
+long BTreeIndex::countSubtreeInt(const PageId pageNo, const int level, const int low, const int high,
+		const bool lowBounded, const bool highBounded)
+{
+	if (level == 0) {
+		Page* page = latchPage(pageNo, false);
+		LeafNodeInt* leaf = (LeafNodeInt*)page;
+		int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		int begin = lowBounded ? intLowerBound(leaf->keyArray, numKeys, low, false) : 0;
+		int end = highBounded ? intLowerBound(leaf->keyArray, numKeys, high, true) : numKeys;
+		long count = leafEntriesInt(leaf, begin, end);
+		unlatchPage(pageNo, false, false);
+		return count;
+	}
+
+	// the children strictly between those the two bounds lead to are counted whole
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+	int numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+	int first = lowBounded ? intLowerBound(node->keyArray, numKeys, low, false) : -1;
+	int last = highBounded ? intLowerBound(node->keyArray, numKeys, high, false) : numKeys + 1;
+	long count = 0;
+	for (int i = first + 1; i < last; i++) {
+		count += loadCountInt(node, i);
+	}
+	PageId firstPid = first >= 0 ? node->pageNoArray[first] : Page::INVALID_NUMBER;
+	PageId lastPid = last <= numKeys ? node->pageNoArray[last] : Page::INVALID_NUMBER;
+	bufMgr->unPinPage(file, pageNo, false);
+	if (first == last) {
+		return countSubtreeInt(firstPid, level - 1, low, high, lowBounded, highBounded);
+	}
+
+	// below that, only the low bound cuts into the first child and only the high bound into the last
+	if (firstPid != Page::INVALID_NUMBER) {
+		count += countSubtreeInt(firstPid, level - 1, low, high, true, false);
+	}
+	if (lastPid != Page::INVALID_NUMBER) {
+		count += countSubtreeInt(lastPid, level - 1, low, high, false, true);
+	}
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countLeavesInt
+// -----------------------------------------------------------------------------
+
+long BTreeIndex::countLeavesInt(const int low, const int high)
+{
+	PageId leafPid;
+	LeafNodeInt* leaf = (LeafNodeInt*)findLeafInt(low, leafPid, false);
+	long count = 0;
+	while (true) {
+		int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		int begin = intLowerBound(leaf->keyArray, numKeys, low, false);
+		int end = intLowerBound(leaf->keyArray, numKeys, high, true);
+		count += leafEntriesInt(leaf, begin, end);
+		PageId nextPid = leaf->rightSibPageNo;
+		if (end < numKeys || nextPid == Page::INVALID_NUMBER) {
+			break;
+		}
+		// leaves are latched left to right, each before the one left of it is let go
+		leaf = (LeafNodeInt*)latchPage(nextPid, false);
+		unlatchPage(leafPid, false, false);
+		leafPid = nextPid;
+	}
+	unlatchPage(leafPid, false, false);
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countLeavesString
+// -----------------------------------------------------------------------------
+
+long BTreeIndex::countLeavesString(const std::string& low, const Operator lowOp, const std::string& high,
+		const Operator highOp)
+{
+	PageId leafPid;
+	LeafNodeString* leaf = (LeafNodeString*)findLeafString(low, leafPid, false);
+	long count = 0;
+	while (true) {
+		int begin = leafStringLowerBound(leaf, low, lowOp == GT);
+		int end = leafStringLowerBound(leaf, high, highOp == LTE);
+		count += std::max(end - begin, 0);
+		PageId nextPid = leaf->rightSibPageNo;
+		if (end < leaf->numKeys || nextPid == Page::INVALID_NUMBER) {
+			break;
+		}
+		leaf = (LeafNodeString*)latchPage(nextPid, false);
+		unlatchPage(leafPid, false, false);
+		leafPid = nextPid;
+	}
+	unlatchPage(leafPid, false, false);
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::estimateSelectivity
+// -----------------------------------------------------------------------------
+
+double BTreeIndex::estimateSelectivity(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	if ((lowOpParm != GTE && lowOpParm != GT) || (highOpParm != LT && highOpParm != LTE)) {
+		throw BadOpcodesException();
+	}
+	if (attributeType == STRING) {
+		std::string low = makeStringKey((const char*)lowValParm);
+		std::string high = makeStringKey((const char*)highValParm);
+		if (high < low) {
+			throw BadScanrangeException();
+		}
+		PageId rootPid;
+		Page* rootPage = latchRoot(rootPid, false);
+		double share = estimateString(rootPage, ((NonLeafNodeString*)rootPage)->level, low, lowOpParm, high,
+				highOpParm, true, true);
+		unlatchPage(rootPid, false, false);
+		return share;
+	}
+	long long low = *((const int*)lowValParm);
+	long long high = *((const int*)highValParm);
+	if (high < low) {
+		throw BadScanrangeException();
+	}
+	low += lowOpParm == GT ? 1 : 0;
+	high -= highOpParm == LT ? 1 : 0;
+	if (high < low) {
+		return 0.0;
+	}
+
+	// nodes are latched shared from the root down to the leaves at the two bounds
+	PageId rootPid;
+	Page* rootPage = latchRoot(rootPid, false);
+	double share = estimateInt(rootPage, ((NonLeafNodeInt*)rootPage)->level, low, high, true, true);
+	unlatchPage(rootPid, false, false);
+	return share;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::estimateInt
+// -----------------------------------------------------------------------------
+
+double BTreeIndex::estimateInt(const Page* page, const int level, const int low, const int high,
+		const bool lowBounded, const bool highBounded)
+{
+	if (level == 0) {
+		const LeafNodeInt* leaf = (const LeafNodeInt*)page;
+		int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		int begin = lowBounded ? intLowerBound(leaf->keyArray, numKeys, low, false) : 0;
+		int end = highBounded ? intLowerBound(leaf->keyArray, numKeys, high, true) : numKeys;
+		return numKeys == 0 ? 0.0 : (double)(end - begin) / numKeys;
+	}
+
+	// children weigh by their entry counts if those are kept, otherwise all alike
+	const NonLeafNodeInt* node = (const NonLeafNodeInt*)page;
+	int numKeys = countKeys(node->keyArray, INTARRAYNONLEAFSIZE);
+	int first = lowBounded ? intLowerBound(node->keyArray, numKeys, low, false) : -1;
+	int last = highBounded ? intLowerBound(node->keyArray, numKeys, high, false) : numKeys + 1;
+	double total = subtreeCounts ? sumCountsInt(node) : numKeys + 1;
+	if (total <= 0) {
+		return 0.0;
+	}
+	// share of child i in the range, times its weight
+	auto below = [&](const int i, const bool lowCut, const bool highCut) {
+		PageId childPid = node->pageNoArray[i];
+		Page* child = latchPage(childPid, false);
+		double share = estimateInt(child, level - 1, low, high, lowCut, highCut);
+		unlatchPage(childPid, false, false);
+		return share * (subtreeCounts ? loadCountInt(node, i) : 1);
+	};
+	if (first == last) {
+		return below(first, lowBounded, highBounded) / total;
+	}
+
+	// only the low bound cuts into the first child and only the high bound into the last
+	double inside = 0;
+	for (int i = first + 1; i < last; i++) {
+		inside += subtreeCounts ? loadCountInt(node, i) : 1;
+	}
+	if (first >= 0) {
+		inside += below(first, true, false);
+	}
+	if (last <= numKeys) {
+		inside += below(last, false, true);
+	}
+	return inside / total;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::estimateString
+// -----------------------------------------------------------------------------
+
+double BTreeIndex::estimateString(const Page* page, const int level, const std::string& low, const Operator lowOp,
+		const std::string& high, const Operator highOp, const bool lowBounded, const bool highBounded)
+{
+	if (level == 0) {
+		const LeafNodeString* leaf = (const LeafNodeString*)page;
+		int begin = lowBounded ? leafStringLowerBound(leaf, low, lowOp == GT) : 0;
+		int end = highBounded ? leafStringLowerBound(leaf, high, highOp == LTE) : leaf->numKeys;
+		return leaf->numKeys == 0 || end <= begin ? 0.0 : (double)(end - begin) / leaf->numKeys;
+	}
+
+	const NonLeafNodeString* node = (const NonLeafNodeString*)page;
+	int first = lowBounded ? nonLeafStringChildIndex(node, low) : -1;
+	int last = highBounded ? nonLeafStringChildIndex(node, high) : node->numKeys + 1;
+	auto below = [&](const int i, const bool lowCut, const bool highCut) {
+		PageId childPid = nonLeafStringChild(node, i);
+		Page* child = latchPage(childPid, false);
+		double share = estimateString(child, level - 1, low, lowOp, high, highOp, lowCut, highCut);
+		unlatchPage(childPid, false, false);
+		return share;
+	};
+	if (first == last) {
+		return below(first, lowBounded, highBounded) / (node->numKeys + 1);
+	}
+	double inside = last - first - 1;
+	if (first >= 0) {
+		inside += below(first, true, false);
+	}
+	if (last <= node->numKeys) {
+		inside += below(last, false, true);
+	}
+	return inside / (node->numKeys + 1);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::openScan
+// -----------------------------------------------------------------------------
+
+IndexScanCursor* BTreeIndex::openScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	return newCursor(lowValParm, lowOpParm, highValParm, highOpParm, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::openReverseScan
+// -----------------------------------------------------------------------------
+
+IndexScanCursor* BTreeIndex::openReverseScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	return newCursor(lowValParm, lowOpParm, highValParm, highOpParm, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::newCursor
+// -----------------------------------------------------------------------------
+
+IndexScanCursor* BTreeIndex::newCursor(const void* lowValParm, const Operator lowOpParm, const void* highValParm,
+		const Operator highOpParm, const bool descending)
+{
+    	// check type ids
+    	if (lowOpParm != GTE && lowOpParm != GT) {
+        	throw BadOpcodesException();
+	} 
+    	if (highOpParm != LT && highOpParm != LTE) {
+       	 	throw BadOpcodesException();
+    	}
+
+	// scans read the tree alone, so whatever is buffered goes in first
+	flushInsertBuffer();
+	IndexScanCursor* cursor = new IndexScanCursor(this, lowOpParm, highOpParm, descending);
+	try {
+		if (attributeType == STRING) {
+			startScanString(*cursor, makeStringKey((const char*)lowValParm), makeStringKey((const char*)highValParm));
+		} else {
+			startScanInt(*cursor, *((int*)lowValParm), *((int*)highValParm));
+		}
+	} catch (...) {
+		delete cursor;
+		throw;
+	}
+	return cursor;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::openMultiScan
+// -----------------------------------------------------------------------------
+
+IndexScanCursor* BTreeIndex::openMultiScan(const ScanRange* ranges, const int numRanges)
+{
+	IndexScanCursor* cursor = new IndexScanCursor(this, GTE, LTE, false);
+	try {
+		setRanges(*cursor, ranges, numRanges);
+	} catch (...) {
+		delete cursor;
+		throw;
+	}
+	flushInsertBuffer();
+	if (!advanceRange(*cursor)) {
+		// no range can match, the scan is over before it starts
+		return cursor;
+	}
+
+	// the first batch finds the first match from here, see scanBatchInt
+	PageId leafPid;
+	if (attributeType == STRING) {
+		cursor->currentPageData = findLeafString(cursor->lowValString, leafPid, false);
+	} else {
+		cursor->currentPageData = findLeafInt(cursor->lowValInt, leafPid, false);
+	}
+	cursor->leafShiftsSeen = leafShifts;
+	latches.get(leafPid).unlockShared();
+	cursor->currentPageNum = leafPid;
+	return cursor;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::setRanges
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::setRanges(IndexScanCursor& cursor, const ScanRange* ranges, const int numRanges)
+{
+	std::vector<IndexScanCursor::Range> sorted;
+	for (int i = 0; i < numRanges; i++) {
+		if ((ranges[i].lowOp != GTE && ranges[i].lowOp != GT) || (ranges[i].highOp != LT && ranges[i].highOp != LTE)) {
+			throw BadOpcodesException();
+		}
+		IndexScanCursor::Range range;
+		range.lowOp = ranges[i].lowOp;
+		range.highOp = ranges[i].highOp;
+		range.lowInt = 0;
+		range.highInt = 0;
+		if (attributeType == STRING) {
+			range.lowString = makeStringKey((const char*)ranges[i].lowVal);
+			range.highString = makeStringKey((const char*)ranges[i].highVal);
+			if (range.highString < range.lowString) {
+				throw BadScanrangeException();
+			}
+			if (range.lowString == range.highString && (range.lowOp == GT || range.highOp == LT)) {
+				continue;
+			}
+		} else {
+			// bounds are made inclusive as in startScanInt
+			long long low = *((const int*)ranges[i].lowVal);
+			long long high = *((const int*)ranges[i].highVal);
+			if (high < low) {
+				throw BadScanrangeException();
+			}
+			low += range.lowOp == GT ? 1 : 0;
+			high -= range.highOp == LT ? 1 : 0;
+			if (high < low) {
+				continue;
+			}
+			range.lowInt = low;
+			range.highInt = high;
+			range.lowOp = GTE;
+			range.highOp = LTE;
+		}
+		sorted.push_back(range);
+	}
+
+	bool isString = attributeType == STRING;
+	std::sort(sorted.begin(), sorted.end(), [isString](const IndexScanCursor::Range& a, const IndexScanCursor::Range& b) {
+		if (!isString) {
+			return a.lowInt < b.lowInt;
+		}
+		// a range that includes its low bound starts before one that does not
+		return a.lowString < b.lowString || (a.lowString == b.lowString && a.lowOp == GTE && b.lowOp == GT);
+	});
+
+	// merge each range into the one before it if they overlap or nothing lies between them
+	for (size_t i = 0; i < sorted.size(); i++) {
+		IndexScanCursor::Range& range = sorted[i];
+		if (cursor.ranges.empty()) {
+			cursor.ranges.push_back(range);
+			continue;
+		}
+		IndexScanCursor::Range& last = cursor.ranges.back();
+		if (!isString) {
+			if ((long long)range.lowInt <= (long long)last.highInt + 1) {
+				last.highInt = std::max(last.highInt, range.highInt);
+			} else {
+				cursor.ranges.push_back(range);
+			}
+			continue;
+		}
+		if (range.lowString < last.highString
+				|| (range.lowString == last.highString && (range.lowOp == GTE || last.highOp == LTE))) {
+			if (last.highString < range.highString) {
+				last.highString = range.highString;
+				last.highOp = range.highOp;
+			} else if (last.highString == range.highString && range.highOp == LTE) {
+				last.highOp = LTE;
+			}
+		} else {
+			cursor.ranges.push_back(range);
+		}
+	}
+	cursor.nextRange = 0;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::advanceRange
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::advanceRange(IndexScanCursor& cursor)
+{
+	if (cursor.nextRange >= cursor.ranges.size()) {
+		return false;
+	}
+	const IndexScanCursor::Range& range = cursor.ranges[cursor.nextRange++];
+	cursor.lowValInt = range.lowInt;
+	cursor.highValInt = range.highInt;
+	cursor.lowValString = range.lowString;
+	cursor.highValString = range.highString;
+	cursor.lowOp = range.lowOp;
+	cursor.highOp = range.highOp;
+	cursor.lastValid = false;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startScan
+// -----------------------------------------------------------------------------
 
+void BTreeIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)  
 {
-	std::ostringstream idxStr;
-	idxStr << relationName << "." << attrByteOffset;
-	outIndexName = idxStr.str();
-	// check if the index file exists
-	if (!File::exists(outIndexName)) {
-		// create the index file if not already exists
-		std::shared_ptr<BlobFile> blobFile; // initialized to nullptr
-		blobFile = std::make_shared<BlobFile>(BlobFile::create(outIndexName));
-		
-		// initialize metadata
-		BTreeIndex::file = blobFile.get();
-		BTreeIndex::bufMgr = bufMgrIn;
-		BTreeIndex::attributeType = attrType;
-		BTreeIndex::attrByteOffset = attrByteOffset;
+	// open the new cursor first, a scan that fails to start leaves the current one alone
+	IndexScanCursor* cursor = openScan(lowValParm, lowOpParm, highValParm, highOpParm);
 
-		// create header page
-		Page* headerPage;
-		bufMgr->allocPage(file, headerPageNum, headerPage); // file->writePage(headerPageNum, headerPage);
-		IndexMetaInfo* headerInfo = (IndexMetaInfo *)headerPage;
-		strcpy(headerInfo->relationName, relationName.c_str());
-		headerInfo->attrByteOffset = attrByteOffset;
-		headerInfo->attrType = attrType;
-		// const IndexMetaInfo btreeHeader = {outIndexName[0], attrByteOffset, attrType, 2};
-		// Page headerPage = *(reinterpret_cast<const Page*>(&btreeHeader));
-		bufMgr->unPinPage(file, headerPageNum, true);
+	// end scan if one if already going on
+	if (scanExecuting) {
+		endScan();
+	}
+	scanCursor = cursor;
+	scanExecuting = true;
+}
 
-		// create root page
-		Page* rootPage;
-		bufMgr->allocPage(file, rootPageNum, rootPage);
-		((NonLeafNodeInt*)rootPage)->level=1;
-		// set empty nonleaf's keys and pageNums all to NULL 
-		for (int i=0; i < INTARRAYNONLEAFSIZE; i++) {
-			((NonLeafNodeInt*)rootPage)->keyArray[i] = MYNULL;
-			((NonLeafNodeInt*)rootPage)->pageNoArray[i] = Page::INVALID_NUMBER;
-		}
-		((NonLeafNodeInt*)rootPage)->pageNoArray[INTARRAYNONLEAFSIZE] = Page::INVALID_NUMBER;
-		bufMgr->unPinPage(file, rootPageNum, true);
+// -----------------------------------------------------------------------------
+// BTreeIndex::startReverseScan
+// -----------------------------------------------------------------------------
 
-		headerInfo->rootPageNo = BTreeIndex::rootPageNum; 
+void BTreeIndex::startReverseScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	IndexScanCursor* cursor = openReverseScan(lowValParm, lowOpParm, highValParm, highOpParm);
+	if (scanExecuting) {
+		endScan();
+	}
+	scanCursor = cursor;
+	scanExecuting = true;
+}
 
-		// insert entries for every tuple in the base relation using FileScan class
-		FileScan fileScanner = FileScan(relationName, bufMgrIn);
-		try {
-			RecordId rid;
-			while (true) {
-				fileScanner.scanNext(rid);
-				std::string record = fileScanner.getRecord();
-				// get key from record 
-				const char *record_ptr = record.c_str();
-				const void *key = (int *)(record_ptr + attrByteOffset);
-				
-				// std::cout << *((int*)key) << std::endl;
-				
-				// if (*((int*)key) == -320) {
-				// 	std::cout << "STOP" << std::endl;
-				// }
-				
-				insertEntry(key, rid);
+// -----------------------------------------------------------------------------
+// BTreeIndex::startScanInt
+// -----------------------------------------------------------------------------
 
-				// for debugging
-				NonLeafNodeInt* rootInfo = (NonLeafNodeInt*)rootPage;
-			}
-		} catch(EndOfFileException e) {
-			// end of file scan
-		}
-		// fileScanner.~FileScan();
-	} else {
-		// if exists, open the index file
-		std::shared_ptr<BlobFile> blobFile;
-		blobFile = std::make_shared<BlobFile>(BlobFile::open(outIndexName));
-		BTreeIndex::file = blobFile.get();
-		// check if the metadata in header matches with the given values
-		BTreeIndex::bufMgr = bufMgrIn;
-		BTreeIndex::headerPageNum = file->getFirstPageNo(); // or 1
-		BTreeIndex::attributeType = attrType;
-		BTreeIndex::attrByteOffset = attrByteOffset;
-		Page* headerPage;
-		bufMgr->readPage(file, headerPageNum, headerPage); // Page headerPage = (*file).readPage(headerPageNum);
-		bufMgr->unPinPage(file, headerPageNum, true);
-		// convert char[](Page) to struct 
-		IndexMetaInfo* headerInfo = (IndexMetaInfo*)(headerPage);
-		// if not match, throw BadIndexInfoException
-		if (headerInfo->relationName != relationName || headerInfo->attrByteOffset != attrByteOffset 
-				|| headerInfo->attrType != attrType) {
-			throw new BadIndexInfoException(outIndexName);
-		}
-		BTreeIndex::rootPageNum = headerInfo->rootPageNo;
+void BTreeIndex::startScanInt(IndexScanCursor& cursor, const int lowVal, const int highVal)
+{
+	int localLow = lowVal;
+	int localHigh = highVal;
+
+    // if low param is greater than high param throw error
+    if (localHigh < localLow) {
+       	throw BadScanrangeException();
+    }
+
+	// change < to <= and > to >=; an open bound at the end of the int range matches nothing
+	if ((cursor.lowOp == GT && localLow == INT_MAX) || (cursor.highOp == LT && localHigh == INT_MIN)) {
+		throw NoSuchKeyFoundException();
 	}
-	scanExecuting = false;
-	BTreeIndex::nodeOccupancy = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
-	BTreeIndex::leafOccupancy = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+	if (cursor.highOp == LT) {
+		localHigh -= 1;
+	}
+	if (cursor.lowOp == GT) {
+		localLow += 1;
+	}
+
+	// set scan variables
+	cursor.lowValInt = localLow;
+	cursor.highValInt = localHigh;
+	if (cursor.descending) {
+		startReverseScanInt(cursor);
+		return;
+	}
+
+	PageId leafPid;
+	Page* leafPage = findLeafInt(localLow, leafPid, false);
+	LeafNodeInt* leaf = (LeafNodeInt*)leafPage;
+	int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+	int entry = intLowerBound(leaf->keyArray, numKeys, localLow, false);
+
+	// the first match can sit further right, past leaves whose keys are all below the low bound
+	while (entry == numKeys && leaf->rightSibPageNo != Page::INVALID_NUMBER) {
+		PageId nextPid = leaf->rightSibPageNo;
+		leafPage = latchPage(nextPid, false);
+		unlatchPage(leafPid, false, false);
+		leafPid = nextPid;
+		leaf = (LeafNodeInt*)leafPage;
+		numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		entry = intLowerBound(leaf->keyArray, numKeys, localLow, false);
+	}
+
+	if (entry == numKeys || leaf->keyArray[entry] > localHigh) {
+		unlatchPage(leafPid, false, false);
+		throw NoSuchKeyFoundException();
+	}
+
+	// the leaf stays pinned for scanNext, but its latch is only held inside each call
+	cursor.leafShiftsSeen = leafShifts;
+	latches.get(leafPid).unlockShared();
+	cursor.currentPageNum = leafPid;
+	cursor.currentPageData = leafPage;
+	cursor.nextEntry = entry;
+	cursor.posting.pageNo = Page::INVALID_NUMBER;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::scanNext(RecordId& outRid){
+	//check if scan is in proccess
+	if(scanExecuting == false){
+		throw ScanNotInitializedException();
+	}
+	scanCursor->scanNext(outRid);
 }
 
+void BTreeIndex::scanNext(RecordId& outRid, char* outPayload)
+{
+	if (!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	scanCursor->scanNext(outRid, outPayload);
+}
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::~BTreeIndex -- destructor
+// BTreeIndex::scanNextBatch
 // -----------------------------------------------------------------------------
 
-BTreeIndex::~BTreeIndex()
+int BTreeIndex::scanNextBatch(RecordId* outRids, const int maxRids)
 {
-	if (scanExecuting) {
-		try {
-			endScan();
-		} catch (PagePinnedException e) {
+	if (!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	return scanCursor->scanNextBatch(outRids, maxRids);
+}
 
-		} catch (BadgerDbException e) {
-			// unpin all pages
-			// TODO
-		}
+int BTreeIndex::scanNextBatch(RecordId* outRids, char* outPayloads, const int maxRids)
+{
+	if (!scanExecuting) {
+		throw ScanNotInitializedException();
 	}
-	// assuming all pinned papges are unpinned as soon as the btree finishes using them.
-	try {
-		bufMgr->flushFile(file);
-	} catch (PagePinnedException e) {
+	return scanCursor->scanNextBatch(outRids, outPayloads, maxRids);
+}
 
-	} catch (BadgerDbException e) {
-		// unpin all pages
-		// TODO
-	} 
-	// delete bufMgr;
-	file->~File();
-}
-
-// -----------------------------------------------------------------------------
-// BTreeIndex::traverseTree
-//------------------------------------------------------------------------------
-
-LeafNodeInt* BTreeIndex::traverseTree (Page current, int target, int level) {
-    if (level != 1) {
-		// cast page to nonLeafNode
-		NonLeafNodeInt* cur = reinterpret_cast<NonLeafNodeInt*>(&current);
-		LeafNodeInt* next;
-		int flag = 0;
-		int pos = INTARRAYNONLEAFSIZE-1;
-		// search for next node
-		for (int i = 0; i < INTARRAYNONLEAFSIZE-1; i++) {
-			int curkey = cur->keyArray[i];
-			// if the target is less than the current key
-			if (curkey == MYNULL || target < curkey) {
-				// recursive case #1
-				flag = 1;
-				pos = i;
-				Page* nextPage = nullptr; 
-				bufMgr->readPage(file, cur->pageNoArray[i], nextPage);
-				bufMgr->unPinPage(file, cur->pageNoArray[i], true);
-				next = traverseTree(*nextPage, target, cur->level);
-				break;
-			}
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanBatchInt
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::scanBatchInt(IndexScanCursor& cursor, RecordId* outRids, char* outPayloads, const int maxRids)
+{
+	if (cursor.currentPageNum == Page::INVALID_NUMBER || maxRids <= 0) {
+		return 0;
+	}
+
+	latches.get(cursor.currentPageNum).lockShared();
+	LeafNodeInt* leaf = (LeafNodeInt*)cursor.currentPageData;
+	int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+
+	// where the scan goes on after the entry it returned last, which may be gone by now; searching is set
+	// if that is past the leaf
+	PostingPosition posting;
+	bool searching = false;
+	auto resume = [&]() {
+		int pos = resumeLeafInt(leaf, numKeys, cursor.lastKeyInt, cursor.lastRid, posting);
+		searching = pos == numKeys;
+		return pos;
+	};
+
+	// find our place again: since the last call inserts may have shifted the entries of the leaf,
+	// or moved them to a new leaf on the right
+	int entry;
+	posting.pageNo = Page::INVALID_NUMBER;
+	if (!cursor.lastValid) {
+		entry = intLowerBound(leaf->keyArray, numKeys, cursor.lowValInt, false);
+	} else if (latches.get(cursor.currentPageNum).readVersion() == cursor.leafVersion) {
+		// no one changed the leaf meanwhile
+		entry = cursor.nextEntry;
+		posting = cursor.posting;
+	} else if (cursor.nextEntry > 0 && cursor.nextEntry <= numKeys
+			&& leaf->keyArray[cursor.nextEntry - 1] == cursor.lastKeyInt
+			&& !isPostingRid(leaf->ridArray[cursor.nextEntry - 1])
+			&& leaf->ridArray[cursor.nextEntry - 1] == cursor.lastRid) {
+		entry = cursor.nextEntry;
+	} else {
+		entry = resume();
+	}
 
+	// a delete may have moved the entries we have not reached yet onto the leaf on the left, or merged
+	// this leaf away altogether: look the place up again from the root
+	std::uint64_t shifts = leafShifts;
+	if (entry == 0 && posting.pageNo == Page::INVALID_NUMBER && shifts != cursor.leafShiftsSeen) {
+		unlatchPage(cursor.currentPageNum, false, false);
+		int from = cursor.lastValid ? cursor.lastKeyInt : cursor.lowValInt;
+		cursor.currentPageData = findLeafInt(from, cursor.currentPageNum, false);
+		leaf = (LeafNodeInt*)cursor.currentPageData;
+		numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+		if (!cursor.lastValid) {
+			entry = intLowerBound(leaf->keyArray, numKeys, cursor.lowValInt, false);
+		} else {
+			entry = resume();
 		}
-		// enter the node at the right end
-		if (flag == 0) {
-			Page* nextPage;
-			bufMgr->readPage(file, cur->pageNoArray[pos], nextPage);
-			bufMgr->unPinPage(file, cur->pageNoArray[pos], true);
-			next = traverseTree(*nextPage, target, cur->level);
+	}
+	cursor.leafShiftsSeen = shifts;
+
+	int count = 0;
+	while (count < maxRids) {
+		// go on through the posting list of entry, a page at a time
+		if (posting.pageNo != Page::INVALID_NUMBER) {
+			PageId pid = posting.pageNo;
+			Page* page;
+			bufMgr->readPage(file, pid, page);
+			PostingNode* node = (PostingNode*)page;
+			int got = decodePostingRids(node, posting, outRids + count,
+					outPayloads != nullptr ? outPayloads + count * payloadSize : nullptr, maxRids - count, payloadSize);
+			if (got > 0) {
+				count += got;
+				cursor.lastKeyInt = leaf->keyArray[entry];
+				cursor.lastRid = posting.prev;
+				cursor.lastValid = true;
+			}
+			if (posting.next == node->numRids) {
+				posting = postingStart(node->nextPageNo);
+				if (posting.pageNo == Page::INVALID_NUMBER) {
+					entry++;
+				}
+			}
+			bufMgr->unPinPage(file, pid, false);
+			continue;
 		}
-		return next;
 
-	} else {
-		// nonleaf nodes directly above leaf!
-		// cast page to nonLeafNode
-		NonLeafNodeInt* cur = reinterpret_cast<NonLeafNodeInt*>(&current);
-		LeafNodeInt* leaf;
-		PageId leafPid;
-		int flag = 0;
-		int pos = INTARRAYNONLEAFSIZE-1;
-		// search for next node
-		for (int i = 0; i < INTARRAYNONLEAFSIZE-1; i++) {
-			int curkey = cur->keyArray[i];
-			// if the target is less than the current key
-			if (curkey == MYNULL || target < curkey) {
-				// recursive case #1
-				flag = 1;
-				pos = i;
-				Page* leafPage = nullptr; 
-				bufMgr->readPage(file, cur->pageNoArray[i], leafPage);
-				leaf = (LeafNodeInt*) leafPage;
-				leafPid = cur->pageNoArray[i];
-				break;
+		// move on to the right sibling once the current leaf is used up
+		if (entry == numKeys) {
+			PageId nextPid = leaf->rightSibPageNo;
+			if (nextPid == Page::INVALID_NUMBER) {
+				unlatchPage(cursor.currentPageNum, false, false);
+				cursor.currentPageNum = Page::INVALID_NUMBER;
+				cursor.currentPageData = nullptr;
+				return count;
+			}
+			Page* nextPage = latchPage(nextPid, false);
+			unlatchPage(cursor.currentPageNum, false, false);
+			cursor.currentPageNum = nextPid;
+			cursor.currentPageData = nextPage;
+			leaf = (LeafNodeInt*)nextPage;
+			numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+			if (!cursor.lastValid) {
+				entry = intLowerBound(leaf->keyArray, numKeys, cursor.lowValInt, false);
+			} else if (searching) {
+				entry = resume();
+			} else {
+				entry = 0;
 			}
+			continue;
+		}
 
+		// keys are sorted, so the matching entries left on this leaf are one run ending at the
+		// first key above the high bound; copy it out in one go up to the first posting list
+		int end = std::min(numKeys, entry + (maxRids - count));
+		int stop = std::min(end, intLowerBound(leaf->keyArray, numKeys, cursor.highValInt, true));
+		int run = entry;
+		while (run < stop && !isPostingRid(leaf->ridArray[run])) {
+			run++;
 		}
-		// enter the node at the right end
-		if (flag == 0) {
-			Page* leafPage;
-			bufMgr->readPage(file, cur->pageNoArray[pos], leafPage);
-			leaf = (LeafNodeInt*) leafPage;
-			leafPid = cur->pageNoArray[pos];
+		if (run > entry) {
+			memcpy(outRids + count, leaf->ridArray + entry, (run - entry) * sizeof(RecordId));
+			if (outPayloads != nullptr) {
+				memcpy(outPayloads + count * payloadSize, leafPayload(leaf, payloadSize, entry), (run - entry) * payloadSize);
+			}
+			count += run - entry;
+			cursor.lastKeyInt = leaf->keyArray[run - 1];
+			cursor.lastRid = leaf->ridArray[run - 1];
+			cursor.lastValid = true;
 		}
-
-		// check if the target is in this node
-		for (int i = 0; i < INTARRAYLEAFSIZE; i ++) {
-			if (leaf->keyArray[i] != MYNULL && leaf->keyArray[i] >= target) {
-				currentPageNum = leafPid;
-				nextEntry = i;
-				return leaf;
+		entry = run;
+		if (run < stop) {
+			posting = postingStart(leaf->ridArray[run].page_number);
+			continue;
+		}
+		if (stop < end) {
+			// reached the high bound; a multi-range scan goes on with its next range, on this leaf if it
+			// starts there and from the root otherwise
+			if (!advanceRange(cursor)) {
+				break;
+			}
+			searching = false;
+			entry = intLowerBound(leaf->keyArray, numKeys, cursor.lowValInt, false);
+			if (entry == numKeys) {
+				unlatchPage(cursor.currentPageNum, false, false);
+				cursor.currentPageData = findLeafInt(cursor.lowValInt, cursor.currentPageNum, false);
+				leaf = (LeafNodeInt*)cursor.currentPageData;
+				numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+				entry = intLowerBound(leaf->keyArray, numKeys, cursor.lowValInt, false);
 			}
 		}
-		// did not find the target
-		currentPageNum = Page::INVALID_NUMBER;
-		nextEntry = MYNULL;
-		LeafNodeInt* none = nullptr;
-		return none;
 	}
+	cursor.nextEntry = entry;
+	cursor.posting = posting;
+	cursor.leafVersion = latches.get(cursor.currentPageNum).readVersion();
+	latches.get(cursor.currentPageNum).unlockShared();
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::seekReverseInt
+// -----------------------------------------------------------------------------
 
+int BTreeIndex::seekReverseInt(IndexScanCursor& cursor)
+{
+	// all entries of a key are on one leaf and every leaf right of it holds larger keys only, so the place
+	// is on the leaf the key leads to
+	int from = cursor.lastValid ? cursor.lastKeyInt : cursor.highValInt;
+	cursor.currentPageData = findLeafInt(from, cursor.currentPageNum, false);
+	LeafNodeInt* leaf = (LeafNodeInt*)cursor.currentPageData;
+	int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+	cursor.postingLeft = 0;
+	if (!cursor.lastValid) {
+		return intLowerBound(leaf->keyArray, numKeys, cursor.highValInt, true);
+	}
+
+	int first = intLowerBound(leaf->keyArray, numKeys, cursor.lastKeyInt, false);
+	if (first < numKeys && leaf->keyArray[first] == cursor.lastKeyInt && isPostingRid(leaf->ridArray[first])) {
+		// a key with a posting list has no other entry, go on with its RecordIds below lastRid
+		cursor.postingRids.clear();
+		cursor.postingPayloads.clear();
+		readPosting(leaf->ridArray[first].page_number, cursor.postingRids, &cursor.postingPayloads);
+		std::uint64_t value = ridValue(cursor.lastRid);
+		cursor.postingLeft = std::lower_bound(cursor.postingRids.begin(), cursor.postingRids.end(), value,
+				[](const RecordId& rid, std::uint64_t v) { return ridValue(rid) < v; }) - cursor.postingRids.begin();
+		return cursor.postingLeft > 0 ? first + 1 : first;
+	}
+	return leafIntLowerBound(leaf, numKeys, cursor.lastKeyInt, cursor.lastRid);
 }
 
-void BTreeIndex::splitNonLeaf(NonLeafNodeInt* oldNode, PageId oldPid, NonLeafNodeInt* tempNode, NonLeafNodeInt* returnedNode, PageId returnPid) {
-	// extract info from tempNode
-	int newKey = tempNode->keyArray[0];
-	PageId page1 = tempNode->pageNoArray[0];
-	PageId page2 = tempNode->pageNoArray[1];
+// -----------------------------------------------------------------------------
+// BTreeIndex::stepLeftInt
+// -----------------------------------------------------------------------------
 
-	// create new page
-	Page* newPage = nullptr;
-	bufMgr->allocPage(file, nextPageID, newPage);
-	// unpin page and increment nextPageID
-	bufMgr->unPinPage(file, nextPageID, true);
-	PageId newPid = nextPageID;
+int BTreeIndex::stepLeftInt(IndexScanCursor& cursor)
+{
+	PageId leftPid = ((LeafNodeInt*)cursor.currentPageData)->leftSibPageNo;
+	if (leftPid == Page::INVALID_NUMBER) {
+		return -1;
+	}
+	Page* leftPage = latchLeftLeaf(cursor.currentPageNum, leftPid);
+	if (leftPage == nullptr) {
+		return seekReverseInt(cursor);
+	}
+	cursor.currentPageNum = leftPid;
+	cursor.currentPageData = leftPage;
 
-	// cast page to node
-	NonLeafNodeInt* newNode = (NonLeafNodeInt*)(newPage);
+	// every entry of the left sibling comes before those of the leaf we came from
+	LeafNodeInt* leaf = (LeafNodeInt*)leftPage;
+	int numKeys = countKeys(leaf->keyArray, INTARRAYLEAFSIZE);
+	if (!cursor.lastValid) {
+		return intLowerBound(leaf->keyArray, numKeys, cursor.highValInt, true);
+	}
+	return numKeys;
+}
 
-	// set all values in arrays of newNode to null
-	for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-		newNode->keyArray[i] = MYNULL;
+// -----------------------------------------------------------------------------
+// BTreeIndex::startReverseScanInt
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::startReverseScanInt(IndexScanCursor& cursor)
+{
+	int entry = seekReverseInt(cursor);
+
+	// the leaf the high bound leads to may hold nothing at or below it
+	while (entry == 0) {
+		entry = stepLeftInt(cursor);
+	}
+	if (entry < 0 || ((LeafNodeInt*)cursor.currentPageData)->keyArray[entry - 1] < cursor.lowValInt) {
+		unlatchPage(cursor.currentPageNum, false, false);
+		cursor.currentPageNum = Page::INVALID_NUMBER;
+		cursor.currentPageData = nullptr;
+		throw NoSuchKeyFoundException();
 	}
 
-	//calc halfindex
-	int halfindex = INTARRAYNONLEAFSIZE/2;
-	//get middlekey
-	int middleKey = oldNode->keyArray[halfindex];
-	// get page nos
-	Page* oldPage = (Page*)(oldNode);
-	PageId nextPage1 = oldPid;
-	PageId nextPage2 = newPid;
+	// the leaf stays pinned for scanNext, but its latch is only held inside each call
+	cursor.nextEntry = entry;
+	cursor.leafVersion = latches.get(cursor.currentPageNum).readVersion();
+	latches.get(cursor.currentPageNum).unlockShared();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::reverseBatchInt
+// -----------------------------------------------------------------------------
 
-	// remove middlekey and pageNos
-	for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-		if (oldNode->keyArray[i] > middleKey) {
-			oldNode->keyArray[i-1] = oldNode->keyArray[i];
+int BTreeIndex::reverseBatchInt(IndexScanCursor& cursor, RecordId* outRids, char* outPayloads, const int maxRids)
+{
+	if (cursor.currentPageNum == Page::INVALID_NUMBER || maxRids <= 0) {
+		return 0;
+	}
+
+	// if the leaf changed since the last call, a split may have moved the entries we have not reached yet
+	// onto a new leaf on its right, or a delete onto the leaf on its left: look the place up from the root
+	latches.get(cursor.currentPageNum).lockShared();
+	int entry = cursor.nextEntry;
+	if (latches.get(cursor.currentPageNum).readVersion() != cursor.leafVersion) {
+		unlatchPage(cursor.currentPageNum, false, false);
+		entry = seekReverseInt(cursor);
+	}
+	LeafNodeInt* leaf = (LeafNodeInt*)cursor.currentPageData;
+
+	int count = 0;
+	while (count < maxRids) {
+		// go on through the posting list of the entry before entry
+		if (cursor.postingLeft > 0) {
+			int got = std::min(cursor.postingLeft, maxRids - count);
+			for (int i = 0; i < got; i++) {
+				cursor.postingLeft--;
+				if (outPayloads != nullptr) {
+					std::copy_n(cursor.postingPayloads.begin() + cursor.postingLeft * payloadSize, payloadSize,
+							outPayloads + count * payloadSize);
+				}
+				outRids[count++] = cursor.postingRids[cursor.postingLeft];
+			}
+			cursor.lastKeyInt = leaf->keyArray[entry - 1];
+			cursor.lastRid = outRids[count - 1];
+			cursor.lastValid = true;
+			if (cursor.postingLeft == 0) {
+				entry--;
+			}
+			continue;
+		}
+
+		// move on to the left sibling once the current leaf is used up
+		if (entry == 0) {
+			entry = stepLeftInt(cursor);
+			if (entry < 0) {
+				unlatchPage(cursor.currentPageNum, false, false);
+				cursor.currentPageNum = Page::INVALID_NUMBER;
+				cursor.currentPageData = nullptr;
+				return count;
+			}
+			leaf = (LeafNodeInt*)cursor.currentPageData;
+			continue;
+		}
+
+		// the matching entries left on this leaf are one run down to the first key at or above the low
+		// bound; copy it out from the top down to the first posting list
+		int first = intLowerBound(leaf->keyArray, entry, cursor.lowValInt, false);
+		if (entry <= first) {
+			// reached the low bound
+			break;
+		}
+		if (isPostingRid(leaf->ridArray[entry - 1])) {
+			cursor.postingRids.clear();
+			cursor.postingPayloads.clear();
+			readPosting(leaf->ridArray[entry - 1].page_number, cursor.postingRids, &cursor.postingPayloads);
+			cursor.postingLeft = cursor.postingRids.size();
+			continue;
+		}
+		int stop = std::max(first, entry - (maxRids - count));
+		int run = entry;
+		while (run > stop && !isPostingRid(leaf->ridArray[run - 1])) {
+			run--;
+			if (outPayloads != nullptr) {
+				memcpy(outPayloads + count * payloadSize, leafPayload(leaf, payloadSize, run), payloadSize);
+			}
+			outRids[count++] = leaf->ridArray[run];
 		}
+		cursor.lastKeyInt = leaf->keyArray[run];
+		cursor.lastRid = leaf->ridArray[run];
+		cursor.lastValid = true;
+		entry = run;
+	}
+	cursor.nextEntry = entry;
+	cursor.leafVersion = latches.get(cursor.currentPageNum).readVersion();
+	latches.get(cursor.currentPageNum).unlockShared();
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::endScan
+// -----------------------------------------------------------------------------
+//
+void BTreeIndex::endScan(){
+	//stops scan and  throws error if startScan has not been called
+	if(!scanExecuting){
+		throw ScanNotInitializedException();
 	}
-	oldNode->keyArray[INTARRAYNONLEAFSIZE-1] = MYNULL;
+	scanExecuting = false;//end the scan
+	// deleting the cursor unpins its leaf
+	delete scanCursor;
+	scanCursor = nullptr;
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanCursor::IndexScanCursor
+// -----------------------------------------------------------------------------
+
+IndexScanCursor::IndexScanCursor(BTreeIndex *index, const Operator lowOp, const Operator highOp, const bool descending)
+	: index(index),
+		descending(descending),
+		nextEntry(0),
+		currentPageNum(Page::INVALID_NUMBER),
+		currentPageData(nullptr),
+		lowValInt(0),
+		highValInt(0),
+		lowOp(lowOp),
+		highOp(highOp),
+		lastValid(false),
+		lastKeyInt(0),
+		leafShiftsSeen(0),
+		leafVersion(0),
+		postingLeft(0),
+		nextRange(0)
+{
+	posting.pageNo = Page::INVALID_NUMBER;
+	posting.next = 0;
+	posting.offset = 0;
+	posting.prev = RecordId();
+}
 
-	//redistribute array values to each node
-	for (int i = halfindex; i < INTARRAYNONLEAFSIZE; i++) {
-		newNode->keyArray[i-halfindex] = oldNode->keyArray[i];
+// -----------------------------------------------------------------------------
+// IndexScanCursor::~IndexScanCursor
+// -----------------------------------------------------------------------------
 
-		// remove old values
-		oldNode->keyArray[i] = MYNULL;
-	}
-	for (int i = halfindex; i < INTARRAYNONLEAFSIZE+1; i++) {
-		newNode->pageNoArray[i-halfindex] = oldNode->pageNoArray[i];
+IndexScanCursor::~IndexScanCursor()
+{
+	// unpin the leaf, unless the scan already ran off the last one
+	if (currentPageNum != Page::INVALID_NUMBER) {
+		index->bufMgr->unPinPage(index->file, currentPageNum, false);
 	}
+}
 
-	// insert newKey and pages
-	int tempKey[INTARRAYLEAFSIZE];
-	PageId temppid[INTARRAYLEAFSIZE+1];
+// -----------------------------------------------------------------------------
+// IndexScanCursor::scanNext
+// -----------------------------------------------------------------------------
 
-	// if newKey will go into oldNode
-	if (newKey < middleKey) {
+void IndexScanCursor::scanNext(RecordId& outRid)
+{
+	scanNext(outRid, nullptr);
+}
 
-		// find pos first
-		int pos = -1;
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			if (oldNode->keyArray[i] > newKey || oldNode->keyArray[i] == MYNULL) {
-				pos = i;
-				break;
-			}
-		}	
+void IndexScanCursor::scanNext(RecordId& outRid, char* outPayload)
+{
+	if (scanNextBatch(&outRid, outPayload, 1) == 0) {
+		throw IndexScanCompletedException();
+	}
+}
 
-		for (int i = 0; i < INTARRAYNONLEAFSIZE-1; i++) {
-			if ( i < pos) {
-				tempKey[i] = oldNode->keyArray[i];
-			} else {
-				tempKey[i+1] = oldNode->keyArray[i];
-			}
-		}
+// -----------------------------------------------------------------------------
+// IndexScanCursor::scanNextBatch
+// -----------------------------------------------------------------------------
 
-		// set middlekey
-		tempKey[pos] = newKey;
+int IndexScanCursor::scanNextBatch(RecordId* outRids, const int maxRids)
+{
+	return scanNextBatch(outRids, nullptr, maxRids);
+}
 
-		// loop for pageNoArray
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			if ( i < pos) {
-				temppid[i] = oldNode->pageNoArray[i];
-			} else if (i > pos) {
-				temppid[i+1] = oldNode->pageNoArray[i];
-			}
+int IndexScanCursor::scanNextBatch(RecordId* outRids, char* outPayloads, const int maxRids)
+{
+	if (index->attributeType == STRING) {
+		if (descending) {
+			return index->reverseBatchString(*this, outRids, maxRids);
 		}
+		return index->scanBatchString(*this, outRids, maxRids);
+	}
+	if (descending) {
+		return index->reverseBatchInt(*this, outRids, outPayloads, maxRids);
+	}
+	return index->scanBatchInt(*this, outRids, outPayloads, maxRids);
+}
 
-		// set pageIds
-		temppid[pos] = page1;
-		temppid[pos+1] = page2;
+// -----------------------------------------------------------------------------
+// BTreeIndex::findLeafString
+// -----------------------------------------------------------------------------
 
-		// set temp arrays to oldNode
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			oldNode->keyArray[i] = tempKey[i];
-		}
-		for (int i = 0; i < INTARRAYNONLEAFSIZE+1; i++) {
-			oldNode->pageNoArray[i] = temppid[i];
+Page* BTreeIndex::findLeafString(const std::string& key, PageId& leafPid, const bool exclusive)
+{
+	NonLeafNodeString node;
+	while (true) {
+		PageId pid = rootPageNum;
+		bool cached;
+		Page* page = readNode(pid, cached);
+		std::uint32_t version = latches.get(pid).readVersion();
+		if (rootPageNum != pid) {
+			releaseNode(pid, page, cached, false);
+			continue;
 		}
-
-	// if newKey will go into newNode
-	} else {
-
-		// find pos first
-		int pos = -1;
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			if (newNode->keyArray[i] > newKey || newNode->keyArray[i] == MYNULL) {
-				pos = i;
+		Page* leafPage = nullptr;
+		bool validated = false;
+		while (true) {
+			memcpy(&node, page, sizeof(NonLeafNodeString));
+			if (!latches.get(pid).validate(version)) {
 				break;
 			}
-		}	
+			nodeCache.count(node.level, cached);
+			PageId childPid = nonLeafStringChild(&node, nonLeafStringChildIndex(&node, key));
 
-		for (int i = 0; i < INTARRAYNONLEAFSIZE-1; i++) {
-			if ( i < pos) {
-				tempKey[i] = newNode->keyArray[i];
-			} else {
-				tempKey[i+1] = newNode->keyArray[i];
+			if (node.level == 1) {
+				Page* childPage = latchPage(childPid, exclusive);
+				if (latches.get(pid).validate(version)) {
+					leafPid = childPid;
+					leafPage = childPage;
+					validated = true;
+					nodeCache.count(0, false);
+				} else {
+					unlatchPage(childPid, exclusive, false);
+				}
+				break;
 			}
-		}
-
-		// set middlekey
-		tempKey[pos] = newKey;
 
-		// loop for pageNoArray
-		for (int i = 0; INTARRAYNONLEAFSIZE; i++) {
-			if ( i < pos) {
-				temppid[i] = newNode->pageNoArray[i];
-			} else if (i > pos) {
-				temppid[i+1] = newNode->pageNoArray[i];
+			bool childCached;
+			Page* childPage = readNode(childPid, childCached);
+			std::uint32_t childVersion = latches.get(childPid).readVersion();
+			if (!latches.get(pid).validate(version)) {
+				releaseNode(childPid, childPage, childCached, false);
+				break;
 			}
+			releaseNode(pid, page, cached, true);
+			pid = childPid;
+			page = childPage;
+			cached = childCached;
+			version = childVersion;
 		}
-
-		// set pageIds
-		temppid[pos] = page1;
-		temppid[pos+1] = page2;
-
-		// set temp arrays to newNode
-		// set temp arrays to oldNode
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			newNode->keyArray[i] = tempKey[i];
-		}
-		for (int i = 0; i < INTARRAYNONLEAFSIZE+1; i++) {
-			newNode->pageNoArray[i] = temppid[i];
+		releaseNode(pid, page, cached, validated);
+		if (leafPage != nullptr) {
+			return leafPage;
 		}
-
 	}
-
-	//give tempnode middlekey and pages too pass up
-	returnedNode->level = oldNode->level+1; // this doesnt actually matter for this node
-	returnedNode->keyArray[0] = middleKey;
-	returnedNode->pageNoArray[0] = nextPage1;
-	returnedNode->pageNoArray[1] = nextPage2;
-
 }
 
-void BTreeIndex::insertIntoNonLeaf(NonLeafNodeInt* tempNode, NonLeafNodeInt*& cur) {
-	// extract middle key(target) and pageNos from tempNode
-	int newKey = tempNode->keyArray[0];
-	PageId page1 = tempNode->pageNoArray[0];
-	PageId page2 = tempNode->pageNoArray[1];
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertEntryString
+// -----------------------------------------------------------------------------
 
-	int tempKey[INTARRAYNONLEAFSIZE];
-	PageId temppid[INTARRAYNONLEAFSIZE+1];
-	// add them into the current node
-	
-	// find pos first
-	int pos = INTARRAYNONLEAFSIZE-1;
-	// if target < all keys
-	// TODO insert to the left end
+void BTreeIndex::insertEntryString(const std::string& key, const RecordId rid)
+{
+	// most inserts fit on their leaf: find it optimistically and latch nothing but the leaf
+	PageId leafPid;
+	Page* page = findLeafString(key, leafPid, true);
+	LeafNodeString* leaf = (LeafNodeString*)page;
+	int pos = leafStringLowerBound(leaf, key, true);
+	if (insertStringEntry(leaf->data, leaf->numKeys, leaf->heapOffset, leaf->prefix, leaf->prefixLength,
+				key, &rid, sizeof(RecordId), pos)) {
+		unlatchPage(leafPid, true, true);
+		return;
+	}
+	std::vector<RIDKeyPair<std::string> > entries;
+	readLeafString(leaf, entries);
+	RIDKeyPair<std::string> pair;
+	pair.set(rid, key);
+	entries.insert(entries.begin() + pos, pair);
+	if (writeLeafString(leaf, entries, 0, entries.size())) {
+		unlatchPage(leafPid, true, true);
+		return;
+	}
+	unlatchPage(leafPid, true, false);
 
-	for (int i = 0; i < INTARRAYNONLEAFSIZE-1; i++) {
-		if (cur->keyArray[i] == MYNULL || cur->keyArray[i] > newKey) {
-			pos = i;
+	// the leaf has to split: descend again with exclusive latches, letting go of the ones above a node
+	// that is sure to take one more separator without splitting
+	std::vector<PathEntry> path;
+	PageId pid;
+	while (true) {
+		pid = rootPageNum;
+		page = latchPage(pid, true);
+		if (rootPageNum == pid) {
 			break;
 		}
+		// the root split while we waited for its latch
+		unlatchPage(pid, true, false);
 	}
-
-	for (int i = 0; i < INTARRAYNONLEAFSIZE-1; i++) {
-		if ( i < pos) {
-			tempKey[i] = cur->keyArray[i];
-		} else {
-			tempKey[i+1] = cur->keyArray[i];
+	int rootLevel = ((NonLeafNodeString*)page)->level;
+	while (true) {
+		NonLeafNodeString* node = (NonLeafNodeString*)page;
+		if (stringNodeSafe(node->numKeys, node->prefixLength, node->heapOffset, STRINGNONLEAFDATASIZE, sizeof(PageId))) {
+			releasePath(path);
 		}
-	}
-
-	// loop for pageNoArray
-	for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-		if ( i < pos) {
-			temppid[i] = cur->pageNoArray[i];
-		} else if (i > pos) {
-			temppid[i+1] = cur->pageNoArray[i];
+		PathEntry entry;
+		entry.pageNo = pid;
+		entry.page = page;
+		entry.child = nonLeafStringChildIndex(node, key);
+		path.push_back(entry);
+		int level = node->level;
+		pid = nonLeafStringChild(node, entry.child);
+		page = latchPage(pid, true);
+		if (level == 1) {
+			break;
 		}
 	}
 
-	// add new key and pages
-	tempKey[pos] = newKey;
-	temppid[pos] = page1;
-	// potential place of failure
-	temppid[pos+1] = page2;
-	
-	for (int i  = 0; i < INTARRAYNONLEAFSIZE; i++) {
-		cur->keyArray[i] = tempKey[i];
+	// add the entry to the leaf, after any duplicates of the key
+	leaf = (LeafNodeString*)page;
+	leafPid = pid;
+	if (stringNodeSafe(leaf->numKeys, leaf->prefixLength, leaf->heapOffset, STRINGLEAFDATASIZE, sizeof(RecordId))) {
+		releasePath(path);
 	}
-	for (int i  = 0; i < INTARRAYNONLEAFSIZE+1; i++) {
-		cur->pageNoArray[i] = temppid[i];
-	}
-
-}
+	bool split = false;
+	std::string separator;
+	PageId newPid = Page::INVALID_NUMBER;
+	pos = leafStringLowerBound(leaf, key, true);
+	if (!insertStringEntry(leaf->data, leaf->numKeys, leaf->heapOffset, leaf->prefix, leaf->prefixLength,
+				key, &rid, sizeof(RecordId), pos)) {
+		// the key does not share the page prefix or the heap is full: rebuild the page
+		readLeafString(leaf, entries);
+		entries.insert(entries.begin() + pos, pair);
+		if (!writeLeafString(leaf, entries, 0, entries.size())) {
+			// still does not fit, move the upper half of the entries to a new leaf
+			int middle = splitPoint(entries);
+			Page* newPage;
+			bufMgr->allocPage(file, newPid, newPage);
+			LeafNodeString* newLeaf = (LeafNodeString*)newPage;
+			initLeafString(newLeaf);
+			writeLeafString(leaf, entries, 0, middle);
+			writeLeafString(newLeaf, entries, middle, entries.size());
 
-/*
-	temp node pointer is the output
-*/
-void BTreeIndex::splitLeafNode(LeafNodeInt* cur, PageId curPid, NonLeafNodeInt*& tempNode, int target, RecordId rid){
-	// create new node and page
-	Page* newPage = nullptr;
-	PageId newPid;
-	bufMgr->allocPage(file, newPid, newPage);
-	bufMgr->unPinPage(file, newPid, true); // unpinpage
-	LeafNodeInt* newNode = (LeafNodeInt*)(newPage);
+			// fix the linked list
+			newLeaf->rightSibPageNo = leaf->rightSibPageNo;
+			newLeaf->leftSibPageNo = leafPid;
+			leaf->rightSibPageNo = newPid;
+			linkLeftSibling(newLeaf->rightSibPageNo, newPid);
+			bufMgr->unPinPage(file, newPid, true);
 
-	// set all values of newNodes arrays to null
-	for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-		newNode->keyArray[i] = MYNULL;
-		// newNode->ridArray[i] = NULL;
-	}
-
-	// set the middle key
-	int halfindex = INTARRAYLEAFSIZE/2;
-	int middleKey = cur->keyArray[halfindex];
-
-	//populate arrays with old stuff
-	for (int i = halfindex; i < INTARRAYLEAFSIZE; i++) {
-		newNode->keyArray[i-halfindex] = cur->keyArray[i];
-		newNode->ridArray[i-halfindex] = cur->ridArray[i];
-
-		// remove old value
-		cur->keyArray[i] = MYNULL;
-		// cur->ridArray[i] = NULL;
-	}
-
-	// insert target key and rid into either the old node or the new one
-	// create temp new arrays
-	int tempKey[INTARRAYLEAFSIZE];
-	RecordId temprid[INTARRAYLEAFSIZE];
-
-	// if the target is going into the old node
-	if (target < middleKey) {
-		int pos = INTARRAYLEAFSIZE-1;
-		int flag = -1;
-		for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-			if (cur->keyArray[i] < target && cur->keyArray[i] != MYNULL) {
-				tempKey[i] = cur->keyArray[i];
-				temprid[i] = cur->ridArray[i];
-			} else if (flag == -1) {
-				pos = i;
-				flag = 0;
-				break;
-			}
+			separator = shortestSeparator(entries[middle - 1].key, entries[middle].key);
+			split = true;
 		}
+	}
+	unlatchPage(leafPid, true, true);
 
-		// add target key and rid and what's left in the origional keyarray and ridarray
-		tempKey[pos] = target;
-		temprid[pos] = rid;
-		for (int i = pos+1; i < INTARRAYLEAFSIZE; i++) {
-			tempKey[i] = cur->keyArray[i-1];
-			temprid[i] = cur->ridArray[i-1];
-		}
-		// set cur->arrays to temparrays
-		for (int i  = 0; i < INTARRAYLEAFSIZE; i ++) {
-			cur->keyArray[i] = tempKey[i];
-			cur->ridArray[i] = temprid[i];
-		}
+	// walk back up the nodes still latched, adding the separator of each split to the parent
+	bool topDirty = false;
+	for (int level = path.size() - 1; level >= 0; level--) {
+		NonLeafNodeString* node = (NonLeafNodeString*)path[level].page;
+		bool dirty = split;
+		if (split) {
+			// the new node goes right after the child we came from
+			pos = path[level].child;
+			split = false;
+			if (!insertStringEntry(node->data, node->numKeys, node->heapOffset, node->prefix, node->prefixLength,
+						separator, &newPid, sizeof(PageId), pos)) {
+				std::vector<PageKeyPair<std::string> > entries;
+				readNonLeafString(node, entries);
+				PageKeyPair<std::string> pair;
+				pair.set(newPid, separator);
+				entries.insert(entries.begin() + pos, pair);
+				if (!writeNonLeafString(node, node->leftmostPageNo, entries, 0, entries.size())) {
+					// split the node, the middle separator moves up to the parent
+					int middle = splitPoint(entries);
+					Page* newPage;
+					PageId splitPid;
+					bufMgr->allocPage(file, splitPid, newPage);
+					NonLeafNodeString* newNode = (NonLeafNodeString*)newPage;
+					initNonLeafString(newNode, node->level, entries[middle].pageNo);
+					writeNonLeafString(node, node->leftmostPageNo, entries, 0, middle);
+					writeNonLeafString(newNode, entries[middle].pageNo, entries, middle + 1, entries.size());
+					bufMgr->unPinPage(file, splitPid, true);
 
-	// if target goes into new node							
-	} else {
-		int pos = INTARRAYLEAFSIZE-1;
-		int flag = -1;
-		for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-			if (newNode->keyArray[i] < target && newNode->keyArray[i] != MYNULL) {
-				tempKey[i] = newNode->keyArray[i];
-				temprid[i] = newNode->ridArray[i];
-			} else if (flag == -1) {
-				pos = i;
-				flag = 0;
-				break;
+					separator = entries[middle].key;
+					newPid = splitPid;
+					split = true;
+				}
 			}
 		}
-		// add target key and rid and what's left in the origional keyarray and ridarray
-		tempKey[pos] = target;
-		temprid[pos] = rid;
-		for (int i = pos+1; i < INTARRAYLEAFSIZE; i++) {
-			tempKey[i] = newNode->keyArray[i-1];
-			temprid[i] = newNode->ridArray[i-1];
+		// the topmost node may be the root; it stays latched until a new root is in place
+		if (level > 0) {
+			unlatchPage(path[level].pageNo, true, dirty);
+		} else {
+			topDirty = dirty;
 		}
-		// set cur->arrays to temparrays
-		for (int i  = 0; i < INTARRAYLEAFSIZE; i ++) {
-			newNode->keyArray[i] = tempKey[i];
-			newNode->ridArray[i] = temprid[i];
-		}		
 	}
 
-	// fix the linked list
-	newNode->rightSibPageNo = cur->rightSibPageNo;
-	cur->rightSibPageNo = newPid;
-
-	// set tempNodes info
-	tempNode->level = 1;
-	// need help with this
-	tempNode->keyArray[0] = middleKey;
-	// Page* oldPage = reinterpret_cast<Page*>(&cur);
-	Page* oldPage = (Page*)(cur);
-	// Page* newPage = reinterpret_cast<Page*>(newNode);
-	tempNode->pageNoArray[0] = curPid;// old node
-	tempNode->pageNoArray[1] = newPid;// new node		
-}
-
-void BTreeIndex::insertIntoLeaf(LeafNodeInt*& cur, int target, RecordId rid) {
-	// create temp new arrays
-	int tempKey[INTARRAYLEAFSIZE];
-	RecordId temprid[INTARRAYLEAFSIZE];
-
-	// find pos for target key and rid to fit into
-	int pos = INTARRAYLEAFSIZE-1;
-	int flag = -1;
-	// if target < all keys
-	// TODO insert to the left end
-
-	for (int i  = 0; i < INTARRAYLEAFSIZE-1; i ++) {
-		if (cur->keyArray[i] != MYNULL && cur->keyArray[i] < target) {
-			tempKey[i] = cur->keyArray[i];
-			temprid[i] = cur->ridArray[i];
-		} else if (flag == -1) {
-			pos = i;
-			flag = 0;
-			break;
-		}
+	// the root itself was split, grow the tree by one level
+	if (split) {
+		Page* newRootPage;
+		PageId newRootPid;
+		bufMgr->allocPage(file, newRootPid, newRootPage);
+		std::vector<PageKeyPair<std::string> > rootEntries(1);
+		rootEntries[0].set(newPid, separator);
+		NonLeafNodeString* newRoot = (NonLeafNodeString*)newRootPage;
+		initNonLeafString(newRoot, rootLevel + 1, rootPageNum);
+		writeNonLeafString(newRoot, rootPageNum, rootEntries, 0, 1);
+		bufMgr->unPinPage(file, newRootPid, true);
+		bufMgr->flushPage(file, newRootPid);
+		rootPageNum = newRootPid;
+		writeRootInfo(rootLevel + 1);
 	}
-
-	// add target key and rid and what's left in the origional keyarray and ridarray
-	tempKey[pos] = target;
-	temprid[pos] = rid;
-	for (int i  = pos+1; i < INTARRAYLEAFSIZE; i++) {
-		tempKey[i] = cur->keyArray[i-1];
-		temprid[i] = cur->ridArray[i-1];
+	if (!path.empty()) {
+		unlatchPage(path[0].pageNo, true, topDirty);
 	}
+}
 
-	// set cur->arrays to temparrays
-	for (int i  = 0; i < INTARRAYLEAFSIZE; i ++) {
-		cur->keyArray[i] = tempKey[i];
-		cur->ridArray[i] = temprid[i];
+// -----------------------------------------------------------------------------
+// BTreeIndex::seekEntryString
+// -----------------------------------------------------------------------------
 
+bool BTreeIndex::seekEntryString(Page*& page, PageId& leafPid, const std::string& key, const RecordId rid, int& pos)
+{
+	while (true) {
+		LeafNodeString* leaf = (LeafNodeString*)page;
+		bool found;
+		pos = leafStringResume(leaf, key, rid, found) - 1;
+		if (found) {
+			return true;
+		}
+		// duplicates of the key can continue on the right sibling
+		if (pos + 1 < leaf->numKeys || leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+			unlatchPage(leafPid, true, false);
+			return false;
+		}
+		PageId nextPid = leaf->rightSibPageNo;
+		page = latchPage(nextPid, true);
+		unlatchPage(leafPid, true, false);
+		leafPid = nextPid;
 	}
 }
-	
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntryString
 // -----------------------------------------------------------------------------
-// BTreeIndex::treeInsertNode
-//------------------------------------------------------------------------------
-NonLeafNodeInt* BTreeIndex::treeInsertNode(Page*& current, PageId curPid, int target, int level, RecordId rid) {
-	// if its not parent of leaf node
-	if (level != 1) {
-		// cast to non leaf node
-		NonLeafNodeInt* cur = (NonLeafNodeInt*)(current);
-		NonLeafNodeInt* tempNode;
 
-		int flag = -1;
-		int keymatched;
+void BTreeIndex::deleteEntryString(const std::string& key, const RecordId rid)
+{
+	// most deletes leave their leaf at least a quarter full: find it optimistically and latch nothing but the leaf
+	PageId leafPid;
+	Page* page = findLeafString(key, leafPid, true);
+	int pos;
+	if (!seekEntryString(page, leafPid, key, rid, pos)) {
+		throw NoSuchKeyFoundException();
+	}
+	LeafNodeString* leaf = (LeafNodeString*)page;
+	if (stringNodeBytes(leaf->data, leaf->numKeys, sizeof(RecordId)) - stringEntryBytes(leaf->data, pos, sizeof(RecordId))
+			>= STRINGLEAFMIN) {
+		removeStringSlot(leaf->data, leaf->numKeys, pos);
+		unlatchPage(leafPid, true, true);
+		return;
+	}
+	unlatchPage(leafPid, true, false);
 
-		//loop to find the next node
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			int curkey = cur->keyArray[i];
-			if (curkey == MYNULL) {
-				keymatched = i;
-				break;
-			}
-			// else if the target is less than the current key
-			 else if (target < curkey) {
-				// recursive case # 1
-				flag = 1;
-				Page* nextPage = nullptr; 
-				bufMgr->readPage(file, cur->pageNoArray[i], nextPage);
-				bufMgr->unPinPage(file, cur->pageNoArray[i], true);
-				tempNode = treeInsertNode(nextPage, cur->pageNoArray[i], target, cur->level, rid);
-				break;
-			}
+	// the leaf would underflow: descend again with exclusive latches, letting go of the ones above a node
+	// that is sure to stay at least a quarter full when it loses a separator
+	std::vector<PathEntry> path;
+	PageId pid;
+	while (true) {
+		pid = rootPageNum;
+		page = latchPage(pid, true);
+		if (rootPageNum == pid) {
+			break;
 		}
-		// recursive case #2
-		if (flag == -1) {
-			Page* nextPage = nullptr; 
-			bufMgr->readPage(file, cur->pageNoArray[keymatched], nextPage);
-			bufMgr->unPinPage(file, cur->pageNoArray[keymatched], true);
-			tempNode = treeInsertNode(nextPage, cur->pageNoArray[keymatched], target, cur->level, rid);
+		// the root changed while we waited for its latch
+		unlatchPage(pid, true, false);
+	}
+	const int largestEntry = sizeof(std::uint16_t) + 1 + STRINGSIZE + sizeof(PageId);
+	bool isRoot = true;
+	while (true) {
+		NonLeafNodeString* node = (NonLeafNodeString*)page;
+		bool safe = isRoot ? (node->level == 1 || node->numKeys > 1)
+			: stringNodeBytes(node->data, node->numKeys, sizeof(PageId)) - largestEntry >= STRINGNONLEAFMIN;
+		isRoot = false;
+		if (safe) {
+			releasePath(path);
 		}
-		
-		// if nothing needs to be changed
-		if (tempNode == nullptr) {
-			return nullptr;
+		PathEntry entry;
+		entry.pageNo = pid;
+		entry.page = page;
+		entry.child = nonLeafStringChildIndex(node, key);
+		path.push_back(entry);
+		if (node->level == 1) {
+			break;
 		}
-		
-		// if we need to add a nodes info to this node
+		pid = nonLeafStringChild(node, entry.child);
+		page = latchPage(pid, true);
+	}
 
-		// check if there is space
-		// geniune question: what if the key array is full but not the pageNo one
-		int space = 0;
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			if (cur->keyArray[i] == MYNULL) {
-				space = 1;
-				break;
-			}
+	// find the entry among the children of the lowest node, see deleteEntryInt
+	NonLeafNodeString* parent = (NonLeafNodeString*)path.back().page;
+	int child = path.back().child;
+	while (true) {
+		leafPid = nonLeafStringChild(parent, child);
+		page = latchPage(leafPid, true);
+		leaf = (LeafNodeString*)page;
+		bool found;
+		pos = leafStringResume(leaf, key, rid, found) - 1;
+		if (found) {
+			break;
 		}
-
-		// if there is space
-		if (space) {
-			// insert the tempNode information into the current node
-			insertIntoNonLeaf(tempNode, cur);
-
-			return nullptr;
-		
-		} else {
-			Page* returnedPage = nullptr;
-			bufMgr->allocPage(file, nextPageID, returnedPage);
-			bufMgr->unPinPage(file, nextPageID, true);
-			PageId returnPid = nextPageID;
-			NonLeafNodeInt* returnedNode = (NonLeafNodeInt*)(returnedPage);
-			
-			splitNonLeaf(cur, curPid, tempNode, returnedNode, returnPid);
-
-			return returnedNode;
+		if (pos + 1 == leaf->numKeys && child < parent->numKeys && compareNonLeafStringKey(parent, child, key) == 0) {
+			unlatchPage(leafPid, true, false);
+			child++;
+			continue;
+		}
+		releasePath(path);
+		if (!seekEntryString(page, leafPid, key, rid, pos)) {
+			throw NoSuchKeyFoundException();
 		}
+		leaf = (LeafNodeString*)page;
+		removeStringSlot(leaf->data, leaf->numKeys, pos);
+		unlatchPage(leafPid, true, true);
+		return;
+	}
 
+	if (stringNodeBytes(leaf->data, leaf->numKeys, sizeof(RecordId)) - stringEntryBytes(leaf->data, pos, sizeof(RecordId))
+			>= STRINGLEAFMIN || parent->numKeys == 0) {
+		removeStringSlot(leaf->data, leaf->numKeys, pos);
+		unlatchPage(leafPid, true, true);
+		releasePath(path);
+		return;
+	}
 
-	// if it's a non leaf node whose children are leaf nodes
+	// rebalance the leaf with its right sibling, or with its left one if it is the last child
+	int sep = child < parent->numKeys ? child : child - 1;
+	PageId leftPid = nonLeafStringChild(parent, sep);
+	PageId rightPid = nonLeafStringChild(parent, sep + 1);
+	Page* leftPage;
+	Page* rightPage;
+	if (sep == child) {
+		removeStringSlot(leaf->data, leaf->numKeys, pos);
+		leftPage = page;
+		rightPage = latchPage(rightPid, true);
 	} else {
-		NonLeafNodeInt* cur = (NonLeafNodeInt*)(current);
-		LeafNodeInt* leafNode;
-		PageId leafPid;
-
-		int flag = -1;
-		int keymatched;
+		// latch left to right, see deleteEntryInt
+		unlatchPage(leafPid, true, false);
+		leftPage = latchPage(leftPid, true);
+		rightPage = latchPage(rightPid, true);
+		leaf = (LeafNodeString*)rightPage;
+		bool found;
+		pos = leafStringResume(leaf, key, rid, found) - 1;
+		if (!found) {
+			unlatchPage(rightPid, true, false);
+			unlatchPage(leftPid, true, false);
+			releasePath(path);
+			throw NoSuchKeyFoundException();
+		}
+		removeStringSlot(leaf->data, leaf->numKeys, pos);
+	}
+	bool merged = rebalanceLeafString(parent, sep, (LeafNodeString*)leftPage, (LeafNodeString*)rightPage);
+	leafShifts++;
+	if (merged) {
+		linkLeftSibling(((LeafNodeString*)leftPage)->rightSibPageNo, leftPid);
+	}
+	unlatchPage(rightPid, true, true);
+	unlatchPage(leftPid, true, true);
+	std::vector<PageId> freed;
+	if (merged) {
+		freed.push_back(rightPid);
+	}
 
-		//loop to find the next node
-		for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-			int curkey = cur->keyArray[i];
-			if (curkey == MYNULL) {
-				keymatched = i;
-				break;
-			}
-			// else if the target is less than the current key
-			 else if (target < curkey) {
-				// recursive case # 1
-				flag = 1;
-				Page* nextPage = nullptr; 
-				bufMgr->readPage(file, cur->pageNoArray[i], nextPage);
-				bufMgr->unPinPage(file, cur->pageNoArray[i], true);
-				leafNode = (LeafNodeInt*)nextPage;
-				leafPid = cur->pageNoArray[i];
-				break;
-			}
+	// walk back up the nodes still latched, rebalancing the ones a merge below left underfull
+	std::vector<bool> dirty(path.size(), false);
+	dirty.back() = true;
+	int level = path.size() - 1;
+	while (merged && level > 0) {
+		NonLeafNodeString* node = (NonLeafNodeString*)path[level].page;
+		NonLeafNodeString* grand = (NonLeafNodeString*)path[level - 1].page;
+		if (stringNodeBytes(node->data, node->numKeys, sizeof(PageId)) >= STRINGNONLEAFMIN || grand->numKeys == 0) {
+			break;
 		}
-		// recursive case #2
-		if (flag == -1) {
-			Page* nextPage = nullptr; 
-			bufMgr->readPage(file, cur->pageNoArray[keymatched], nextPage);
-			bufMgr->unPinPage(file, cur->pageNoArray[keymatched], true);
-			leafNode = (LeafNodeInt*)nextPage;
-			leafPid = cur->pageNoArray[keymatched];
+		child = path[level - 1].child;
+		sep = child < grand->numKeys ? child : child - 1;
+		PageId sibPid = nonLeafStringChild(grand, sep == child ? child + 1 : child - 1);
+		NonLeafNodeString* sibling = (NonLeafNodeString*)latchPage(sibPid, true);
+		if (sep == child) {
+			merged = rebalanceNonLeafString(grand, sep, node, sibling);
+		} else {
+			merged = rebalanceNonLeafString(grand, sep, sibling, node);
 		}
-
-		// check if there is space in arrays
-		int space = 0;
-		for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-			if (leafNode->keyArray[i] == MYNULL) {
-				space = 1;
-				break;
-			}
+		unlatchPage(sibPid, true, true);
+		if (merged) {
+			freed.push_back(sep == child ? sibPid : path[level].pageNo);
 		}
+		dirty[level - 1] = true;
+		level--;
+	}
 
-		// if there is space
-		if (space) {
-			// insert key and rid into leafNode
-			insertIntoLeaf(leafNode, target, rid);
+	// the root lost its last separator: its only child becomes the root
+	NonLeafNodeString* top = (NonLeafNodeString*)path[0].page;
+	if (merged && level == 0 && path[0].pageNo == rootPageNum && top->level > 1 && top->numKeys == 0) {
+		rootPageNum = top->leftmostPageNo;
+		writeRootInfo(top->level - 1);
+		freed.push_back(path[0].pageNo);
+	}
 
-			// return null if no propogation or splitting is needed
-			return nullptr;
+	for (int i = path.size() - 1; i >= 0; i--) {
+		unlatchPage(path[i].pageNo, true, dirty[i]);
+	}
+	retirePages(freed);
+}
 
-		// hard case
-		} else { 
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupString
+// -----------------------------------------------------------------------------
 
-			// create tempNode to pass up
-			Page* tempPage = nullptr;
-			bufMgr->allocPage(file, nextPageID, tempPage);
-			bufMgr->unPinPage(file, nextPageID, true);
-			// dont increment nextPageID because this node/page is only temporary
-			NonLeafNodeInt* tempNode = (NonLeafNodeInt*)(tempPage);
+int BTreeIndex::lookupString(const std::string& key, std::vector<RecordId>& outRids)
+{
+	PageId leafPid;
+	Page* page = findLeafString(key, leafPid, false);
+	probeLeafString(page, leafPid, key, outRids);
+	unlatchPage(leafPid, false, false);
+	return outRids.size();
+}
 
-			splitLeafNode(leafNode, leafPid, tempNode, target, rid);
+// -----------------------------------------------------------------------------
+// BTreeIndex::probeLeafString
+// -----------------------------------------------------------------------------
 
-			// if leafNode is directly under root, need to merge tempNode into cur root and return a new root
-			if (curPid == rootPageNum) {
-				int space_root = 0;
-				for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-					if (cur->keyArray[i] == MYNULL) {
-						space_root = 1;
-						break;
-					}
-				}
+void BTreeIndex::probeLeafString(Page*& page, PageId& leafPid, const std::string& key, std::vector<RecordId>& outRids)
+{
+	LeafNodeString* leaf = (LeafNodeString*)page;
+	int entry = leafStringLowerBound(leaf, key, false);
+	while (true) {
+		for (; entry < leaf->numKeys && compareLeafStringKey(leaf, entry, key) == 0; entry++) {
+			outRids.push_back(leafStringRid(leaf, entry));
+		}
+		// duplicates of the key can continue on the right sibling
+		if (entry < leaf->numKeys || leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+			break;
+		}
+		PageId nextPid = leaf->rightSibPageNo;
+		page = latchPage(nextPid, false);
+		unlatchPage(leafPid, false, false);
+		leafPid = nextPid;
+		leaf = (LeafNodeString*)page;
+		entry = 0;
+	}
+}
 
-				// if there is space
-				if (space_root) {
-					// insert the tempNode information into the current node
-					insertIntoNonLeaf(tempNode, cur);
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupManyString
+// -----------------------------------------------------------------------------
 
-					return nullptr;
-				
-				} else {
-					Page* returnedPage = nullptr;
-					bufMgr->allocPage(file, nextPageID, returnedPage);
-					bufMgr->unPinPage(file, nextPageID, true);
-					PageId returnPid = nextPageID;
-					NonLeafNodeInt* returnedNode = (NonLeafNodeInt*)(returnedPage);
-					
-					splitNonLeaf(cur, curPid, tempNode, returnedNode, returnPid);
-					// set root to returnedNode and update rootPageNum
-					rootPageNum = returnPid;
-					return nullptr;
-				}
-			} else {
-				return tempNode;
+void BTreeIndex::lookupManyString(const void* const* keys, const int numKeys, std::vector<RecordId>& outRids,
+		std::vector<int>& outOffsets)
+{
+	Page* page = nullptr;
+	PageId leafPid = Page::INVALID_NUMBER;
+	std::string prevKey;
+	std::string lastKey;
+	for (int i = 0; i < numKeys; i++) {
+		std::string key = makeStringKey((const char*)keys[i]);
+		outOffsets.push_back(outRids.size());
+		if (i > 0 && key == lastKey) {
+			int begin = outOffsets[i - 1];
+			int end = outOffsets[i];
+			outRids.reserve(outRids.size() + end - begin);
+			for (int j = begin; j < end; j++) {
+				outRids.push_back(outRids[j]);
+			}
+			continue;
+		}
+		lastKey = key;
+		if (bloomFilter.numBlocks() > 0 && !bloomFilter.mayContain(BloomFilter::hash(key.data(), key.size()))) {
+			continue;
+		}
+		if (page != nullptr) {
+			// see lookupManyInt
+			LeafNodeString* leaf = (LeafNodeString*)page;
+			if (key < prevKey || leaf->numKeys == 0 || compareLeafStringKey(leaf, leaf->numKeys - 1, key) < 0) {
+				unlatchPage(leafPid, false, false);
+				page = nullptr;
 			}
 		}
+		if (page == nullptr) {
+			page = findLeafString(key, leafPid, false);
+		}
+		probeLeafString(page, leafPid, key, outRids);
+		prevKey = key;
+	}
+	if (page != nullptr) {
+		unlatchPage(leafPid, false, false);
 	}
-}	
-	
+}
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::insertEntry
+// BTreeIndex::startScanString
 // -----------------------------------------------------------------------------
 
-void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
+void BTreeIndex::startScanString(IndexScanCursor& cursor, const std::string& lowVal, const std::string& highVal)
 {
-	// cast key to an int	
-	// int keyInt = *(reinterpret_cast<int*>(&key));
-	int keyInt = *((int*)key);
-
-	// get root
-	Page* rootPage = nullptr;
-	bufMgr->readPage(file, rootPageNum, rootPage);
-	bufMgr->unPinPage(file, rootPageNum, true);
+	if (highVal < lowVal) {
+		throw BadScanrangeException();
+	}
+	cursor.lowValString = lowVal;
+	cursor.highValString = highVal;
+	if (cursor.descending) {
+		startReverseScanString(cursor);
+		return;
+	}
 
-	// NonLeafNodeInt* root = reinterpret_cast<NonLeafNodeInt*>(&rootPage);
-	NonLeafNodeInt* root = (NonLeafNodeInt*)(rootPage);
+	PageId leafPid;
+	Page* leafPage = findLeafString(cursor.lowValString, leafPid, false);
+	LeafNodeString* leaf = (LeafNodeString*)leafPage;
+	int entry = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
 
-	// check if roots keyArray is empty
-	int isEmpty = 1;
-	for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-		if (root->keyArray[i] != MYNULL) {
-			isEmpty = 0; // root is not empty
-			break;
-		}
+	// the first match can sit further right, past leaves whose keys are all below the low bound
+	while (entry == leaf->numKeys && leaf->rightSibPageNo != Page::INVALID_NUMBER) {
+		PageId nextPid = leaf->rightSibPageNo;
+		leafPage = latchPage(nextPid, false);
+		unlatchPage(leafPid, false, false);
+		leafPid = nextPid;
+		leaf = (LeafNodeString*)leafPage;
+		entry = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
 	}
 
-	/*	Root Case	*/
-	if (isEmpty) {
-		
-		// create a R leafnode 
-		Page* leafPageR = nullptr;
-		bufMgr->allocPage(file, nextPageID, leafPageR);
-		// std::cout<< leafPage->page_number() << std::endl;
-		bufMgr->unPinPage(file, nextPageID, true);
-
-		// in root node, set pageNoArray at [1] to the leafNode
-		root->pageNoArray[1] = nextPageID;
+	bool found = entry < leaf->numKeys;
+	if (found) {
+		int cmp = compareLeafStringKey(leaf, entry, cursor.highValString);
+		found = cmp < 0 || (cmp == 0 && cursor.highOp == LTE);
+	}
+	if (!found) {
+		unlatchPage(leafPid, false, false);
+		throw NoSuchKeyFoundException();
+	}
 
-		// create a L leafnode
-		Page* leafPageL = nullptr;
-		bufMgr->allocPage(file, nextPageID, leafPageL);
-		// std::cout<< leafPage->page_number() << std::endl;
-		bufMgr->unPinPage(file, nextPageID, true);
-		root->pageNoArray[0] = nextPageID;
-		
-		// set keyArray at [0] to key
-		root->keyArray[0] = keyInt;
-		
-		LeafNodeInt* leafR = (LeafNodeInt*)(leafPageR);
-		LeafNodeInt* leafL = (LeafNodeInt*)(leafPageL);
+	cursor.leafShiftsSeen = leafShifts;
+	latches.get(leafPid).unlockShared();
+	cursor.currentPageNum = leafPid;
+	cursor.currentPageData = leafPage;
+	cursor.nextEntry = entry;
+}
 
-		// set empty leaf's keys all to MYNULL 
-		for (int i=0; i < INTARRAYLEAFSIZE; i++) {
-			leafR->keyArray[i] = MYNULL;
-			leafL->keyArray[i] = MYNULL;
-		}
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanBatchString
+// -----------------------------------------------------------------------------
 
-		//insert key and rid into leaf node
-		leafR->keyArray[0] = keyInt;
-		leafR->ridArray[0] = rid;
+int BTreeIndex::scanBatchString(IndexScanCursor& cursor, RecordId* outRids, const int maxRids)
+{
+	if (cursor.currentPageNum == Page::INVALID_NUMBER || maxRids <= 0) {
+		return 0;
 	}
 
+	latches.get(cursor.currentPageNum).lockShared();
+	LeafNodeString* leaf = (LeafNodeString*)cursor.currentPageData;
 
-	/*	Noraml case	*/
-	else {
-		// insert element in tree with recursion!
-		NonLeafNodeInt* node = treeInsertNode(rootPage, rootPageNum, keyInt, root->level, rid);
-
-		// check if the returned node is = to nullptr
-		if (node != nullptr) {
-			// set root node to returned node
+	// find our place again, see scanBatchInt
+	bool searching = false;
+	int entry;
+	if (!cursor.lastValid) {
+		entry = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
+	} else if (cursor.nextEntry > 0 && cursor.nextEntry <= leaf->numKeys
+			&& leafStringRid(leaf, cursor.nextEntry - 1) == cursor.lastRid
+			&& compareLeafStringKey(leaf, cursor.nextEntry - 1, cursor.lastKeyString) == 0) {
+		entry = cursor.nextEntry;
+	} else {
+		bool found;
+		entry = leafStringResume(leaf, cursor.lastKeyString, cursor.lastRid, found);
+		searching = !found && entry == leaf->numKeys;
+	}
 
-			Page* newRoot = (Page*)(node);
+	// entries may have moved left under a delete, see scanBatchInt
+	std::uint64_t shifts = leafShifts;
+	if (entry == 0 && shifts != cursor.leafShiftsSeen) {
+		unlatchPage(cursor.currentPageNum, false, false);
+		const std::string& from = cursor.lastValid ? cursor.lastKeyString : cursor.lowValString;
+		cursor.currentPageData = findLeafString(from, cursor.currentPageNum, false);
+		leaf = (LeafNodeString*)cursor.currentPageData;
+		if (!cursor.lastValid) {
+			entry = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
+		} else {
+			bool found;
+			entry = leafStringResume(leaf, cursor.lastKeyString, cursor.lastRid, found);
+			searching = !found && entry == leaf->numKeys;
+		}
+	}
+	cursor.leafShiftsSeen = shifts;
 
-			// someone should double check this
-			rootPageNum = newRoot->page_number();
+	int count = 0;
+	while (count < maxRids) {
+		// move on to the right sibling once the current leaf is used up
+		if (entry == leaf->numKeys) {
+			PageId nextPid = leaf->rightSibPageNo;
+			if (nextPid == Page::INVALID_NUMBER) {
+				unlatchPage(cursor.currentPageNum, false, false);
+				cursor.currentPageNum = Page::INVALID_NUMBER;
+				cursor.currentPageData = nullptr;
+				return count;
+			}
+			Page* nextPage = latchPage(nextPid, false);
+			unlatchPage(cursor.currentPageNum, false, false);
+			cursor.currentPageNum = nextPid;
+			cursor.currentPageData = nextPage;
+			leaf = (LeafNodeString*)nextPage;
+			if (!cursor.lastValid) {
+				entry = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
+			} else if (searching) {
+				bool found;
+				entry = leafStringResume(leaf, cursor.lastKeyString, cursor.lastRid, found);
+				searching = !found && entry == leaf->numKeys;
+			} else {
+				entry = 0;
+			}
+			continue;
+		}
 
+		// the matching entries left on this leaf end at the first key past the high bound
+		int end = std::min(leaf->numKeys, entry + (maxRids - count));
+		int stop = std::min(end, leafStringLowerBound(leaf, cursor.highValString, cursor.highOp == LTE));
+		for (int i = entry; i < stop; i++) {
+			outRids[count++] = leafStringRid(leaf, i);
+		}
+		if (stop > entry) {
+			cursor.lastKeyString = leafStringKey(leaf, stop - 1);
+			cursor.lastRid = outRids[count - 1];
+			cursor.lastValid = true;
+			cursor.nextEntry = stop;
+		}
+		entry = stop;
+		if (stop < end) {
+			// reached the high bound, see scanBatchInt
+			if (!advanceRange(cursor)) {
+				break;
+			}
+			searching = false;
+			entry = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
+			if (entry == leaf->numKeys) {
+				unlatchPage(cursor.currentPageNum, false, false);
+				cursor.currentPageData = findLeafString(cursor.lowValString, cursor.currentPageNum, false);
+				leaf = (LeafNodeString*)cursor.currentPageData;
+				entry = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
+			}
 		}
 	}
+	latches.get(cursor.currentPageNum).unlockShared();
+	return count;
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::startScan
+// BTreeIndex::seekReverseString
 // -----------------------------------------------------------------------------
 
-void BTreeIndex::startScan(const void* lowValParm,
-				   const Operator lowOpParm,
-				   const void* highValParm,
-				   const Operator highOpParm)  
+int BTreeIndex::seekReverseString(IndexScanCursor& cursor)
 {
-    	// check type ids
-    	if (lowOpParm != 2 && lowOpParm != 3) {
-        	throw BadOpcodesException();
-	} 
-    	if (highOpParm != 0 && highOpParm != 1) {
-       	 	throw BadOpcodesException();
-    	}
-
-	// end scan if one if already going on
-	if (scanExecuting) {
-		endScan();
+	const std::string& from = cursor.lastValid ? cursor.lastKeyString : cursor.highValString;
+	cursor.currentPageData = findLeafString(from, cursor.currentPageNum, false);
+	LeafNodeString* leaf = (LeafNodeString*)cursor.currentPageData;
+	bool found = false;
+	int entry;
+	if (!cursor.lastValid) {
+		entry = leafStringLowerBound(leaf, cursor.highValString, cursor.highOp == LTE);
+	} else {
+		entry = leafStringResume(leaf, cursor.lastKeyString, cursor.lastRid, found);
 	}
 
-	// set scanExecuting to true
-	scanExecuting = true;
-
-	// get root page to start
-	Page* root = nullptr;
-	bufMgr->readPage(file, rootPageNum, root);
-	bufMgr->unPinPage(file, rootPageNum, true);
-	NonLeafNodeInt* rootNode = (NonLeafNodeInt*)root;
-	
-	// if empty tree
-	if (rootNode->keyArray[0] == MYNULL) {
-		throw NoSuchKeyFoundException();
+	// duplicates of the key can go on past the leaf the descent leads to
+	while (!found && entry == leaf->numKeys && leaf->rightSibPageNo != Page::INVALID_NUMBER) {
+		PageId nextPid = leaf->rightSibPageNo;
+		Page* nextPage = latchPage(nextPid, false);
+		LeafNodeString* next = (LeafNodeString*)nextPage;
+		int nextEntry;
+		if (!cursor.lastValid) {
+			nextEntry = leafStringLowerBound(next, cursor.highValString, cursor.highOp == LTE);
+		} else {
+			nextEntry = leafStringResume(next, cursor.lastKeyString, cursor.lastRid, found);
+		}
+		if (nextEntry == 0) {
+			unlatchPage(nextPid, false, false);
+			break;
+		}
+		unlatchPage(cursor.currentPageNum, false, false);
+		cursor.currentPageNum = nextPid;
+		cursor.currentPageData = nextPage;
+		leaf = next;
+		entry = nextEntry;
 	}
 
-	// can we assume low and highValParm will always point to ints?
-	int localLow = *((int*)(lowValParm));
-	// int localLow = *((int *)(lowValParm));
-	int localHigh = *((int*)(highValParm));
+	if (!cursor.lastValid) {
+		return entry;
+	}
+	if (found) {
+		// entry is just past the one returned last
+		return entry - 1;
+	}
+	return leafStringLowerBound(leaf, cursor.lastKeyString, false);
+}
 
-    // if low param is greater than high param throw error
-    if (localHigh < localLow) {
-       	throw BadScanrangeException();
-    }
+// -----------------------------------------------------------------------------
+// BTreeIndex::stepLeftString
+// -----------------------------------------------------------------------------
 
-	// change what the values will be based on their operators
-	// change < to <= and > to >=
-	if (highOpParm == 0) {
-		localHigh -= 1;
+int BTreeIndex::stepLeftString(IndexScanCursor& cursor)
+{
+	PageId leftPid = ((LeafNodeString*)cursor.currentPageData)->leftSibPageNo;
+	if (leftPid == Page::INVALID_NUMBER) {
+		return -1;
 	}
-	if (lowOpParm == 3) {
-		localLow += 1;
+	Page* leftPage = latchLeftLeaf(cursor.currentPageNum, leftPid);
+	if (leftPage == nullptr) {
+		return seekReverseString(cursor);
 	}
+	cursor.currentPageNum = leftPid;
+	cursor.currentPageData = leftPage;
+	LeafNodeString* leaf = (LeafNodeString*)leftPage;
+	if (!cursor.lastValid) {
+		return leafStringLowerBound(leaf, cursor.highValString, cursor.highOp == LTE);
+	}
+	return leaf->numKeys;
+}
 
-	// set scan variables
-	lowValInt = localLow;
-	highValInt = localHigh;
-
-	// find the first leaf node
-	// not sure how to tell if root is a leaf or not
-	LeafNodeInt* leaf;
-	// try {
-	// 	// if it is not the leaf
-	// 	leaf = traverseTree(*root, lowValInt, rootNode->level);
-	// } catch (BadgerDbException e) {
-	// 	// if it is a leaf
-	// 	// leaf = traverseTree(*root, lowValInt, 1);
-	// }
-	leaf = traverseTree(*root, lowValInt, rootNode->level);
-	if (leaf == nullptr) {
-		// what to do if the entry is not found?
-		currentPageData = nullptr;
+// -----------------------------------------------------------------------------
+// BTreeIndex::startReverseScanString
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::startReverseScanString(IndexScanCursor& cursor)
+{
+	int entry = seekReverseString(cursor);
+	while (entry == 0) {
+		entry = stepLeftString(cursor);
+	}
+	bool found = entry > 0;
+	if (found) {
+		int cmp = compareLeafStringKey((LeafNodeString*)cursor.currentPageData, entry - 1, cursor.lowValString);
+		found = cmp > 0 || (cmp == 0 && cursor.lowOp == GTE);
+	}
+	if (!found) {
+		unlatchPage(cursor.currentPageNum, false, false);
+		cursor.currentPageNum = Page::INVALID_NUMBER;
+		cursor.currentPageData = nullptr;
 		throw NoSuchKeyFoundException();
 	}
-	currentPageData = (Page*)(leaf);
-}	
 
+	cursor.nextEntry = entry;
+	cursor.leafVersion = latches.get(cursor.currentPageNum).readVersion();
+	latches.get(cursor.currentPageNum).unlockShared();
+}
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::scanNext
+// BTreeIndex::reverseBatchString
 // -----------------------------------------------------------------------------
 
-void BTreeIndex::scanNext(RecordId& outRid){
-	//check if scan is in proccess
-	if(scanExecuting == false){
-		throw ScanNotInitializedException();
+int BTreeIndex::reverseBatchString(IndexScanCursor& cursor, RecordId* outRids, const int maxRids)
+{
+	if (cursor.currentPageNum == Page::INVALID_NUMBER || maxRids <= 0) {
+		return 0;
 	}
 
-	if (currentPageNum == Page::INVALID_NUMBER) {
-		throw IndexScanCompletedException();
+	// find our place again, see reverseBatchInt
+	latches.get(cursor.currentPageNum).lockShared();
+	int entry = cursor.nextEntry;
+	if (latches.get(cursor.currentPageNum).readVersion() != cursor.leafVersion) {
+		unlatchPage(cursor.currentPageNum, false, false);
+		entry = seekReverseString(cursor);
 	}
+	LeafNodeString* leaf = (LeafNodeString*)cursor.currentPageData;
 
-	//look at current page
-	LeafNodeInt *node = (LeafNodeInt *) currentPageData;
-	// if rid is valid
-	if (node->keyArray[nextEntry] != MYNULL && nextEntry < INTARRAYLEAFSIZE) {
-		// if the scan is complete
-		if (node->keyArray[nextEntry] > highValInt) {
-			throw IndexScanCompletedException();
+	int count = 0;
+	while (count < maxRids) {
+		// move on to the left sibling once the current leaf is used up
+		if (entry == 0) {
+			entry = stepLeftString(cursor);
+			if (entry < 0) {
+				unlatchPage(cursor.currentPageNum, false, false);
+				cursor.currentPageNum = Page::INVALID_NUMBER;
+				cursor.currentPageData = nullptr;
+				return count;
+			}
+			leaf = (LeafNodeString*)cursor.currentPageData;
+			continue;
 		}
-		outRid = node->ridArray[nextEntry];
-		nextEntry++;
-	}
-
-	// if reach end of current page, jump into the next page to the right
-	if (nextEntry == INTARRAYLEAFSIZE || node->keyArray[nextEntry] == MYNULL){
-		// unpin the previous page
-		bufMgr->unPinPage(file, currentPageNum, true);
-		// update the current page and read into buffer
-		currentPageNum = node->rightSibPageNo;
-		bufMgr->readPage(file, currentPageNum, currentPageData);
-		nextEntry = 0; // reset nextEntry
-	}
-}
 
-// -----------------------------------------------------------------------------
-// BTreeIndex::endScan
-// -----------------------------------------------------------------------------
-//
-void BTreeIndex::endScan(){
-	//stops scan and  throws error if startScan has not been called
-	if(!scanExecuting){
-		throw ScanNotInitializedException();
+		// the matching entries left on this leaf start at the first key past the low bound
+		int first = leafStringLowerBound(leaf, cursor.lowValString, cursor.lowOp == GT);
+		if (entry <= first) {
+			// reached the low bound
+			break;
+		}
+		int stop = std::max(first, entry - (maxRids - count));
+		for (int i = entry - 1; i >= stop; i--) {
+			outRids[count++] = leafStringRid(leaf, i);
+		}
+		cursor.lastKeyString = leafStringKey(leaf, stop);
+		cursor.lastRid = outRids[count - 1];
+		cursor.lastValid = true;
+		entry = stop;
 	}
-	scanExecuting = false;//end the scan
-	//unpin the pages for the scan
-	bufMgr->unPinPage(file, currentPageNum, true);
+	cursor.nextEntry = entry;
+	cursor.leafVersion = latches.get(cursor.currentPageNum).readVersion();
+	latches.get(cursor.currentPageNum).unlockShared();
+	return count;
 }
 
 }
@@ -16,45 +16,122 @@
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "latch.h"
+#include "node_cache.h"
+#include "bloom_filter.h"
 #include <climits>
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace badgerdb
 {
 
+#define MYNULL (INT_MIN)
+
 /**
- * @brief Datatype enumeration type.
+ * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-enum Datatype
-{
-	INTEGER = 0,
-	DOUBLE = 1,
-	STRING = 2
-};
+//                                                  sibling ptrs                key               rid
+const  int INTARRAYLEAFSIZE = ( Page::SIZE - 2 * sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
 
 /**
- * @brief Scan operations enumeration. Passed to BTreeIndex::startScan() method.
+ * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
  */
-enum Operator
-{ 
-	LT, 	/* Less Than */
-	LTE,	/* Less Than or Equal to */
-	GTE,	/* Greater Than or Equal to */
-	GT		/* Greater Than */
-};
+//                                                     level     extra pageNo, count                          key       pageNo        count
+const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) - sizeof( int ) ) / ( sizeof( int ) + sizeof( PageId ) + sizeof( int ) );
 
-#define MYNULL (INT_MIN)
+/**
+ * @brief Number of bytes available for slots and entries in a B+Tree leaf for STRING key.
+ */
+//                                                   numKeys, prefixLength, heapOffset   sibling ptrs           prefix
+const  int STRINGLEAFDATASIZE = Page::SIZE - 3 * sizeof( int ) - 2 * sizeof( PageId ) - STRINGSIZE;
 
 /**
- * @brief Number of key slots in B+Tree leaf for INTEGER key.
+ * @brief Number of bytes available for slots and entries in a B+Tree non-leaf for STRING key.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+//                                                      level, numKeys, prefixLength, heapOffset   leftmost pageNo    prefix
+const  int STRINGNONLEAFDATASIZE = Page::SIZE - 4 * sizeof( int ) - sizeof( PageId ) - STRINGSIZE;
 
 /**
- * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
+ * @brief Fewest keys an INTEGER leaf other than the only one keeps after a delete. A delete that leaves
+ * fewer merges the leaf with a sibling, or evens the two out if they do not fit on one page. Merging only
+ * below a quarter leaves room for inserts afterwards, so nodes do not split and merge over and over.
+ */
+const  int INTLEAFMIN = INTARRAYLEAFSIZE / 4;
+
+/**
+ * @brief Fewest keys an INTEGER non-leaf other than the root keeps after a delete, see INTLEAFMIN.
+ */
+const  int INTNONLEAFMIN = INTARRAYNONLEAFSIZE / 4;
+
+/**
+ * @brief Fewest bytes of slots and entries a STRING leaf other than the only one keeps after a delete, see INTLEAFMIN.
+ */
+const  int STRINGLEAFMIN = STRINGLEAFDATASIZE / 4;
+
+/**
+ * @brief Fewest bytes of slots and entries a STRING non-leaf other than the root keeps after a delete, see INTLEAFMIN.
+ */
+const  int STRINGNONLEAFMIN = STRINGNONLEAFDATASIZE / 4;
+
+/**
+ * @brief Number of entries of one key an INTEGER leaf gathers into a posting list. Shorter runs stay plain
+ * entries, since a posting list takes a page of its own. Being at most half a leaf, a run never keeps a
+ * split from finding a key boundary near the middle of the leaf.
+ */
+const  int INTPOSTINGMIN = INTARRAYLEAFSIZE / 2;
+
+/**
+ * @brief RecordId::padding of an INTEGER leaf entry that refers to a posting list instead of a record.
+ * Entries of records are stored with padding 0.
+ */
+const  SlotId POSTINGMARK = 0xFFFF;
+
+/**
+ * @brief An index keeps up to one in NODECACHESHARE frames of the buffer pool pinned for its non-leaf
+ * nodes, see NodeCache. A tree of a few million entries has far fewer non-leaf nodes than that.
+ */
+const  int NODECACHESHARE = 8;
+
+/**
+ * @brief Largest number of columns a covering index includes in its leaves, see IncludedColumn.
+ */
+const  int MAXINCLUDEDCOLUMNS = 8;
+
+/**
+ * @brief Largest number of bytes of included columns a covering index stores with each entry.
+ */
+const  int MAXPAYLOADSIZE = 64;
+
+/**
+ * @brief Default number of Bloom filter bits per distinct key, see BTreeIndex::enableBloomFilter.
+ * About 1% of probes for absent keys get past a filter this size.
+ */
+const  int BLOOMBITSPERKEY = 10;
+
+/**
+ * @brief Largest number of pages the Bloom filter of an index is kept in, which bounds its size.
+ */
+const  int MAXBLOOMPAGES = 1024;
+
+/**
+ * @brief Default number of entries the insert buffer of an index holds before it is flushed, see
+ * BTreeIndex::enableInsertBuffer.
+ */
+const  int INSERTBUFFERSIZE = 16384;
+
+/**
+ * @brief Default largest distance, in leaves, between the leaf the learned model of an index predicts for a
+ * key and the leaf the key is on, see BTreeIndex::enableLearnedModel.
  */
-//                                                     level     extra pageNo                  key       pageNo
-const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+const  int LEARNEDMAXERROR = 8;
+
+/**
+ * @brief Number of bytes available for encoded RecordIds in a posting list page.
+ */
+//                                                  numRids, usedBytes, totalRids   next, last pageNo           lastRid
+const  int POSTINGDATASIZE = Page::SIZE - 3 * sizeof( int ) - 2 * sizeof( PageId ) - sizeof( RecordId );
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
@@ -102,6 +179,23 @@ bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
 		return r1.rid.page_number < r2.rid.page_number;
 }
 
+/**
+ * @brief A column of the base relation that a covering index stores in its leaves next to each RecordId,
+ * so scans and lookups can return it without reading the record. The payload of an entry is the bytes
+ * of all included columns of its record, one after the other.
+*/
+struct IncludedColumn{
+  /**
+   * Offset of the column inside records.
+   */
+	int byteOffset;
+
+  /**
+   * Number of bytes of the column.
+   */
+	int length;
+};
+
 /**
  * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
  * to the following structure to store or retrieve information from it.
@@ -130,13 +224,61 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * Level of the root node, which is the number of non-leaf levels of the tree.
+   */
+	int rootLevel;
+
+  /**
+   * Number of times the root changed since the index was created. rootPageNo, rootLevel and rootEpoch are
+   * written together, in a single write of this page, whenever the root splits or shrinks.
+   */
+	std::uint32_t rootEpoch;
+
+  /**
+   * True once BTreeIndex::enableSubtreeCounts was called; the non-leaf nodes of an INTEGER index then keep
+   * the number of entries below each of their children.
+   */
+	bool subtreeCounts;
+
+  /**
+   * Number of columns the index includes in its leaves.
+   */
+	int numIncluded;
+
+  /**
+   * Included columns, in the order their bytes follow each other in a payload.
+   */
+	IncludedColumn included[ MAXINCLUDEDCOLUMNS ];
+
+  /**
+   * Number of blocks of the Bloom filter of the index, 0 if it has none, see BTreeIndex::enableBloomFilter.
+   */
+	int bloomBlocks;
+
+  /**
+   * True if the Bloom filter pages were written when the index was last closed. An index opened and not
+   * closed again, as after a crash, may have inserted keys the pages miss; its filter is built again.
+   */
+	bool bloomClean;
+
+  /**
+   * Number of pages the Bloom filter is kept in.
+   */
+	int numBloomPages;
+
+  /**
+   * Pages the Bloom filter is kept in, in block order, Page::SIZE / BloomFilter::BLOCK_BYTES blocks each.
+   */
+	PageId bloomPages[ MAXBLOOMPAGES ];
 };
 
 /*
 Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
 These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of 
-node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes 
-at this level are just above the leaf nodes. Otherwise set to 0.
+node they are. The level memeber of each non leaf structure seen below is the height of the node above
+the leaves: 1 if the nodes at this level are just above the leaf nodes, 2 above those and so on.
 */
 
 /**
@@ -157,6 +299,12 @@ struct NonLeafNodeInt{
    * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
 	PageId pageNoArray[ INTARRAYNONLEAFSIZE + 1 ];
+
+  /**
+   * Number of entries in the subtree of each child, RecordIds of posting lists included. Only kept while
+   * IndexMetaInfo::subtreeCounts is set, zero or stale otherwise.
+   */
+	int countArray[ INTARRAYNONLEAFSIZE + 1 ];
 };
 
 
@@ -170,7 +318,8 @@ struct LeafNodeInt{
 	int keyArray[ INTARRAYLEAFSIZE ];
 
   /**
-   * Stores RecordIds.
+   * Stores RecordIds. A leaf of a covering index holds fewer entries than INTARRAYLEAFSIZE and the
+   * payloads of its entries fill the rest of this array, see BTreeIndex::leafOccupancy.
    */
 	RecordId ridArray[ INTARRAYLEAFSIZE ];
 
@@ -179,67 +328,231 @@ struct LeafNodeInt{
 	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
 	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, followed by descending scans.
+   */
+	PageId leftSibPageNo;
 };
 
 
+/*
+INTEGER leaves are split and evened out only between two different keys, so all entries of a key are on
+one leaf, ordered by RecordId (page_number, then slot_number). Keys of low cardinality repeat in entry
+after entry: once a leaf holds INTPOSTINGMIN entries of one key they are replaced by a single entry whose
+RecordId has padding POSTINGMARK and the page number of the first page of a posting list, a chain of pages
+holding the RecordIds of that key in order. Each RecordId is stored as the difference of
+page_number << 16 | slot_number to the one before it on the page, zigzag-mapped and cut into 7-bit groups,
+so RecordIds of neighbouring records take a byte or two. A list left with one RecordId goes back to being
+a plain entry. In a covering index the payload of each RecordId follows its encoding. Posting pages are
+not latched; they are read and changed under the latch of the leaf holding their entry.
+*/
+
 /**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
+ * @brief Structure for the pages of a posting list.
 */
-class BTreeIndex {
+struct PostingNode{
+  /**
+   * Number of RecordIds on this page.
+   */
+	int numRids;
 
- private:
+  /**
+   * Number of bytes of data in use.
+   */
+	int usedBytes;
 
   /**
-   * File object for the index file.
+   * Page number of the next page of the list, Page::INVALID_NUMBER on the last one.
    */
-	File		*file;
+	PageId nextPageNo;
 
   /**
-   * Buffer Manager Instance.
+   * On the first page of a list, page number of its last page.
    */
-	BufMgr	*bufMgr;
+	PageId lastPageNo;
 
   /**
-   * Page number of meta page.
+   * On the first page of a list, number of RecordIds in the whole list.
    */
-	PageId	headerPageNum;
+	int totalRids;
 
   /**
-   * page number of root page of B+ tree inside index file.
+   * Last RecordId on this page, the base of the next one appended.
    */
-	PageId	rootPageNum;
+	RecordId lastRid;
 
   /**
-   * Datatype of attribute over which index is built.
+   * Encoded RecordIds.
    */
-	Datatype	attributeType;
+	char data[ POSTINGDATASIZE ];
+};
+
+static_assert( sizeof( PostingNode ) == Page::SIZE, "Posting list node must fill exactly one page." );
+
+/**
+ * @brief Place inside a posting list: the next RecordId to read is number next on page pageNo, whose
+ * encoding starts offset bytes into its data and is relative to prev.
+*/
+struct PostingPosition{
+	PageId pageNo;
+	int next;
+	int offset;
+	RecordId prev;
+};
+
 
+/*
+STRING nodes do not use fixed key slots. Keys are stored with the bytes shared by every key on the page
+(the page prefix) factored out, so each entry only holds its suffix. The data area starts with a slot
+array of numKeys 16-bit offsets kept in key order; the entries themselves are packed downwards from the
+end of the data area, with heapOffset pointing at the lowest used byte. Every entry starts with a one
+byte suffix length followed by the suffix bytes and then the RecordId (leaf) or child PageId (non-leaf).
+*/
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type.
+ * Separator keys are truncated to the shortest prefix that still separates the two children, so
+ * key i is only guaranteed to be >= every key under child i and <= every key under child i+1.
+*/
+struct NonLeafNodeString{
   /**
-   * Offset of attribute, over which index is built, inside records. 
+   * Level of the node in the tree.
    */
-	int 		attrByteOffset;
+	int level;
 
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * Number of separator keys in the node. The node has numKeys + 1 children.
    */
-	int			leafOccupancy;
+	int numKeys;
 
   /**
-   * Number of keys in non-leaf node, depending upon the type of key.
+   * Number of bytes of prefix shared by every separator key on this page.
    */
-	int			nodeOccupancy;
+	int prefixLength;
 
+  /**
+   * Offset inside data of the first byte of the entry heap.
+   */
+	int heapOffset;
 
-	// MEMBERS SPECIFIC TO SCANNING
+  /**
+   * Page number of the child to the left of the first separator key.
+   */
+	PageId leftmostPageNo;
 
   /**
-   * True if an index scan has been started.
+   * Bytes shared by every separator key on this page.
    */
-	bool		scanExecuting;
+	char prefix[ STRINGSIZE ];
+
+  /**
+   * Slot array followed by free space and the entry heap. An entry holds the key suffix and the
+   * page number of the child to the right of that key.
+   */
+	char data[ STRINGNONLEAFDATASIZE ];
+};
+
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+*/
+struct LeafNodeString{
+  /**
+   * Number of entries in the node.
+   */
+	int numKeys;
+
+  /**
+   * Number of bytes of prefix shared by every key on this page.
+   */
+	int prefixLength;
+
+  /**
+   * Offset inside data of the first byte of the entry heap.
+   */
+	int heapOffset;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Bytes shared by every key on this page.
+   */
+	char prefix[ STRINGSIZE ];
+
+  /**
+   * Slot array followed by free space and the entry heap. An entry holds the key suffix and the RecordId.
+   */
+	char data[ STRINGLEAFDATASIZE ];
+};
+
+static_assert( sizeof( NonLeafNodeString ) == Page::SIZE, "STRING non-leaf node must fill exactly one page." );
+static_assert( sizeof( LeafNodeString ) == Page::SIZE, "STRING leaf node must fill exactly one page." );
+
+
+/**
+ * @brief One range of a multi-range scan, see BTreeIndex::openMultiScan. The values are those of startScan.
+ */
+struct ScanRange{
+  /**
+   * Low value of range, pointer to integer / double / char string.
+   */
+	const void* lowVal;
+
+  /**
+   * Low operator (GT/GTE).
+   */
+	Operator lowOp;
+
+  /**
+   * High value of range, pointer to integer / double / char string.
+   */
+	const void* highVal;
+
+  /**
+   * High operator (LT/LTE).
+   */
+	Operator highOp;
+};
+
+
+class BTreeIndex;
+
+/**
+ * @brief Position of one range scan over a BTreeIndex.
+ * Cursors are opened with BTreeIndex::openScan, or BTreeIndex::openReverseScan to go from the high bound
+ * down. Each keeps its own bounds, its own pinned leaf and its own
+ * place in it, so any number of them can be open on one index at the same time, alongside inserts.
+ * A cursor is used by one thread at a time. Deleting it ends the scan and unpins its leaf; every cursor
+ * has to be deleted before its index.
+*/
+class IndexScanCursor {
+
+	friend class BTreeIndex;
+
+ private:
+
+  /**
+   * Index being scanned.
+   */
+	BTreeIndex	*index;
+
+  /**
+   * True if the scan returns entries from the high bound down, following left siblings.
+   */
+	bool		descending;
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * Index of next entry to be scanned in current leaf being scanned. A descending scan goes on with the
+   * entry before it.
    */
 	int			nextEntry;
 
@@ -258,11 +571,6 @@ class BTreeIndex {
    */
 	int			lowValInt;
 
-  /**
-   * Low DOUBLE value for scan.
-   */
-	double	lowValDouble;
-
   /**
    * Low STRING value for scan.
    */
@@ -273,11 +581,6 @@ class BTreeIndex {
    */
 	int			highValInt;
 
-  /**
-   * High DOUBLE value for scan.
-   */
-	double	highValDouble;
-
   /**
    * High STRING value for scan.
    */
@@ -295,83 +598,1028 @@ class BTreeIndex {
 
 
   /**
-   * placeholder for temporary pageId returned by bufmgr.allocPage/readPage
+   * True once scanNext has returned an entry; lastKeyInt/lastKeyString and lastRid then hold it.
    */
-	PageId nextPageID;
-	
-	
- public:
+	bool		lastValid;
 
   /**
-   * BTreeIndex Constructor. 
-	 * Check to see if the corresponding index file exists. If so, open the file.
-	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
-   *
-   * @param relationName        Name of file.
-   * @param outIndexName        Return the name of index file.
-   * @param bufMgrIn						Buffer Manager Instance
-   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
-   * @param attrType						Datatype of attribute over which index is built
-   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * INTEGER key of the entry last returned by scanNext.
    */
-	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
-	
+	int			lastKeyInt;
 
   /**
-   * BTreeIndex Destructor. 
-	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
-	 * and delete file instance thereby closing the index file.
-	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself. 
-	 * */
-	~BTreeIndex();
+   * STRING key of the entry last returned by scanNext.
+   */
+	std::string	lastKeyString;
 
-/**
-    * Given a current page and a target, function will cast the page to a non-leaf-node
-    * and check to see which pointer in pageNoArray points to the given target
-    * recrusivly calls itself when it finds that new node to continue traversing down to the target.
-    * @param current        current node being iterated through
-    * @param target         target value
-**/
-   
-   LeafNodeInt* traverseTree (Page current, int target, int level);
-/**
-	*Recursivly iterates down the tree to find the leaf node to insert target key and id into
-	*splits and propogates nodes back up tree if need be
-	*@param current		current page being interated through
-	*@param target		target key
-	*@param level		previous depth in the tree
-	*@param id		rid to be inserted into tree
-**/
-	NonLeafNodeInt* treeInsertNode(Page*& current, PageId curPid, int target, int level, RecordId rid);
+  /**
+   * RecordId of the entry last returned by scanNext.
+   */
+	RecordId	lastRid;
 
-   void insertIntoNonLeaf(NonLeafNodeInt* tempNode, NonLeafNodeInt*& cur);
-   
-   void insertIntoLeaf(LeafNodeInt*& cur, int target, RecordId rid);
+  /**
+   * Value of BTreeIndex::leafShifts when the cursor last found its place.
+   */
+	std::uint64_t	leafShiftsSeen;
 
-   void splitLeafNode(LeafNodeInt* cur, PageId curPid, NonLeafNodeInt*& tempNode, int target, RecordId rid);
+  /**
+   * Place inside the posting list of entry nextEntry the scan is in the middle of, pageNo is
+   * Page::INVALID_NUMBER if it is not in one.
+   */
+	PostingPosition	posting;
 
-   void splitNonLeaf(NonLeafNodeInt* oldNode, PageId oldPid, NonLeafNodeInt* tempNode, NonLeafNodeInt* returnedNode, PageId returnPid);
+  /**
+   * Version of the latch of the current leaf when the cursor let go of it. While it stays the same
+   * neither the leaf nor its posting lists changed, so posting is still good.
+   */
+	std::uint32_t	leafVersion;
 
   /**
-	 * Insert a new entry using the pair <value,rid>. 
-	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
-	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
-	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
-	 * Make sure to unpin pages as soon as you can.
-   * @param key			Key to insert, pointer to integer/double/char string
-   * @param rid			Record ID of a record whose entry is getting inserted into the index.
-	**/
-	void insertEntry(const void* key, const RecordId rid);
+   * RecordIds of the posting list of entry nextEntry - 1 a descending scan is in the middle of. Posting
+   * pages only link forwards, so the list is read as a whole and returned from the back.
+   */
+	std::vector<RecordId>	postingRids;
 
+  /**
+   * Payloads of postingRids in a covering index, BTreeIndex::payloadSize bytes each.
+   */
+	std::vector<char>	postingPayloads;
 
   /**
-	 * Begin a filtered scan of the index.  For instance, if the method is called 
-	 * using ("a",GT,"d",LTE) then we should seek all entries with a value 
-	 * greater than "a" and less than or equal to "d".
-	 * If another scan is already executing, that needs to be ended here.
-	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
-	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+   * Number of RecordIds at the front of postingRids not returned yet, 0 if the scan is not in a posting list.
+   */
+	int			postingLeft;
+
+  /**
+   * Bounds of one range of a multi-range scan, kept like those of the range being scanned.
+   */
+	struct Range {
+		int lowInt;
+		int highInt;
+		std::string lowString;
+		std::string highString;
+		Operator lowOp;
+		Operator highOp;
+	};
+
+  /**
+   * Ranges of a multi-range scan in key order, empty for other scans.
+   */
+	std::vector<Range>	ranges;
+
+  /**
+   * Position in ranges of the range to scan once the current one is done.
+   */
+	size_t	nextRange;
+
+  /**
+   * Construct a cursor with no position. Only BTreeIndex::openScan, BTreeIndex::openReverseScan and
+   * BTreeIndex::openMultiScan create cursors.
+   */
+	IndexScanCursor(BTreeIndex *index, const Operator lowOp, const Operator highOp, const bool descending);
+
+ public:
+
+  /**
+	 * End the scan, unpinning the leaf it is on.
+	**/
+	~IndexScanCursor();
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid);
+
+  /**
+	 * Fetch the record id and the included columns of the next index entry that matches the scan, so an
+	 * index-only scan never reads the record.
+   * @param outRid			RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload	BTreeIndex::getPayloadSize bytes the payload of the entry is returned in
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid, char* outPayload);
+
+  /**
+	 * Fetch the record ids of up to maxRids next index entries that match the scan, taking whole runs
+	 * of a leaf at a time.
+   * @param outRids	Array of at least maxRids RecordIds the matching entries are returned in
+   * @param maxRids	Largest number of entries to return
+	 * @return				Number of entries returned; less than maxRids only once the scan is complete, 0 on every call after that
+	**/
+	int scanNextBatch(RecordId* outRids, const int maxRids);
+
+  /**
+	 * scanNextBatch that also returns the included columns of each entry.
+   * @param outRids			Array of at least maxRids RecordIds the matching entries are returned in
+   * @param outPayloads	Array of maxRids payloads of BTreeIndex::getPayloadSize bytes, filled alongside outRids;
+   *										may be nullptr if they are not needed
+   * @param maxRids			Largest number of entries to return
+	 * @return						Number of entries returned, as for scanNextBatch
+	**/
+	int scanNextBatch(RecordId* outRids, char* outPayloads, const int maxRids);
+};
+
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation. startScan, scanNext and endScan drive one built-in scan; openScan returns independent
+ * cursors for as many further scans as needed. startReverseScan and openReverseScan do the same in
+ * descending key order, so the largest keys of a range come first without reading the rest of it.
+ *
+ * insertEntry and lookup may be called from several threads at once. Every page carries a latch with a
+ * version counter. Non-leaf nodes are read optimistically (optimistic lock coupling): a descent takes no
+ * latch above the leaf but checks after reading each node that its version did not change, and starts
+ * over from the root if it did. Only the leaf is latched, shared by readers and exclusive by inserts.
+ * Non-leaf nodes a descent validated stay pinned in a node cache, up to a share of the buffer pool, so
+ * descents normally only go through the buffer manager for the leaf.
+ * An insert that has to split its leaf descends again coupling exclusive latches from the root down
+ * (latch crabbing), keeping them only on the ancestors the split could still reach.
+ * Latches are never held between calls, so a scan keeps its leaf pinned but re-latches it in every
+ * scanNext and finds its place again from the last entry it returned if the leaf changed meanwhile.
+ * Leaves are linked both ways but only ever latched left to right: a descending scan pins the left
+ * sibling, lets go of its leaf, and only trusts the link if the leaf did not change meanwhile.
+ * The built-in scan (startScan, scanNext, endScan) belongs to one thread.
+ *
+ * deleteEntry works the same way in reverse: it removes the entry from its leaf under the leaf latch alone
+ * unless the leaf would underflow, and otherwise crabs down from the root keeping the ancestors a merge
+ * could reach. Merges always empty the right node of a pair into the left one, and a node taken out of
+ * the tree goes back to the file only once no thread has it pinned any more.
+ *
+ * Once enableSubtreeCounts was called, the non-leaf nodes of an INTEGER index also keep the number of
+ * entries below each child. An insert or delete that stays within its leaf then latches the root shared
+ * instead of reading it optimistically and adds to the counts on its path atomically; one that splits or
+ * merges keeps its whole path latched exclusively, root included. countRange holds the root shared, so
+ * it sees no split or merge halfway and its count is exact.
+*/
+class BTreeIndex {
+
+	friend class IndexScanCursor;
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+	 * Only changed while the old root is latched exclusively, so a thread that latched the root (or read
+	 * its version) and then still finds it here knows it has the current root.
+   */
+	std::atomic<PageId>	rootPageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records. 
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Number of entries an INTEGER leaf holds: INTARRAYLEAFSIZE, or fewer in a covering index so that the
+   * payloads of its entries fit into the end of ridArray.
+   */
+	int			leafOccupancy;
+
+  /**
+   * Fewest entries an INTEGER leaf other than the only one keeps after a delete, INTLEAFMIN scaled to leafOccupancy.
+   */
+	int			leafMin;
+
+  /**
+   * Number of entries of one key an INTEGER leaf gathers into a posting list, INTPOSTINGMIN scaled to leafOccupancy.
+   */
+	int			postingMin;
+
+  /**
+   * Columns stored with each entry, empty unless this is a covering index.
+   */
+	std::vector<IncludedColumn>	includedColumns;
+
+  /**
+   * Number of bytes of included columns stored with each entry, the sum of their lengths.
+   */
+	int			payloadSize;
+
+  /**
+   * Number of keys in non-leaf node, depending upon the type of key.
+   */
+	int			nodeOccupancy;
+
+  /**
+   * Copy of IndexMetaInfo::subtreeCounts: the non-leaf nodes of this INTEGER index keep entry counts.
+   */
+	bool		subtreeCounts;
+
+  /**
+   * Descents of this INTEGER index search cached non-leaf nodes through Eytzinger copies of their keys, see
+   * enableEytzingerSearch.
+   */
+	bool		eytzingerSearch;
+
+  /**
+   * One piece of the learned model: from firstKey on, the number of leaf separators below a key grows by
+   * slope per key, starting from rank.
+   */
+	struct LearnedSegment {
+		int firstKey;
+		double slope;
+		double rank;
+	};
+
+  /**
+   * Pieces of the learned model, by firstKey, empty if the index has none. See enableLearnedModel.
+   */
+	std::vector<LearnedSegment>	learnedSegments;
+
+  /**
+   * Keys separating the leaves, in order, as they were when the model was built: the leaf a descent for a
+   * key reaches is learnedLeaves[number of separators < key].
+   */
+	std::vector<int>	learnedSeparators;
+
+  /**
+   * Leaves from left to right, as they were when the model was built.
+   */
+	std::vector<PageId>	learnedLeaves;
+
+  /**
+   * Largest error of the model in leaves.
+   */
+	int			learnedMaxError;
+
+  /**
+   * True while no leaf was split or merged since the model was built, so that learnedLeaves still holds the
+   * leaf of every key. Cleared under the exclusive latch of the leaf that changes.
+   */
+	std::atomic<bool>	learnedFresh;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Cursor of the scan driven by startScan, scanNext and endScan.
+   */
+	IndexScanCursor	*scanCursor;
+
+
+	// MEMBERS SPECIFIC TO CONCURRENCY
+
+  /**
+   * Latches of the index pages, see latchPage.
+   */
+	LatchTable	latches;
+
+  /**
+   * Number of times a delete moved leaf entries, possibly onto the leaf left of them. Ascending scans
+   * only ever walk right, so one that sees this change looks its place up again from the root.
+   */
+	std::atomic<std::uint64_t>	leafShifts;
+
+  /**
+   * Non-leaf nodes kept pinned for descents, see readNode.
+   */
+	NodeCache	nodeCache;
+
+  /**
+   * Pages deletes took out of the tree that were still pinned when they tried to dispose of them.
+   */
+	std::vector<PageId>	retiredPages;
+
+  /**
+   * Guards retiredPages.
+   */
+	std::mutex	retiredMutex;
+
+  /**
+   * Filter that answers lookups of absent keys without a descent, empty unless enableBloomFilter was called.
+   */
+	BloomFilter	bloomFilter;
+
+  /**
+   * An entry inserted into the insert buffer and not yet into the tree.
+   */
+	struct BufferedInsert {
+		RecordId rid;
+		std::string payload;
+	};
+
+  /**
+   * Entries waiting to go into the tree, by key and then RecordId order, see enableInsertBuffer.
+   */
+	std::multimap<std::pair<int, std::uint64_t>, BufferedInsert>	insertBuffer;
+
+  /**
+   * Number of entries that make insertEntry flush the insert buffer, 0 if inserts go straight into the tree.
+   */
+	int			insertBufferLimit;
+
+  /**
+   * Number of times the insert buffer was flushed. A lookup that reads the buffer and then the tree checks
+   * it did not change in between, or it may have found an entry twice.
+   */
+	std::uint64_t	insertBufferFlushes;
+
+  /**
+   * Guards insertBuffer and insertBufferFlushes, and is held for the whole of a flush.
+   */
+	std::mutex	insertBufferMutex;
+
+  /**
+   * Pages of the index file the Bloom filter is written to when the index is closed.
+   */
+	std::vector<PageId>	bloomPages;
+
+  /**
+   * A node latched by an insert or delete on its way down, kept until it knows whether a split or merge
+   * reaches it.
+   */
+	struct PathEntry {
+		PageId pageNo;
+		Page* page;
+		int child;
+	};
+
+
+  /**
+	 * Pin a page of the index file and latch it. Pages are always pinned before they are latched
+	 * and unlatched before they are unpinned.
+   * @param pageNo		Page to read
+   * @param exclusive	Take the latch in exclusive instead of shared mode
+	 * @return					Pinned and latched page
+	**/
+	Page* latchPage(const PageId pageNo, const bool exclusive);
+
+  /**
+	 * Undo latchPage.
+   * @param pageNo		Page to release
+   * @param exclusive	The latch is held in exclusive mode
+   * @param dirty			The page was changed
+	**/
+	void unlatchPage(const PageId pageNo, const bool exclusive, const bool dirty);
+
+  /**
+	 * Get a non-leaf node for an optimistic read, from the node cache if it is there and pinned through
+	 * the buffer manager otherwise.
+   * @param pageNo		Page to read
+   * @param cached		True returned in this if the page came from the node cache
+	 * @return					Frame of the page
+	**/
+	Page* readNode(const PageId pageNo, bool& cached);
+
+  /**
+	 * Undo readNode. A node read through the buffer manager whose version was validated is offered to
+	 * the node cache, which then keeps the pin.
+   * @param pageNo		Page to release
+   * @param page			Frame returned by readNode
+   * @param cached		Value readNode returned in cached
+   * @param validated	The node was reachable from the root and its version validated
+	**/
+	void releaseNode(const PageId pageNo, Page* page, const bool cached, const bool validated);
+
+  /**
+	 * Release the exclusive latches an insert or delete holds on the nodes of path.
+	 * Called once a node below them is known to absorb any split or merge. None of the released pages was changed
+	 * unless subtree counts are kept, in which case they are all marked dirty.
+   * @param path				Nodes to release, cleared on return
+	**/
+	void releasePath(std::vector<PathEntry>& path);
+
+  /**
+	 * Descend from the root to the leaf of an INTEGER index that may hold key, reading the non-leaf
+	 * nodes optimistically and restarting whenever one of them changes under the descent.
+   * @param key			Key to search for
+   * @param leafPid	Page number of the leaf returned in this
+   * @param exclusive	Latch the leaf in exclusive instead of shared mode
+	 * @return				Pinned and latched leaf page
+	**/
+	Page* findLeafInt(const int key, PageId& leafPid, const bool exclusive);
+
+  /**
+	 * Latch the current root, retrying if the root changes while the latch is awaited.
+   * @param rootPid		Page number of the root returned in this
+   * @param exclusive	Latch in exclusive instead of shared mode
+	 * @return					Pinned and latched root page
+	**/
+	Page* latchRoot(PageId& rootPid, const bool exclusive);
+
+  /**
+	 * Descend to the leaf of an INTEGER index with subtree counts that may hold key. The root is latched
+	 * shared, which keeps out every split and merge, the non-leaf nodes below it are only pinned, and the
+	 * leaf is latched exclusively. Undone with releaseCountPath.
+   * @param key			Key to search for
+   * @param path		Non-leaf nodes passed through and the child taken in each, root first
+   * @param leafPid	Page number of the leaf returned in this
+	 * @return				Pinned and exclusively latched leaf page
+	**/
+	Page* latchCountPathInt(const int key, std::vector<PathEntry>& path, PageId& leafPid);
+
+  /**
+	 * Add delta to the count of the child taken in each of the first end nodes of path. Does nothing
+	 * unless subtree counts are kept.
+   * @param path		Nodes from the root down, as latched by an insert or delete
+   * @param end			Number of nodes of path to change
+   * @param delta		Change in the number of entries below
+	**/
+	void addPathCounts(std::vector<PathEntry>& path, const size_t end, const int delta);
+
+  /**
+	 * Undo latchCountPathInt after adding delta to the counts along path.
+   * @param path		Path returned by latchCountPathInt, cleared on return
+   * @param delta		Change in the number of entries of the leaf, 0 if it was not changed
+	**/
+	void releaseCountPath(std::vector<PathEntry>& path, const int delta);
+
+  /**
+	 * Count the entries at positions [begin, end) of an INTEGER leaf, a posting list counting
+	 * with all its RecordIds.
+   * @param leaf		Latched leaf
+   * @param begin		First position to count
+   * @param end			Position after the last one to count
+	 * @return				Number of entries
+	**/
+	long leafEntriesInt(const LeafNodeInt* leaf, const int begin, const int end);
+
+  /**
+	 * Set the counts of every non-leaf node below and including pageNo from the leaves up.
+	 * Only called while no other thread uses the index.
+   * @param pageNo	Non-leaf node of an INTEGER index
+	 * @return				Number of entries below the node
+	**/
+	long fillCountsInt(const PageId pageNo);
+
+  /**
+	 * Hash every distinct key of the index, walking the leaves from left to right.
+	 * Only called while no other thread uses the index.
+   * @param outHashes	Hashes of the keys returned in this, see BloomFilter::hash
+	**/
+	void hashKeys(std::vector<std::uint64_t>& outHashes);
+
+  /**
+	 * Rebuild the Bloom filter with the given number of blocks from the keys of the index.
+	 * Only called while no other thread uses the index.
+	**/
+	void fillBloomFilter(const std::uint32_t blocks);
+
+  /**
+	 * Find the child of an INTEGER non-leaf node a descent to key goes to. Nodes found in the node cache are
+	 * searched through their Eytzinger copy when eytzingerSearch is set and the copy matches the version
+	 * the node was read at, and get a new copy when it does not. The caller validates the node afterwards.
+   * @param node			Node, read optimistically
+   * @param pageNo		Page number of the node
+   * @param version		Version the node was read at; the node was in the tree at that version
+   * @param cached		The node was found in the node cache
+   * @param key				Key the descent is for
+	 * @return					Index of the child in pageNoArray
+	**/
+	int childIndexInt(const NonLeafNodeInt* node, const PageId pageNo, const std::uint32_t version, const bool cached,
+			const int key);
+
+  /**
+	 * Find the leaf of an INTEGER key through the learned model instead of a descent, and latch it shared.
+	 * The predicted leaf is checked against the separators around it.
+   * @param key				Key to look for
+   * @param leafPid		Page number of the leaf returned in this
+	 * @return					The latched leaf, or nullptr if there is no fresh model or the prediction is off
+	 *									by more than the model allows; then the caller descends from the root.
+	**/
+	Page* findLearnedLeafInt(const int key, PageId& leafPid);
+
+  /**
+	 * Walk the non-leaf nodes below pageNo in key order, appending their leaves to learnedLeaves and the keys
+	 * between them to learnedSeparators.
+	**/
+	void collectLeavesInt(const PageId pageNo);
+
+  /**
+	 * Move every entry of the insert buffer into the tree. Entries are taken in key order and all those
+	 * that fit into the leaf found for the first one go in under a single latch, so a leaf is read and
+	 * written about once per flush however many entries it gains. Called with insertBufferMutex held.
+	**/
+	void drainInsertBuffer();
+
+  /**
+	 * lookup for an INTEGER index with an insert buffer: the entries of the key found in the tree with the
+	 * buffered ones merged in, in RecordId order.
+   * @param key					Key to look for
+   * @param outRids			RecordIds of the matching entries returned in this
+   * @param outPayloads	Payloads of the matching entries returned in this; null if not asked for
+	**/
+	void lookupBufferedInt(const int key, std::vector<RecordId>& outRids, std::vector<char>* outPayloads);
+
+  /**
+	 * Set IndexMetaInfo::bloomClean, writing the meta page through to the file at once.
+	**/
+	void markBloomFilter(const bool clean);
+
+  /**
+	 * Record a new root in the meta page and write the page through to the file at once, so that the index
+	 * opens at this root even if it is never closed. Called with the old root latched exclusively, after the
+	 * new root is set in rootPageNum.
+   * @param rootLevel	Level of the new root
+	**/
+	void writeRootInfo(const int rootLevel);
+
+  /**
+	 * Hash of a key as the Bloom filter takes it.
+   * @param key			Key, pointer to integer/double/char string
+	**/
+	std::uint64_t bloomHash(const void* key) const;
+
+  /**
+	 * Count the entries with keys in [low, high] below a node of an INTEGER index with subtree counts.
+	 * Children the range covers whole are counted from their parent, so only the nodes on the paths to
+	 * the two bounds are read. The caller holds the root latched shared.
+   * @param pageNo			Node to count below
+   * @param level				Level of the node, 0 for a leaf
+   * @param low					Smallest key to count
+   * @param high				Largest key to count
+   * @param lowBounded	False if every key below the node is known to be >= low
+   * @param highBounded	False if every key below the node is known to be <= high
+	 * @return						Number of entries
+	**/
+	long countSubtreeInt(const PageId pageNo, const int level, const int low, const int high,
+			const bool lowBounded, const bool highBounded);
+
+  /**
+	 * Count the entries with keys in [low, high] of an INTEGER index by walking its leaves.
+   * @param low			Smallest key to count
+   * @param high		Largest key to count
+	 * @return				Number of entries
+	**/
+	long countLeavesInt(const int low, const int high);
+
+  /**
+	 * STRING counterpart of countLeavesInt.
+   * @param low			Low bound, already cut as by makeStringKey
+   * @param lowOp		GT or GTE
+   * @param high		High bound, already cut as by makeStringKey
+   * @param highOp	LT or LTE
+	 * @return				Number of entries
+	**/
+	long countLeavesString(const std::string& low, const Operator lowOp, const std::string& high,
+			const Operator highOp);
+
+  /**
+	 * Estimate the share of the entries below a node of an INTEGER index with keys in [low, high], see
+	 * estimateSelectivity. Children the range covers whole add their weight; those the bounds lead to
+	 * are latched shared and estimated in turn.
+   * @param page				Node, latched shared by the caller
+   * @param level				Level of the node, 0 for a leaf
+   * @param low					Smallest key in the range
+   * @param high				Largest key in the range
+   * @param lowBounded	False if every key below the node is known to be >= low
+   * @param highBounded	False if every key below the node is known to be <= high
+	 * @return						Estimated share in [0, 1]
+	**/
+	double estimateInt(const Page* page, const int level, const int low, const int high,
+			const bool lowBounded, const bool highBounded);
+
+  /**
+	 * STRING counterpart of estimateInt. Every child of a node is taken to hold as many entries.
+   * @param page				Node, latched shared by the caller
+   * @param level				Level of the node, 0 for a leaf
+   * @param low					Low bound, already cut as by makeStringKey
+   * @param lowOp				GT or GTE
+   * @param high				High bound, already cut as by makeStringKey
+   * @param highOp			LT or LTE
+   * @param lowBounded	False if every key below the node is known to be above the low bound
+   * @param highBounded	False if every key below the node is known to be below the high bound
+	 * @return						Estimated share in [0, 1]
+	**/
+	double estimateString(const Page* page, const int level, const std::string& low, const Operator lowOp,
+			const std::string& high, const Operator highOp, const bool lowBounded, const bool highBounded);
+
+  /**
+	 * Insert a key/rid pair into an index over an INTEGER attribute. The leaf is found optimistically; if it
+	 * is full the insert starts over, crabbing exclusive latches down the tree.
+   * @param key			Key to insert
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   * @param payload	payloadSize bytes of included columns to store with the entry
+	**/
+	void insertEntryInt(const int key, const RecordId rid, const char* payload);
+
+  /**
+	 * Split a full leaf while adding the pair at position pos. The entries above the key boundary nearest
+	 * the middle move to a new leaf linked in to the right of cur, so no key spans both leaves.
+   * @param cur			Full leaf, latched exclusively
+   * @param curPid	Page number of cur
+   * @param pos			Position of the new pair among the entries of cur
+   * @param key			Key to insert
+   * @param rid			Record ID to insert
+   * @param payload	Payload of the new entry
+   * @param sepKey	Largest key left in cur returned in this, every key of the new leaf is >= sepKey
+	 * @return				Page number of the new leaf
+	**/
+	PageId splitLeafNode(LeafNodeInt* cur, const PageId curPid, const int pos, const int key, const RecordId rid,
+			const char* payload, int& sepKey);
+
+  /**
+	 * Point the left sibling link of a leaf at leftPid, after the leaf left of it was split or merged. The
+	 * caller holds the latch of that left leaf, so the leaf is latched in the usual left to right order.
+   * @param pageNo	Leaf to change, nothing is done for Page::INVALID_NUMBER
+   * @param leftPid	Page number of its new left sibling
+	**/
+	void linkLeftSibling(const PageId pageNo, const PageId leftPid);
+
+  /**
+	 * Move from a leaf latched in shared mode onto its left sibling. The sibling is pinned before the leaf is
+	 * let go and latched after, and is only returned if the leaf did not change in between.
+   * @param pageNo	Leaf latched in shared mode; unlatched and unpinned in any case
+   * @param leftPid	Its left sibling, as read under the latch
+	 * @return				Left sibling, pinned and latched in shared mode, or nullptr if the link may be stale
+	**/
+	Page* latchLeftLeaf(const PageId pageNo, const PageId leftPid);
+
+  /**
+	 * Split a full non-leaf while adding key at position pos with child to its right. The upper half
+	 * of the keys moves to a new node and the middle key moves up.
+   * @param cur			Full non-leaf, latched exclusively
+   * @param pos			Position of the new key among the keys of cur
+   * @param key			Key to insert
+   * @param child		Page number of the child right of key
+   * @param childCount	Entry count of child, kept if subtree counts are
+   * @param upKey		Key to insert into the parent returned in this
+	 * @return				Page number of the new node
+	**/
+	PageId splitNonLeaf(NonLeafNodeInt* cur, const int pos, const int key, const PageId child, const int childCount,
+			int& upKey);
+
+  /**
+	 * Remove a key/rid pair from an index over an INTEGER attribute. The leaf is found optimistically; if the
+	 * removal would leave it underfull the delete starts over, crabbing exclusive latches down the tree, and merges
+	 * or evens out underfull nodes with a sibling on the way back up.
+   * @param key			Key to remove
+   * @param rid			Record ID of the entry to remove
+	 * @throws  NoSuchKeyFoundException If the index has no such entry.
+	**/
+	void deleteEntryInt(const int key, const RecordId rid);
+
+  /**
+	 * Find the entry (key, rid) starting at the leaf an INTEGER key descends to, moving right while
+	 * duplicates of key go on. Leaves are latched exclusively, coupled left to right.
+   * @param page		Exclusively latched leaf to start at, the leaf holding the entry returned in this
+   * @param leafPid	Page number of page, updated with it
+   * @param key			Key to find
+   * @param rid			Record ID to find
+   * @param pos			Position of the entry in its leaf returned in this
+	 * @return				True if the entry was found; its leaf is then still latched, otherwise nothing is
+	**/
+	bool seekEntryInt(Page*& page, PageId& leafPid, const int key, const RecordId rid, int& pos);
+
+  /**
+	 * Find the entry (key, rid) in a latched INTEGER leaf, looking inside posting lists as well.
+   * @param node		Leaf to search
+   * @param numKeys	Number of entries of node
+   * @param key			Key to find
+   * @param rid			Record ID to find
+   * @param found		Whether the entry is on this leaf returned in this
+	 * @return				Position of the entry holding (key, rid) if found, otherwise of the first entry with a larger key, or numKeys
+	**/
+	int locateEntryInt(const LeafNodeInt* node, const int numKeys, const int key, const RecordId rid, bool& found);
+
+  /**
+	 * Find where a scan that returned (key, rid) last goes on in a latched INTEGER leaf: at the first entry
+	 * after it in key and RecordId order, whether or not (key, rid) itself is still there.
+   * @param node		Leaf to search
+   * @param numKeys	Number of entries of node
+   * @param key			Key returned last
+   * @param rid			Record ID returned last
+   * @param posting	If the scan goes on inside a posting list, its place there returned in this;
+	 *								otherwise pageNo is set to Page::INVALID_NUMBER
+	 * @return				Position of the entry to go on with, numKeys if it is past this leaf
+	**/
+	int resumeLeafInt(const LeafNodeInt* node, const int numKeys, const int key, const RecordId rid, PostingPosition& posting);
+
+  /**
+	 * Add rid to the posting list of key in an exclusively latched leaf, or gather the entries of key and
+	 * rid into a new posting list if there are postingMin of them with it.
+   * @param leaf		Leaf to insert into
+   * @param numKeys	Number of entries of leaf
+   * @param key			Key to insert
+   * @param rid			Record ID to insert
+   * @param payload	Payload of the new entry
+	 * @return				True if rid went into a posting list, false if it has to be inserted as a plain entry
+	**/
+	bool insertPostingInt(LeafNodeInt* leaf, const int numKeys, const int key, const RecordId rid, const char* payload);
+
+  /**
+	 * Add rid and its payload to the posting list starting at page headPid. A page it does not fit on is split in two.
+	**/
+	void insertPosting(const PageId headPid, const RecordId rid, const char* payload);
+
+  /**
+	 * Find the first RecordId of the posting list starting at page headPid that is not below rid, or that
+	 * is above it if after is set.
+   * @param headPid		First page of the list
+   * @param rid				Record ID to compare with
+   * @param after			Skip rid itself
+   * @param position	Place of the RecordId found returned in this
+   * @param atRid			The RecordId found returned in this
+	 * @return					False if the list has no such RecordId
+	**/
+	bool seekPosting(const PageId headPid, const RecordId rid, const bool after, PostingPosition& position, RecordId& atRid);
+
+  /**
+	 * Remove rid from the posting list of entry pos of an exclusively latched leaf, turning the entry back into
+	 * a plain one if a single RecordId is left.
+   * @param leaf		Leaf holding the entry
+   * @param pos			Position of the entry
+   * @param rid			Record ID to remove
+   * @param freed		Pages that left the list are appended to this, to be retired once the leaf is let go
+	 * @return				False if the list does not hold rid
+	**/
+	bool removePosting(LeafNodeInt* leaf, const int pos, const RecordId rid, std::vector<PageId>& freed);
+
+  /**
+	 * Append every RecordId of the posting list starting at page headPid to outRids, and their payloads
+	 * to outPayloads unless it is nullptr.
+	**/
+	void readPosting(const PageId headPid, std::vector<RecordId>& outRids, std::vector<char>* outPayloads);
+
+  /**
+	 * Hand pages taken out of the tree back to the file, together with those that could not be disposed of before.
+	 * Pages some thread still has pinned are kept for a later call. Retired pages leave the node cache first.
+   * @param pages		Unlatched and unpinned pages no longer reachable from the root
+	**/
+	void retirePages(const std::vector<PageId>& pages);
+
+
+  /**
+	 * Insert a key/rid pair into an index over a STRING attribute.
+	 * The leaf is found optimistically and the pair added if the leaf has room. Otherwise descends again from the root
+	 * crabbing exclusive latches, adds the pair to the leaf and pushes the truncated separator of the split up the
+	 * latched path, splitting non-leaf nodes and growing a new root as needed.
+   * @param key			Key to insert, already cut down as described for STRINGSIZE
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	void insertEntryString(const std::string& key, const RecordId rid);
+
+  /**
+	 * STRING counterpart of deleteEntryInt. A redistribution whose new separator does not fit into the
+	 * parent is skipped, leaving the node underfull.
+   * @param key			Key to remove, already cut down as described for STRINGSIZE
+   * @param rid			Record ID of the entry to remove
+	 * @throws  NoSuchKeyFoundException If the index has no such entry.
+	**/
+	void deleteEntryString(const std::string& key, const RecordId rid);
+
+  /**
+	 * STRING counterpart of seekEntryInt.
+	**/
+	bool seekEntryString(Page*& page, PageId& leafPid, const std::string& key, const RecordId rid, int& pos);
+
+  /**
+	 * STRING counterpart of findLeafInt. Each non-leaf node is copied and the copy searched once its
+	 * version checks out, since a slotted page read while it changes can point anywhere.
+   * @param key			Key to search for
+   * @param leafPid	Page number of the leaf returned in this
+   * @param exclusive	Latch the leaf in exclusive instead of shared mode
+	 * @return				Pinned and latched leaf page
+	**/
+	Page* findLeafString(const std::string& key, PageId& leafPid, const bool exclusive);
+
+  /**
+	 * STRING counterpart of lookup.
+   * @param key			Key to look for, already cut down as described for STRINGSIZE
+   * @param outRids	RecordIds of the matching entries are appended to this
+	 * @return				Number of matching entries
+	**/
+	int lookupString(const std::string& key, std::vector<RecordId>& outRids);
+
+  /**
+	 * Append the RecordIds of every entry with the given key to outRids, starting at the leaf a descent
+	 * for the key latched and following right siblings as long as the key continues on them.
+   * @param page		Leaf latched in shared mode; the leaf the key ends on, still latched, returned in this
+   * @param leafPid	Page number of page, updated along with it
+   * @param key			Key to look for
+   * @param outRids	RecordIds of the matching entries are appended to this
+   * @param outPayloads	Payloads of the matching entries are appended to this unless it is nullptr
+	**/
+	void probeLeafInt(Page*& page, PageId& leafPid, const int key, std::vector<RecordId>& outRids,
+			std::vector<char>* outPayloads);
+
+  /**
+	 * STRING counterpart of probeLeafInt.
+	**/
+	void probeLeafString(Page*& page, PageId& leafPid, const std::string& key, std::vector<RecordId>& outRids);
+
+  /**
+	 * INTEGER part of lookupMany. Keeps the leaf the last key ended on latched and probes the next key
+	 * there if it is larger and not past the last key of the leaf, descending from the root otherwise.
+   * @param keys				Keys as passed to lookupMany
+   * @param numKeys			Number of keys
+   * @param outRids			RecordIds of the matching entries are appended to this
+   * @param outOffsets	Position in outRids of the entries of each key is appended to this
+	**/
+	void lookupManyInt(const void* const* keys, const int numKeys, std::vector<RecordId>& outRids,
+			std::vector<int>& outOffsets);
+
+  /**
+	 * STRING counterpart of lookupManyInt.
+	**/
+	void lookupManyString(const void* const* keys, const int numKeys, std::vector<RecordId>& outRids,
+			std::vector<int>& outOffsets);
+
+  /**
+	 * INTEGER part of openScan: set the bounds of the cursor and place it on the first matching entry.
+   * @param cursor	New cursor, its operators already validated
+	 * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	void startScanInt(IndexScanCursor& cursor, const int lowVal, const int highVal);
+
+  /**
+	 * STRING counterpart of startScanInt.
+	 * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	void startScanString(IndexScanCursor& cursor, const std::string& lowVal, const std::string& highVal);
+
+  /**
+	 * Advance a cursor over an INTEGER index, see IndexScanCursor::scanNextBatch.
+	**/
+	int scanBatchInt(IndexScanCursor& cursor, RecordId* outRids, char* outPayloads, const int maxRids);
+
+  /**
+	 * STRING counterpart of scanBatchInt.
+	**/
+	int scanBatchString(IndexScanCursor& cursor, RecordId* outRids, const int maxRids);
+
+  /**
+	 * Descend to the place a descending INTEGER cursor goes on from: right below its last entry, or at the
+	 * high bound if it has not returned any. Sets the leaf of the cursor and, if the place is inside a
+	 * posting list, postingRids, postingPayloads and postingLeft.
+   * @param cursor	Descending cursor whose leaf is not latched or pinned
+	 * @return				Number of entries of the leaf, now latched in shared mode, that come before the place
+	**/
+	int seekReverseInt(IndexScanCursor& cursor);
+
+  /**
+	 * STRING counterpart of seekReverseInt. A last entry that is gone puts the cursor before the other entries
+	 * of its key on the leaf it is found on, like an ascending scan skips the rest of such a key.
+	**/
+	int seekReverseString(IndexScanCursor& cursor);
+
+  /**
+	 * Move a descending INTEGER cursor whose leaf is used up onto the left sibling, descending again with
+	 * seekReverseInt if the link may be stale.
+   * @param cursor	Descending cursor, its leaf latched in shared mode
+	 * @return				Number of entries of the new leaf that come before the place, or -1 if there is no left
+	 *								sibling; the leaf then stays latched
+	**/
+	int stepLeftInt(IndexScanCursor& cursor);
+
+  /**
+	 * STRING counterpart of stepLeftInt.
+	**/
+	int stepLeftString(IndexScanCursor& cursor);
+
+  /**
+	 * Place a new descending INTEGER cursor on the last entry at or below the high bound, see startScanInt.
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	void startReverseScanInt(IndexScanCursor& cursor);
+
+  /**
+	 * STRING counterpart of startReverseScanInt.
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	void startReverseScanString(IndexScanCursor& cursor);
+
+  /**
+	 * Advance a descending cursor over an INTEGER index, see IndexScanCursor::scanNextBatch.
+	**/
+	int reverseBatchInt(IndexScanCursor& cursor, RecordId* outRids, char* outPayloads, const int maxRids);
+
+  /**
+	 * STRING counterpart of reverseBatchInt.
+	**/
+	int reverseBatchString(IndexScanCursor& cursor, RecordId* outRids, const int maxRids);
+
+  /**
+	 * Check the ranges of openMultiScan and keep them in the cursor in key order, dropping those that cannot
+	 * match and merging those that overlap or touch.
+   * @param cursor		New cursor
+   * @param ranges		Ranges as passed to openMultiScan
+   * @param numRanges	Number of ranges
+   * @throws  BadOpcodesException If a range has an unexpected operator
+   * @throws  BadScanrangeException If a range has lowVal > highVal
+	**/
+	void setRanges(IndexScanCursor& cursor, const ScanRange* ranges, const int numRanges);
+
+  /**
+	 * Make the next range of a multi-range scan the current one. Nothing has been returned from it yet, so
+	 * the cursor goes on from its low bound.
+	 * @return				False if the scan has no range left
+	**/
+	bool advanceRange(IndexScanCursor& cursor);
+
+  /**
+	 * Check the operators and open a cursor for openScan or openReverseScan.
+	**/
+	IndexScanCursor* newCursor(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			const bool descending);
+
+
+ public:
+
+  /**
+   * BTreeIndex Constructor. 
+	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @param included						Columns to store in the leaves next to each entry, making this a covering
+   *													index; only INTEGER indexes support them. Each entry then takes more room, so
+   *													the leaves hold fewer entries.
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type, included columns etc.) do not match with values received through constructor parameters,
+   *													or if the included columns are not supported: for a STRING index, more than MAXINCLUDEDCOLUMNS of them or more than MAXPAYLOADSIZE bytes in all.
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const std::vector<IncludedColumn>& included = std::vector<IncludedColumn>());
+	
+
+  /**
+   * BTreeIndex Destructor. 
+	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+	 * and delete file instance thereby closing the index file.
+	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself. 
+	 * */
+	~BTreeIndex();
+
+  /**
+	 * Insert a new entry using the pair <value,rid>. 
+	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
+	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
+	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
+	 * Make sure to unpin pages as soon as you can.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Insert a new entry together with the values of its included columns. insertEntry stores zeros for them.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   * @param payload	getPayloadSize bytes of included columns, laid out as in a payload
+	**/
+	void insertEntry(const void* key, const RecordId rid, const void* payload);
+
+  /**
+	 * Insert the entry of a record, taking the key and the included columns from the record itself.
+   * @param record	Record as stored in the base relation
+   * @param rid			Record ID of the record
+	**/
+	void insertRecord(const char* record, const RecordId rid);
+
+
+  /**
+	 * Remove the entry <value,rid>. A leaf left less than a quarter full is merged with a sibling, or evened
+	 * out with it if both do not fit on one page; a merge may in turn leave the parent underfull and so on up
+	 * to the root, which goes once it has a single child above the leaves. Pages emptied by merges are
+	 * handed back with BufMgr::disposePage. May be called while other threads insert, delete or scan.
+   * @param key			Key to remove, pointer to integer/double/char string
+   * @param rid			Record ID of the entry to remove
+	 * @throws  NoSuchKeyFoundException If the index has no such entry.
+	**/
+	void deleteEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Begin a filtered scan of the index.  For instance, if the method is called 
+	 * using ("a",GT,"d",LTE) then we should seek all entries with a value 
+	 * greater than "a" and less than or equal to "d".
+	 * If another scan is already executing, that needs to be ended here.
+	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
+	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
    * @param lowVal	Low value of range, pointer to integer / double / char string
    * @param lowOp		Low operator (GT/GTE)
    * @param highVal	High value of range, pointer to integer / double / char string
@@ -383,6 +1631,59 @@ class BTreeIndex {
 	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
 
 
+  /**
+	 * Begin a filtered scan of the index on a cursor of its own, independent of startScan and of any other cursor.
+	 * The arguments are those of startScan. The cursor has its first leaf pinned; deleting it ends the scan.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+	 * @return				New cursor, owned by the caller
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	IndexScanCursor* openScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+  /**
+	 * Begin a filtered scan that returns the matching entries in descending key order, starting at the high
+	 * bound and walking the leaves right to left. Replaces the scan started by startScan like startScan does.
+	 * The arguments and exceptions are those of startScan.
+	**/
+	void startReverseScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+  /**
+	 * Begin a descending scan on a cursor of its own, see startReverseScan and openScan. Taking the first k
+	 * entries of such a scan finds the k largest keys of the range while only reading the leaves holding them.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+	 * @return				New cursor, owned by the caller
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	IndexScanCursor* openReverseScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+  /**
+	 * Begin a scan over several ranges at once, returning the entries of all of them in key order on one
+	 * cursor. An IN list is a set of ranges whose bounds are both its key, with GTE and LTE. Ranges may be
+	 * given in any order; overlapping ones are merged so no entry is returned twice. Once a range is done the
+	 * next one is looked for on the same leaf, and only if it starts past that leaf does the cursor descend
+	 * from the root again. Unlike openScan this does not throw if no entry matches; the scan is then empty.
+   * @param ranges		Array of numRanges ranges
+   * @param numRanges	Number of ranges
+	 * @return					New cursor, owned by the caller
+   * @throws  BadOpcodesException If a range has an unexpected operator
+   * @throws  BadScanrangeException If a range has lowVal > highVal
+	**/
+	IndexScanCursor* openMultiScan(const ScanRange* ranges, const int numRanges);
+
+
   /**
 	 * Fetch the record id of the next index entry that matches the scan.
 	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
@@ -393,6 +1694,195 @@ class BTreeIndex {
 	void scanNext(RecordId& outRid);  // returned record id
 
 
+  /**
+	 * scanNext that also returns the included columns of the entry, see IndexScanCursor::scanNext.
+   * @param outRid			RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload	getPayloadSize bytes the payload of the entry is returned in
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid, char* outPayload);
+
+
+  /**
+	 * Batched scanNext: fetch the record ids of up to maxRids next index entries that match the scan.
+   * @param outRids	Array of at least maxRids RecordIds the matching entries are returned in
+   * @param maxRids	Largest number of entries to return
+	 * @return				Number of entries returned; less than maxRids only once the scan is complete
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	int scanNextBatch(RecordId* outRids, const int maxRids);
+
+
+  /**
+	 * scanNextBatch that also returns the included columns of each entry, see IndexScanCursor::scanNextBatch.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	int scanNextBatch(RecordId* outRids, char* outPayloads, const int maxRids);
+
+
+  /**
+	 * Find every entry with the given key. Safe to call while other threads insert into the index.
+   * @param key			Key to look for, pointer to integer/double/char string
+   * @param outRids	RecordIds of the matching entries returned in this, in index order
+	 * @return				Number of matching entries
+	**/
+	int lookup(const void* key, std::vector<RecordId>& outRids);
+
+  /**
+	 * lookup that also returns the included columns of each matching entry.
+   * @param key					Key to look for, pointer to integer/double/char string
+   * @param outRids			RecordIds of the matching entries returned in this, in index order
+   * @param outPayloads	Payloads of the matching entries returned in this, getPayloadSize bytes each
+	 * @return						Number of matching entries
+	**/
+	int lookup(const void* key, std::vector<RecordId>& outRids, std::vector<char>& outPayloads);
+
+  /**
+	 * Get the number of bytes of included columns stored with each entry, 0 unless this is a covering index.
+	**/
+	int getPayloadSize() const;
+
+  /**
+	 * Find every entry of each of several keys, as the inner side of an index nested loop join does.
+	 * Keys given in ascending order are found leaf by leaf: a key that starts on the leaf the key before
+	 * it ended on is probed there without descending from the root again, and a key repeated right after
+	 * itself is not looked up again at all. Keys in any other order are still found, each with a descent
+	 * of its own. Safe to call while other threads change the index.
+   * @param keys				Array of numKeys pointers to keys, each as passed to lookup
+   * @param numKeys			Number of keys
+   * @param outRids			RecordIds of the matching entries returned in this, grouped by key in the order of keys
+   * @param outOffsets	numKeys + 1 positions returned in this; the entries of keys[i] are those in outRids
+	 *										from outOffsets[i] up to but not including outOffsets[i + 1]
+	 * @return						Number of matching entries
+	**/
+	int lookupMany(const void* const* keys, const int numKeys, std::vector<RecordId>& outRids,
+			std::vector<int>& outOffsets);
+
+  /**
+	 * Get the hits and misses of the node cache by tree level since the index was opened or
+	 * clearNodeCacheStats was last called.
+	 * @return				Counts and current size of the node cache
+	**/
+	NodeCacheStats getNodeCacheStats() const;
+
+  /**
+	 * Reset the hit and miss counts of the node cache.
+	**/
+	void clearNodeCacheStats();
+
+  /**
+	 * Keep the number of entries below each child in the non-leaf nodes of an INTEGER index from now on,
+	 * so that countRange reads them off instead of walking the leaves. The setting is stored in the meta
+	 * page and stays on for good. Must not be called while other threads use the index.
+	 * @return				True if counts are kept, false for a STRING index, which does not support them
+	**/
+	bool enableSubtreeCounts();
+
+  /**
+	 * Search the non-leaf nodes an INTEGER index keeps in its node cache through copies of their keys in
+	 * Eytzinger order, which a search walks with fewer cache misses and branch mispredictions than the
+	 * sorted keys of the node. The copies live in memory only and are made again whenever their node
+	 * changes, so the setting can only pay off on indexes that are read far more than they are split or,
+	 * with subtree counts, written at all. It is off by default: the leaf read through the buffer manager
+	 * dominates a lookup, and in searchLayoutBench the two searches differ by no more than the noise
+	 * between runs. Must not be called while other threads use the index.
+   * @param enabled	Search through the copies from now on, or search the nodes themselves again
+	 * @return				True if the setting took effect, false for a STRING index, which does not support it
+	**/
+	bool enableEytzingerSearch(const bool enabled = true);
+
+  /**
+	 * Build a piecewise linear model over the leaf level of an INTEGER index, so that lookups and scans jump
+	 * straight to the leaf of a key instead of descending from the root. The model maps a key to the position
+	 * of its leaf within maxError leaves, and the separators around the prediction tell the exact leaf; a key
+	 * the model misses by more goes down from the root. Keys that grow almost evenly, as in a relation loaded
+	 * in key order, need a single piece. The model lives in memory only and is dropped for good by the first
+	 * leaf split or merge, so it pays off on read-only indexes; inserts that fit into their leaf keep it.
+	 * Must not be called while other threads use the index.
+   * @param maxError	Largest error of the model in leaves
+	 * @return					Number of pieces of the model, 0 for a STRING index, which does not support it
+	**/
+	int enableLearnedModel(const int maxError = LEARNEDMAXERROR);
+
+  /**
+	 * Get the number of pieces of the learned model, 0 if there is none or a leaf split or merge dropped it.
+	**/
+	int getLearnedSegments() const;
+
+  /**
+	 * Buffer the inserts into an INTEGER index in memory and move them into the tree in batches, in key
+	 * order, once maxEntries have gathered. Random inserts then read and write each leaf once per batch
+	 * instead of once per entry. lookup and deleteEntry look at the buffer as well; scans, counts and
+	 * lookupMany flush it before they start. Buffered entries are only in memory until they are flushed,
+	 * which the destructor does at the latest. Must not be called while other threads use the index.
+   * @param maxEntries	Number of entries that make an insert flush the buffer, 0 to flush it now and
+	 *										insert straight into the tree again
+	 * @return						True if inserts are buffered as asked, false for a STRING index, which does not
+	 *										support it
+	**/
+	bool enableInsertBuffer(const int maxEntries = INSERTBUFFERSIZE);
+
+  /**
+	 * Move the entries of the insert buffer into the tree now. Does nothing if inserts are not buffered.
+	**/
+	void flushInsertBuffer();
+
+  /**
+	 * Build a Bloom filter over the keys of the index and keep it up to date from now on, so that lookup and
+	 * lookupMany answer most probes for absent keys without reading a page. The filter is sized for twice
+	 * the distinct keys the index holds now, and is kept in pages of the index file between runs. Calling
+	 * this again builds it anew, at the new size and without the keys deleted since. Must not be called
+	 * while other threads use the index.
+   * @param bitsPerKey	Number of filter bits per distinct key; more bits let fewer absent keys through
+	**/
+	void enableBloomFilter(const int bitsPerKey = BLOOMBITSPERKEY);
+
+  /**
+	 * Get the number of bits of the Bloom filter, 0 if the index has none.
+	**/
+	std::uint64_t getBloomFilterBits() const;
+
+  /**
+	 * Get the number of times the root split or shrank since the index was created, as kept in the meta page.
+	**/
+	std::uint32_t getRootEpoch() const;
+
+  /**
+	 * Get the level of the root, the number of non-leaf levels of the tree, as kept in the meta page.
+	**/
+	int getRootLevel() const;
+
+  /**
+	 * Count the entries in a range, taking the bounds as startScan does. With subtree counts this reads
+	 * only the nodes on the paths to the two bounds; otherwise every leaf of the range is read.
+	 * An entry of a posting list counts like any other entry.
+	 * @param lowVal	Low value of range, pointer to integer / string
+	 * @param lowOp		Low operator (GT/GTE)
+	 * @param highVal	High value of range, pointer to integer / string
+	 * @param highOp	High operator (LT/LTE)
+	 * @return				Number of entries in the range
+	 * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+	 * @throws  BadScanrangeException If lowVal > highval
+	**/
+	long countRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Estimate the share of the entries of the index that fall in a range from the nodes on the paths to
+	 * its two bounds. Children between the paths count whole, and the entries of a leaf alike. Children
+	 * weigh by their subtree counts if those are kept and all alike otherwise, so the estimate is close
+	 * to exact with counts and rougher without.
+	 * @param lowVal	Low value of range, pointer to integer / string
+	 * @param lowOp		Low operator (GT/GTE)
+	 * @param highVal	High value of range, pointer to integer / string
+	 * @param highOp	High operator (LT/LTE)
+	 * @return				Estimated share in [0, 1]
+	 * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+	 * @throws  BadScanrangeException If lowVal > highval
+	**/
+	double estimateSelectivity(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
   /**
 	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
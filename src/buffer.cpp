@@ -5,9 +5,12 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <iostream>
 #include "buffer.h"
+#include "log_mgr.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
@@ -20,8 +23,8 @@ namespace badgerdb {
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
+BufMgr::BufMgr(std::uint32_t bufs, LogMgr* logMgr)
+	: numBufs(bufs), log(logMgr), logImages(nullptr), lastCheckpointLsn(0) {
 	bufDescTable = new BufDesc[bufs];
 
   for (FrameId i = 0; i < bufs; i++) 
@@ -31,6 +34,9 @@ BufMgr::BufMgr(std::uint32_t bufs)
   }
 
   bufPool = new Page[bufs];
+  if (log != nullptr) {
+    logImages = new Page[bufs];
+  }
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
@@ -40,6 +46,10 @@ BufMgr::BufMgr(std::uint32_t bufs)
 
 
 BufMgr::~BufMgr() {
+  if (log != nullptr) {
+    log->flush();
+  }
+
   //Flush out all unwritten pages
   for (std::uint32_t i = 0; i < numBufs; i++) 
   {
@@ -50,16 +60,22 @@ BufMgr::~BufMgr() {
   	}
   }
 
+  // every page the log has records of is on disk now
+  if (log != nullptr) {
+    log->truncate();
+  }
+
 	delete hashTable;
   delete [] bufDescTable;
   delete [] bufPool;
+  delete [] logImages;
 }
 
 void BufMgr::allocBuf(FrameId & frame) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
+  // Caller holds bufMutex
   std::uint32_t numScanned = 0;
   bool found = 0;
 
@@ -102,9 +118,12 @@ void BufMgr::allocBuf(FrameId & frame)
     throw BufferExceededException();
   }
   
-  // flush any existing changes to disk if necessary
+  // flush any existing changes to disk if necessary, the log records of them first
   if (bufDescTable[clockHand].dirty)
   {
+    if (log != nullptr) {
+      log->flush(bufDescTable[clockHand].lsn);
+    }
     bufStats.diskwrites++;
     //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
     bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
@@ -120,6 +139,8 @@ void BufMgr::allocBuf(FrameId & frame)
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
+  std::lock_guard<std::mutex> guard(bufMutex);
+
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
@@ -141,6 +162,16 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
     bufStats.diskreads++;
     //status = file->readPage(pageNo, &bufPool[frameNo]);
     bufPool[frameNo] = file->readPage(pageNo);
+    // in this mode the pool verifies a page once, as it brings it in, instead of every read of the file
+    if (PageFile::getChecksumMode() == CHECKSUM_ON_POOL_READ) {
+      const PageFile* pageFile = dynamic_cast<const PageFile*>(file);
+      if (pageFile != nullptr) {
+        pageFile->verifyChecksum(pageNo, bufPool[frameNo]);
+      }
+    }
+    if (log != nullptr) {
+      logImages[frameNo] = bufPool[frameNo];
+    }
 
     // set up the entry properly
     bufDescTable[frameNo].Set(file, pageNo);
@@ -154,6 +185,8 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
+  std::lock_guard<std::mutex> guard(bufMutex);
+
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
@@ -166,22 +199,69 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
   	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
   }
   else bufDescTable[frameNo].pinCnt--;
+
+  if (dirty && log != nullptr) {
+    Lsn lsn = log->logUpdate(file, pageNo, bufPool[frameNo], logImages[frameNo]);
+    if (lsn != 0) {
+      bufDescTable[frameNo].lsn = lsn;
+      if (bufDescTable[frameNo].recLsn == 0) {
+        bufDescTable[frameNo].recLsn = lsn;
+      }
+    }
+  }
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
-  FrameId frameNo;
+  std::lock_guard<std::mutex> guard(bufMutex);
 
-  // alloc a new frame
-  allocBuf(frameNo);
+  FrameId frameNo;
 
   // allocate a new page in the file
-	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  Page newPage = file->allocatePage(pageNo);
+
+  // a page reused after disposePage can still have a frame, read in by someone who looked the page
+  // up just before it was freed; take over that frame so the pins on it stay counted
+  FrameId oldFrameNo;
+  try
+  {
+    hashTable->lookup(file, pageNo, oldFrameNo);
+    bufPool[oldFrameNo] = newPage;
+    bufDescTable[oldFrameNo].pinCnt++;
+    bufDescTable[oldFrameNo].refbit = true;
+    if (log != nullptr) {
+      bufDescTable[oldFrameNo].lsn = log->logImage(file, pageNo, bufPool[oldFrameNo], logImages[oldFrameNo]);
+      if (bufDescTable[oldFrameNo].recLsn == 0) {
+        bufDescTable[oldFrameNo].recLsn = bufDescTable[oldFrameNo].lsn;
+      }
+    }
+    page = &bufPool[oldFrameNo];
+    return;
+  }
+  catch(const HashNotFoundException &e)
+  {
+  }
+
+  // alloc a new frame only now, so that taking over a stale frame claims and evicts none
+  try
+  {
+    allocBuf(frameNo);
+  }
+  catch(const BufferExceededException &e)
+  {
+    file->deletePage(pageNo);
+    throw;
+  }
+
+  bufPool[frameNo] = newPage;
   page = &bufPool[frameNo];
 
   // set up the entry properly
   bufDescTable[frameNo].Set(file, pageNo);
+  if (log != nullptr) {
+    bufDescTable[frameNo].lsn = log->logImage(file, pageNo, bufPool[frameNo], logImages[frameNo]);
+    bufDescTable[frameNo].recLsn = bufDescTable[frameNo].lsn;
+  }
 
   // insert in the hash table
   hashTable->insert(file, pageNo, frameNo);
@@ -189,6 +269,8 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::lock_guard<std::mutex> guard(bufMutex);
+
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -199,6 +281,9 @@ void BufMgr::flushFile(const File* file)
 
 	    if (tmpbuf->dirty == true)
 			{
+				if (log != nullptr) {
+					log->flush(tmpbuf->lsn);
+				}
 				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
 				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
 				tmpbuf->dirty = false;
@@ -212,24 +297,144 @@ void BufMgr::flushFile(const File* file)
   }
 }
 
+void BufMgr::flushPage(File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(bufMutex);
+
+  FrameId frameNo = 0;
+  try
+  {
+    hashTable->lookup(file, pageNo, frameNo);
+  }
+  catch(const HashNotFoundException &e)
+  {
+    return;
+  }
+  if (bufDescTable[frameNo].dirty)
+  {
+    if (log != nullptr) {
+      log->flush(bufDescTable[frameNo].lsn);
+    }
+    bufStats.diskwrites++;
+    file->writePage(pageNo, bufPool[frameNo]);
+    bufDescTable[frameNo].dirty = false;
+    bufDescTable[frameNo].recLsn = 0;
+  }
+}
+
 void BufMgr::disposePage(File* file, const PageId pageNo)
 {
+  std::lock_guard<std::mutex> guard(bufMutex);
+
 	//Deallocate from file altogether
   //See if it is in the buffer pool
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  try
+  {
+    hashTable->lookup(file, pageNo, frameNo);
+    if (bufDescTable[frameNo].pinCnt > 0)
+      throw PagePinnedException(file->filename(), pageNo, frameNo);
 
-	// clear the page
-	bufDescTable[frameNo].Clear();
+    // clear the page
+    bufDescTable[frameNo].Clear();
 
-	hashTable->remove(file, pageNo);
+    hashTable->remove(file, pageNo);
+  }
+  catch(const HashNotFoundException &e)
+  {
+  }
+
+  // older records of the page must not be replayed over it once the file lists it as free
+  if (log != nullptr) {
+    log->logFree(file, pageNo);
+  }
 
   // deallocate it in the file	
   file->deletePage(pageNo);
 }
 
+void BufMgr::checkpoint()
+{
+  if (log == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> checkpointGuard(checkpointMutex);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::uint64_t bytes = 0;
+  std::uint64_t written = 0;
+
+  // pages dirty since before the previous checkpoint go to disk as the log last recorded them, which a
+  // thread changing the frame meanwhile does not touch; one page per hold of the pool mutex
+  for (std::uint32_t i = 0; i < numBufs; i++)
+  {
+    std::lock_guard<std::mutex> guard(bufMutex);
+    BufDesc* tmpbuf = &(bufDescTable[i]);
+    if (tmpbuf->valid && tmpbuf->recLsn != 0 && tmpbuf->recLsn < lastCheckpointLsn)
+    {
+      log->flush(tmpbuf->lsn);
+      bufStats.diskwrites++;
+      tmpbuf->file->writePage(tmpbuf->pageNo, logImages[i]);
+      tmpbuf->dirty = false;
+      tmpbuf->recLsn = 0;
+      written++;
+      bytes += Page::SIZE;
+    }
+  }
+
+  // the table and its record under the pool mutex, so that no page gets a record in between
+  std::vector<DirtyPage> table;
+  Lsn checkpointLsn;
+  Lsn redoLsn;
+  {
+    std::lock_guard<std::mutex> guard(bufMutex);
+    for (std::uint32_t i = 0; i < numBufs; i++)
+    {
+      BufDesc* tmpbuf = &(bufDescTable[i]);
+      if (tmpbuf->valid && tmpbuf->recLsn != 0)
+      {
+        DirtyPage entry;
+        entry.file = tmpbuf->file;
+        entry.pageNo = tmpbuf->pageNo;
+        entry.recLsn = tmpbuf->recLsn;
+        table.push_back(entry);
+      }
+    }
+    checkpointLsn = log->logCheckpoint(table);
+    bytes += log->getEndLsn() - checkpointLsn;
+  }
+  redoLsn = checkpointLsn;
+  for (std::size_t i = 0; i < table.size(); i++)
+  {
+    redoLsn = std::min(redoLsn, table[i].recLsn);
+  }
+
+  // no page needs the records before the oldest entry of the table any more
+  Lsn baseLsn = log->getBaseLsn();
+  bytes += log->truncate(redoLsn);
+  lastCheckpointLsn = checkpointLsn;
+
+  std::uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  checkpointStats.checkpoints++;
+  checkpointStats.dirtyPages = table.size();
+  checkpointStats.pagesWritten += written;
+  checkpointStats.bytesWritten += bytes;
+  checkpointStats.bytesTruncated += log->getBaseLsn() - baseLsn;
+  checkpointStats.microseconds += microseconds;
+  checkpointStats.lastMicroseconds = microseconds;
+  checkpointStats.redoLsn = redoLsn;
+}
+
+CheckpointStats BufMgr::getCheckpointStats()
+{
+  std::lock_guard<std::mutex> checkpointGuard(checkpointMutex);
+  return checkpointStats;
+}
+
 void BufMgr::printSelf(void) 
 {
+  std::lock_guard<std::mutex> guard(bufMutex);
+
   BufDesc* tmpbuf;
 	int validFrames = 0;
   
@@ -10,6 +10,7 @@
 #include "file.h"
 #include "bufHashTbl.h"
 #include <iostream>
+#include <mutex>
 
 namespace badgerdb {
 
@@ -17,6 +18,7 @@ namespace badgerdb {
 * forward declaration of BufMgr class 
 */
 class BufMgr;
+class LogMgr;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
@@ -61,6 +63,18 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * Number of the last log record of the page, 0 if none since it was read; the log must be on disk up
+   * to this record before the frame is written back
+	 */
+  Lsn lsn;
+
+	/**
+   * Number of the first log record of the page that may not be on disk, 0 if every record of it is; the
+   * entry of the page in the dirty page table of a checkpoint
+	 */
+  Lsn recLsn;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -72,6 +86,8 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+		lsn = 0;
+		recLsn = 0;
   };
 
 	/**
@@ -89,6 +105,8 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    lsn = 0;
+    recLsn = 0;
   }
 
   void Print()
@@ -155,12 +173,91 @@ struct BufStats
 };
 
 
+/**
+* @brief Statistics of the checkpoints taken by BufMgr::checkpoint
+*/
+struct CheckpointStats
+{
+	/**
+   * Number of checkpoints taken
+	 */
+  std::uint64_t checkpoints;
+
+	/**
+   * Number of pages in the dirty page table of the last checkpoint
+	 */
+  std::uint64_t dirtyPages;
+
+	/**
+   * Number of pages written back because they stayed dirty since before the checkpoint before
+	 */
+  std::uint64_t pagesWritten;
+
+	/**
+   * Bytes written: pages written back, checkpoint records and records copied when the log was truncated
+	 */
+  std::uint64_t bytesWritten;
+
+	/**
+   * Bytes of log dropped by truncation
+	 */
+  std::uint64_t bytesTruncated;
+
+	/**
+   * Time spent taking checkpoints, in microseconds
+	 */
+  std::uint64_t microseconds;
+
+	/**
+   * Time the last checkpoint took, in microseconds
+	 */
+  std::uint64_t lastMicroseconds;
+
+	/**
+   * Number of the first record recovery needs, as of the last checkpoint
+	 */
+  Lsn redoLsn;
+
+	/**
+   * Clear all values 
+	 */
+  void clear()
+  {
+		checkpoints = dirtyPages = pagesWritten = bytesWritten = bytesTruncated = 0;
+		microseconds = lastMicroseconds = 0;
+		redoLsn = 0;
+  }
+
+	/**
+   * Constructor of CheckpointStats class 
+	 */
+  CheckpointStats()
+  {
+		clear();
+  }
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* All public methods may be called from several threads at once; they are serialized by a single mutex.
+* The contents of a pinned page are not protected by the buffer manager and callers sharing a page must
+* coordinate among themselves (the B+Tree uses per-node latches for that).
+*
+* Given a LogMgr, the buffer manager logs every page that is allocated, unpinned dirty or disposed of, and
+* writes a dirty frame back only once the log is on disk up to the last record of its page. Checkpoints
+* record which pages are dirty while the pool keeps serving other threads, and let the log drop the
+* records every page on disk already has.
 */
 class BufMgr 
 {
  private:
+	/**
+   * Serializes access to the frame table, hash table, clock and statistics
+	 */
+  std::mutex bufMutex;
+
 	/**
    * Current position of clockhand in our buffer pool
 	 */
@@ -186,6 +283,31 @@ class BufMgr
 	 */
   BufStats bufStats;
 
+	/**
+   * Write-ahead log of the pages changed in the pool, null if changes are not logged
+	 */
+  LogMgr* log;
+
+	/**
+   * With a log, a copy of each frame as the log last recorded it, which the next record is taken against
+	 */
+  Page* logImages;
+
+	/**
+   * Serializes checkpoints and their statistics
+	 */
+  std::mutex checkpointMutex;
+
+	/**
+   * Number of the record of the last checkpoint, 0 before the first
+	 */
+  Lsn lastCheckpointLsn;
+
+	/**
+   * Statistics of the checkpoints taken
+	 */
+  CheckpointStats checkpointStats;
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
@@ -210,8 +332,12 @@ class BufMgr
 
 	/**
    * Constructor of BufMgr class
+	 *
+	 * @param bufs		Number of frames in the buffer pool
+	 * @param logMgr	Write-ahead log to record every change to a page in, null for none. Recover the log
+	 *								before the pool reads any page it names.
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, LogMgr* logMgr = nullptr);
 	
 	/**
    * Destructor of BufMgr class
@@ -234,7 +360,8 @@ class BufMgr
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number
-	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty; with a log, the changes made to
+	 *								the page since its last record are appended to the log
    * @throws  PageNotPinnedException If the page is not already pinned
 	 */
   void unPinPage(File* file, const PageId PageNo, const bool dirty);
@@ -260,16 +387,35 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Writes one page to disk now if it is in the buffer pool and dirty, after the log records of it.
+	 * The page may stay pinned.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 */
+  void flushPage(File* file, const PageId PageNo);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number
+   * @throws  PagePinnedException If the page is pinned in the buffer pool; it is then left in place
 	 */
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Takes a fuzzy checkpoint: appends the table of dirty pages, each with the first record of it that may
+	 * not be on disk, to the log and drops the records before the oldest of them. Other threads keep using
+	 * the pool meanwhile; pages are not flushed, except for those dirty since before the previous checkpoint,
+	 * which are written back as the log last recorded them, one at a time, so that the log never reaches
+	 * back further than the checkpoint before the last. Does nothing without a log.
+	 */
+  void checkpoint();
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
@@ -288,6 +434,19 @@ class BufMgr
   void clearBufStats() 
   {
 		bufStats.clear();
+  }
+
+	/**
+   * Get the statistics of the checkpoints taken so far
+	 */
+  CheckpointStats getCheckpointStats();
+
+	/**
+   * Get the number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
   }
 };
 
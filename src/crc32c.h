@@ -0,0 +1,139 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define BADGERDB_CRC32C_SSE42 1
+#endif
+
+namespace badgerdb {
+
+/**
+ * @brief CRC32C (Castagnoli) checksums of byte ranges.
+ *
+ * On x86-64 processors with SSE4.2 the checksum is taken with the crc32 instruction, eight bytes at a
+ * time; elsewhere a table lookup does eight bytes per step in software. Both give the same values, so a
+ * file written on one machine checks out on another.
+ */
+class Crc32c {
+ public:
+  /**
+   * Extends a checksum with more bytes: extend(extend(0, a), b) is the checksum of a followed by b.
+   *
+   * @param crc     Checksum of the bytes before, 0 to start
+   * @param data    Bytes to add
+   * @param length  Number of bytes
+   * @return  Checksum of the bytes before followed by these.
+   */
+  static std::uint32_t extend(const std::uint32_t crc, const void* data, const std::size_t length) {
+#ifdef BADGERDB_CRC32C_SSE42
+    if (hardwareSupported()) {
+      return extendHardware(crc, data, length);
+    }
+#endif
+    return extendSoftware(crc, data, length);
+  }
+
+  /**
+   * Returns true if extend uses the crc32 instruction of the processor.
+   */
+  static bool hardwareSupported() {
+#ifdef BADGERDB_CRC32C_SSE42
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * extend without the crc32 instruction, whatever the processor has.
+   */
+  static std::uint32_t extendSoftware(const std::uint32_t crc, const void* data, const std::size_t length) {
+    const std::uint32_t (*table)[256] = tables();
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint32_t c = ~crc;
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+      std::uint32_t low;
+      std::uint32_t high;
+      std::memcpy(&low, bytes + i, sizeof(low));
+      std::memcpy(&high, bytes + i + 4, sizeof(high));
+      low ^= c;
+      c = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^ table[5][(low >> 16) & 0xff]
+          ^ table[4][low >> 24] ^ table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff]
+          ^ table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+    }
+    for (; i < length; i++) {
+      c = table[0][(c ^ bytes[i]) & 0xff] ^ (c >> 8);
+    }
+    return ~c;
+  }
+
+#ifdef BADGERDB_CRC32C_SSE42
+  /**
+   * extend with the crc32 instruction; only to be called if hardwareSupported.
+   */
+  __attribute__((target("sse4.2")))
+  static std::uint32_t extendHardware(const std::uint32_t crc, const void* data, const std::size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t c = ~crc;
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, bytes + i, sizeof(word));
+      c = _mm_crc32_u64(c, word);
+    }
+    std::uint32_t c32 = c;
+    for (; i < length; i++) {
+      c32 = _mm_crc32_u8(c32, bytes[i]);
+    }
+    return ~c32;
+  }
+#endif
+
+ private:
+  /**
+   * Reflected Castagnoli polynomial.
+   */
+  static const std::uint32_t POLYNOMIAL = 0x82F63B78;
+
+  /**
+   * Tables of the software checksum: table[0] advances the checksum by one byte, table[k] by a byte
+   * followed by k zero bytes. Built on first use.
+   */
+  static const std::uint32_t (*tables())[256] {
+    struct Tables {
+      std::uint32_t table[8][256];
+
+      Tables() {
+        for (std::uint32_t n = 0; n < 256; n++) {
+          std::uint32_t c = n;
+          for (int bit = 0; bit < 8; bit++) {
+            c = (c & 1) ? (c >> 1) ^ POLYNOMIAL : c >> 1;
+          }
+          table[0][n] = c;
+        }
+        for (std::uint32_t n = 0; n < 256; n++) {
+          for (int k = 1; k < 8; k++) {
+            table[k][n] = table[0][table[k - 1][n] & 0xff] ^ (table[k - 1][n] >> 8);
+          }
+        }
+      }
+    };
+    static const Tables built;
+    return built.table;
+  }
+};
+
+}
@@ -0,0 +1,64 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a page read from a file does not
+ *        match the checksum in its header.
+ *
+ * The page was torn by a crash in the middle of writing it, or corrupted on
+ * disk since; in a compressed file, its extent no longer decompresses.
+ */
+class PageChecksumException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page checksum exception for the given page number and
+   * filename.
+   *
+   * @param page_number  Number of the page.
+   * @param file         Name of file the page was read from.
+   */
+  PageChecksumException(const PageId page_number,
+                        const std::string& file);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageChecksumException() throw() {}
+
+  /**
+   * Returns the number of the page that did not match its checksum.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Number of the page which caused this exception.
+   */
+  const PageId page_number_;
+
+  /**
+   * Name of file which caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
@@ -0,0 +1,186 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Copy of the keys of one INTEGER non-leaf node in Eytzinger order, for searching them.
+ *
+ * A binary search over the sorted keys of a node jumps across the whole array; with several hundred keys
+ * most of its steps land on a cache line of their own, and whether it goes left or right is anybody's guess
+ * to the branch predictor. In Eytzinger order the keys are stored as an implicit binary tree, root first and
+ * every level after the one above it, so the first steps of all searches share the same few cache lines. The
+ * descendants four levels below a key sit in one cache line of 16 keys, which the search prefetches while it
+ * works on the levels in between, and the step to a child is computed rather than branched on.
+ *
+ * A copy belongs to one page and is tagged with the latch version of the node it was made from. Searches
+ * only use it while the tag matches the version they read the node at; otherwise they search the node itself
+ * and may build the copy again. Like the node, the copy is read optimistically: a search checks the tag both
+ * before and after reading it, and a copy being built carries a tag no node version can have.
+ */
+class EytzingerKeys {
+ public:
+  /**
+   * Tag of a copy that matches no node version; versions of stable nodes are even.
+   */
+  static const std::uint32_t NONE = 0xFFFFFFFF;
+
+  /**
+   * Tag of a copy being built.
+   */
+  static const std::uint32_t BUILDING = 0xFFFFFFFD;
+
+  /**
+   * Constructs an empty copy.
+   *
+   * @param capacity  Largest number of keys a node holds
+   */
+  explicit EytzingerKeys(const int capacity)
+      : storage_(new int[capacity + 1 + KEYS_PER_LINE]),
+        ranks_(new std::uint16_t[capacity + 1]),
+        capacity_(capacity),
+        numKeys_(0),
+        tag_(NONE) {
+    // keys_[0] is not used, so the keys of one line of the tree start on a cache line boundary
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage_);
+    keys_ = storage_ + (LINE_BYTES - address % LINE_BYTES) % LINE_BYTES / sizeof(int);
+  }
+
+  ~EytzingerKeys() {
+    delete [] storage_;
+    delete [] ranks_;
+  }
+
+  /**
+   * Returns the node version the copy was made at, NONE or BUILDING if there is no usable copy.
+   */
+  std::uint32_t tag() const {
+    return tag_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Checks that the copy was not changed since tag returned the given value. A search result may only be
+   * used if this returns true.
+   *
+   * @param tag  Value returned by tag before the search
+   */
+  bool validate(const std::uint32_t tag) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return tag_.load(std::memory_order_relaxed) == tag;
+  }
+
+  /**
+   * Takes the copy over for building, unless another thread is building it or it changed since tag.
+   *
+   * @param tag  Value returned by tag
+   * @return  True if the caller builds the copy and must call endBuild.
+   */
+  bool beginBuild(std::uint32_t tag) {
+    return tag != BUILDING && tag_.compare_exchange_strong(tag, BUILDING, std::memory_order_acquire);
+  }
+
+  /**
+   * Copies the sorted keys of a node. Only called between beginBuild and endBuild.
+   *
+   * @param sorted   Keys of the node, in ascending order
+   * @param numKeys  Number of keys, at most the capacity
+   */
+  void build(const int* sorted, const int numKeys) {
+    numKeys_ = numKeys < capacity_ ? numKeys : capacity_;
+    int next = 0;
+    fill(sorted, 1, next);
+  }
+
+  /**
+   * Ends building the copy.
+   *
+   * @param valid    The node did not change while its keys were copied
+   * @param version  Version the node was read at
+   */
+  void endBuild(const bool valid, const std::uint32_t version) {
+    tag_.store(valid ? version : NONE, std::memory_order_release);
+  }
+
+  /**
+   * Finds the first key that is >= key. The result is only meaningful if validate succeeds afterwards.
+   *
+   * @param key  Key to look for
+   * @return  Position of that key among the sorted keys, or the number of keys if there is none.
+   */
+  int lowerBound(const int key) const {
+    std::uint32_t n = numKeys_;
+    std::uint32_t k = 1;
+    while (k <= n) {
+      __builtin_prefetch(keys_ + k * KEYS_PER_LINE);
+      k = 2 * k + (keys_[k] < key);
+    }
+    // undo the steps right since the last step left, which was at the key looked for
+    k >>= __builtin_ffs(~k);
+    return k == 0 ? (int)n : ranks_[k];
+  }
+
+ private:
+  /**
+   * Size of a cache line.
+   */
+  static const int LINE_BYTES = 64;
+
+  /**
+   * Number of keys in a cache line.
+   */
+  static const int KEYS_PER_LINE = LINE_BYTES / sizeof(int);
+
+  /**
+   * Places the keys of the subtree rooted at k, taking them in order from sorted[next].
+   */
+  void fill(const int* sorted, const std::uint32_t k, int& next) {
+    if (k > (std::uint32_t)numKeys_) {
+      return;
+    }
+    fill(sorted, 2 * k, next);
+    keys_[k] = sorted[next];
+    ranks_[k] = next++;
+    fill(sorted, 2 * k + 1, next);
+  }
+
+  /**
+   * Memory keys_ points into.
+   */
+  int* storage_;
+
+  /**
+   * Keys in Eytzinger order, keys_[1] being the root of the implicit tree.
+   */
+  int* keys_;
+
+  /**
+   * Position among the sorted keys of each key in keys_.
+   */
+  std::uint16_t* ranks_;
+
+  /**
+   * Largest number of keys.
+   */
+  int capacity_;
+
+  /**
+   * Number of keys in the copy.
+   */
+  int numKeys_;
+
+  /**
+   * Node version the copy was made at, or NONE or BUILDING.
+   */
+  std::atomic<std::uint32_t> tag_;
+};
+
+}
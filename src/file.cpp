@@ -11,20 +11,27 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "file_iterator.h"
+#include "lz_codec.h"
 #include "page.h"
 
 namespace badgerdb {
 
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::EndMap File::stored_ends_;
+ChecksumMode PageFile::checksum_mode_ = CHECKSUM_ON_READ;
+const PageId File::MAX_COMPRESSED_PAGES = File::MAP_BLOCKS * File::MAP_ENTRIES;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -64,14 +71,34 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+PageId File::getNumPages() {
+  const FileHeader& header = readHeader();
+  return header.num_pages;
+}
+
+File::File(const std::string& name, const bool create_new,
+           const FileFormat format) : filename_(name), format_(format) {
   openIfNeeded(create_new);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         (std::uint32_t)format /* format */};
     writeHeader(header);
+    if (format == FORMAT_COMPRESSED) {
+      // Extents start after the compressed header; the page map is allocated
+      // block by block as pages are written.
+      CompressedHeader compressed;
+      memset(&compressed, 0, sizeof(CompressedHeader));
+      compressed.end = sizeof(FileHeader) + sizeof(CompressedHeader);
+      stream_->seekp(sizeof(FileHeader), std::ios::beg);
+      stream_->write(reinterpret_cast<const char*>(&compressed),
+                     sizeof(CompressedHeader));
+      stream_->flush();
+    }
+  } else {
+    format_ = (FileFormat)readHeader().format;
   }
 }
 
@@ -112,6 +139,7 @@ void File::close() {
   if (open_counts_[filename_] == 0) {
     open_streams_.erase(filename_);
     open_counts_.erase(filename_);
+    stored_ends_.erase(filename_);
   }
 }
 
@@ -128,20 +156,154 @@ void File::writeHeader(const FileHeader& header) {
   stream_->flush();
 }
 
+std::streampos File::extentPosition(const PageId page_number) const {
+  const PageId index = page_number - 1;
+  std::uint64_t block;
+  stream_->seekg(sizeof(FileHeader) + offsetof(CompressedHeader, map_blocks) +
+                 (index / MAP_ENTRIES) * sizeof(std::uint64_t), std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&block), sizeof(block));
+  if (block == 0) {
+    return 0;
+  }
+  return block + (index % MAP_ENTRIES) * sizeof(Extent);
+}
 
+std::uint64_t File::storedEnd() const {
+  const EndMap::const_iterator cached = stored_ends_.find(filename_);
+  if (cached != stored_ends_.end()) {
+    return cached->second;
+  }
+  std::uint64_t end;
+  stream_->seekg(sizeof(FileHeader) + offsetof(CompressedHeader, end),
+                 std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&end), sizeof(end));
+  stored_ends_[filename_] = end;
+  return end;
+}
+
+void File::readStored(const PageId page_number, char* bytes,
+                      const std::size_t length) const {
+  if (format_ == FORMAT_PLAIN) {
+    stream_->seekg(pagePosition(page_number), std::ios::beg);
+    stream_->read(bytes, length);
+    return;
+  }
 
+  Extent extent = {0, 0, 0};
+  if (page_number >= 1 && page_number <= MAX_COMPRESSED_PAGES) {
+    const std::streampos position = extentPosition(page_number);
+    if (position != 0) {
+      stream_->seekg(position, std::ios::beg);
+      stream_->read(reinterpret_cast<char*>(&extent), sizeof(Extent));
+    }
+  }
+  if (extent.offset == 0) {
+    memset(bytes, 0, length);
+    return;
+  }
+  // a garbled entry must not be read into the buffers below
+  const std::uint64_t stored_end = storedEnd();
+  if (extent.length == 0 || extent.length > Page::SIZE ||
+      extent.offset > stored_end || extent.length > stored_end - extent.offset) {
+    throw PageChecksumException(page_number, filename_);
+  }
+  stream_->seekg(extent.offset, std::ios::beg);
+  if (extent.length == Page::SIZE) {
+    stream_->read(bytes, length);
+    return;
+  }
+  char compressed[Page::SIZE];
+  stream_->read(compressed, extent.length);
+  const bool decompressed = length == Page::SIZE
+      ? LzCodec::decompress(compressed, extent.length, bytes, Page::SIZE)
+      : LzCodec::decompressPrefix(compressed, extent.length, bytes, length);
+  if (!decompressed) {
+    throw PageChecksumException(page_number, filename_);
+  }
+}
+
+void File::writeStored(const PageId page_number, const char* bytes) {
+  if (format_ == FORMAT_PLAIN) {
+    stream_->seekp(pagePosition(page_number), std::ios::beg);
+    stream_->write(bytes, Page::SIZE);
+    stream_->flush();
+    return;
+  }
+  if (page_number < 1 || page_number > MAX_COMPRESSED_PAGES) {
+    throw InvalidPageException(page_number, filename_);
+  }
+
+  // a page that does not compress is stored as it is
+  char compressed[Page::SIZE];
+  std::uint32_t length = LzCodec::compress(bytes, Page::SIZE, compressed,
+                                           Page::SIZE - 1);
+  const char* stored = compressed;
+  if (length == 0) {
+    length = Page::SIZE;
+    stored = bytes;
+  }
 
+  CompressedHeader header;
+  bool header_changed = false;
+  stream_->seekg(sizeof(FileHeader), std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&header), sizeof(CompressedHeader));
+  const PageId block = (page_number - 1) / MAP_ENTRIES;
+  if (header.map_blocks[block] == 0) {
+    const std::vector<char> zeros(MAP_ENTRIES * sizeof(Extent), 0);
+    header.map_blocks[block] = header.end;
+    header.end += zeros.size();
+    header_changed = true;
+    stream_->seekp(header.map_blocks[block], std::ios::beg);
+    stream_->write(&zeros[0], zeros.size());
+  }
+
+  Extent extent;
+  const std::streampos position = header.map_blocks[block] +
+      ((page_number - 1) % MAP_ENTRIES) * sizeof(Extent);
+  if (header_changed) {
+    memset(&extent, 0, sizeof(Extent));
+  } else {
+    stream_->seekg(position, std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&extent), sizeof(Extent));
+  }
+  if (extent.offset == 0 || extent.capacity < length) {
+    extent.offset = header.end;
+    extent.capacity = (length + EXTENT_ALIGN - 1) / EXTENT_ALIGN * EXTENT_ALIGN;
+    header.end += extent.capacity;
+    header_changed = true;
+  }
+  extent.length = length;
+
+  // the page first, then the entry pointing at it
+  stream_->seekp(extent.offset, std::ios::beg);
+  stream_->write(stored, length);
+  if (header_changed) {
+    stream_->seekp(sizeof(FileHeader), std::ios::beg);
+    stream_->write(reinterpret_cast<const char*>(&header),
+                   sizeof(CompressedHeader));
+  }
+  stream_->seekp(position, std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&extent), sizeof(Extent));
+  stream_->flush();
+  stored_ends_[filename_] = header.end;
+}
 
 PageFile PageFile::create(const std::string& filename) {
   return PageFile(filename, true /* create_new */);
 }
 
+PageFile PageFile::create(const std::string& filename,
+                          const FileFormat format) {
+  return PageFile(filename, true /* create_new */, format);
+}
+
 PageFile PageFile::open(const std::string& filename) {
   return PageFile(filename, false /* create_new */);
 }
 
-PageFile::PageFile(const std::string& name, const bool create_new)
-: File(name, create_new)
+PageFile::PageFile(const std::string& name, const bool create_new,
+                   const FileFormat format)
+: File(name, create_new, format)
 {
 }
 
@@ -166,6 +328,7 @@ Page PageFile::allocatePage(PageId &new_page_number) {
   FileHeader header = readHeader();
   Page new_page;
   Page existing_page;
+  bool new_last_page = false;
   if (header.num_free_pages > 0) {
     new_page = readPage(header.first_free_page, true /* allow_free */);
     new_page.set_page_number(header.first_free_page);
@@ -179,22 +342,26 @@ Page PageFile::allocatePage(PageId &new_page_number) {
       // than the one we just allocated, so add the new page to the head.
       if (header.first_used_page > new_page.page_number()) {
         new_page.set_next_page_number(header.first_used_page);
+      } else {
+        new_last_page = true;
       }
       header.first_used_page = new_page.page_number();
     } else {
       // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
+      // find where in the used list to insert it.  Only page headers are read
+      // on the way.
+      PageId previous_page_number = header.first_used_page;
+      PageId next_page_number =
+          readPageHeader(previous_page_number).next_page_number;
+      while (next_page_number != Page::INVALID_NUMBER &&
+             next_page_number < new_page.page_number()) {
+        previous_page_number = next_page_number;
+        next_page_number = readPageHeader(previous_page_number).next_page_number;
       }
+      existing_page = readPage(previous_page_number, false /* allow_free */);
       existing_page.set_next_page_number(new_page.page_number());
       new_page.set_next_page_number(next_page_number);
+      new_last_page = next_page_number == Page::INVALID_NUMBER;
     }
 
     assert((header.num_free_pages == 0) ==
@@ -213,16 +380,12 @@ Page PageFile::allocatePage(PageId &new_page_number) {
 		{
       // If we have pages allocated, we need to add the new page to the tail
       // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
+      existing_page = readPage(lastUsedPage(header), false /* allow_free */);
       assert(existing_page.isUsed());
       existing_page.set_next_page_number(new_page.page_number());
     }
     ++header.num_pages;
+    new_last_page = true;
   }
   writePage(new_page_number, new_page.header_, new_page);
   if (existing_page.page_number() != Page::INVALID_NUMBER) {
@@ -231,6 +394,9 @@ Page PageFile::allocatePage(PageId &new_page_number) {
     writePage(existing_page.page_number(), existing_page.header_, existing_page);
   }
   writeHeader(header);
+  if (new_last_page) {
+    setLastUsedPage(new_page_number);
+  }
 
   return new_page;
 }
@@ -247,16 +413,23 @@ Page PageFile::readPage(const PageId page_number) const {
 
 Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  readStored(page_number, reinterpret_cast<char*>(&page));
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
+  if (checksum_mode_ == CHECKSUM_ON_READ) {
+    verifyChecksum(page_number, page);
+  }
 
   return page;
 }
 
+void PageFile::verifyChecksum(const PageId page_number, const Page& page) const {
+  if (page.computeChecksum(page.header_) != page.header_.checksum) {
+    throw PageChecksumException(page_number, filename_);
+  }
+}
+
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 	PageHeader header = readPageHeader(new_page_number);
 	if (header.current_page_number == Page::INVALID_NUMBER)
@@ -278,18 +451,25 @@ void PageFile::deletePage(const PageId page_number) {
 
   Page existing_page = readPage(page_number);
   Page previous_page;
+  PageId previous_page_number = Page::INVALID_NUMBER;
+  const bool last_page =
+      existing_page.next_page_number() == Page::INVALID_NUMBER;
   // If this page is the head of the used list, update the header to point to
   // the next page in line.
   if (page_number == header.first_used_page) {
     header.first_used_page = existing_page.next_page_number();
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
+    // Walk the used list, a page header at a time, so we can update the page
+    // that points to this one.
+    PageId next_page_number = header.first_used_page;
+    while (next_page_number != Page::INVALID_NUMBER &&
+           next_page_number != page_number) {
+      previous_page_number = next_page_number;
+      next_page_number = readPageHeader(previous_page_number).next_page_number;
+    }
+    if (next_page_number == page_number) {
+      previous_page = readPage(previous_page_number, false /* allow_free */);
+      previous_page.set_next_page_number(existing_page.next_page_number());
     }
   }
   // Clear the page and add it to the head of the free list.
@@ -302,6 +482,9 @@ void PageFile::deletePage(const PageId page_number) {
   }
   writePage(page_number, existing_page.header_, existing_page);
   writeHeader(header);
+  if (last_page) {
+    setLastUsedPage(previous_page_number);
+  }
 }
 
 FileIterator PageFile::begin() {
@@ -315,19 +498,48 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  Page stored_page = new_page;
+  stored_page.header_ = header;
+  stored_page.header_.checksum = stored_page.computeChecksum(stored_page.header_);
+  writeStored(page_number, reinterpret_cast<const char*>(&stored_page));
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
+  // the header starts the page, so in a compressed file only it is decompressed
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
+  readStored(page_number, reinterpret_cast<char*>(&header), sizeof(PageHeader));
   return header;
 }
 
+PageId PageFile::lastUsedPage(const FileHeader& header) const {
+  if (format_ == FORMAT_COMPRESSED) {
+    PageId page_number;
+    stream_->seekg(sizeof(FileHeader) + offsetof(CompressedHeader, last_used_page),
+                   std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&page_number), sizeof(PageId));
+    return page_number;
+  }
+  PageId page_number = header.first_used_page;
+  if (page_number == Page::INVALID_NUMBER) {
+    return page_number;
+  }
+  PageId next_page_number = readPageHeader(page_number).next_page_number;
+  while (next_page_number != Page::INVALID_NUMBER) {
+    page_number = next_page_number;
+    next_page_number = readPageHeader(page_number).next_page_number;
+  }
+  return page_number;
+}
+
+void PageFile::setLastUsedPage(const PageId page_number) {
+  if (format_ == FORMAT_COMPRESSED) {
+    stream_->seekp(sizeof(FileHeader) + offsetof(CompressedHeader, last_used_page),
+                   std::ios::beg);
+    stream_->write(reinterpret_cast<const char*>(&page_number), sizeof(PageId));
+    stream_->flush();
+  }
+}
+
 
 
 
@@ -364,6 +576,18 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
   FileHeader header = readHeader();
 	Page new_page;
 
+	if (header.num_free_pages > 0) {
+		// take the most recently freed page off the free list
+		new_page_number = header.first_free_page;
+		Page free_page = readPage(new_page_number);
+		memcpy(&header.first_free_page, reinterpret_cast<const char*>(&free_page), sizeof(PageId));
+		--header.num_free_pages;
+
+		writePage(new_page_number, new_page);
+		writeHeader(header);
+		return new_page;
+	}
+
 	new_page_number = header.num_pages;
 
 	if (header.first_used_page == Page::INVALID_NUMBER) {
@@ -380,20 +604,27 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
-	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+	readStored(page_number, reinterpret_cast<char*>(&page));
 	return page;
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
-	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+	writeStored(new_page_number, reinterpret_cast<const char*>(&new_page));
 }
 
-//delePage should not be called for a blob_file, not supported
 void BlobFile::deletePage(const PageId page_number) {
-	throw InvalidPageException(page_number, filename_);
+  FileHeader header = readHeader();
+	if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages) {
+		throw InvalidPageException(page_number, filename_);
+	}
+
+	// push the page onto the free list
+	Page free_page;
+	memcpy(reinterpret_cast<char*>(&free_page), &header.first_free_page, sizeof(PageId));
+	writePage(page_number, free_page);
+	header.first_free_page = page_number;
+	++header.num_free_pages;
+	writeHeader(header);
 }
 
 }
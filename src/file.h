@@ -42,6 +42,11 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * How the pages are stored, a FileFormat.
+   */
+  std::uint32_t format;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -56,6 +61,46 @@ struct FileHeader {
   }
 };
 
+/**
+ * @brief How a file stores its pages.
+ */
+enum FileFormat {
+  /**
+   * Every page takes Page::SIZE bytes at a position given by its number.
+   */
+  FORMAT_PLAIN = 0,
+
+  /**
+   * Every page is compressed into an extent of its own, found through a page
+   * map.
+   */
+  FORMAT_COMPRESSED = 1
+};
+
+/**
+ * @brief When the checksums of PageFile pages are verified.
+ *
+ * PageFile writes a checksum into the header of every page whatever the
+ * mode; the mode only says which reads verify it.
+ */
+enum ChecksumMode {
+  /**
+   * Every read of a page from the file.
+   */
+  CHECKSUM_ON_READ,
+
+  /**
+   * Only a read of a page into a frame of a buffer pool, so each page is
+   * verified once while it stays in the pool.
+   */
+  CHECKSUM_ON_POOL_READ,
+
+  /**
+   * No read.
+   */
+  CHECKSUM_OFF
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
@@ -68,6 +113,15 @@ struct FileHeader {
  * detects this (by looking in the open_streams_ map) and just returns a file object with
  * the already created stream for the file without actually opening the UNIX file again. 
  *
+ * A file in FORMAT_COMPRESSED keeps the same pages, but compresses each one
+ * with LzCodec into an extent of its own, a multiple of EXTENT_ALIGN bytes
+ * long, and decompresses it again on read. A page map, in blocks of
+ * MAP_ENTRIES entries allocated as the file grows, gives the position and
+ * length of every extent.  A page rewritten to a length its extent still holds
+ * stays in place; one that outgrew it moves to a new extent at the end of the
+ * file and leaves the old one unused, so compressed files suit relations that
+ * are seldom rewritten.
+ *
  * @warning This class is not threadsafe.
  */
 
@@ -80,12 +134,15 @@ class File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param format      How a new file stores its pages; an existing file keeps
+   *                    the format it was created with.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const FileFormat format = FORMAT_PLAIN);
 
   /**
    * Deletes an existing file.
@@ -164,7 +221,127 @@ class File {
    */
 	PageId getFirstPageNo();
 
+  /**
+   * Returns the number the next page allocated at the end of the file gets;
+   * the pages below it are allocated, used or free.
+   *
+   * @return  Number of pages, the header counted as one.
+   */
+  PageId getNumPages();
+
+  /**
+   * Returns how the file stores its pages.
+   *
+   * @return  Format of the file.
+   */
+  FileFormat format() const { return format_; }
+
+  /**
+   * Largest number a page of a compressed file can have.
+   */
+  static const PageId MAX_COMPRESSED_PAGES;
+
  protected:
+  /**
+   * Number of blocks of the page map of a compressed file.
+   */
+  static const int MAP_BLOCKS = 256;
+
+  /**
+   * Number of entries in a block of the page map.
+   */
+  static const int MAP_ENTRIES = 4096;
+
+  /**
+   * Extents of a compressed file are multiples of this many bytes, so that a
+   * page can grow a little in place.
+   */
+  static const int EXTENT_ALIGN = 256;
+
+  /**
+   * @brief Entry of the page map of a compressed file.
+   */
+  struct Extent {
+    /**
+     * Position of the extent in the file, 0 if the page was never written.
+     */
+    std::uint64_t offset;
+
+    /**
+     * Bytes of the page in the extent; Page::SIZE if it is stored as it is.
+     */
+    std::uint32_t length;
+
+    /**
+     * Bytes the extent holds.
+     */
+    std::uint32_t capacity;
+  };
+
+  /**
+   * @brief Header of a compressed file, right after its FileHeader.
+   */
+  struct CompressedHeader {
+    /**
+     * Position where the next extent or map block goes.
+     */
+    std::uint64_t end;
+
+    /**
+     * Position of each block of the page map, 0 for one not allocated yet.
+     */
+    std::uint64_t map_blocks[MAP_BLOCKS];
+
+    /**
+     * Number of the last page of the used list, so that allocatePage need not
+     * walk the list to append to it.
+     */
+    PageId last_used_page;
+  };
+
+  /**
+   * Reads the first length bytes of a page, decompressing them from their
+   * extent in a compressed file; only as much of the extent is decompressed as
+   * they need.  In a compressed file, a page never written reads as zeros.  No
+   * bounds checking is performed on a plain file.
+   *
+   * @param page_number   Number of page to read.
+   * @param bytes         Bytes of the page returned in this.
+   * @param length        Number of bytes to read, at most Page::SIZE.
+   * @throws  PageChecksumException  If the extent of the page does not
+   *                                 decompress to a page.
+   */
+  void readStored(const PageId page_number, char* bytes,
+                  const std::size_t length = Page::SIZE) const;
+
+  /**
+   * Writes the Page::SIZE bytes of a page, compressing them into its extent in
+   * a compressed file.
+   *
+   * @param page_number   Number of page to write.
+   * @param bytes         Bytes of the page.
+   * @throws  InvalidPageException  If the page number is beyond
+   *                                MAX_COMPRESSED_PAGES in a compressed file.
+   */
+  void writeStored(const PageId page_number, const char* bytes);
+
+  /**
+   * Returns the position of the page map entry of a page of a compressed file,
+   * 0 if its block is not allocated yet.
+   *
+   * @param page_number   Number of page.
+   * @return  Position of the entry in the file.
+   */
+  std::streampos extentPosition(const PageId page_number) const;
+
+  /**
+   * Returns CompressedHeader::end of a compressed file, from stored_ends_ once
+   * it has been read.
+   *
+   * @return  Position where the stored data of the file ends.
+   */
+  std::uint64_t storedEnd() const;
+
   /**
    * Returns the position of the page with the given number in the file (as an
    * offset from the beginning of the file).
@@ -212,6 +389,7 @@ class File {
 
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, std::uint64_t> EndMap;
 
   /**
    * Streams for opened files.
@@ -223,6 +401,12 @@ class File {
    */
   static CountMap open_counts_;
 
+  /**
+   * CompressedHeader::end of opened compressed files, kept with their streams
+   * so that reads can check extents against it without seeking.
+   */
+  static EndMap stored_ends_;
+
   /**
    * Name of the file this object represents.
    */
@@ -233,6 +417,11 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * How the file stores its pages, as its header says.
+   */
+  FileFormat format_;
+
   friend class FileIterator;
 };
 
@@ -247,6 +436,15 @@ class PageFile : public File {
    */
   static PageFile create(const std::string& filename);
 
+  /**
+   * Creates a new file storing its pages in the given format.
+   *
+   * @param filename  Name of the file.
+   * @param format    How the file stores its pages.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static PageFile create(const std::string& filename, const FileFormat format);
+
   /**
    * Opens the file named fileName and returns the corresponding File object.
 	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
@@ -264,12 +462,14 @@ class PageFile : public File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param format      How a new file stores its pages.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  PageFile(const std::string& name, const bool create_new);
+  PageFile(const std::string& name, const bool create_new,
+           const FileFormat format = FORMAT_PLAIN);
 
   /**
    * Copy constructor.
@@ -307,6 +507,8 @@ class PageFile : public File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  PageChecksumException  If the mode is CHECKSUM_ON_READ and the
+   *                                 page does not match its checksum.
    */
   Page readPage(const PageId page_number) const override;
 
@@ -341,7 +543,35 @@ class PageFile : public File {
    */
   FileIterator end();
 
+  /**
+   * Checks a page read from the file against the checksum in its header.
+   *
+   * @param page_number   Number of the page in the file.
+   * @param page          Page as read from the file.
+   * @throws  PageChecksumException  If the page does not match its checksum.
+   */
+  void verifyChecksum(const PageId page_number, const Page& page) const;
+
+  /**
+   * Sets which reads of pages verify their checksums, for all PageFiles.  Not
+   * to be called while other threads read pages.
+   *
+   * @param mode  New mode; CHECKSUM_ON_READ at first.
+   */
+  static void setChecksumMode(const ChecksumMode mode) { checksum_mode_ = mode; }
+
+  /**
+   * Returns which reads of pages verify their checksums.
+   *
+   * @return  Current mode.
+   */
+  static ChecksumMode getChecksumMode() { return checksum_mode_; }
+
  private:
+  /**
+   * Which reads verify the checksums of pages.
+   */
+  static ChecksumMode checksum_mode_;
 
   /**
    * Reads a page from the file.  If <allow_free> is not set, an exception
@@ -355,11 +585,14 @@ class PageFile : public File {
    * @return  The page.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
+   * @throws  PageChecksumException  If the mode is CHECKSUM_ON_READ and the
+   *                                 page does not match its checksum.
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
   /**
-   * Writes a page into the file at the given page number with the given header.
+   * Writes a page into the file at the given page number with the given header,
+   * its checksum filled in.
    * This does not ensure that the number in the header equals the position on
    * disk.  No bounds checking is performed.
    *
@@ -379,6 +612,24 @@ class PageFile : public File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
+  /**
+   * Returns the number of the last page of the used list.  A compressed file
+   * keeps it in its CompressedHeader; in a plain file the list is walked a
+   * page header at a time.
+   *
+   * @param header  Header of the file.
+   * @return  Number of the last used page, Page::INVALID_NUMBER if none.
+   */
+  PageId lastUsedPage(const FileHeader& header) const;
+
+  /**
+   * Records the last page of the used list in a compressed file; a plain file
+   * keeps no record of it.
+   *
+   * @param page_number   Number of the last used page.
+   */
+  void setLastUsedPage(const PageId page_number);
+
   friend class FileIterator;
 };
 
@@ -442,7 +693,8 @@ class BlobFile : public File {
   ~BlobFile();
 
   /**
-   * Allocates a new page in the file.
+   * Allocates a new page in the file, reusing a page freed by deletePage if
+   * there is one.
    *
    * @return The new page.
    */
@@ -468,9 +720,12 @@ class BlobFile : public File {
   void writePage(const PageId page_number, const Page& new_page) override;
 
   /**
-   * Deletes a page from the file.
+   * Deletes a page from the file. Blob pages have no header to link them by,
+   * so free pages are chained through their first bytes; the file keeps its
+   * size and allocatePage hands the page out again.
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
    */
   void deletePage(const PageId page_number) override;
 };
@@ -103,6 +103,13 @@ class FileIterator {
 	inline Page operator*() const
   { return file_->readPage(current_page_number_); }
 
+  /**
+   * Returns the number of the current page in the file, without reading it.
+   *
+   * @return  Page number.
+   */
+  inline PageId page_number() const { return current_page_number_; }
+
  private:
   /**
    * File we're iterating over.
@@ -5,11 +5,30 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include "filescan.h"
+#include "range_filter.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_scan_param_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
 
 namespace badgerdb { 
 
+/*
+	A STRING value as BTreeIndex keys it: at most STRINGSIZE bytes, up to a null byte, trailing spaces dropped.
+*/
+static std::string stringKey(const char* value)
+{
+	size_t len = strnlen(value, STRINGSIZE);
+	while (len > 0 && value[len - 1] == ' ') {
+		len--;
+	}
+	return std::string(value, len);
+}
+
 FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 {
   file = new PageFile(name, false);	//dont create new file
@@ -17,6 +36,9 @@ FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 	curDirtyFlag = false;
   curPage = NULL;
 	filePageIter = file->begin();
+	hasPredicate = false;
+	emptyRange = false;
+	nextMatch = 0;
 }
 
 FileScan::~FileScan()
@@ -33,10 +55,128 @@ FileScan::~FileScan()
   delete file;
 }
 
+void FileScan::setPredicate(const int attrByteOffsetParm, const Datatype attrTypeParm,
+                            const void* lowVal, const Operator lowOpParm,
+                            const void* highVal, const Operator highOpParm)
+{
+	if ((lowOpParm != GTE && lowOpParm != GT) || (highOpParm != LT && highOpParm != LTE)) {
+		throw BadOpcodesException();
+	}
+	attrByteOffset = attrByteOffsetParm;
+	attrType = attrTypeParm;
+	lowOp = lowOpParm;
+	highOp = highOpParm;
+	emptyRange = false;
+	if (attrType == INTEGER) {
+		// bounds are made inclusive as in BTreeIndex::countRange
+		long long low = *((const int*)lowVal);
+		long long high = *((const int*)highVal);
+		if (high < low) {
+			throw BadScanrangeException();
+		}
+		low += lowOp == GT ? 1 : 0;
+		high -= highOp == LT ? 1 : 0;
+		emptyRange = high < low;
+		lowInt = (int)low;
+		highInt = (int)high;
+	} else if (attrType == DOUBLE) {
+		double low = *((const double*)lowVal);
+		double high = *((const double*)highVal);
+		if (high < low) {
+			throw BadScanrangeException();
+		}
+		// the next double past an excluded bound is the first one included
+		if (lowOp == GT) {
+			low = std::nextafter(low, std::numeric_limits<double>::infinity());
+		}
+		if (highOp == LT) {
+			high = std::nextafter(high, -std::numeric_limits<double>::infinity());
+		}
+		emptyRange = high < low;
+		lowDouble = low;
+		highDouble = high;
+	} else {
+		lowString = stringKey((const char*)lowVal);
+		highString = stringKey((const char*)highVal);
+		if (highString < lowString) {
+			throw BadScanrangeException();
+		}
+	}
+	hasPredicate = true;
+}
+
+void FileScan::selectMatches()
+{
+	matches.clear();
+	nextMatch = 0;
+	const SlotId records = curPage->getNumRecords();
+	if (emptyRange || records == 0) {
+		return;
+	}
+	const int length = attrType == INTEGER ? sizeof(int) : attrType == DOUBLE ? sizeof(double) : STRINGSIZE;
+	values.resize((records * length + 7) / 8);
+	valueSlots.resize(records);
+	positions.resize(records);
+	char* bytes = reinterpret_cast<char*>(&values[0]);
+	const SlotId count = curPage->getFieldValues(attrByteOffset, length, bytes, &valueSlots[0]);
+
+	int selected = 0;
+	if (attrType == INTEGER) {
+		selected = RangeFilter::selectInt(reinterpret_cast<const int*>(bytes), count, lowInt, highInt, &positions[0]);
+	} else if (attrType == DOUBLE) {
+		selected = RangeFilter::selectDouble(reinterpret_cast<const double*>(bytes), count, lowDouble, highDouble,
+			&positions[0]);
+	} else {
+		for (SlotId i = 0; i < count; i++) {
+			const std::string key = stringKey(bytes + i * length);
+			if ((key > lowString || (key == lowString && lowOp == GTE)) &&
+				(key < highString || (key == highString && highOp == LTE))) {
+				positions[selected++] = i;
+			}
+		}
+	}
+	matches.resize(selected);
+	for (int i = 0; i < selected; i++) {
+		matches[i] = valueSlots[positions[i]];
+	}
+}
+
+void FileScan::scanNextMatch(RecordId& outRid)
+{
+	if (filePageIter == file->end()) {
+		throw EndOfFileException();
+	}
+	while (true) {
+		if (curPage == NULL) {
+			bufMgr->readPage(file, filePageIter.page_number(), curPage);
+			curDirtyFlag = false;
+			selectMatches();
+		}
+		if (nextMatch < matches.size()) {
+			break;
+		}
+		bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
+		curPage = NULL;
+		curDirtyFlag = false;
+		filePageIter++;
+		if (filePageIter == file->end()) {
+			throw EndOfFileException();
+		}
+	}
+	outRid = {filePageIter.page_number(), matches[nextMatch++], 0};
+	pageRecordIter = PageIterator(curPage, outRid);
+}
+
 void FileScan::scanNext(RecordId& outRid)
 {
   std::string rec;
 
+  if (hasPredicate)
+  {
+    scanNextMatch(outRid);
+    return;
+  }
+
   if (filePageIter == file->end())
 	{
 		throw EndOfFileException();
@@ -95,7 +235,7 @@ void FileScan::scanNext(RecordId& outRid)
   }
 
   // curRec points at a valid record
-  // see if the record satisfies the scan's predicate 
+  // without a predicate every record satisfies the scan, see scanNextMatch
   // get a pointer to the record
   rec = *pageRecordIter;
 
@@ -117,4 +257,67 @@ void FileScan::markDirty()
   curDirtyFlag = true;
 }
 
+ColumnScan::ColumnScan(const std::string &name, BufMgr *bufferMgr,
+                       const std::vector<int> &scanAttributes)
+{
+  file = new PageFile(name, false);	//dont create new file
+  bufMgr = bufferMgr;
+  curPage = NULL;
+  attributes = scanAttributes;
+  filePageIter = file->begin();
+}
+
+ColumnScan::~ColumnScan()
+{
+  if (curPage != NULL)
+  {
+    bufMgr->unPinPage(file, filePageIter.page_number(), false);
+    curPage = NULL;
+  }
+  bufMgr->flushFile(file);
+  delete file;
+}
+
+SlotId ColumnScan::scanNext(std::vector<const char*> &columns)
+{
+  // the first call starts at the first page, the others leave the last one
+  if (curPage != NULL)
+  {
+    bufMgr->unPinPage(file, filePageIter.page_number(), false);
+    curPage = NULL;
+    filePageIter++;
+  }
+
+  for (; filePageIter != file->end(); filePageIter++)
+  {
+    bufMgr->readPage(file, filePageIter.page_number(), curPage);
+    if (curPage->getNumRecords() > 0)
+    {
+      break;
+    }
+    bufMgr->unPinPage(file, filePageIter.page_number(), false);
+    curPage = NULL;
+  }
+  if (curPage == NULL)
+  {
+    throw EndOfFileException();
+  }
+
+  columns.resize(attributes.size());
+  for (size_t i = 0; i < attributes.size(); i++)
+  {
+    if (attributes[i] < 0 || attributes[i] >= curPage->getNumAttributes())
+    {
+      throw BadScanParamException();
+    }
+    columns[i] = curPage->getColumn(attributes[i]);
+  }
+  return curPage->getNumRecords();
+}
+
+PageId ColumnScan::getPageNumber() const
+{
+  return filePageIter.page_number();
+}
+
 }
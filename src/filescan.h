@@ -9,6 +9,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "types.h"
 #include "page.h"
 #include "buffer.h"
@@ -19,6 +20,12 @@ namespace badgerdb {
 
 /**
  * @brief This class is used to sequentially scan records in a relation.
+ *
+ * A scan may be given a predicate on one attribute, which it checks for all
+ * the records of a page at once when it reaches the page: the values of the
+ * attribute are copied out of the records into one array and compared with
+ * the bounds several at a time (see RangeFilter), and scanNext then returns
+ * the matching records only.
  */
 class FileScan
 {
@@ -28,6 +35,26 @@ class FileScan
 
   ~FileScan();
 
+  /**
+   * Restricts the scan to the records whose attribute lies in a range, given
+   * as for BTreeIndex::startScan.  STRING attributes compare as the index
+   * keys them: their first STRINGSIZE bytes, up to a null byte and without
+   * trailing spaces.  Records too short to hold the attribute do not match.
+   * Call before the first scanNext.
+   *
+   * @param attrByteOffset  Offset of the attribute in a record
+   * @param attrType        Type of the attribute
+   * @param lowVal          Low value of range, pointer to integer / double / char string
+   * @param lowOp           Low operator (GT/GTE)
+   * @param highVal         High value of range, pointer to integer / double / char string
+   * @param highOp          High operator (LT/LTE)
+   * @throws  BadOpcodesException    If lowOp and highOp do not contain one of their expected values
+   * @throws  BadScanrangeException  If lowVal > highVal
+   */
+  void setPredicate(const int attrByteOffset, const Datatype attrType,
+                    const void* lowVal, const Operator lowOp,
+                    const void* highVal, const Operator highOp);
+
   //return RecordId of next record that satisfies the scan 
   void scanNext(RecordId& outRid);
 
@@ -60,6 +87,146 @@ class FileScan
    * True if page has been updated
    */
   bool  	      curDirtyFlag;
+
+  /**
+   * scanNext with a predicate: returns the next record of the matches of the
+   * current page, moving on to the next page with matches if none are left.
+   */
+  void scanNextMatch(RecordId& outRid);
+
+  /**
+   * Fills matches with the slot numbers of the records of curPage that
+   * satisfy the predicate.
+   */
+  void selectMatches();
+
+  /**
+   * True if setPredicate was called.
+   */
+  bool          hasPredicate;
+
+  /**
+   * True if no value can satisfy the predicate, such as (3,4) for INTEGER.
+   */
+  bool          emptyRange;
+
+  /**
+   * Offset of the attribute of the predicate in a record.
+   */
+  int           attrByteOffset;
+
+  /**
+   * Type of the attribute of the predicate.
+   */
+  Datatype      attrType;
+
+  /**
+   * Bounds of the predicate, made inclusive, for INTEGER attributes.
+   */
+  int           lowInt, highInt;
+
+  /**
+   * Bounds of the predicate, made inclusive, for DOUBLE attributes.
+   */
+  double        lowDouble, highDouble;
+
+  /**
+   * Bounds of the predicate for STRING attributes, with their operators.
+   */
+  std::string   lowString, highString;
+  Operator      lowOp, highOp;
+
+  /**
+   * Values of the attribute on the current page, in words so that ints and
+   * doubles are read in place, and the slots they come from.
+   */
+  std::vector<std::uint64_t> values;
+  std::vector<SlotId> valueSlots;
+
+  /**
+   * Positions in values of the matching records.
+   */
+  std::vector<std::uint16_t> positions;
+
+  /**
+   * Slot numbers of the matching records of the current page, and the next
+   * one scanNext returns.
+   */
+  std::vector<SlotId> matches;
+  size_t              nextMatch;
+};
+
+/**
+ * @brief This class is used to scan some attributes of a relation of PAX pages
+ * a page at a time, as column vectors.
+ *
+ * Each call returns the minipages of the attributes on the next page, in the
+ * frame the page is pinned in, so the values are read without being copied
+ * and without the rest of the records.  See Page::formatPax.
+ */
+class ColumnScan
+{
+ public:
+  /**
+   * Opens a scan of the given attributes of a relation.
+   *
+   * @param name        Name of the relation
+   * @param bufMgr      Buffer Manager Instance
+   * @param attributes  Numbers of the attributes to scan, in the order of the
+   *                    columns scanNext returns
+   */
+  ColumnScan(const std::string &name, BufMgr *bufMgr,
+             const std::vector<int> &attributes);
+
+  /**
+   * Unpins the page of the scan and closes the relation.
+   */
+  ~ColumnScan();
+
+  /**
+   * Moves to the next page of the relation that holds records and returns its
+   * columns.  Value j of each column belongs to the record with slot number
+   * j + 1 on the page; the columns stay valid until the next call.
+   *
+   * @param columns  For each attribute of the scan, the values of the records
+   *                 one after another, each as long as the attribute
+   * @return  Number of records on the page, the length of every column.
+   * @throws  EndOfFileException     If the relation has no more pages.
+   * @throws  BadScanParamException  If the page is not a PAX page or lacks an
+   *                                 attribute of the scan.
+   */
+  SlotId scanNext(std::vector<const char*> &columns);
+
+  /**
+   * Returns the number of the page the last columns come from.
+   */
+  PageId getPageNumber() const;
+
+ private:
+  /**
+   * File which is being scanned.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read pages into the buffer pool.
+   */
+  BufMgr        *bufMgr;
+
+  /**
+   * Current page being scanned, pinned; null before the first page.
+   */
+  Page*         curPage;
+
+  /**
+   * Page of the relation the scan is at.
+   */
+  FileIterator  filePageIter;
+
+  /**
+   * Numbers of the attributes scanned.
+   */
+  std::vector<int> attributes;
 };
 
 }
@@ -0,0 +1,193 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Reader-writer latch protecting one B+Tree node.
+ *
+ * Latches are short-term: they are held while a thread reads or changes a pinned page and are never
+ * kept across calls into the index. The latch is a single word holding -1 while it is held exclusively
+ * and the number of shared holders otherwise. Waiters spin and yield, which suits the short critical
+ * sections of a node search or update.
+ *
+ * The latch also carries a version counter for optimistic readers, which take no latch at all: they
+ * read the version, read the node, and then check that the version did not change. The version is
+ * odd while an exclusive holder may be changing the node and moves on when it releases the latch.
+ */
+class NodeLatch {
+ public:
+  /**
+   * Constructs a free latch.
+   */
+  NodeLatch()
+      : state_(0),
+        version_(0) {
+  }
+
+  /**
+   * Acquires the latch in shared mode, waiting while a writer holds it.
+   */
+  void lockShared() {
+    while (true) {
+      int state = state_.load(std::memory_order_relaxed);
+      if (state >= 0 &&
+          state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire)) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * Releases a shared hold on the latch.
+   */
+  void unlockShared() {
+    state_.fetch_sub(1, std::memory_order_release);
+  }
+
+  /**
+   * Acquires the latch in exclusive mode, waiting until no one else holds it.
+   */
+  void lockExclusive() {
+    while (true) {
+      int state = 0;
+      if (state_.compare_exchange_weak(state, -1, std::memory_order_acquire)) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+    // make the version odd before any change to the node can be seen
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  /**
+   * Releases an exclusive hold on the latch.
+   */
+  void unlockExclusive() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    state_.store(0, std::memory_order_release);
+  }
+
+  /**
+   * Starts an optimistic read of the node, waiting while an exclusive holder may be changing it.
+   *
+   * @return  Version to pass to validate once the node has been read.
+   */
+  std::uint32_t readVersion() const {
+    while (true) {
+      std::uint32_t version = version_.load(std::memory_order_acquire);
+      if ((version & 1) == 0) {
+        return version;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * Ends an optimistic read of the node. Whatever was read since readVersion may only be used if this
+   * returns true; otherwise the node changed meanwhile and the read has to be restarted.
+   *
+   * @param version Version returned by readVersion
+   * @return  True if no exclusive holder took the latch since readVersion.
+   */
+  bool validate(const std::uint32_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
+ private:
+  /**
+   * -1 if held exclusively, otherwise the number of shared holders.
+   */
+  std::atomic<int> state_;
+
+  /**
+   * Even while the node is stable, odd while it is held exclusively.
+   */
+  std::atomic<std::uint32_t> version_;
+};
+
+/**
+ * @brief Table holding the latch of every page of one index file.
+ *
+ * Page numbers of a BlobFile are dense, so latches are kept in fixed-size chunks indexed by page number.
+ * A chunk is allocated the first time one of its pages is latched and is only freed with the table, so
+ * finding the latch of a page never takes a lock.
+ *
+ * @warning Latches only order threads that agree to use them; the table does not pin pages.
+ */
+class LatchTable {
+ public:
+  /**
+   * Number of latches allocated together.
+   */
+  static const std::uint32_t CHUNK_SIZE = 1024;
+
+  /**
+   * Number of chunks, which bounds the number of pages an index file may have.
+   */
+  static const std::uint32_t MAX_CHUNKS = 16384;
+
+  /**
+   * Constructs a table with no chunks allocated.
+   */
+  LatchTable() {
+    for (std::uint32_t i = 0; i < MAX_CHUNKS; i++) {
+      chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Frees all chunks. No latch may be held at this point.
+   */
+  ~LatchTable() {
+    for (std::uint32_t i = 0; i < MAX_CHUNKS; i++) {
+      delete [] chunks_[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Returns the latch of the given page, allocating its chunk if needed.
+   *
+   * @param pageNo  Page number in the index file
+   * @return  Latch of the page.
+   */
+  NodeLatch& get(const PageId pageNo) {
+    assert(pageNo / CHUNK_SIZE < MAX_CHUNKS);
+    std::atomic<NodeLatch*>& slot = chunks_[pageNo / CHUNK_SIZE];
+    NodeLatch* chunk = slot.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      NodeLatch* fresh = new NodeLatch[CHUNK_SIZE];
+      if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+        chunk = fresh;
+      } else {
+        // another thread allocated the chunk first, chunk now holds its pointer
+        delete [] fresh;
+      }
+    }
+    return chunk[pageNo % CHUNK_SIZE];
+  }
+
+ private:
+  /**
+   * Chunks of latches, nullptr until first used.
+   */
+  std::atomic<NodeLatch*> chunks_[MAX_CHUNKS];
+};
+
+}
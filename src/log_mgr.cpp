@@ -0,0 +1,475 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_mgr.h"
+#include "crc32c.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "exceptions/file_exists_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+LogMgr::LogMgr(const std::string& name)
+  : logName(name) {
+  fd = ::open(logName.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    throw FileNotFoundException(logName);
+  }
+  std::memset(&stats, 0, sizeof(stats));
+
+  LogHeader header;
+  if (::pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+    // a new log; record numbers start at 1 so that 0 can stand for no record
+    header.magic = LOG_MAGIC;
+    header.reserved = 0;
+    header.baseLsn = 1;
+    if (::pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+      ::close(fd);
+      throw FileNotFoundException(logName);
+    }
+    ::fdatasync(fd);
+  } else if (header.magic != LOG_MAGIC) {
+    ::close(fd);
+    throw FileExistsException(logName);
+  }
+  baseLsn = header.baseLsn;
+
+  // new records go right after the last whole one, over whatever a crash left behind it
+  std::vector<char> record;
+  endLsn = baseLsn;
+  while (readRecord(endLsn, record)) {
+    endLsn += record.size();
+  }
+  flushedLsn = endLsn;
+  if (::ftruncate(fd, sizeof(LogHeader) + (endLsn - baseLsn)) != 0) {
+    ::close(fd);
+    throw FileNotFoundException(logName);
+  }
+}
+
+LogMgr::~LogMgr() {
+  flush();
+  ::close(fd);
+}
+
+void LogMgr::beginRecord(std::vector<char>& record, const RecordType type, const File* file,
+                         const PageId pageNo) {
+  const std::string name = file != nullptr ? file->filename() : std::string();
+  RecordHeader header;
+  header.checksum = 0;
+  header.length = 0;
+  header.lsn = endLsn;
+  header.pageNo = pageNo;
+  header.nameLength = name.size();
+  header.type = type;
+  header.pageFile = file != nullptr && dynamic_cast<const PageFile*>(file) != nullptr;
+  record.resize(sizeof(header));
+  std::memcpy(&record[0], &header, sizeof(header));
+  record.insert(record.end(), name.begin(), name.end());
+}
+
+Lsn LogMgr::append(std::vector<char>& record) {
+  RecordHeader* header = reinterpret_cast<RecordHeader*>(&record[0]);
+  header->length = record.size();
+  header->checksum = checksum(&record[sizeof(header->checksum)], record.size() - sizeof(header->checksum));
+  Lsn lsn = endLsn;
+  buffer.insert(buffer.end(), record.begin(), record.end());
+  endLsn += record.size();
+  stats.records++;
+  stats.bytes += record.size();
+  if (buffer.size() >= BUFFER_BYTES) {
+    writeBuffer();
+  }
+  return lsn;
+}
+
+Lsn LogMgr::logImage(const File* file, const PageId pageNo, Page& page, Page& image) {
+  std::lock_guard<std::mutex> guard(logMutex);
+  std::vector<char> record;
+  beginRecord(record, LOG_IMAGE, file, pageNo);
+  if (record[offsetof(RecordHeader, pageFile)]) {
+    page.header_.lsn = endLsn;
+  }
+  const char* bytes = reinterpret_cast<const char*>(&page);
+  record.insert(record.end(), bytes, bytes + Page::SIZE);
+  image = page;
+  return append(record);
+}
+
+Lsn LogMgr::logUpdate(const File* file, const PageId pageNo, Page& page, Page& image) {
+  std::lock_guard<std::mutex> guard(logMutex);
+  if (std::memcmp(&page, &image, Page::SIZE) == 0) {
+    return 0;
+  }
+  std::vector<char> record;
+  beginRecord(record, LOG_UPDATE, file, pageNo);
+  if (record[offsetof(RecordHeader, pageFile)]) {
+    page.header_.lsn = endLsn;
+  }
+
+  // compare word by word; a run of changed words ends once RANGE_GAP equal bytes follow it
+  const std::uint64_t* now = reinterpret_cast<const std::uint64_t*>(&page);
+  std::uint64_t* was = reinterpret_cast<std::uint64_t*>(&image);
+  const int words = Page::SIZE / sizeof(std::uint64_t);
+  const int gapWords = RANGE_GAP / sizeof(std::uint64_t);
+  std::size_t changed = 0;
+  int word = 0;
+  while (word < words) {
+    if (now[word] == was[word]) {
+      word++;
+      continue;
+    }
+    int first = word;
+    int last = word;
+    for (word++; word < words && word <= last + gapWords + 1; word++) {
+      if (now[word] != was[word]) {
+        last = word;
+      }
+    }
+    std::uint16_t range[2] = {(std::uint16_t)(first * sizeof(std::uint64_t)),
+                              (std::uint16_t)((last + 1 - first) * sizeof(std::uint64_t))};
+    const char* rangeBytes = reinterpret_cast<const char*>(range);
+    record.insert(record.end(), rangeBytes, rangeBytes + sizeof(range));
+    record.insert(record.end(), reinterpret_cast<const char*>(now + first),
+                  reinterpret_cast<const char*>(now + last + 1));
+    std::memcpy(was + first, now + first, range[1]);
+    changed += range[1];
+    word = last + 1;
+  }
+
+  // most of the page changed: the whole page is about as long, and replay can start from it
+  if (changed > Page::SIZE / 2) {
+    record.resize(sizeof(RecordHeader) + file->filename().size());
+    record[offsetof(RecordHeader, type)] = LOG_IMAGE;
+    const char* bytes = reinterpret_cast<const char*>(&page);
+    record.insert(record.end(), bytes, bytes + Page::SIZE);
+  }
+  return append(record);
+}
+
+Lsn LogMgr::logFree(const File* file, const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(logMutex);
+  std::vector<char> record;
+  beginRecord(record, LOG_FREE, file, pageNo);
+  Lsn lsn = append(record);
+  writeBuffer();
+  return lsn;
+}
+
+Lsn LogMgr::logCheckpoint(const std::vector<DirtyPage>& table) {
+  std::lock_guard<std::mutex> guard(logMutex);
+  std::vector<char> record;
+  beginRecord(record, LOG_CHECKPOINT, nullptr, 0);
+  std::uint32_t count = table.size();
+  record.insert(record.end(), reinterpret_cast<const char*>(&count), reinterpret_cast<const char*>(&count + 1));
+  for (std::size_t i = 0; i < table.size(); i++) {
+    const std::string name = table[i].file->filename();
+    std::uint16_t nameLength = name.size();
+    const char* recLsn = reinterpret_cast<const char*>(&table[i].recLsn);
+    const char* pageNo = reinterpret_cast<const char*>(&table[i].pageNo);
+    const char* length = reinterpret_cast<const char*>(&nameLength);
+    record.insert(record.end(), recLsn, recLsn + sizeof(Lsn));
+    record.insert(record.end(), pageNo, pageNo + sizeof(PageId));
+    record.insert(record.end(), length, length + sizeof(nameLength));
+    record.insert(record.end(), name.begin(), name.end());
+  }
+  Lsn lsn = append(record);
+  writeBuffer();
+  return lsn;
+}
+
+void LogMgr::flush(const Lsn lsn) {
+  std::lock_guard<std::mutex> guard(logMutex);
+  if (lsn >= flushedLsn && !buffer.empty()) {
+    writeBuffer();
+  }
+}
+
+void LogMgr::flush() {
+  std::lock_guard<std::mutex> guard(logMutex);
+  if (!buffer.empty()) {
+    writeBuffer();
+  }
+}
+
+void LogMgr::writeBuffer() {
+  if (buffer.empty()) {
+    return;
+  }
+  off_t offset = sizeof(LogHeader) + (flushedLsn - baseLsn);
+  std::size_t written = 0;
+  while (written < buffer.size()) {
+    ssize_t n = ::pwrite(fd, &buffer[written], buffer.size() - written, offset + written);
+    if (n <= 0) {
+      throw FileNotFoundException(logName);
+    }
+    written += n;
+  }
+  ::fdatasync(fd);
+  flushedLsn = endLsn;
+  buffer.clear();
+  stats.flushes++;
+}
+
+bool LogMgr::readRecord(const Lsn lsn, std::vector<char>& record) {
+  RecordHeader header;
+  off_t offset = sizeof(LogHeader) + (lsn - baseLsn);
+  if (::pread(fd, &header, sizeof(header), offset) != (ssize_t)sizeof(header)
+      || header.lsn != lsn || header.length < sizeof(header) + header.nameLength) {
+    return false;
+  }
+  // only a dirty page table can be longer than a page and its update ranges
+  if (header.type == LOG_CHECKPOINT ? header.length > MAX_CHECKPOINT_BYTES
+      : header.length > sizeof(header) + header.nameLength + Page::SIZE + Page::SIZE / 2) {
+    return false;
+  }
+  record.resize(header.length);
+  if (::pread(fd, &record[0], header.length, offset) != (ssize_t)header.length) {
+    return false;
+  }
+  return checksum(&record[sizeof(header.checksum)], header.length - sizeof(header.checksum)) == header.checksum;
+}
+
+std::uint64_t LogMgr::recover() {
+  std::lock_guard<std::mutex> truncateGuard(truncateMutex);
+  std::lock_guard<std::mutex> guard(logMutex);
+  if (!buffer.empty()) {
+    writeBuffer();
+  }
+
+  // first pass: the last full image or free record of each page, where its replay starts, and the dirty
+  // page table of the last checkpoint
+  typedef std::pair<std::string, PageId> PageKey;
+  std::map<PageKey, Lsn> start;
+  std::map<PageKey, Lsn> dirty;
+  Lsn checkpointLsn = 0;
+  std::vector<char> record;
+  for (Lsn lsn = baseLsn; lsn < endLsn; lsn += record.size()) {
+    readRecord(lsn, record);
+    const RecordHeader* header = reinterpret_cast<const RecordHeader*>(&record[0]);
+    if (header->type == LOG_IMAGE || header->type == LOG_FREE) {
+      start[PageKey(std::string(&record[sizeof(RecordHeader)], header->nameLength), header->pageNo)] = lsn;
+    } else if (header->type == LOG_CHECKPOINT) {
+      checkpointLsn = lsn;
+      dirty.clear();
+      const char* body = &record[sizeof(RecordHeader) + header->nameLength];
+      std::uint32_t count;
+      std::memcpy(&count, body, sizeof(count));
+      body += sizeof(count);
+      for (std::uint32_t i = 0; i < count; i++) {
+        Lsn recLsn;
+        PageId pageNo;
+        std::uint16_t nameLength;
+        std::memcpy(&recLsn, body, sizeof(recLsn));
+        std::memcpy(&pageNo, body + sizeof(recLsn), sizeof(pageNo));
+        std::memcpy(&nameLength, body + sizeof(recLsn) + sizeof(pageNo), sizeof(nameLength));
+        body += sizeof(recLsn) + sizeof(pageNo) + sizeof(nameLength);
+        dirty[PageKey(std::string(body, nameLength), pageNo)] = recLsn;
+        body += nameLength;
+      }
+    }
+  }
+
+  // second pass: apply the records from there on to the pages, read from their files once
+  struct RedoPage {
+    Page page;
+    Lsn diskLsn;
+    PageId diskNext;
+    bool pageFile;
+  };
+  std::map<PageKey, RedoPage> pages;
+  std::map<std::string, File*> files;
+  for (Lsn lsn = baseLsn; lsn < endLsn; lsn += record.size()) {
+    readRecord(lsn, record);
+    const RecordHeader* header = reinterpret_cast<const RecordHeader*>(&record[0]);
+    std::string name(&record[sizeof(RecordHeader)], header->nameLength);
+    PageKey key(name, header->pageNo);
+    std::map<PageKey, Lsn>::const_iterator from = start.find(key);
+    if (header->type == LOG_FREE || header->type == LOG_CHECKPOINT
+        || (from != start.end() && lsn < from->second)) {
+      continue;
+    }
+    // before the checkpoint, only the records its table says may be missing from disk
+    if (lsn < checkpointLsn) {
+      std::map<PageKey, Lsn>::const_iterator entry = dirty.find(key);
+      if (entry == dirty.end() || lsn < entry->second) {
+        continue;
+      }
+    }
+
+    std::map<PageKey, RedoPage>::iterator it = pages.find(key);
+    if (it == pages.end()) {
+      if (files.find(name) == files.end()) {
+        files[name] = File::exists(name) ? new BlobFile(name, false) : nullptr;
+      }
+      // a page past the end of its file, or in a file removed since, is not replayed
+      File* file = files[name];
+      if (file == nullptr || header->pageNo >= file->getNumPages()) {
+        continue;
+      }
+      RedoPage redo;
+      redo.page = file->readPage(header->pageNo);
+      redo.diskLsn = header->pageFile ? redo.page.header_.lsn : 0;
+      redo.diskNext = redo.page.header_.next_page_number;
+      redo.pageFile = header->pageFile;
+      it = pages.insert(std::make_pair(key, redo)).first;
+    }
+
+    // the header of a PageFile page says which of its records are on disk already
+    RedoPage& redo = it->second;
+    if (redo.pageFile && lsn <= redo.diskLsn) {
+      continue;
+    }
+    const char* body = &record[sizeof(RecordHeader) + header->nameLength];
+    const char* end = &record[0] + record.size();
+    char* bytes = reinterpret_cast<char*>(&redo.page);
+    if (header->type == LOG_IMAGE) {
+      std::memcpy(bytes, body, Page::SIZE);
+    } else {
+      while (body < end) {
+        std::uint16_t range[2];
+        std::memcpy(range, body, sizeof(range));
+        std::memcpy(bytes + range[0], body + sizeof(range), range[1]);
+        body += sizeof(range) + range[1];
+      }
+    }
+  }
+
+  // the file keeps the next page numbers of PageFile pages up to date on its own
+  for (std::map<PageKey, RedoPage>::iterator it = pages.begin(); it != pages.end(); ++it) {
+    RedoPage& redo = it->second;
+    if (redo.pageFile) {
+      redo.page.header_.next_page_number = redo.diskNext;
+      redo.page.header_.checksum = redo.page.computeChecksum(redo.page.header_);
+    }
+    files[it->first.first]->writePage(it->first.second, redo.page);
+  }
+  for (std::map<std::string, File*>::iterator it = files.begin(); it != files.end(); ++it) {
+    delete it->second;
+  }
+  stats.pagesRedone += pages.size();
+
+  // every page is back on disk, so the records are not needed any more
+  emptyFile();
+  return pages.size();
+}
+
+void LogMgr::truncate() {
+  std::lock_guard<std::mutex> truncateGuard(truncateMutex);
+  std::lock_guard<std::mutex> guard(logMutex);
+  emptyFile();
+}
+
+std::uint64_t LogMgr::truncate(const Lsn lsn) {
+  std::lock_guard<std::mutex> truncateGuard(truncateMutex);
+  Lsn copiedLsn;
+  {
+    std::lock_guard<std::mutex> guard(logMutex);
+    if (lsn <= baseLsn || lsn > endLsn) {
+      return 0;
+    }
+    writeBuffer();
+    copiedLsn = flushedLsn;
+  }
+
+  // the records written so far are copied without holding logMutex; only truncations move them
+  const std::string newName = logName + ".new";
+  int newFd = ::open(newName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (newFd < 0) {
+    throw FileNotFoundException(newName);
+  }
+  LogHeader header;
+  header.magic = LOG_MAGIC;
+  header.reserved = 0;
+  header.baseLsn = lsn;
+  std::uint64_t written = 0;
+  bool ok = ::pwrite(newFd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+  written += sizeof(header);
+  ok = ok && copyRecords(newFd, lsn, lsn, copiedLsn);
+  written += copiedLsn - lsn;
+
+  std::lock_guard<std::mutex> guard(logMutex);
+  writeBuffer();
+  ok = ok && copyRecords(newFd, lsn, copiedLsn, flushedLsn);
+  written += flushedLsn - copiedLsn;
+  if (!ok || ::fdatasync(newFd) != 0 || ::rename(newName.c_str(), logName.c_str()) != 0) {
+    ::close(newFd);
+    ::unlink(newName.c_str());
+    throw FileNotFoundException(logName);
+  }
+  syncDirectory();
+  ::close(fd);
+  fd = newFd;
+  baseLsn = lsn;
+  return written;
+}
+
+bool LogMgr::copyRecords(const int to, const Lsn toBaseLsn, const Lsn from, const Lsn end) {
+  std::vector<char> bytes(std::min<Lsn>(end - from, (Lsn)BUFFER_BYTES));
+  for (Lsn lsn = from; lsn < end; ) {
+    std::size_t length = std::min<Lsn>(end - lsn, bytes.size());
+    if (::pread(fd, &bytes[0], length, sizeof(LogHeader) + (lsn - baseLsn)) != (ssize_t)length
+        || ::pwrite(to, &bytes[0], length, sizeof(LogHeader) + (lsn - toBaseLsn)) != (ssize_t)length) {
+      return false;
+    }
+    lsn += length;
+  }
+  return true;
+}
+
+void LogMgr::syncDirectory() {
+  std::string::size_type slash = logName.rfind('/');
+  const std::string directory = slash == std::string::npos ? "." : logName.substr(0, slash + 1);
+  int dirFd = ::open(directory.c_str(), O_RDONLY);
+  if (dirFd >= 0) {
+    ::fsync(dirFd);
+    ::close(dirFd);
+  }
+}
+
+void LogMgr::emptyFile() {
+  buffer.clear();
+  baseLsn = endLsn;
+  flushedLsn = endLsn;
+  LogHeader header;
+  header.magic = LOG_MAGIC;
+  header.reserved = 0;
+  header.baseLsn = baseLsn;
+  if (::pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+      || ::ftruncate(fd, sizeof(LogHeader)) != 0) {
+    throw FileNotFoundException(logName);
+  }
+  ::fdatasync(fd);
+}
+
+Lsn LogMgr::getBaseLsn() {
+  std::lock_guard<std::mutex> guard(logMutex);
+  return baseLsn;
+}
+
+Lsn LogMgr::getEndLsn() {
+  std::lock_guard<std::mutex> guard(logMutex);
+  return endLsn;
+}
+
+LogStats LogMgr::getStats() {
+  std::lock_guard<std::mutex> guard(logMutex);
+  return stats;
+}
+
+std::uint32_t LogMgr::checksum(const char* data, const std::size_t length) {
+  return Crc32c::extend(0, data, length);
+}
+
+}
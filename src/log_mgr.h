@@ -0,0 +1,396 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Counts of a LogMgr since it was created, see LogMgr::getStats.
+ */
+struct LogStats {
+  /**
+   * Number of records appended.
+   */
+  std::uint64_t records;
+
+  /**
+   * Number of bytes appended.
+   */
+  std::uint64_t bytes;
+
+  /**
+   * Number of times the log was forced to disk.
+   */
+  std::uint64_t flushes;
+
+  /**
+   * Number of pages recover wrote.
+   */
+  std::uint64_t pagesRedone;
+};
+
+/**
+ * @brief Entry of the dirty page table a checkpoint records, see LogMgr::logCheckpoint.
+ */
+struct DirtyPage {
+  /**
+   * File of the page.
+   */
+  const File* file;
+
+  /**
+   * Page number in the file.
+   */
+  PageId pageNo;
+
+  /**
+   * Number of the first record of the page that may not be on disk yet.
+   */
+  Lsn recLsn;
+};
+
+/**
+ * @brief Write-ahead log of the pages changed through a BufMgr, with redo recovery.
+ *
+ * The log is physical: every time a page is unpinned dirty, the buffer manager appends the bytes that
+ * changed since its last record, or the whole page when most of it changed, and a page that is allocated
+ * or disposed of gets a record of its own. Before a frame is written back, the log is forced to disk up to
+ * the last record of its page, so a page on disk never holds a change the log could lose.
+ *
+ * After a crash, recover brings every page the log names back to its last record. A page is replayed from
+ * its last full image or from its state on disk, and a page whose last record says it was disposed of is
+ * left alone, as the file already lists it as free. Pages of a PageFile carry the number of their last
+ * record in their header, so records already on disk are skipped; blob pages have no room for it and
+ * replay all their records, which gives the same bytes. Recovery restores pages, not operations: a B+Tree
+ * split caught halfway by the crash stays halfway.
+ *
+ * A checkpoint record holds the pages that were dirty in the pool when it was taken, each with the first
+ * record of it that may not be on disk. Recovery skips the records before the last checkpoint that the table
+ * says are on disk, and the log can drop every record before the oldest of them.
+ *
+ * Files are named by their path in the records. Files written around the buffer manager, like the
+ * relations the tests fill through PageFile::writePage, are not logged.
+ */
+class LogMgr {
+ public:
+  /**
+   * Opens the log at the given path, creating it if it does not exist. Call recover before any file the
+   * log names is opened.
+   *
+   * @param logName  Path of the log
+   * @throws  FileNotFoundException  If the log can neither be opened nor created
+   */
+  explicit LogMgr(const std::string& logName);
+
+  /**
+   * Forces what is left of the log to disk and closes it.
+   */
+  ~LogMgr();
+
+  /**
+   * Appends a record holding the whole of a page, as it is after being allocated.
+   *
+   * @param file    File of the page
+   * @param pageNo  Page number in the file
+   * @param page    Contents of the page; a PageFile page gets the number of the record in its header
+   * @param image   Copy of the page as the log last recorded it, set to page
+   * @return  Number of the record.
+   */
+  Lsn logImage(const File* file, const PageId pageNo, Page& page, Page& image);
+
+  /**
+   * Appends a record of the bytes of a page that differ from the copy the log last recorded, or of the
+   * whole page if most of it differs.
+   *
+   * @param file    File of the page
+   * @param pageNo  Page number in the file
+   * @param page    Contents of the page; a PageFile page gets the number of the record in its header
+   * @param image   Copy of the page as the log last recorded it, brought up to date with page
+   * @return  Number of the record, 0 if no byte changed and nothing was appended.
+   */
+  Lsn logUpdate(const File* file, const PageId pageNo, Page& page, Page& image);
+
+  /**
+   * Appends a record saying that a page was disposed of, and forces it to disk: the file lists the page as
+   * free right afterwards, and older records must not be replayed over it.
+   *
+   * @param file    File of the page
+   * @param pageNo  Page number in the file
+   * @return  Number of the record.
+   */
+  Lsn logFree(const File* file, const PageId pageNo);
+
+  /**
+   * Appends a checkpoint record holding the given dirty page table, and forces it to disk. Every page left
+   * out of the table must be on disk up to the record, and every page in it from its recLsn on.
+   *
+   * @param table  Dirty page table
+   * @return  Number of the record.
+   */
+  Lsn logCheckpoint(const std::vector<DirtyPage>& table);
+
+  /**
+   * Forces the log to disk up to and including the record with the given number.
+   *
+   * @param lsn  Number of the record; records before it are forced as well
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Forces the whole log to disk.
+   */
+  void flush();
+
+  /**
+   * Replays the log over the files it names, writing every page back to its last record, and empties the
+   * log. Files that no longer exist are skipped. A record cut short or garbled by the crash ends the log.
+   *
+   * @return  Number of pages written.
+   */
+  std::uint64_t recover();
+
+  /**
+   * Empties the log, once every page it holds records of is on disk. Record numbers go on from where they
+   * were.
+   */
+  void truncate();
+
+  /**
+   * Drops the records before the given number, once every page they are records of is on disk. The records
+   * kept are copied to a new file that then takes the place of the log; records appended meanwhile wait
+   * only for the last of them to be copied.
+   *
+   * @param lsn  Number of the first record to keep
+   * @return  Number of bytes written to the new file, 0 if nothing was dropped.
+   */
+  std::uint64_t truncate(const Lsn lsn);
+
+  /**
+   * Returns the number of the first record the log holds.
+   */
+  Lsn getBaseLsn();
+
+  /**
+   * Returns the number the next record will get.
+   */
+  Lsn getEndLsn();
+
+  /**
+   * Returns the counts of the log since it was created.
+   */
+  LogStats getStats();
+
+ private:
+  /**
+   * Kinds of records.
+   */
+  enum RecordType {
+    /** Whole page */
+    LOG_IMAGE = 1,
+    /** Byte ranges of a page */
+    LOG_UPDATE = 2,
+    /** Page disposed of */
+    LOG_FREE = 3,
+    /** Dirty page table */
+    LOG_CHECKPOINT = 4
+  };
+
+  /**
+   * Header of every record, followed by the file name and the bytes of the kind of record: the page for
+   * LOG_IMAGE, for LOG_UPDATE a run of ranges, each a 2-byte offset, a 2-byte length and the bytes, and for
+   * LOG_CHECKPOINT a 4-byte count of pages, each a recLsn, a page number, a 2-byte name length and the name.
+   */
+  struct RecordHeader {
+    /**
+     * Checksum of the record after this field.
+     */
+    std::uint32_t checksum;
+
+    /**
+     * Length of the record in bytes, this header included.
+     */
+    std::uint32_t length;
+
+    /**
+     * Number of the record.
+     */
+    Lsn lsn;
+
+    /**
+     * Page number in the file.
+     */
+    PageId pageNo;
+
+    /**
+     * Length of the file name.
+     */
+    std::uint16_t nameLength;
+
+    /**
+     * RecordType.
+     */
+    std::uint8_t type;
+
+    /**
+     * True if the page belongs to a PageFile, whose next page number stays as the file has it.
+     */
+    std::uint8_t pageFile;
+  };
+
+  /**
+   * Header of the log file.
+   */
+  struct LogHeader {
+    /**
+     * LOG_MAGIC, to tell a log from other files.
+     */
+    std::uint32_t magic;
+
+    /**
+     * Unused.
+     */
+    std::uint32_t reserved;
+
+    /**
+     * Number of the first record in the file.
+     */
+    Lsn baseLsn;
+  };
+
+  /**
+   * Value of LogHeader::magic.
+   */
+  static const std::uint32_t LOG_MAGIC = 0x4C4F4742;
+
+  /**
+   * Equal bytes that may sit between two changed ranges of an update record before they are recorded
+   * separately; each range costs 4 bytes of its own.
+   */
+  static const int RANGE_GAP = 8;
+
+  /**
+   * Bytes appended since the last write before the log is written out without being asked to.
+   */
+  static const std::size_t BUFFER_BYTES = 1 << 20;
+
+  /**
+   * Longest checkpoint record that is taken for one, well above the table of any pool.
+   */
+  static const std::uint32_t MAX_CHECKPOINT_BYTES = 1 << 30;
+
+  /**
+   * Appends a record built in record, setting its number and checksum. Caller holds logMutex.
+   *
+   * @param record  Header and body of the record; its lsn was set to endLsn by the caller
+   * @return  Number of the record.
+   */
+  Lsn append(std::vector<char>& record);
+
+  /**
+   * Starts a record in record, of no file if file is null. Caller holds logMutex.
+   */
+  void beginRecord(std::vector<char>& record, const RecordType type, const File* file, const PageId pageNo);
+
+  /**
+   * Writes the buffered records to the file and forces them to disk. Caller holds logMutex.
+   */
+  void writeBuffer();
+
+  /**
+   * Copies the records from one number up to another, excluded, from the log to a new file that starts at
+   * the given number.
+   *
+   * @param to         File descriptor of the new file
+   * @param toBaseLsn  Number of the first record of the new file
+   * @param from       Number of the first record to copy
+   * @param end        Number after the last record to copy
+   * @return  False if a read or a write failed.
+   */
+  bool copyRecords(const int to, const Lsn toBaseLsn, const Lsn from, const Lsn end);
+
+  /**
+   * Forces the directory of the log to disk, so a new file put in place of the log stays there.
+   */
+  void syncDirectory();
+
+  /**
+   * Drops every record from the file; the next record starts it anew. Caller holds logMutex.
+   */
+  void emptyFile();
+
+  /**
+   * Reads the record with the given number from the file.
+   *
+   * @param lsn     Number of the record
+   * @param record  Bytes of the record returned in this
+   * @return  False if there is no whole record with a matching checksum at lsn, which ends the log.
+   */
+  bool readRecord(const Lsn lsn, std::vector<char>& record);
+
+  /**
+   * Checksum of a record: CRC32C over its bytes after the checksum field.
+   */
+  static std::uint32_t checksum(const char* data, const std::size_t length);
+
+  /**
+   * Path of the log.
+   */
+  std::string logName;
+
+  /**
+   * File descriptor of the log.
+   */
+  int fd;
+
+  /**
+   * Serializes appends, writes and truncation.
+   */
+  std::mutex logMutex;
+
+  /**
+   * Serializes the truncations and recovery, which replace or empty the file; a truncation copies the log
+   * mostly without holding logMutex.
+   */
+  std::mutex truncateMutex;
+
+  /**
+   * Number of the first record in the file.
+   */
+  Lsn baseLsn;
+
+  /**
+   * Number the next record gets.
+   */
+  Lsn endLsn;
+
+  /**
+   * Records up to this number, excluded, are on disk.
+   */
+  Lsn flushedLsn;
+
+  /**
+   * Records appended but not written yet, from flushedLsn on.
+   */
+  std::vector<char> buffer;
+
+  /**
+   * Counts since the log was created.
+   */
+  LogStats stats;
+};
+
+}
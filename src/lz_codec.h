@@ -0,0 +1,255 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+/**
+ * @brief LZ77 compression of small blocks such as pages, in the manner of LZ4.
+ *
+ * The compressed form is a run of sequences. A sequence starts with a token byte whose high four bits
+ * count the literals that follow it and whose low four bits count the bytes of the match after them,
+ * less MIN_MATCH; a count of 15 goes on in the bytes after the token (or after the literals, for the
+ * match), each adding up to 255, until one adds less. The literals come next, then the 2-byte distance
+ * back to where the match is copied from. The last sequence has literals only. A match may overlap the
+ * bytes it produces, so a run of one repeated byte, such as the padding of a string field, costs a few
+ * bytes whatever its length.
+ *
+ * Matches are found through a hash table of the last position of every 4-byte string; blocks must be
+ * shorter than 64 KB so that every distance fits.
+ */
+class LzCodec {
+ public:
+  /**
+   * Longest block that may be compressed.
+   */
+  static const std::size_t MAX_BLOCK = 65535;
+
+  /**
+   * Compresses a block.
+   *
+   * @param in        Bytes to compress
+   * @param length    Number of bytes, at most MAX_BLOCK
+   * @param out       Compressed bytes returned in this
+   * @param capacity  Room in out
+   * @return  Number of compressed bytes, 0 if they do not fit in capacity.
+   */
+  static std::size_t compress(const char* in, const std::size_t length, char* out, const std::size_t capacity) {
+    std::uint16_t table[HASH_SIZE];
+    std::memset(table, 0, sizeof(table));
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(in);
+    unsigned char* dst = reinterpret_cast<unsigned char*>(out);
+    unsigned char* dstEnd = dst + capacity;
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    while (pos + MIN_MATCH <= length) {
+      // positions are stored one up, so that 0 marks an empty entry
+      const std::uint32_t hash = hash4(src + pos);
+      const std::size_t candidate = table[hash];
+      table[hash] = pos + 1;
+      if (candidate == 0 || std::memcmp(src + candidate - 1, src + pos, MIN_MATCH) != 0) {
+        pos++;
+        continue;
+      }
+      const std::size_t from = candidate - 1;
+      std::size_t matchLength = MIN_MATCH;
+      while (pos + matchLength < length && src[from + matchLength] == src[pos + matchLength]) {
+        matchLength++;
+      }
+      dst = putSequence(dst, dstEnd, src + anchor, pos - anchor, pos - from, matchLength);
+      if (dst == nullptr) {
+        return 0;
+      }
+      pos += matchLength;
+      anchor = pos;
+    }
+    dst = putSequence(dst, dstEnd, src + anchor, length - anchor, 0, 0);
+    if (dst == nullptr) {
+      return 0;
+    }
+    return dst - reinterpret_cast<unsigned char*>(out);
+  }
+
+  /**
+   * Decompresses a block made by compress.
+   *
+   * @param in         Compressed bytes
+   * @param length     Number of compressed bytes
+   * @param out        Bytes of the block returned in this
+   * @param outLength  Length of the block
+   * @return  False if the compressed bytes are garbled or do not make a block of exactly outLength bytes.
+   */
+  static bool decompress(const char* in, const std::size_t length, char* out, const std::size_t outLength) {
+    return expand(in, length, out, outLength, false);
+  }
+
+  /**
+   * Decompresses only the start of a block made by compress, and stops there.
+   *
+   * @param in            Compressed bytes
+   * @param length        Number of compressed bytes
+   * @param out           First prefixLength bytes of the block returned in this
+   * @param prefixLength  Number of bytes wanted
+   * @return  False if the compressed bytes are garbled or make fewer than prefixLength bytes.
+   */
+  static bool decompressPrefix(const char* in, const std::size_t length, char* out,
+                               const std::size_t prefixLength) {
+    return expand(in, length, out, prefixLength, true);
+  }
+
+ private:
+  /**
+   * Shortest match worth a sequence.
+   */
+  static const std::size_t MIN_MATCH = 4;
+
+  /**
+   * Number of entries in the hash table.
+   */
+  static const std::size_t HASH_SIZE = 4096;
+
+  /**
+   * Hash of the 4 bytes at p, an index into the hash table.
+   */
+  static std::uint32_t hash4(const unsigned char* p) {
+    std::uint32_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return (word * 2654435761u) >> 20;
+  }
+
+  /**
+   * Appends a sequence; a matchLength of 0 makes it the last one, with literals only.
+   *
+   * @return  End of the bytes written, null if they do not fit before dstEnd.
+   */
+  static unsigned char* putSequence(unsigned char* dst, unsigned char* dstEnd, const unsigned char* literals,
+                                    const std::size_t literalCount, const std::size_t distance,
+                                    const std::size_t matchLength) {
+    // token, both extended counts and the distance are at most this much beside the literals
+    const std::size_t worstCase = 1 + literalCount / 255 + 1 + literalCount + 2 + matchLength / 255 + 1;
+    if ((std::size_t)(dstEnd - dst) < worstCase) {
+      return nullptr;
+    }
+    unsigned char* token = dst++;
+    *token = (literalCount >= 15 ? 15 : literalCount) << 4;
+    if (literalCount >= 15) {
+      dst = putLength(dst, literalCount - 15);
+    }
+    std::memcpy(dst, literals, literalCount);
+    dst += literalCount;
+    if (matchLength == 0) {
+      return dst;
+    }
+    *dst++ = distance & 0xff;
+    *dst++ = distance >> 8;
+    const std::size_t extra = matchLength - MIN_MATCH;
+    *token |= extra >= 15 ? 15 : extra;
+    if (extra >= 15) {
+      dst = putLength(dst, extra - 15);
+    }
+    return dst;
+  }
+
+  /**
+   * Appends the bytes that go on with a count of 15.
+   */
+  static unsigned char* putLength(unsigned char* dst, std::size_t rest) {
+    while (rest >= 255) {
+      *dst++ = 255;
+      rest -= 255;
+    }
+    *dst++ = rest;
+    return dst;
+  }
+
+  /**
+   * Decompresses into out until outLength bytes are made; with prefix, the sequence that reaches outLength
+   * is cut short there, otherwise the block must end exactly at outLength.
+   */
+  static bool expand(const char* in, const std::size_t length, char* out, const std::size_t outLength,
+                     const bool prefix) {
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(in);
+    const unsigned char* srcEnd = src + length;
+    unsigned char* dst = reinterpret_cast<unsigned char*>(out);
+    unsigned char* dstStart = dst;
+    unsigned char* dstEnd = dst + outLength;
+    while (src < srcEnd) {
+      const unsigned char token = *src++;
+      std::size_t literals = token >> 4;
+      if (literals == 15 && !getLength(src, srcEnd, literals)) {
+        return false;
+      }
+      if (literals > (std::size_t)(srcEnd - src)) {
+        return false;
+      }
+      if (prefix && literals >= (std::size_t)(dstEnd - dst)) {
+        std::memcpy(dst, src, dstEnd - dst);
+        return true;
+      }
+      if (literals > (std::size_t)(dstEnd - dst)) {
+        return false;
+      }
+      std::memcpy(dst, src, literals);
+      src += literals;
+      dst += literals;
+      if (src == srcEnd) {
+        break;
+      }
+
+      if (srcEnd - src < 2) {
+        return false;
+      }
+      const std::size_t distance = src[0] | (src[1] << 8);
+      src += 2;
+      std::size_t matchLength = token & 15;
+      if (matchLength == 15 && !getLength(src, srcEnd, matchLength)) {
+        return false;
+      }
+      matchLength += MIN_MATCH;
+      if (prefix && matchLength > (std::size_t)(dstEnd - dst)) {
+        matchLength = dstEnd - dst;
+      }
+      if (distance == 0 || distance > (std::size_t)(dst - dstStart) || matchLength > (std::size_t)(dstEnd - dst)) {
+        return false;
+      }
+      // byte by byte: the match may overlap what it writes
+      const unsigned char* from = dst - distance;
+      for (std::size_t i = 0; i < matchLength; i++) {
+        dst[i] = from[i];
+      }
+      dst += matchLength;
+      if (prefix && dst == dstEnd) {
+        return true;
+      }
+    }
+    return dst == dstEnd;
+  }
+
+  /**
+   * Adds the bytes that go on with a count of 15 to count.
+   *
+   * @return  False if the compressed bytes end first.
+   */
+  static bool getLength(const unsigned char*& src, const unsigned char* srcEnd, std::size_t& count) {
+    unsigned char byte;
+    do {
+      if (src == srcEnd) {
+        return false;
+      }
+      byte = *src++;
+      count += byte;
+    } while (byte == 255);
+    return true;
+  }
+};
+
+}
@@ -5,10 +5,17 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <vector>
+#include <thread>
+#include <fstream>
 #include "btree.h"
+#include "log_mgr.h"
+#include "crc32c.h"
 #include "page.h"
 #include "filescan.h"
+#include "range_filter.h"
+#include "bitmapscan.h"
 #include "page_iterator.h"
 #include "file_iterator.h"
 #include "exceptions/insufficient_space_exception.h"
@@ -19,6 +26,10 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/page_checksum_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/bad_scan_param_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -42,6 +53,8 @@ using namespace badgerdb;
 const std::string relationName = "relA";
 //If the relation size is changed then the second parameter 2 chechPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
 const int	relationSize = 5000;
+// Lowest key of the relation; the forward relation starts below 0, the others at 0.
+int relationLowest = 0;
 std::string intIndexName, doubleIndexName, stringIndexName;
 
 // This is the structure for tuples in the base relation
@@ -68,6 +81,10 @@ void createRelationBackward();
 void createRelationRandom(int size);
 void intTests();
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int cursorScan(BTreeIndex *index, int lowVal1, int highVal1, int lowVal2, int highVal2);
+int batchScan(BTreeIndex *index, const void* lowVal, Operator lowOp, const void* highVal, Operator highOp, int batchSize);
+void stringTests();
+int stringScan(BTreeIndex *index, std::string lowVal, Operator lowOp, std::string highVal, Operator highOp);
 void indexTests();
 void test1();
 void test2();
@@ -78,6 +95,49 @@ void deleteRelation();
 void test4();
 void test5();
 void testEmpty();
+void test6();
+void concurrentTests();
+void test7();
+void deleteTests();
+void test8();
+void postingTests();
+void test9();
+void nodeCacheTests();
+void test10();
+void lookupManyTests();
+void test11();
+void reverseScanTests();
+void test12();
+void multiScanTests();
+void test13();
+void countTests();
+void test14();
+void coveringTests();
+void test15();
+void bitmapScanTests();
+void test16();
+void bloomFilterTests();
+void test17();
+void insertBufferTests();
+void test18();
+void eytzingerTests();
+void test19();
+void learnedModelTests();
+void test20();
+void rootInfoTests();
+void test21();
+void writeAheadLogTests();
+void test22();
+void checkpointTests();
+void test23();
+void pageChecksumTests();
+void test24();
+void compressedFileTests();
+void test25();
+void paxPageTests();
+void test26();
+void filteredScanTests();
+int countScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int& outOfOrder);
 
 
 int main(int argc, char **argv)
@@ -145,6 +205,27 @@ int main(int argc, char **argv)
 	errorTests();
 	test4();
 	test5();
+	test6();
+	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
 	delete bufMgr;
 
   return 1;
@@ -191,6 +272,13 @@ void test4()
 	  std::cout << "Empty Tree" << std::endl;
 	  createRelationRandom(0);
 	  testEmpty();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
 	  deleteRelation();
 }
 void test5()
@@ -228,7 +316,8 @@ void createRelationForward()
   Page new_page = file1->allocatePage(new_page_number);
 
   // Insert a bunch of tuples into the relation.
-  for(int i = -1000; i < 5000; i++ )
+  relationLowest = -1000;
+  for(int i = relationLowest; i < relationSize; i++ )
 	{
     sprintf(record1.s, "%05d string record", i);
     record1.i = i;
@@ -274,6 +363,7 @@ void createRelationBackward()
   Page new_page = file1->allocatePage(new_page_number);
 
   // Insert a bunch of tuples into the relation.
+  relationLowest = 0;
   for(int i = relationSize - 1; i >= 0; i-- )
 	{
     sprintf(record1.s, "%05d string record", i);
@@ -320,6 +410,7 @@ void createRelationRandom(int size)
 
   // insert records in random order
 
+  relationLowest = 0;
   std::vector<int> intvec(size);
   for (int i = 0; i < size; i++) {
     intvec[i] = i;
@@ -370,6 +461,14 @@ void indexTests()
   catch(const FileNotFoundException &e)
   {
   }
+  stringTests();
+	try
+	{
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -384,11 +483,103 @@ void intTests()
 	// run some tests
 	checkPassFail(intScan(&index,25,GT,40,LT), 14)
 	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 3) // 3?
+	// -2 and -1 are only in the forward relation
+	const int nearZero = relationLowest < 0 ? 5 : 3;
+	checkPassFail(intScan(&index,-3,GT,3,LT), nearZero)
 	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
 	checkPassFail(intScan(&index,0,GT,1,LT), 0)
 	checkPassFail(intScan(&index,300,GT,400,LT), 99)
 	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	// cursors advanced in turn keep their own place, also while the built-in scan runs
+	checkPassFail(cursorScan(&index,25,40,20,35), 14 + 16)
+
+	// batches return the same entries as scanNext, also when they span leaves
+	int low = 300;
+	int high = 400;
+	checkPassFail(batchScan(&index,&low,GT,&high,LT,7), 99)
+	low = 3000;
+	high = 4000;
+	checkPassFail(batchScan(&index,&low,GTE,&high,LT,1), 1000)
+	checkPassFail(batchScan(&index,&low,GTE,&high,LT,256), 1000)
+}
+
+// -----------------------------------------------------------------------------
+// batchScan
+// -----------------------------------------------------------------------------
+
+/*
+	Run a scan with scanNextBatch, batchSize entries at a time, and return the number of entries found,
+	or -1 if a batch is returned after the scan reported completion.
+*/
+int batchScan(BTreeIndex *index, const void* lowVal, Operator lowOp, const void* highVal, Operator highOp, int batchSize)
+{
+	try
+	{
+		index->startScan(lowVal, lowOp, highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+		return 0;
+	}
+
+	std::vector<RecordId> rids(batchSize);
+	int numResults = 0;
+	int got;
+	do
+	{
+		got = index->scanNextBatch(rids.data(), batchSize);
+		numResults += got;
+	} while (got == batchSize);
+
+	// the scan stays complete
+	if (index->scanNextBatch(rids.data(), batchSize) != 0)
+		numResults = -1;
+	index->endScan();
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// cursorScan
+// -----------------------------------------------------------------------------
+
+/*
+	Scan (lowVal1,highVal1) and [lowVal2,highVal2] on two cursors, taking one entry from each in turn
+	while the built-in scan covers the whole index, and return the number of entries both cursors found.
+*/
+int cursorScan(BTreeIndex *index, int lowVal1, int highVal1, int lowVal2, int highVal2)
+{
+	int low = 0;
+	int high = relationSize;
+	index->startScan(&low, GTE, &high, LT);
+	IndexScanCursor* cursors[2];
+	cursors[0] = index->openScan(&lowVal1, GT, &highVal1, LT);
+	cursors[1] = index->openScan(&lowVal2, GTE, &highVal2, LTE);
+	bool done[2] = {false, false};
+	int numResults = 0;
+	RecordId scanRid;
+	while (!done[0] || !done[1])
+	{
+		for (int c = 0; c < 2; c++)
+		{
+			if (done[c])
+				continue;
+			try
+			{
+				cursors[c]->scanNext(scanRid);
+				index->scanNext(scanRid);
+				numResults++;
+			}
+			catch(const IndexScanCompletedException &e)
+			{
+				done[c] = true;
+			}
+		}
+	}
+	delete cursors[0];
+	delete cursors[1];
+	index->endScan();
+	return numResults;
 }
 
 int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
@@ -452,6 +643,88 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 }
 
 
+// -----------------------------------------------------------------------------
+// stringTests
+// -----------------------------------------------------------------------------
+
+void stringTests()
+{
+  std::cout << "Create a B+ Tree index on the string field" << std::endl;
+  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+
+	// run some tests
+	checkPassFail(stringScan(&index,"00010",GT,"00035",LT), 25)
+	checkPassFail(stringScan(&index,"00600",GTE,"00655",LTE), 55)
+	checkPassFail(stringScan(&index,"#",GT,"%",LT), 0)
+	checkPassFail(stringScan(&index,"00996",GT,"01001",LT), 5)
+	checkPassFail(stringScan(&index,"00000",GT,"00001",LT), 1)
+	checkPassFail(stringScan(&index,"00300",GT,"00400",LT), 100)
+	checkPassFail(stringScan(&index,"03000",GTE,"04000",LT), 1000)
+	checkPassFail(stringScan(&index,"01234 string record",GTE,"01234 string record",LTE), 1)
+	checkPassFail(batchScan(&index,"00300",GT,"00400",LT,7), 100)
+	checkPassFail(batchScan(&index,"03000",GTE,"04000",LT,256), 1000)
+}
+
+int stringScan(BTreeIndex * index, std::string lowVal, Operator lowOp, std::string highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(lowVal.c_str(), lowOp, highVal.c_str(), highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults < 5 )
+			{
+				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+			}
+			else if( numResults == 5 )
+			{
+				std::cout << "..." << std::endl;
+			}
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  if( numResults >= 5 )
+  {
+    std::cout << "Number of results: " << numResults << std::endl;
+  }
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
 // -----------------------------------------------------------------------------
 // errorTests
 // -----------------------------------------------------------------------------
@@ -608,3 +881,2957 @@ void testEmpty() {
   checkPassFail(intScan(&index, 300, GT, 400, LT), 0)
   checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 0)
 }
+
+void test6()
+{
+	// Insert into an index from several threads at once while a scan runs over it
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Concurrent Inserts" << std::endl;
+	createRelationRandom(0);
+	concurrentTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// concurrentTests
+// -----------------------------------------------------------------------------
+
+void concurrentTests()
+{
+	const int numThreads = 4;
+	const int numKeys = 20000;
+  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// thread t inserts keys t, t + numThreads, ... with the key as page number of the rid
+	std::vector<std::thread> workers;
+	for (int t = 0; t < numThreads; t++)
+	{
+		workers.push_back(std::thread([&index, t]() {
+			for (int key = t; key < numKeys; key += numThreads)
+			{
+				RecordId keyRid;
+				keyRid.page_number = key;
+				keyRid.slot_number = 0;
+				index.insertEntry(&key, keyRid);
+			}
+		}));
+	}
+
+	// meanwhile every scan must return keys in ascending order without repeating any
+	int outOfOrder = 0;
+	for (int pass = 0; pass < 20; pass++)
+		countScan(&index, 0, GTE, numKeys, LT, outOfOrder);
+	for (int t = 0; t < numThreads; t++)
+		workers[t].join();
+	checkPassFail(outOfOrder, 0)
+
+	checkPassFail(countScan(&index, 25, GT, 40, LT, outOfOrder), 14)
+	checkPassFail(countScan(&index, 0, GTE, numKeys, LT, outOfOrder), numKeys)
+	checkPassFail(outOfOrder, 0)
+
+	// duplicates of a key are all found by lookup
+	std::vector<RecordId> rids;
+	int key = 7;
+	checkPassFail(index.lookup(&key, rids), 1)
+	for (int i = 0; i < 3; i++)
+	{
+		RecordId keyRid;
+		keyRid.page_number = key;
+		keyRid.slot_number = i + 1;
+		index.insertEntry(&key, keyRid);
+	}
+	checkPassFail(index.lookup(&key, rids), 4)
+	key = numKeys;
+	checkPassFail(index.lookup(&key, rids), 0)
+}
+
+void test7()
+{
+	// Delete entries, with and without concurrent scans, and reuse the pages deletes free
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Deletes" << std::endl;
+	createRelationRandom(0);
+	deleteTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	try
+	{
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// deleteTests
+// -----------------------------------------------------------------------------
+
+/*
+	Size in bytes of the file with the given name.
+*/
+static long fileBytes(const std::string& name)
+{
+	std::ifstream file(name.c_str(), std::ios::binary | std::ios::ate);
+	return file.tellg();
+}
+
+void deleteTests()
+{
+	const int numThreads = 4;
+	const int numKeys = 20000;
+	long fullBytes;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		for (int key = 0; key < numKeys; key++)
+		{
+			RecordId keyRid;
+			keyRid.page_number = key;
+			keyRid.slot_number = 0;
+			index.insertEntry(&key, keyRid);
+		}
+
+		// delete the odd keys from several threads while scans run over the index
+		std::vector<std::thread> workers;
+		for (int t = 0; t < numThreads; t++)
+		{
+			workers.push_back(std::thread([&index, t]() {
+				for (int key = 2 * t + 1; key < numKeys; key += 2 * numThreads)
+				{
+					RecordId keyRid;
+					keyRid.page_number = key;
+					keyRid.slot_number = 0;
+					index.deleteEntry(&key, keyRid);
+				}
+			}));
+		}
+		int outOfOrder = 0;
+		for (int pass = 0; pass < 20; pass++)
+			countScan(&index, 0, GTE, numKeys, LT, outOfOrder);
+		for (int t = 0; t < numThreads; t++)
+			workers[t].join();
+		checkPassFail(outOfOrder, 0)
+
+		checkPassFail(countScan(&index, 25, GT, 40, LT, outOfOrder), 7)
+		checkPassFail(countScan(&index, 0, GTE, numKeys, LT, outOfOrder), numKeys / 2)
+		checkPassFail(outOfOrder, 0)
+
+		std::vector<RecordId> rids;
+		int key = 7;
+		checkPassFail(index.lookup(&key, rids), 0)
+		key = 8;
+		checkPassFail(index.lookup(&key, rids), 1)
+
+		// deleting an entry that is not there throws
+		bool thrown = false;
+		RecordId keyRid;
+		keyRid.page_number = 7;
+		keyRid.slot_number = 0;
+		key = 7;
+		try
+		{
+			index.deleteEntry(&key, keyRid);
+		}
+		catch(const NoSuchKeyFoundException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+
+		// only the entry with the given rid is deleted among duplicates
+		key = 8;
+		keyRid.page_number = 8;
+		keyRid.slot_number = 1;
+		index.insertEntry(&key, keyRid);
+		keyRid.slot_number = 0;
+		index.deleteEntry(&key, keyRid);
+		checkPassFail(index.lookup(&key, rids), 1)
+		checkPassFail(rids[0].slot_number, 1)
+		keyRid.slot_number = 1;
+		index.deleteEntry(&key, keyRid);
+
+		// put the odd keys back so the index file is as large as it gets
+		for (key = 1; key < numKeys; key += 2)
+		{
+			keyRid.page_number = key;
+			keyRid.slot_number = 0;
+			index.insertEntry(&key, keyRid);
+		}
+		checkPassFail(countScan(&index, 0, GTE, numKeys, LT, outOfOrder), numKeys - 1)
+	}
+	fullBytes = fileBytes(intIndexName);
+
+	{
+		// emptying and refilling the index reuses the freed pages instead of growing the file
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int outOfOrder = 0;
+		for (int key = 0; key < numKeys; key++)
+		{
+			if (key == 8)
+				continue;
+			RecordId keyRid;
+			keyRid.page_number = key;
+			keyRid.slot_number = 0;
+			index.deleteEntry(&key, keyRid);
+		}
+		checkPassFail(countScan(&index, 0, GTE, numKeys, LT, outOfOrder), 0)
+		for (int key = 0; key < numKeys; key++)
+		{
+			if (key == 8)
+				continue;
+			RecordId keyRid;
+			keyRid.page_number = key;
+			keyRid.slot_number = 0;
+			index.insertEntry(&key, keyRid);
+		}
+		checkPassFail(countScan(&index, 0, GTE, numKeys, LT, outOfOrder), numKeys - 1)
+		checkPassFail(outOfOrder, 0)
+	}
+	bool notGrown = fileBytes(intIndexName) <= fullBytes;
+	checkPassFail(notGrown, true)
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		char key[STRINGSIZE];
+		for (int i = 0; i < numKeys; i++)
+		{
+			RecordId keyRid;
+			keyRid.page_number = i;
+			keyRid.slot_number = 0;
+			sprintf(key, "%05d string record", i);
+			index.insertEntry(key, keyRid);
+		}
+		for (int i = 0; i < numKeys; i++)
+		{
+			if (i % 3 == 0)
+				continue;
+			RecordId keyRid;
+			keyRid.page_number = i;
+			keyRid.slot_number = 0;
+			sprintf(key, "%05d string record", i);
+			index.deleteEntry(key, keyRid);
+		}
+		std::string lowVal = "00025";
+		std::string highVal = "00040";
+		checkPassFail(batchScan(&index, lowVal.c_str(), GT, highVal.c_str(), LT, 4), 5)
+		lowVal = "00000";
+		highVal = "99999";
+		checkPassFail(batchScan(&index, lowVal.c_str(), GTE, highVal.c_str(), LTE, 100), (numKeys + 2) / 3)
+	}
+
+	{
+		// a reused page that still has a stale frame takes that frame over and evicts no other page
+		const std::string staleName = "relA.stale";
+		{
+			BlobFile blob = BlobFile::create(staleName);
+			BufMgr pool(2);
+			PageId stalePage, otherPage;
+			Page* page;
+			pool.allocPage(&blob, stalePage, page);
+			pool.unPinPage(&blob, stalePage, true);
+			pool.allocPage(&blob, otherPage, page);
+			pool.unPinPage(&blob, otherPage, true);
+			pool.flushFile(&blob);
+
+			// free the page behind the pool's back, then read it as a reader that looked it up just before would
+			blob.deletePage(stalePage);
+			pool.readPage(&blob, stalePage, page);
+			pool.readPage(&blob, otherPage, page);
+			pool.unPinPage(&blob, otherPage, false);
+
+			pool.clearBufStats();
+			PageId reused;
+			pool.allocPage(&blob, reused, page);
+			checkPassFail(reused, stalePage)
+			pool.readPage(&blob, otherPage, page);
+			pool.unPinPage(&blob, otherPage, false);
+			checkPassFail(pool.getBufStats().diskreads, 0)
+
+			pool.unPinPage(&blob, reused, true);
+			pool.unPinPage(&blob, reused, false);
+			pool.flushFile(&blob);
+		}
+		File::remove(staleName);
+	}
+}
+
+void test8()
+{
+	// Index a column with few distinct values, whose entries go into posting lists
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Posting Lists" << std::endl;
+	createRelationRandom(0);
+	postingTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// postingTests
+// -----------------------------------------------------------------------------
+
+/*
+	RecordId of record i of a relation holding 50 records per page.
+*/
+static RecordId postingRid(int i)
+{
+	RecordId rid;
+	rid.page_number = i / 50 + 1;
+	rid.slot_number = i % 50;
+	rid.padding = 0;
+	return rid;
+}
+
+/*
+	Number of RecordIds in rids that do not come after the one before them.
+*/
+static int unordered(const std::vector<RecordId>& rids)
+{
+	int count = 0;
+	for (size_t i = 1; i < rids.size(); i++)
+	{
+		if (rids[i].page_number < rids[i - 1].page_number
+				|| (rids[i].page_number == rids[i - 1].page_number && rids[i].slot_number <= rids[i - 1].slot_number))
+			count++;
+	}
+	return count;
+}
+
+void postingTests()
+{
+	const int numKeys = 5;
+	const int numRecords = 20000;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+		// record i holds key i % numKeys
+		for (int i = 0; i < numRecords; i++)
+		{
+			int key = i % numKeys;
+			index.insertEntry(&key, postingRid(i));
+		}
+		std::vector<RecordId> rids;
+		int key = 3;
+		checkPassFail(index.lookup(&key, rids), numRecords / numKeys)
+		checkPassFail(unordered(rids), 0)
+		checkPassFail(rids[0].page_number, 1)
+		checkPassFail(rids[0].slot_number, 3)
+		int lowVal = 1;
+		int highVal = 3;
+		checkPassFail(batchScan(&index, &lowVal, GTE, &highVal, LTE, 1), 3 * numRecords / numKeys)
+		checkPassFail(batchScan(&index, &lowVal, GT, &highVal, LT, 999), numRecords / numKeys)
+
+		// the entries of a key are kept in RecordId order whatever order they come in
+		key = numKeys;
+		for (int i = 0; i < numRecords; i++)
+		{
+			index.insertEntry(&key, postingRid((i * 7919) % numRecords));
+		}
+		checkPassFail(index.lookup(&key, rids), numRecords)
+		checkPassFail(unordered(rids), 0)
+
+		// deletes take RecordIds out of the list until a single one is left
+		key = 2;
+		for (int i = 2; i < numRecords; i += numKeys)
+		{
+			if (i != 7 && i != 12)
+				index.deleteEntry(&key, postingRid(i));
+		}
+		checkPassFail(index.lookup(&key, rids), 2)
+		index.deleteEntry(&key, postingRid(7));
+		checkPassFail(index.lookup(&key, rids), 1)
+		bool kept = rids[0] == postingRid(12);
+		checkPassFail(kept, true)
+		bool thrown = false;
+		try
+		{
+			index.deleteEntry(&key, postingRid(7));
+		}
+		catch(const NoSuchKeyFoundException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		key = numKeys;
+		for (int i = 0; i < numRecords; i += 2)
+		{
+			index.deleteEntry(&key, postingRid(i));
+		}
+		checkPassFail(index.lookup(&key, rids), numRecords / 2)
+		checkPassFail(unordered(rids), 0)
+		kept = rids[0] == postingRid(1);
+		checkPassFail(kept, true)
+		lowVal = 0;
+		highVal = numKeys;
+		checkPassFail(batchScan(&index, &lowVal, GTE, &highVal, LTE, 64), numRecords * 4 / numKeys + 1 + numRecords / 2)
+	}
+
+	// a posting list stores most RecordIds in a byte or two instead of a 12 byte leaf entry
+	bool smaller = fileBytes(intIndexName) * 4 < (long)(numRecords * 2 * (sizeof(int) + sizeof(RecordId)));
+	checkPassFail(smaller, true)
+}
+
+void test9()
+{
+	// Look keys up in a tree with two levels of non-leaf nodes, which all fit into the node cache
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Node Cache" << std::endl;
+	createRelationForward();
+	nodeCacheTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// nodeCacheTests
+// -----------------------------------------------------------------------------
+
+void nodeCacheTests()
+{
+	const int numKeys = 600000;
+	const int step = 7;
+	std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	for (int i = relationSize; i < numKeys; i++)
+	{
+		RecordId rid;
+		rid.page_number = i / 100 + 1;
+		rid.slot_number = i % 100;
+		rid.padding = 0;
+		index.insertEntry(&i, rid);
+	}
+
+	index.clearNodeCacheStats();
+	std::vector<RecordId> rids;
+	int found = 0;
+	for (int i = 0; i < numKeys; i += step)
+	{
+		found += index.lookup(&i, rids);
+	}
+	checkPassFail(found, (numKeys + step - 1) / step)
+
+	// every lookup reaches one leaf through the buffer manager and finds all nodes above it in the cache,
+	// which the inserts filled
+	NodeCacheStats stats = index.getNodeCacheStats();
+	long leaves = stats.misses[0];
+	long levels = 0;
+	long innerHits = 0;
+	long innerMisses = 0;
+	for (int level = 1; level < NodeCacheStats::MAX_LEVELS; level++)
+	{
+		if (stats.hits[level] > 0)
+			levels++;
+		innerHits += stats.hits[level];
+		innerMisses += stats.misses[level];
+	}
+	checkPassFail(leaves, found)
+	checkPassFail(levels, 2)
+	checkPassFail(innerHits, 2 * found)
+	checkPassFail(innerMisses, 0)
+	bool withinBudget = stats.pages > 1 && stats.pages <= stats.budget;
+	checkPassFail(withinBudget, true)
+}
+
+void test10()
+{
+	// Probe the integer and string indexes with many keys at once, as an index nested loop join does
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Multi-Key Lookups" << std::endl;
+	createRelationRandom(relationSize);
+	lookupManyTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	try
+	{
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// lookupManyTests
+// -----------------------------------------------------------------------------
+
+/*
+	Number of keys whose entries lookupMany returned differently from lookup.
+*/
+static int lookupManyMismatches(BTreeIndex& index, const std::vector<const void*>& keys,
+		const std::vector<RecordId>& rids, const std::vector<int>& offsets)
+{
+	int mismatches = 0;
+	std::vector<RecordId> single;
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		index.lookup(keys[i], single);
+		std::vector<RecordId> many(rids.begin() + offsets[i], rids.begin() + offsets[i + 1]);
+		if (many != single)
+			mismatches++;
+	}
+	return mismatches;
+}
+
+void lookupManyTests()
+{
+	// keys from below to above the relation, some of them twice in a row
+	std::vector<int> intKeys;
+	for (int key = -10; key < relationSize + 10; key += 3)
+	{
+		intKeys.push_back(key);
+		if (key % 9 == 0)
+			intKeys.push_back(key);
+	}
+	std::vector<const void*> keys;
+	for (size_t i = 0; i < intKeys.size(); i++)
+		keys.push_back(&intKeys[i]);
+	int expected = 0;
+	for (size_t i = 0; i < intKeys.size(); i++)
+	{
+		if (intKeys[i] >= 0 && intKeys[i] < relationSize)
+			expected++;
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::vector<RecordId> rids;
+		std::vector<int> offsets;
+		index.clearNodeCacheStats();
+		int found = index.lookupMany(keys.data(), keys.size(), rids, offsets);
+		long descents = index.getNodeCacheStats().misses[0];
+		checkPassFail(found, expected)
+		checkPassFail(offsets.size(), keys.size() + 1)
+		checkPassFail(lookupManyMismatches(index, keys, rids, offsets), 0)
+
+		// sorted keys only descend again once they pass the end of a leaf
+		bool fewDescents = descents * 20 < (long)keys.size();
+		checkPassFail(fewDescents, true)
+
+		// keys in any other order are found all the same
+		std::reverse(keys.begin(), keys.end());
+		checkPassFail(index.lookupMany(keys.data(), keys.size(), rids, offsets), expected)
+		checkPassFail(lookupManyMismatches(index, keys, rids, offsets), 0)
+		checkPassFail(index.lookupMany(keys.data(), 0, rids, offsets), 0)
+		checkPassFail(offsets.size(), 1)
+	}
+
+	std::vector<std::string> stringKeys;
+	for (int key = -10; key < relationSize + 10; key += 7)
+	{
+		char buffer[STRINGSIZE];
+		sprintf(buffer, "%05d string record", key < 0 ? 0 : key);
+		stringKeys.push_back(buffer);
+	}
+	keys.clear();
+	for (size_t i = 0; i < stringKeys.size(); i++)
+		keys.push_back(stringKeys[i].c_str());
+	expected = 0;
+	for (int key = -10; key < relationSize + 10; key += 7)
+	{
+		if (key < relationSize)
+			expected++;
+	}
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		std::vector<RecordId> rids;
+		std::vector<int> offsets;
+		checkPassFail(index.lookupMany(keys.data(), keys.size(), rids, offsets), expected)
+		checkPassFail(lookupManyMismatches(index, keys, rids, offsets), 0)
+	}
+}
+
+void test11()
+{
+	// Scan the integer and string indexes from the high bound down
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Descending Scans" << std::endl;
+	createRelationRandom(relationSize);
+	reverseScanTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	try
+	{
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// reverseScanTests
+// -----------------------------------------------------------------------------
+
+/*
+	Every RecordId a cursor returns, fetched batchSize at a time. Deletes the cursor.
+*/
+static std::vector<RecordId> drainCursor(IndexScanCursor* cursor, int batchSize)
+{
+	std::vector<RecordId> rids;
+	std::vector<RecordId> batch(batchSize);
+	int got;
+	while ((got = cursor->scanNextBatch(batch.data(), batchSize)) > 0)
+		rids.insert(rids.end(), batch.begin(), batch.begin() + got);
+	delete cursor;
+	return rids;
+}
+
+/*
+	Number of places where descending differs from ascending read backwards.
+*/
+static int reverseMismatches(const std::vector<RecordId>& ascending, const std::vector<RecordId>& descending)
+{
+	if (ascending.size() != descending.size())
+		return std::max(ascending.size(), descending.size());
+	int mismatches = 0;
+	for (size_t i = 0; i < ascending.size(); i++)
+	{
+		if (!(ascending[i] == descending[descending.size() - 1 - i]))
+			mismatches++;
+	}
+	return mismatches;
+}
+
+void reverseScanTests()
+{
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int lowVal = 0;
+		int highVal = relationSize;
+		std::vector<RecordId> ascending = drainCursor(index.openScan(&lowVal, GTE, &highVal, LT), 64);
+		checkPassFail((int)ascending.size(), relationSize)
+		checkPassFail(reverseMismatches(ascending, drainCursor(index.openReverseScan(&lowVal, GTE, &highVal, LT), 64)), 0)
+
+		// open and closed bounds, in batches that end in the middle of leaves
+		int bounds[][2] = {{-5, 3}, {100, 200}, {1234, 4321}, {4990, 5010}};
+		Operator lowOps[] = {GT, GTE};
+		Operator highOps[] = {LT, LTE};
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 2; j++)
+			{
+				std::vector<RecordId> forward = drainCursor(index.openScan(&bounds[i][0], lowOps[j], &bounds[i][1], highOps[j]), 7);
+				std::vector<RecordId> backward = drainCursor(index.openReverseScan(&bounds[i][0], lowOps[j], &bounds[i][1], highOps[j]), 7);
+				checkPassFail(reverseMismatches(forward, backward), 0)
+			}
+		}
+
+		// the largest keys come first, after a single descent to the last leaf
+		index.clearNodeCacheStats();
+		IndexScanCursor* cursor = index.openReverseScan(&lowVal, GTE, &highVal, LT);
+		RecordId top[10];
+		int got = cursor->scanNextBatch(top, 10);
+		delete cursor;
+		long descents = index.getNodeCacheStats().misses[0];
+		checkPassFail(got, 10)
+		checkPassFail(descents, 1)
+		bool largest = true;
+		for (int i = 0; i < 10; i++)
+			largest = largest && top[i] == ascending[relationSize - 1 - i];
+		checkPassFail(largest, true)
+
+		// the built-in scan goes down as well
+		lowVal = 100;
+		highVal = 200;
+		index.startReverseScan(&lowVal, GT, &highVal, LTE);
+		int count = 0;
+		bool inOrder = true;
+		try
+		{
+			RecordId scanRid;
+			while (1)
+			{
+				index.scanNext(scanRid);
+				inOrder = inOrder && scanRid == ascending[highVal - count];
+				count++;
+			}
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+		}
+		index.endScan();
+		checkPassFail(count, 100)
+		checkPassFail(inOrder, true)
+
+		lowVal = relationSize;
+		highVal = relationSize + 10;
+		bool thrown = false;
+		try
+		{
+			index.openReverseScan(&lowVal, GTE, &highVal, LTE);
+		}
+		catch(const NoSuchKeyFoundException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+
+		// deleting what the scan returned merges the leaves under it
+		lowVal = 0;
+		highVal = relationSize;
+		cursor = index.openReverseScan(&lowVal, GTE, &highVal, LT);
+		std::vector<RecordId> returned;
+		RecordId batch[25];
+		while ((got = cursor->scanNextBatch(batch, 25)) > 0)
+		{
+			for (int i = 0; i < got; i++)
+			{
+				int key = relationSize - 1 - returned.size();
+				index.deleteEntry(&key, ascending[key]);
+				returned.push_back(batch[i]);
+			}
+		}
+		delete cursor;
+		checkPassFail(reverseMismatches(ascending, returned), 0)
+
+		// a long run of one key sits in a posting list, which is returned from its largest RecordId down
+		const int numDuplicates = 3000;
+		int key = 7;
+		for (int i = 0; i < numDuplicates; i++)
+			index.insertEntry(&key, postingRid((i * 7919) % numDuplicates));
+		for (key = 0; key <= 20; key++)
+			index.insertEntry(&key, postingRid(numDuplicates + key));
+		lowVal = 0;
+		highVal = 20;
+		std::vector<RecordId> forward = drainCursor(index.openScan(&lowVal, GTE, &highVal, LTE), 64);
+		checkPassFail((int)forward.size(), numDuplicates + 21)
+		checkPassFail(reverseMismatches(forward, drainCursor(index.openReverseScan(&lowVal, GTE, &highVal, LTE), 7)), 0)
+		lowVal = 7;
+		highVal = 7;
+		std::vector<RecordId> rids;
+		key = 7;
+		index.lookup(&key, rids);
+		checkPassFail(reverseMismatches(rids, drainCursor(index.openReverseScan(&lowVal, GTE, &highVal, LTE), 100)), 0)
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		std::vector<RecordId> ascending = drainCursor(index.openScan("00000", GTE, "99999", LTE), 64);
+		checkPassFail((int)ascending.size(), relationSize)
+		checkPassFail(reverseMismatches(ascending, drainCursor(index.openReverseScan("00000", GTE, "99999", LTE), 64)), 0)
+
+		const char* bounds[][2] = {{"00010", "00035"}, {"00996", "01001"}, {"03000", "04000"},
+				{"01234 string record", "01234 string record"}};
+		for (int i = 0; i < 4; i++)
+		{
+			Operator lowOp = i == 3 ? GTE : GT;
+			Operator highOp = i == 3 ? LTE : LT;
+			std::vector<RecordId> forward = drainCursor(index.openScan(bounds[i][0], lowOp, bounds[i][1], highOp), 7);
+			std::vector<RecordId> backward = drainCursor(index.openReverseScan(bounds[i][0], lowOp, bounds[i][1], highOp), 7);
+			checkPassFail(reverseMismatches(forward, backward), 0)
+		}
+
+		IndexScanCursor* cursor = index.openReverseScan("00000", GTE, "99999", LTE);
+		RecordId top[5];
+		int got = cursor->scanNextBatch(top, 5);
+		delete cursor;
+		bool largest = got == 5;
+		for (int i = 0; i < got; i++)
+			largest = largest && top[i] == ascending[relationSize - 1 - i];
+		checkPassFail(largest, true)
+	}
+}
+
+void test12()
+{
+	// Scan several ranges and IN lists of the integer and string indexes on one cursor
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Multi-Range Scans" << std::endl;
+	createRelationRandom(relationSize);
+	multiScanTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	try
+	{
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// multiScanTests
+// -----------------------------------------------------------------------------
+
+/*
+	Range of a multi-range scan.
+*/
+static ScanRange scanRange(const void* lowVal, Operator lowOp, const void* highVal, Operator highOp)
+{
+	ScanRange range;
+	range.lowVal = lowVal;
+	range.lowOp = lowOp;
+	range.highVal = highVal;
+	range.highOp = highOp;
+	return range;
+}
+
+void multiScanTests()
+{
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+		// out of order, overlapping, empty and past the end of the relation
+		int bounds[] = {100, 200, 10, 20, 150, 250, 4990, 6000, 30, 31, 251, 260};
+		std::vector<ScanRange> ranges;
+		ranges.push_back(scanRange(&bounds[0], GT, &bounds[1], LT));
+		ranges.push_back(scanRange(&bounds[2], GTE, &bounds[3], LTE));
+		ranges.push_back(scanRange(&bounds[4], GTE, &bounds[5], LTE));
+		ranges.push_back(scanRange(&bounds[6], GTE, &bounds[7], LT));
+		ranges.push_back(scanRange(&bounds[8], GT, &bounds[9], LT));
+		ranges.push_back(scanRange(&bounds[10], GTE, &bounds[11], LT));
+		std::vector<RecordId> rids = drainCursor(index.openMultiScan(ranges.data(), ranges.size()), 7);
+		checkPassFail((int)rids.size(), 11 + 159 + 10)
+
+		// the ranges come out in key order, each entry once
+		int lowVal = 10;
+		int highVal = 5000;
+		std::vector<RecordId> all = drainCursor(index.openScan(&lowVal, GTE, &highVal, LT), 64);
+		std::vector<RecordId> expected(all.begin(), all.begin() + 11);
+		expected.insert(expected.end(), all.begin() + 91, all.begin() + 250);
+		expected.insert(expected.end(), all.end() - 10, all.end());
+		bool same = rids == expected;
+		checkPassFail(same, true)
+
+		// an IN list of every tenth key only descends again past the end of a leaf
+		std::vector<int> keys;
+		for (int key = 0; key < relationSize; key += 10)
+			keys.push_back(key);
+		ranges.clear();
+		for (size_t i = 0; i < keys.size(); i++)
+			ranges.push_back(scanRange(&keys[i], GTE, &keys[i], LTE));
+		index.clearNodeCacheStats();
+		IndexScanCursor* cursor = index.openMultiScan(ranges.data(), ranges.size());
+		rids = drainCursor(cursor, 64);
+		long descents = index.getNodeCacheStats().misses[0];
+		checkPassFail((int)rids.size(), relationSize / 10)
+		bool fewDescents = descents * 20 < (long)keys.size();
+		checkPassFail(fewDescents, true)
+		std::vector<RecordId> single;
+		int key = 4990;
+		index.lookup(&key, single);
+		same = rids.back() == single[0];
+		checkPassFail(same, true)
+
+		// no range matches
+		lowVal = relationSize;
+		highVal = relationSize + 5;
+		ranges.clear();
+		ranges.push_back(scanRange(&lowVal, GTE, &highVal, LTE));
+		ranges.push_back(scanRange(&lowVal, GT, &lowVal, LT));
+		checkPassFail((int)drainCursor(index.openMultiScan(ranges.data(), ranges.size()), 8).size(), 0)
+		checkPassFail((int)drainCursor(index.openMultiScan(ranges.data(), 0), 8).size(), 0)
+
+		bool thrown = false;
+		ranges[1] = scanRange(&highVal, GTE, &lowVal, LTE);
+		try
+		{
+			index.openMultiScan(ranges.data(), ranges.size());
+		}
+		catch(const BadScanrangeException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		thrown = false;
+		ranges[1] = scanRange(&lowVal, LTE, &highVal, LTE);
+		try
+		{
+			index.openMultiScan(ranges.data(), ranges.size());
+		}
+		catch(const BadOpcodesException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		std::vector<ScanRange> ranges;
+		ranges.push_back(scanRange("00300", GT, "00400", LT));
+		ranges.push_back(scanRange("00010", GT, "00035", LT));
+		ranges.push_back(scanRange("00350", GTE, "00450", LT));
+		ranges.push_back(scanRange("01234 string record", GTE, "01234 string record", LTE));
+		ranges.push_back(scanRange("01234 string record", GT, "01234 string record", LT));
+		std::vector<RecordId> rids = drainCursor(index.openMultiScan(ranges.data(), ranges.size()), 7);
+		checkPassFail((int)rids.size(), 25 + 150 + 1)
+
+		std::vector<RecordId> expected = drainCursor(index.openScan("00010", GT, "00035", LT), 64);
+		std::vector<RecordId> more = drainCursor(index.openScan("00300", GT, "00450", LT), 64);
+		expected.insert(expected.end(), more.begin(), more.end());
+		more = drainCursor(index.openScan("01234", GT, "01235", LT), 64);
+		expected.insert(expected.end(), more.begin(), more.end());
+		bool same = rids == expected;
+		checkPassFail(same, true)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// countScan
+// -----------------------------------------------------------------------------
+
+/*
+	Count the entries of a scan over an index whose rids hold the key as page number, without reading
+	the relation, adding to outOfOrder every rid that does not come strictly after the previous one.
+*/
+int countScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int& outOfOrder)
+{
+	RecordId scanRid;
+	int numResults = 0;
+	int last = -1;
+	try
+	{
+		index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+		return 0;
+	}
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+		if ((int)scanRid.page_number <= last)
+			outOfOrder++;
+		last = scanRid.page_number;
+		numResults++;
+	}
+	index->endScan();
+	return numResults;
+}
+
+void test13()
+{
+	// Count ranges of the integer index from subtree counts while inserts and deletes split and merge nodes
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Subtree Counts" << std::endl;
+	createRelationRandom(relationSize);
+	countTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	try
+	{
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// countTests
+// -----------------------------------------------------------------------------
+
+/*
+	Number of ranges out of a fixed set whose countRange differs from what a scan of the range finds.
+*/
+static int countMismatches(BTreeIndex& index)
+{
+	int bounds[][2] = {{-5, 3}, {0, 4999}, {7, 7}, {100, 200}, {1234, 4321}, {4990, 5010},
+			{0, 400000}, {150000, 150000}, {99999, 312345}, {-100, -1}};
+	Operator lowOps[] = {GT, GTE};
+	Operator highOps[] = {LT, LTE};
+	int mismatches = 0;
+	for (size_t i = 0; i < sizeof(bounds) / sizeof(bounds[0]); i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			long counted = index.countRange(&bounds[i][0], lowOps[j], &bounds[i][1], highOps[1 - j]);
+			if (counted != batchScan(&index, &bounds[i][0], lowOps[j], &bounds[i][1], highOps[1 - j], 256))
+				mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+void countTests()
+{
+	const int numKeys = 400000;
+	const int numDuplicates = 2000;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+		// without counts the leaves of the range are walked
+		checkPassFail(countMismatches(index), 0)
+		bool enabled = index.enableSubtreeCounts();
+		checkPassFail(enabled, true)
+		checkPassFail(countMismatches(index), 0)
+
+		// inserts split leaves and non-leaf nodes up to two levels above the leaves, and a long run
+		// of one key goes into a posting list that counts with all its entries
+		for (int i = relationSize; i < numKeys; i++)
+			index.insertEntry(&i, postingRid(i));
+		int key = 7;
+		for (int i = 0; i < numDuplicates; i++)
+			index.insertEntry(&key, postingRid(numKeys + i));
+		checkPassFail(countMismatches(index), 0)
+		int lowVal = 7;
+		long count = index.countRange(&lowVal, GTE, &key, LTE);
+		checkPassFail(count, numDuplicates + 1)
+
+		// deletes merge and even out nodes, and take entries out of the posting list
+		for (int i = relationSize; i < numKeys; i++)
+		{
+			if (i % 5 != 0 || i > numKeys / 2)
+				index.deleteEntry(&i, postingRid(i));
+		}
+		for (int i = 0; i < numDuplicates; i += 2)
+			index.deleteEntry(&key, postingRid(numKeys + i));
+		checkPassFail(countMismatches(index), 0)
+		count = index.countRange(&lowVal, GTE, &key, LTE);
+		checkPassFail(count, numDuplicates / 2 + 1)
+
+		// a range the keys leave out counts nothing, an inverted one throws
+		lowVal = numKeys;
+		int highVal = numKeys + 10;
+		checkPassFail(index.countRange(&lowVal, GTE, &highVal, LTE), 0)
+		checkPassFail(index.countRange(&lowVal, GT, &lowVal, LT), 0)
+		bool thrown = false;
+		try
+		{
+			index.countRange(&highVal, GTE, &lowVal, LTE);
+		}
+		catch(const BadScanrangeException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		thrown = false;
+		try
+		{
+			index.countRange(&lowVal, LT, &highVal, LTE);
+		}
+		catch(const BadOpcodesException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+
+		// the estimate of the whole index is exact, that of a part within a few percent
+		lowVal = INT_MIN;
+		highVal = INT_MAX;
+		double all = index.estimateSelectivity(&lowVal, GTE, &highVal, LTE);
+		bool whole = all > 0.999 && all <= 1.0;
+		checkPassFail(whole, true)
+		long total = index.countRange(&lowVal, GTE, &highVal, LTE);
+		lowVal = relationSize;
+		highVal = numKeys / 2;
+		double part = index.estimateSelectivity(&lowVal, GTE, &highVal, LTE);
+		double actual = (double)index.countRange(&lowVal, GTE, &highVal, LTE) / total;
+		bool close = part > actual - 0.05 && part < actual + 0.05;
+		checkPassFail(close, true)
+	}
+
+	{
+		// the counts are kept in the index file and stay on once it is opened again
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(countMismatches(index), 0)
+		int key = 7;
+		index.insertEntry(&key, postingRid(numKeys + numDuplicates));
+		checkPassFail(index.countRange(&key, GTE, &key, LTE), numDuplicates / 2 + 2)
+		bool enabled = index.enableSubtreeCounts();
+		checkPassFail(enabled, true)
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		bool enabled = index.enableSubtreeCounts();
+		checkPassFail(enabled, false)
+		const char* bounds[][2] = {{"00010", "00035"}, {"00996", "01001"}, {"03000", "04000"},
+				{"01234 string record", "01234 string record"}, {"00000", "99999"}};
+		bool same = true;
+		for (int i = 0; i < 5; i++)
+		{
+			long counted = index.countRange(bounds[i][0], GTE, bounds[i][1], LTE);
+			same = same && counted == batchScan(&index, bounds[i][0], GTE, bounds[i][1], LTE, 64);
+			counted = index.countRange(bounds[i][0], GT, bounds[i][1], LT);
+			same = same && counted == batchScan(&index, bounds[i][0], GT, bounds[i][1], LT, 64);
+		}
+		checkPassFail(same, true)
+		double all = index.estimateSelectivity("00000", GTE, "99999", LTE);
+		bool whole = all > 0.999 && all <= 1.0;
+		checkPassFail(whole, true)
+	}
+}
+
+void test14()
+{
+	// Read the included columns of a covering integer index from its leaves and posting lists while inserts
+	// and deletes split and merge them
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Covering Index" << std::endl;
+	createRelationRandom(relationSize);
+	coveringTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// coveringTests
+// -----------------------------------------------------------------------------
+
+/*
+	Payload of the covering index of coveringTests: the key, and the d column of the record. Entries inserted
+	by the tests themselves put coveredTag(rid) in place of d.
+*/
+struct CoveredPayload {
+	int i;
+	double d;
+};
+
+static double coveredTag(const RecordId& rid)
+{
+	return 1000000.0 + rid.page_number * 1000.0 + rid.slot_number;
+}
+
+/*
+	Whether payload belongs to the entry (key, rid): records of the relation have d equal to their key.
+*/
+static bool coveredMatches(int key, const RecordId& rid, const char* payload)
+{
+	CoveredPayload p;
+	memcpy(&p.i, payload, sizeof(int));
+	memcpy(&p.d, payload + sizeof(int), sizeof(double));
+	return p.i == key && (p.d == key || p.d == coveredTag(rid));
+}
+
+/*
+	Scans [lowVal, highVal] in batches with payloads, up or down. Returns the number of entries found and
+	adds those whose payload does not belong to them, or whose key is out of order, to mismatches.
+*/
+static int coveredScan(BTreeIndex& index, int lowVal, int highVal, bool descending, int& mismatches)
+{
+	IndexScanCursor* cursor = descending ? index.openReverseScan(&lowVal, GTE, &highVal, LTE)
+			: index.openScan(&lowVal, GTE, &highVal, LTE);
+	const int payloadSize = index.getPayloadSize();
+	RecordId rids[64];
+	std::vector<char> payloads(64 * payloadSize);
+	int count = 0;
+	int last = descending ? highVal : lowVal;
+	int got;
+	while ((got = cursor->scanNextBatch(rids, payloads.data(), 64)) > 0)
+	{
+		for (int j = 0; j < got; j++)
+		{
+			const char* payload = payloads.data() + j * payloadSize;
+			int key;
+			memcpy(&key, payload, sizeof(int));
+			if ((descending ? key > last : key < last) || !coveredMatches(key, rids[j], payload))
+				mismatches++;
+			last = key;
+		}
+		count += got;
+	}
+	delete cursor;
+	return count;
+}
+
+void coveringTests()
+{
+	const int numKeys = 60000;
+	const int numDuplicates = 3000;
+	std::vector<IncludedColumn> included(2);
+	included[0].byteOffset = offsetof(tuple,i);
+	included[0].length = sizeof(int);
+	included[1].byteOffset = offsetof(tuple,d);
+	included[1].length = sizeof(double);
+	{
+		std::cout << "Create a covering B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, included);
+		checkPassFail(index.getPayloadSize(), (int)(sizeof(int) + sizeof(double)))
+
+		// every record comes with its own columns
+		int mismatches = 0;
+		checkPassFail(coveredScan(index, 0, relationSize, false, mismatches), relationSize)
+		checkPassFail(coveredScan(index, 100, 2000, true, mismatches), 1901)
+		checkPassFail(mismatches, 0)
+		int key = 1234;
+		std::vector<RecordId> rids;
+		std::vector<char> payloads;
+		checkPassFail(index.lookup(&key, rids, payloads), 1)
+		bool matches = (int)payloads.size() == index.getPayloadSize() && coveredMatches(key, rids[0], payloads.data());
+		checkPassFail(matches, true)
+
+		// inserts split leaves and gather a long run of one key into a posting list, payloads and all;
+		// an entry inserted without payload gets zeros
+		for (int i = relationSize; i < numKeys; i++)
+		{
+			CoveredPayload p = {i, coveredTag(postingRid(i))};
+			char payload[sizeof(int) + sizeof(double)];
+			memcpy(payload, &p.i, sizeof(int));
+			memcpy(payload + sizeof(int), &p.d, sizeof(double));
+			index.insertEntry(&i, postingRid(i), payload);
+		}
+		key = 7;
+		for (int i = 0; i < numDuplicates; i++)
+		{
+			RecordId rid = postingRid(numKeys + i);
+			CoveredPayload p = {key, coveredTag(rid)};
+			char payload[sizeof(int) + sizeof(double)];
+			memcpy(payload, &p.i, sizeof(int));
+			memcpy(payload + sizeof(int), &p.d, sizeof(double));
+			index.insertEntry(&key, rid, payload);
+		}
+		key = -1;
+		index.insertEntry(&key, postingRid(0));
+		checkPassFail(index.lookup(&key, rids, payloads), 1)
+		bool zeros = std::count(payloads.begin(), payloads.end(), 0) == (long)payloads.size();
+		checkPassFail(zeros, true)
+
+		key = 7;
+		checkPassFail(index.lookup(&key, rids, payloads), numDuplicates + 1)
+		for (size_t i = 0; i < rids.size(); i++)
+		{
+			if (!coveredMatches(key, rids[i], payloads.data() + i * index.getPayloadSize()))
+				mismatches++;
+		}
+		checkPassFail(coveredScan(index, 0, numKeys, false, mismatches), numKeys + numDuplicates)
+		checkPassFail(coveredScan(index, 0, numKeys, true, mismatches), numKeys + numDuplicates)
+		checkPassFail(mismatches, 0)
+
+		// deletes merge and even out leaves, and take entries out of the posting list until it turns back
+		// into a plain entry
+		for (int i = relationSize; i < numKeys; i++)
+		{
+			if (i % 7 != 0)
+				index.deleteEntry(&i, postingRid(i));
+		}
+		for (int i = 0; i < numDuplicates; i++)
+			index.deleteEntry(&key, postingRid(numKeys + i));
+		int remaining = relationSize + (numKeys - 1) / 7 - (relationSize - 1) / 7;
+		checkPassFail(coveredScan(index, 0, numKeys, false, mismatches), remaining)
+		checkPassFail(coveredScan(index, 0, numKeys, true, mismatches), remaining)
+		checkPassFail(index.lookup(&key, rids, payloads), 1)
+		matches = coveredMatches(key, rids[0], payloads.data());
+		checkPassFail(matches, true)
+		checkPassFail(mismatches, 0)
+	}
+
+	{
+		// the included columns are kept in the index file, which only opens with the same ones
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, included);
+		int mismatches = 0;
+		coveredScan(index, 0, relationSize, false, mismatches);
+		checkPassFail(mismatches, 0)
+	}
+	bool thrown = false;
+	try
+	{
+		std::vector<IncludedColumn> other(1, included[1]);
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, other);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+
+	// string indexes take no included columns, and a payload must fit next to its RecordId
+	thrown = false;
+	try
+	{
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, included);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	thrown = false;
+	try
+	{
+		std::vector<IncludedColumn> wide(1);
+		wide[0].byteOffset = offsetof(tuple,s);
+		wide[0].length = MAXPAYLOADSIZE + 1;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, wide);
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+void test15()
+{
+	// Fetch the records of index ranges in heap order, reading each page of the relation once
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Bitmap Heap Scan" << std::endl;
+	createRelationRandom(relationSize);
+	bitmapScanTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// bitmapScanTests
+// -----------------------------------------------------------------------------
+
+/*
+	Runs a bitmap heap scan of [lowVal, highVal] to the end. Returns the number of records it found and adds
+	those out of the range, found twice, or out of heap order to mismatches; outPages is set to the number of
+	heap pages it read, and to 0 if it read a page more than once.
+*/
+static int bitmapScan(BTreeIndex& index, int lowVal, Operator lowOp, int highVal, Operator highOp, int& mismatches,
+		int& outPages)
+{
+	BitmapHeapScan scan(relationName, bufMgr, &index, &lowVal, lowOp, &highVal, highOp);
+	std::vector<bool> seen(relationSize, false);
+	int count = 0;
+	int pages = 0;
+	RecordId last;
+	try
+	{
+		RecordId rid;
+		while (true)
+		{
+			scan.scanNext(rid);
+			std::string recordStr = scan.getRecord();
+			int key = *((int *)(recordStr.c_str() + offsetof(RECORD, i)));
+			bool inRange = (lowOp == GTE ? key >= lowVal : key > lowVal) && (highOp == LTE ? key <= highVal : key < highVal);
+			if (!inRange || seen[key])
+				mismatches++;
+			else
+				seen[key] = true;
+			if (count > 0 && (rid.page_number < last.page_number
+					|| (rid.page_number == last.page_number && rid.slot_number <= last.slot_number)))
+				mismatches++;
+			if (count == 0 || rid.page_number != last.page_number)
+				pages++;
+			last = rid;
+			count++;
+		}
+	}
+	catch(const EndOfFileException &e)
+	{
+	}
+	if (count != scan.getNumRecords())
+		mismatches++;
+	outPages = scan.getPagesRead() == pages ? pages : 0;
+	return count;
+}
+
+void bitmapScanTests()
+{
+	std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	int mismatches = 0;
+	int pages;
+
+	// a narrow range touches a few pages, the whole relation each of its pages once
+	checkPassFail(bitmapScan(index, 25, GT, 40, LT, mismatches, pages), 14)
+	bool fewPages = pages > 0 && pages <= 14;
+	checkPassFail(fewPages, true)
+	checkPassFail(bitmapScan(index, 0, GTE, relationSize, LT, mismatches, pages), relationSize)
+	int relationPages = 0;
+	for (FileIterator iter = file1->begin(); iter != file1->end(); ++iter)
+		relationPages++;
+	checkPassFail(pages, relationPages)
+	checkPassFail(bitmapScan(index, 1000, GTE, 1999, LTE, mismatches, pages), 1000)
+	checkPassFail(mismatches, 0)
+
+	// a range the keys leave out reads nothing, bad operators throw before the relation is read
+	checkPassFail(bitmapScan(index, relationSize, GTE, relationSize + 10, LTE, mismatches, pages), 0)
+	checkPassFail(pages, 0)
+	bool thrown = false;
+	try
+	{
+		int lowVal = 10;
+		int highVal = 20;
+		BitmapHeapScan scan(relationName, bufMgr, &index, &lowVal, LT, &highVal, LTE);
+	}
+	catch(const BadOpcodesException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+void test16()
+{
+	// Answer lookups of absent keys from the Bloom filter, without reaching a leaf
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Bloom Filter" << std::endl;
+	createRelationRandom(relationSize);
+	bloomFilterTests();
+	try
+	{
+		File::remove(intIndexName);
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// bloomFilterTests
+// -----------------------------------------------------------------------------
+
+/*
+	Looks up every key in [lowVal, highVal). Returns the number of keys found with exactly one entry; outLeaves is
+	set to the number of leaves the lookups reached.
+*/
+static int bloomLookups(BTreeIndex& index, int lowVal, int highVal, long& outLeaves)
+{
+	std::vector<RecordId> rids;
+	int found = 0;
+	index.clearNodeCacheStats();
+	for (int key = lowVal; key < highVal; key++)
+	{
+		if (index.lookup(&key, rids) == 1)
+			found++;
+	}
+	outLeaves = index.getNodeCacheStats().misses[0];
+	return found;
+}
+
+void bloomFilterTests()
+{
+	long leaves;
+	std::uint64_t bits;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((int)index.getBloomFilterBits(), 0)
+		index.enableBloomFilter();
+		bits = index.getBloomFilterBits();
+		bool sized = bits >= (std::uint64_t)relationSize * BLOOMBITSPERKEY;
+		checkPassFail(sized, true)
+
+		// every key present is found, nearly every absent one is turned away before the descent
+		checkPassFail(bloomLookups(index, 0, relationSize, leaves), relationSize)
+		checkPassFail(bloomLookups(index, relationSize, relationSize + 1000, leaves), 0)
+		bool fewLeaves = leaves < 50;
+		checkPassFail(fewLeaves, true)
+
+		// keys inserted after the filter was built are added to it
+		for (int key = relationSize; key < relationSize + 100; key++)
+		{
+			RecordId rid;
+			rid.page_number = 1;
+			rid.slot_number = key - relationSize;
+			index.insertEntry(&key, rid);
+		}
+		checkPassFail(bloomLookups(index, relationSize, relationSize + 100, leaves), 100)
+
+		// lookupMany skips the keys the filter rules out and still repeats the entries of duplicate keys
+		std::vector<int> intKeys;
+		for (int i = 0; i < 200; i++)
+		{
+			intKeys.push_back(i * 40);
+			intKeys.push_back(i * 40);
+			intKeys.push_back(-1 - i);
+		}
+		std::vector<const void*> keys;
+		int expected = 0;
+		for (size_t i = 0; i < intKeys.size(); i++)
+		{
+			keys.push_back(&intKeys[i]);
+			if (intKeys[i] >= 0 && intKeys[i] < relationSize + 100)
+				expected++;
+		}
+		std::vector<RecordId> rids;
+		std::vector<int> offsets;
+		checkPassFail(index.lookupMany(keys.data(), keys.size(), rids, offsets), expected)
+		checkPassFail(lookupManyMismatches(index, keys, rids, offsets), 0)
+	}
+
+	{
+		// the filter written on close is read back instead of being built again
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		bool sameBits = index.getBloomFilterBits() == bits;
+		checkPassFail(sameBits, true)
+		checkPassFail(bloomLookups(index, 0, relationSize + 100, leaves), relationSize + 100)
+		checkPassFail(bloomLookups(index, -1000, 0, leaves), 0)
+		bool fewLeaves = leaves < 50;
+		checkPassFail(fewLeaves, true)
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		index.enableBloomFilter();
+		std::vector<RecordId> rids;
+		char key[STRINGSIZE + 1];
+		int found = 0;
+		int absent = 0;
+		index.clearNodeCacheStats();
+		for (int i = 0; i < 1000; i++)
+		{
+			sprintf(key, "%05d string record", i);
+			found += index.lookup(key, rids);
+			sprintf(key, "x%04d", i);
+			absent += index.lookup(key, rids);
+		}
+		checkPassFail(found, 1000)
+		checkPassFail(absent, 0)
+		bool fewLeaves = index.getNodeCacheStats().misses[0] < 1050;
+		checkPassFail(fewLeaves, true)
+	}
+}
+
+void test17()
+{
+	// Buffer random inserts in memory and move them into the tree in key order
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Insert Buffer" << std::endl;
+	createRelationRandom(0);
+	insertBufferTests();
+	try
+	{
+		File::remove(intIndexName);
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// insertBufferTests
+// -----------------------------------------------------------------------------
+
+/*
+	Entries the insert buffer tests put in for a key: one with page number 2 * key + 1, and a second one with
+	the next page number for every tenth key, so page numbers grow in index order.
+*/
+static RecordId bufferedRid(int key, int second)
+{
+	RecordId rid;
+	rid.page_number = 2 * key + 1 + second;
+	rid.slot_number = 1;
+	return rid;
+}
+
+/*
+	Looks up every key in [0, numKeys) and returns how many do not find the entries bufferedRid made for them,
+	in order, leaving out the keys in [goneLow, goneHigh).
+*/
+static int bufferedMismatches(BTreeIndex& index, int numKeys, int goneLow, int goneHigh)
+{
+	int mismatches = 0;
+	std::vector<RecordId> rids;
+	for (int key = 0; key < numKeys; key++)
+	{
+		index.lookup(&key, rids);
+		std::vector<RecordId> expected;
+		if (key < goneLow || key >= goneHigh)
+		{
+			expected.push_back(bufferedRid(key, 0));
+			if (key % 10 == 0)
+				expected.push_back(bufferedRid(key, 1));
+		}
+		if (rids != expected)
+			mismatches++;
+	}
+	return mismatches;
+}
+
+void insertBufferTests()
+{
+	int expected = relationSize + relationSize / 10;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.enableInsertBuffer(1000), true)
+
+		// the keys in an order unrelated to theirs; a lookup finds the entries still buffered as well
+		std::vector<int> keys;
+		for (int i = 0; i < relationSize; i++)
+			keys.push_back((i * 7919) % relationSize);
+		for (int i = 0; i < relationSize; i++)
+		{
+			index.insertEntry(&keys[i], bufferedRid(keys[i], 0));
+			if (keys[i] % 10 == 0)
+				index.insertEntry(&keys[i], bufferedRid(keys[i], 1));
+		}
+		checkPassFail(bufferedMismatches(index, relationSize, 0, 0), 0)
+
+		// deletes find entries in the buffer and in the tree alike
+		index.flushInsertBuffer();
+		for (int key = 100; key < 150; key++)
+		{
+			index.deleteEntry(&key, bufferedRid(key, 0));
+			if (key % 10 == 0)
+				index.deleteEntry(&key, bufferedRid(key, 1));
+		}
+		for (int key = 100; key < 150; key++)
+		{
+			index.insertEntry(&key, bufferedRid(key, 0));
+			if (key % 10 == 0)
+				index.insertEntry(&key, bufferedRid(key, 1));
+		}
+		for (int key = 120; key < 150; key++)
+		{
+			index.deleteEntry(&key, bufferedRid(key, 0));
+			if (key % 10 == 0)
+				index.deleteEntry(&key, bufferedRid(key, 1));
+		}
+		expected -= 33;
+		checkPassFail(bufferedMismatches(index, relationSize, 120, 150), 0)
+
+		// scans and counts see every entry in order
+		for (int key = 120; key < 150; key++)
+			index.insertEntry(&key, bufferedRid(key, 0));
+		expected += 30;
+		int outOfOrder = 0;
+		checkPassFail(countScan(&index, 0, GTE, relationSize, LT, outOfOrder), expected)
+		checkPassFail(outOfOrder, 0)
+		int lowVal = 0;
+		checkPassFail((int)index.countRange(&lowVal, GTE, &relationSize, LT), expected)
+
+		// entries left in the buffer reach the tree when the index is closed
+		for (int key = relationSize; key < relationSize + 100; key++)
+			index.insertEntry(&key, bufferedRid(key, 0));
+		expected += 100;
+	}
+
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int outOfOrder = 0;
+		checkPassFail(countScan(&index, 0, GTE, relationSize + 100, LT, outOfOrder), expected)
+		checkPassFail(outOfOrder, 0)
+		std::vector<RecordId> rids;
+		int key = relationSize + 99;
+		checkPassFail(index.lookup(&key, rids), 1)
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		checkPassFail(index.enableInsertBuffer(), false)
+	}
+}
+
+void test18()
+{
+	// Search the cached non-leaf nodes through Eytzinger copies of their keys while inserts split their children
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Eytzinger Search" << std::endl;
+	createRelationRandom(relationSize);
+	eytzingerTests();
+	try
+	{
+		File::remove(intIndexName);
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// eytzingerTests
+// -----------------------------------------------------------------------------
+
+/*
+	Looks up every key in [lowVal, highVal) and returns how many of them do not find exactly one entry, plus the
+	number of entries found for keys just outside the range.
+*/
+static int eytzingerMismatches(BTreeIndex& index, int lowVal, int highVal)
+{
+	int mismatches = 0;
+	std::vector<RecordId> rids;
+	for (int key = lowVal; key < highVal; key++)
+	{
+		if (index.lookup(&key, rids) != 1)
+			mismatches++;
+	}
+	int below = lowVal - 1;
+	mismatches += index.lookup(&below, rids);
+	mismatches += index.lookup(&highVal, rids);
+	return mismatches;
+}
+
+void eytzingerTests()
+{
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.enableEytzingerSearch(), true)
+
+		// the first pass makes the copies, the second searches through them
+		checkPassFail(eytzingerMismatches(index, 0, relationSize), 0)
+		checkPassFail(eytzingerMismatches(index, 0, relationSize), 0)
+
+		// splits change the nodes above, whose copies are made again
+		int mismatches = 0;
+		for (int key = relationSize; key < relationSize * 5; key++)
+		{
+			RecordId rid;
+			rid.page_number = key + 1;
+			rid.slot_number = 1;
+			index.insertEntry(&key, rid);
+			if (key % 500 == 0)
+				mismatches += eytzingerMismatches(index, 0, key + 1);
+		}
+		checkPassFail(mismatches, 0)
+		checkPassFail(eytzingerMismatches(index, 0, relationSize * 5), 0)
+		int outOfOrder = 0;
+		checkPassFail(countScan(&index, relationSize, GTE, relationSize * 5, LT, outOfOrder), relationSize * 4)
+		checkPassFail(outOfOrder, 0)
+
+		// turned off, the nodes are searched directly again
+		index.enableEytzingerSearch(false);
+		checkPassFail(eytzingerMismatches(index, 0, relationSize * 5), 0)
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		checkPassFail(index.enableEytzingerSearch(), false)
+	}
+}
+
+void test19()
+{
+	// Jump straight to the leaf of a key through a model of the leaf level of an index loaded in key order
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Learned Model" << std::endl;
+	createRelationForward();
+	learnedModelTests();
+	try
+	{
+		File::remove(intIndexName);
+		File::remove(stringIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// learnedModelTests
+// -----------------------------------------------------------------------------
+
+void learnedModelTests()
+{
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int segments = index.enableLearnedModel();
+		bool fewSegments = segments >= 1 && segments <= 2;
+		checkPassFail(fewSegments, true)
+		checkPassFail(index.getLearnedSegments(), segments)
+
+		// every lookup goes straight to its leaf, without reading a non-leaf node
+		index.clearNodeCacheStats();
+		checkPassFail(eytzingerMismatches(index, -1000, relationSize), 0)
+		NodeCacheStats stats = index.getNodeCacheStats();
+		checkPassFail((int)(stats.hits[1] + stats.misses[1]), 0)
+		checkPassFail((int)stats.misses[0], relationSize + 1002)
+		int outOfOrder = 0;
+		checkPassFail(countScan(&index, 25, GT, 40, LT, outOfOrder), 14)
+		checkPassFail(countScan(&index, 0, GTE, relationSize, LT, outOfOrder), relationSize)
+
+		// the first leaf split drops the model, and descents start from the root again
+		for (int key = relationSize; key < relationSize * 2; key++)
+		{
+			RecordId rid;
+			rid.page_number = key + 1;
+			rid.slot_number = 1;
+			index.insertEntry(&key, rid);
+		}
+		checkPassFail(index.getLearnedSegments(), 0)
+		index.clearNodeCacheStats();
+		checkPassFail(eytzingerMismatches(index, -1000, relationSize * 2), 0)
+		stats = index.getNodeCacheStats();
+		bool descended = stats.hits[1] + stats.misses[1] > 0;
+		checkPassFail(descended, true)
+
+		// built again with no room for error, the model still finds every key
+		index.enableLearnedModel(0);
+		checkPassFail(eytzingerMismatches(index, -1000, relationSize * 2), 0)
+		checkPassFail(countScan(&index, 0, GTE, relationSize * 2, LT, outOfOrder), relationSize * 2)
+	}
+
+	{
+		std::cout << "Create a B+ Tree index on the string field" << std::endl;
+		BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+		checkPassFail(index.enableLearnedModel(), 0)
+	}
+}
+
+void test20()
+{
+	// Grow and shrink the tree by a level and reopen the index at the root the meta page keeps
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Root Info" << std::endl;
+	createRelationRandom(relationSize);
+	rootInfoTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+  catch(const FileNotFoundException &e)
+  {
+  }
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// rootInfoTests
+// -----------------------------------------------------------------------------
+
+/*
+	Reads the meta page of an index from the file, as a run that died without closing the index would
+	find it, and checks that it names a root at the level it gives.
+*/
+static bool metaPageOnDisk(const std::string& indexName, IndexMetaInfo& outInfo)
+{
+	BlobFile indexFile = BlobFile::open(indexName);
+	Page headerPage = indexFile.readPage(indexFile.getFirstPageNo());
+	memcpy(&outInfo, &headerPage, sizeof(IndexMetaInfo));
+	Page rootPage = indexFile.readPage(outInfo.rootPageNo);
+	return ((NonLeafNodeInt*)&rootPage)->level == outInfo.rootLevel;
+}
+
+void rootInfoTests()
+{
+	int lastKey = relationSize;
+	{
+		std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.getRootLevel(), 1)
+		checkPassFail((int)index.getRootEpoch(), 1)
+
+		// insert in key order until the root splits
+		while (index.getRootLevel() == 1 && lastKey < relationSize * 200)
+		{
+			for (int i = 0; i < 1000; i++, lastKey++)
+			{
+				RecordId rid;
+				rid.page_number = lastKey + 1;
+				rid.slot_number = 1;
+				index.insertEntry(&lastKey, rid);
+			}
+		}
+		checkPassFail(index.getRootLevel(), 2)
+		checkPassFail((int)index.getRootEpoch(), 2)
+
+		// the meta page on disk already names the new root, before the index is closed
+		IndexMetaInfo info;
+		checkPassFail(metaPageOnDisk(intIndexName, info), true)
+		checkPassFail(info.rootLevel, 2)
+		checkPassFail((int)info.rootEpoch, 2)
+	}
+
+	{
+		std::cout << "Reopen the B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.getRootLevel(), 2)
+		checkPassFail(eytzingerMismatches(index, 0, lastKey), 0)
+
+		// delete the inserted keys again until the root shrinks back to one level
+		int key = lastKey - 1;
+		while (index.getRootLevel() == 2 && key >= relationSize)
+		{
+			RecordId rid;
+			rid.page_number = key + 1;
+			rid.slot_number = 1;
+			index.deleteEntry(&key, rid);
+			key--;
+		}
+		lastKey = key + 1;
+		checkPassFail(index.getRootLevel(), 1)
+		checkPassFail((int)index.getRootEpoch(), 3)
+		IndexMetaInfo info;
+		checkPassFail(metaPageOnDisk(intIndexName, info), true)
+		checkPassFail((int)info.rootEpoch, 3)
+	}
+
+	{
+		std::cout << "Reopen the B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.getRootLevel(), 1)
+		checkPassFail((int)index.getRootEpoch(), 3)
+		checkPassFail(eytzingerMismatches(index, 0, lastKey), 0)
+	}
+}
+
+void test21()
+{
+	// Log the pages of an index and a heap file, copy the files as a crash would leave them and recover them
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Write-Ahead Log" << std::endl;
+	createRelationRandom(relationSize);
+	writeAheadLogTests();
+	const std::string names[] = {intIndexName, relationName + ".heap", relationName + ".log"};
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		try
+		{
+			File::remove(names[i]);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// writeAheadLogTests
+// -----------------------------------------------------------------------------
+
+/*
+	Copies a file byte for byte.
+*/
+static void copyFile(const std::string& from, const std::string& to)
+{
+	std::ifstream in(from.c_str(), std::ios::binary);
+	std::ofstream out(to.c_str(), std::ios::binary | std::ios::trunc);
+	out << in.rdbuf();
+}
+
+void writeAheadLogTests()
+{
+	const std::string heapName = relationName + ".heap";
+	const std::string logName = relationName + ".log";
+	const std::string crashed = ".crashed";
+	const std::string heapRecord = "a record the heap file only has in the log";
+	const std::string names[] = {intIndexName, heapName, logName};
+	const int numNames = sizeof(names) / sizeof(names[0]);
+	PageId heapPid;
+	RecordId heapRid;
+	LogStats stats;
+
+	{
+		LogMgr log(logName);
+		BufMgr* loggedBufMgr = new BufMgr(100, &log);
+		{
+			std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+			BTreeIndex index(relationName, intIndexName, loggedBufMgr, offsetof(tuple,i), INTEGER);
+			for (int key = relationSize; key < relationSize * 3; key++)
+			{
+				RecordId rid;
+				rid.page_number = key + 1;
+				rid.slot_number = 1;
+				index.insertEntry(&key, rid);
+			}
+			for (int key = relationSize * 2; key < relationSize * 3; key++)
+			{
+				RecordId rid;
+				rid.page_number = key + 1;
+				rid.slot_number = 1;
+				index.deleteEntry(&key, rid);
+			}
+
+			// a heap page changed through the pool carries the number of its last record
+			PageFile heap = PageFile::create(heapName);
+			Page* page;
+			loggedBufMgr->allocPage(&heap, heapPid, page);
+			heapRid = page->insertRecord(heapRecord);
+			loggedBufMgr->unPinPage(&heap, heapPid, true);
+			loggedBufMgr->readPage(&heap, heapPid, page);
+			bool numbered = page->lsn() > 0;
+			checkPassFail(numbered, true)
+			loggedBufMgr->unPinPage(&heap, heapPid, false);
+
+			// the crash: the files as they are on disk, with the log forced but pages still in the pool
+			log.flush();
+			for (int i = 0; i < numNames; i++)
+			{
+				copyFile(names[i], names[i] + crashed);
+			}
+			loggedBufMgr->flushFile(&heap);
+		}
+		delete loggedBufMgr;
+		stats = log.getStats();
+	}
+	bool logged = stats.records > 0;
+	checkPassFail(logged, true)
+
+	for (int i = 0; i < numNames; i++)
+	{
+		File::remove(names[i]);
+		std::rename((names[i] + crashed).c_str(), names[i].c_str());
+	}
+
+	{
+		LogMgr log(logName);
+		int pages = (int)log.recover();
+		bool redone = pages > 0;
+		checkPassFail(redone, true)
+		checkPassFail((int)log.getStats().pagesRedone, pages)
+		checkPassFail((int)log.recover(), 0)
+	}
+
+	{
+		std::cout << "Reopen the recovered B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(eytzingerMismatches(index, 0, relationSize * 2), 0)
+		int outOfOrder = 0;
+		checkPassFail(countScan(&index, relationSize, GTE, relationSize * 3, LT, outOfOrder), relationSize)
+		checkPassFail(outOfOrder, 0)
+
+		PageFile heap = PageFile::open(heapName);
+		Page page = heap.readPage(heapPid);
+		bool recovered = page.getRecord(heapRid) == heapRecord;
+		checkPassFail(recovered, true)
+	}
+}
+
+void test22()
+{
+	// Take checkpoints while an index changes, then recover it from the truncated log as a crash leaves it
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Checkpoints" << std::endl;
+	createRelationRandom(relationSize);
+	checkpointTests();
+	const std::string names[] = {intIndexName, relationName + ".log"};
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		try
+		{
+			File::remove(names[i]);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// checkpointTests
+// -----------------------------------------------------------------------------
+
+void checkpointTests()
+{
+	const std::string logName = relationName + ".log";
+	const std::string crashed = ".crashed";
+	const std::string names[] = {intIndexName, logName};
+	const int numNames = sizeof(names) / sizeof(names[0]);
+	const int removedKeys = 10;
+
+	{
+		LogMgr log(logName);
+		BufMgr* loggedBufMgr = new BufMgr(100, &log);
+		{
+			std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+			BTreeIndex index(relationName, intIndexName, loggedBufMgr, offsetof(tuple,i), INTEGER);
+			RecordId rid;
+			rid.slot_number = 1;
+			for (int key = relationSize; key < relationSize * 2; key++)
+			{
+				rid.page_number = key + 1;
+				index.insertEntry(&key, rid);
+			}
+			loggedBufMgr->checkpoint();
+			CheckpointStats first = loggedBufMgr->getCheckpointStats();
+			checkPassFail((int)first.checkpoints, 1)
+			checkPassFail((int)first.pagesWritten, 0)
+			bool tableKept = first.dirtyPages > 0;
+			checkPassFail(tableKept, true)
+
+			for (int key = relationSize * 2; key < relationSize * 3; key++)
+			{
+				rid.page_number = key + 1;
+				index.insertEntry(&key, rid);
+			}
+			loggedBufMgr->checkpoint();
+			CheckpointStats second = loggedBufMgr->getCheckpointStats();
+			checkPassFail((int)second.checkpoints, 2)
+
+			// the pages dirty since the first checkpoint were written, and the log starts after it
+			bool written = second.pagesWritten > 0 && second.bytesWritten > first.bytesWritten;
+			checkPassFail(written, true)
+			bool truncated = second.bytesTruncated > 0 && log.getBaseLsn() == second.redoLsn;
+			checkPassFail(truncated, true)
+			bool pastFirst = second.redoLsn > first.redoLsn;
+			checkPassFail(pastFirst, true)
+
+			// small changes to the last leaf, which only the records kept since the first checkpoint build up
+			for (int key = relationSize * 3 - removedKeys; key < relationSize * 3; key++)
+			{
+				rid.page_number = key + 1;
+				index.deleteEntry(&key, rid);
+			}
+
+			// the crash: the files as they are on disk, with the log forced but pages still in the pool
+			log.flush();
+			for (int i = 0; i < numNames; i++)
+			{
+				copyFile(names[i], names[i] + crashed);
+			}
+		}
+		delete loggedBufMgr;
+	}
+
+	for (int i = 0; i < numNames; i++)
+	{
+		File::remove(names[i]);
+		std::rename((names[i] + crashed).c_str(), names[i].c_str());
+	}
+
+	{
+		LogMgr log(logName);
+		bool redone = log.recover() > 0;
+		checkPassFail(redone, true)
+	}
+
+	{
+		std::cout << "Reopen the recovered B+ Tree index on the integer field" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(eytzingerMismatches(index, 0, relationSize * 3 - removedKeys), 0)
+		int outOfOrder = 0;
+		checkPassFail(countScan(&index, relationSize, GTE, relationSize * 3, LT, outOfOrder), relationSize * 2 - removedKeys)
+		checkPassFail(outOfOrder, 0)
+	}
+}
+
+void test23()
+{
+	// Checksum a heap page, tear it on disk and read it back in each checksum mode
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Page Checksums" << std::endl;
+	pageChecksumTests();
+	try
+	{
+		File::remove(relationName + ".heap");
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+}
+
+// -----------------------------------------------------------------------------
+// pageChecksumTests
+// -----------------------------------------------------------------------------
+
+/*
+	Returns true if reading the page straight from the file finds it torn.
+*/
+static bool fileReadCatches(PageFile& file, PageId pageNo)
+{
+	try
+	{
+		file.readPage(pageNo);
+	}
+	catch(const PageChecksumException &e)
+	{
+		return true;
+	}
+	return false;
+}
+
+/*
+	Returns true if reading the page into the buffer pool finds it torn.
+*/
+static bool poolReadCatches(PageFile& file, PageId pageNo)
+{
+	Page* page;
+	try
+	{
+		bufMgr->readPage(&file, pageNo, page);
+	}
+	catch(const PageChecksumException &e)
+	{
+		return true;
+	}
+	bufMgr->unPinPage(&file, pageNo, false);
+	bufMgr->flushFile(&file);
+	return false;
+}
+
+void pageChecksumTests()
+{
+	// the check value of CRC32C, whole and in two pieces
+	const char digits[] = "123456789";
+	const std::uint32_t checkValue = 0xE3069283;
+	std::uint32_t whole = Crc32c::extend(0, digits, 9);
+	std::uint32_t pieces = Crc32c::extend(Crc32c::extend(0, digits, 4), digits + 4, 5);
+	std::uint32_t software = Crc32c::extendSoftware(0, digits, 9);
+	checkPassFail(whole, checkValue)
+	checkPassFail(pieces, checkValue)
+	checkPassFail(software, checkValue)
+
+	// the instruction and the tables agree whatever the length and alignment
+	std::vector<char> bytes(Page::SIZE + 8);
+	for (size_t i = 0; i < bytes.size(); i++)
+	{
+		bytes[i] = (char)(i * 131 + i / 7);
+	}
+	const size_t lengths[] = {0, 1, 7, 8, 9, 63, Page::SIZE};
+	int disagreements = 0;
+	for (int offset = 0; offset < 8; offset++)
+	{
+		for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+		{
+			if (Crc32c::extend(0, &bytes[offset], lengths[i]) != Crc32c::extendSoftware(0, &bytes[offset], lengths[i]))
+				disagreements++;
+		}
+	}
+	checkPassFail(disagreements, 0)
+
+	const std::string heapName = relationName + ".heap";
+	const std::string record = "a record whose page is torn on disk";
+	PageId pageNo;
+	RecordId rid;
+	{
+		PageFile heap = PageFile::create(heapName);
+		Page page = heap.allocatePage(pageNo);
+		rid = page.insertRecord(record);
+		heap.writePage(pageNo, page);
+		bool intact = heap.readPage(pageNo).getRecord(rid) == record;
+		checkPassFail(intact, true)
+	}
+
+	// flip the last byte of the page, which holds the record
+	{
+		std::fstream stream(heapName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		std::streampos last = sizeof(FileHeader) + (std::streamoff)pageNo * Page::SIZE - 1;
+		char byte;
+		stream.seekg(last);
+		stream.read(&byte, 1);
+		byte = ~byte;
+		stream.seekp(last);
+		stream.write(&byte, 1);
+	}
+
+	PageFile heap = PageFile::open(heapName);
+	std::cout << "Verify on every read of the file" << std::endl;
+	checkPassFail(fileReadCatches(heap, pageNo), true)
+	checkPassFail(poolReadCatches(heap, pageNo), true)
+
+	std::cout << "Verify on reads into the buffer pool only" << std::endl;
+	PageFile::setChecksumMode(CHECKSUM_ON_POOL_READ);
+	checkPassFail(fileReadCatches(heap, pageNo), false)
+	checkPassFail(poolReadCatches(heap, pageNo), true)
+
+	std::cout << "Verify on no read" << std::endl;
+	PageFile::setChecksumMode(CHECKSUM_OFF);
+	checkPassFail(fileReadCatches(heap, pageNo), false)
+	checkPassFail(poolReadCatches(heap, pageNo), false)
+
+	// writing the page again gives it a checksum of what it holds now
+	heap.writePage(pageNo, heap.readPage(pageNo));
+	PageFile::setChecksumMode(CHECKSUM_ON_READ);
+	checkPassFail(fileReadCatches(heap, pageNo), false)
+	checkPassFail(poolReadCatches(heap, pageNo), false)
+}
+
+void test24()
+{
+	// Store a relation in a compressed file next to a plain copy, compare them and index the compressed one
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Compressed Files" << std::endl;
+	compressedFileTests();
+	const std::string names[] = {intIndexName, relationName + ".plain", relationName + ".torn"};
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		try
+		{
+			File::remove(names[i]);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// compressedFileTests
+// -----------------------------------------------------------------------------
+
+/*
+	Returns the records of a page in slot order.
+*/
+static std::vector<std::string> pageRecords(Page& page)
+{
+	std::vector<std::string> records;
+	for (PageIterator it = page.begin(); it != page.end(); ++it)
+	{
+		records.push_back(*it);
+	}
+	return records;
+}
+
+void compressedFileTests()
+{
+	const std::string plainName = relationName + ".plain";
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	// the records of the other tests, space padded, in a compressed file and in a plain one
+	file1 = new PageFile(relationName, true, FORMAT_COMPRESSED);
+	checkPassFail(file1->format(), FORMAT_COMPRESSED)
+	{
+		PageFile plain = PageFile::create(plainName);
+		memset(record1.s, ' ', sizeof(record1.s));
+		PageId packedNo;
+		PageId plainNo;
+		Page packedPage = file1->allocatePage(packedNo);
+		Page plainPage = plain.allocatePage(plainNo);
+		for (int i = 0; i < relationSize; i++)
+		{
+			sprintf(record1.s, "%05d string record", i);
+			record1.i = i;
+			record1.d = (double)i;
+			std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+			if (!packedPage.hasSpaceForRecord(new_data))
+			{
+				file1->writePage(packedNo, packedPage);
+				plain.writePage(plainNo, plainPage);
+				packedPage = file1->allocatePage(packedNo);
+				plainPage = plain.allocatePage(plainNo);
+			}
+			packedPage.insertRecord(new_data);
+			plainPage.insertRecord(new_data);
+		}
+		file1->writePage(packedNo, packedPage);
+		plain.writePage(plainNo, plainPage);
+	}
+	long packedBytes = fileBytes(relationName);
+	bool smaller = packedBytes * 2 < fileBytes(plainName);
+	checkPassFail(smaller, true)
+
+	// both files hold the same pages, read back page by page
+	{
+		PageFile packed = PageFile::open(relationName);
+		checkPassFail(packed.format(), FORMAT_COMPRESSED)
+		PageFile plain = PageFile::open(plainName);
+		checkPassFail(plain.format(), FORMAT_PLAIN)
+		int pages = 0;
+		int mismatches = 0;
+		FileIterator plainIt = plain.begin();
+		for (FileIterator packedIt = packed.begin(); packedIt != packed.end(); ++packedIt, ++plainIt)
+		{
+			Page packedPage = *packedIt;
+			Page plainPage = *plainIt;
+			if (pageRecords(packedPage) != pageRecords(plainPage))
+				mismatches++;
+			pages++;
+		}
+		bool plainDone = plainIt == plain.end();
+		checkPassFail(plainDone, true)
+		checkPassFail(pages, (int)plain.getNumPages() - 1)
+		checkPassFail(mismatches, 0)
+	}
+
+	// the used list keeps track of its last page as pages are freed and reused, so appends still link up
+	{
+		const std::string listName = relationName + ".list";
+		{
+			PageFile list = PageFile::create(listName, FORMAT_COMPRESSED);
+			PageId pageNo;
+			for (int p = 0; p < 4; p++)
+				list.allocatePage(pageNo);
+			list.deletePage(4);
+			list.deletePage(2);
+			for (int p = 0; p < 3; p++)
+				list.allocatePage(pageNo);
+			checkPassFail(pageNo, 5)
+		}
+		PageFile list = PageFile::open(listName);
+		std::vector<PageId> used;
+		for (FileIterator it = list.begin(); it != list.end(); ++it)
+			used.push_back((*it).page_number());
+		const PageId expected[] = {1, 2, 3, 4, 5};
+		bool linked = used == std::vector<PageId>(expected, expected + 5);
+		checkPassFail(linked, true)
+	}
+	File::remove(relationName + ".list");
+
+	// strings that no longer compress outgrow the extent of their page, which moves to the end of the file
+	{
+		PageId first = file1->getFirstPageNo();
+		Page page = file1->readPage(first);
+		unsigned int noise = 12345;
+		for (PageIterator it = page.begin(); it != page.end(); ++it)
+		{
+			RECORD record;
+			std::string data = *it;
+			memcpy(&record, data.data(), sizeof(record));
+			for (size_t c = 0; c < sizeof(record.s); c++)
+			{
+				noise = noise * 1103515245 + 12345;
+				record.s[c] = (char)(noise >> 16);
+			}
+			page.updateRecord(it.getCurrentRecord(), std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+		}
+		file1->writePage(first, page);
+		bool moved = fileBytes(relationName) > packedBytes;
+		checkPassFail(moved, true)
+		Page again = file1->readPage(first);
+		bool kept = pageRecords(again) == pageRecords(page);
+		checkPassFail(kept, true)
+	}
+
+	// a garbled page map entry is refused before anything is read through it
+	{
+		const std::string tornName = relationName + ".torn";
+		PageId pageNo;
+		{
+			PageFile torn = PageFile::create(tornName, FORMAT_COMPRESSED);
+			Page page = torn.allocatePage(pageNo);
+			page.insertRecord("a record whose extent is garbled");
+			torn.writePage(pageNo, page);
+		}
+		// the first map block sits where the compressed header after the FileHeader says, past its end field
+		std::uint64_t block;
+		std::streampos entry;
+		std::uint64_t original[2];
+		{
+			std::fstream stream(tornName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			stream.seekg(sizeof(FileHeader) + sizeof(std::uint64_t));
+			stream.read(reinterpret_cast<char*>(&block), sizeof(block));
+			entry = block + (std::streamoff)(pageNo - 1) * sizeof(original);
+			stream.seekg(entry);
+			stream.read(reinterpret_cast<char*>(original), sizeof(original));
+		}
+		// offset, then length and capacity packed in the second word
+		const std::uint64_t garbled[][2] = {
+			{original[0], original[1] | 0xffffffffull},
+			{original[0], original[1] & ~0xffffffffull},
+			{original[0] + (1ull << 40), original[1]}};
+		for (size_t g = 0; g < sizeof(garbled) / sizeof(garbled[0]); g++)
+		{
+			{
+				std::fstream stream(tornName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+				stream.seekp(entry);
+				stream.write(reinterpret_cast<const char*>(garbled[g]), sizeof(garbled[g]));
+			}
+			PageFile torn = PageFile::open(tornName);
+			checkPassFail(fileReadCatches(torn, pageNo), true)
+		}
+		{
+			std::fstream stream(tornName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			stream.seekp(entry);
+			stream.write(reinterpret_cast<const char*>(original), sizeof(original));
+		}
+		PageFile torn = PageFile::open(tornName);
+		checkPassFail(fileReadCatches(torn, pageNo), false)
+	}
+
+	// the buffer pool and the index read the compressed relation like any other
+	{
+		std::cout << "Create a B+ Tree index on the integer field of the compressed relation" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(eytzingerMismatches(index, 0, relationSize), 0)
+	}
+}
+
+void test25()
+{
+	// Store a relation in PAX pages, read it back by rows and by columns and index it
+	std::cout << "--------------------" << std::endl;
+	std::cout << "PAX Pages" << std::endl;
+	paxPageTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// paxPageTests
+// -----------------------------------------------------------------------------
+
+void paxPageTests()
+{
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	std::vector<PaxAttribute> schema(3);
+	schema[0].offset = offsetof(tuple, i);
+	schema[0].length = sizeof(int);
+	schema[1].offset = offsetof(tuple, d);
+	schema[1].length = sizeof(double);
+	schema[2].offset = offsetof(tuple, s);
+	schema[2].length = sizeof(record1.s);
+
+	// without slots or padding, more records fit on a PAX page than on a slotted one
+	{
+		memset(&record1, 0, sizeof(record1));
+		std::string data(reinterpret_cast<char*>(&record1), sizeof(record1));
+		Page slotted;
+		Page pax;
+		pax.formatPax(schema, sizeof(RECORD));
+		checkPassFail(pax.layout(), LAYOUT_PAX)
+		checkPassFail(slotted.layout(), LAYOUT_SLOTTED)
+		int slottedRecords = 0;
+		while (slotted.hasSpaceForRecord(data))
+		{
+			slotted.insertRecord(data);
+			slottedRecords++;
+		}
+		int paxRecords = 0;
+		while (pax.hasSpaceForRecord(data))
+		{
+			pax.insertRecord(data);
+			paxRecords++;
+		}
+		bool denser = paxRecords > slottedRecords;
+		checkPassFail(denser, true)
+		checkPassFail((int)pax.getNumRecords(), paxRecords)
+		bool full = pax.getFreeSpace() < sizeof(RECORD);
+		checkPassFail(full, true)
+		bool aligned = reinterpret_cast<std::uintptr_t>(pax.getColumn(1)) % 8 == 0;
+		checkPassFail(aligned, true)
+	}
+
+	file1 = new PageFile(relationName, true);
+	{
+		PageId pageNo;
+		Page page = file1->allocatePage(pageNo);
+		page.formatPax(schema, sizeof(RECORD));
+		for (int i = 0; i < relationSize; i++)
+		{
+			memset(&record1, 0, sizeof(record1));
+			sprintf(record1.s, "%05d string record", i);
+			record1.i = i;
+			record1.d = (double)i;
+			std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+			if (!page.hasSpaceForRecord(new_data))
+			{
+				file1->writePage(pageNo, page);
+				page = file1->allocatePage(pageNo);
+				page.formatPax(schema, sizeof(RECORD));
+			}
+			page.insertRecord(new_data);
+		}
+		file1->writePage(pageNo, page);
+	}
+
+	// the records read back whole through FileScan
+	{
+		FileScan fscan(relationName, bufMgr);
+		int count = 0;
+		int mismatches = 0;
+		try
+		{
+			RecordId scanRid;
+			while (1)
+			{
+				fscan.scanNext(scanRid);
+				std::string recordStr = fscan.getRecord();
+				RECORD expected;
+				memset(&expected, 0, sizeof(expected));
+				sprintf(expected.s, "%05d string record", count);
+				expected.i = count;
+				expected.d = (double)count;
+				if (recordStr != std::string(reinterpret_cast<char*>(&expected), sizeof(expected)))
+					mismatches++;
+				count++;
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		checkPassFail(count, relationSize)
+		checkPassFail(mismatches, 0)
+	}
+
+	// and by columns through ColumnScan, the value j of a page belonging to its slot j + 1
+	{
+		std::vector<int> attributes;
+		attributes.push_back(1);
+		attributes.push_back(0);
+		ColumnScan cscan(relationName, bufMgr, attributes);
+		long long sum = 0;
+		int count = 0;
+		int mismatches = 0;
+		try
+		{
+			std::vector<const char*> columns;
+			while (1)
+			{
+				SlotId records = cscan.scanNext(columns);
+				const double* d = reinterpret_cast<const double*>(columns[0]);
+				const int* keys = reinterpret_cast<const int*>(columns[1]);
+				for (SlotId j = 0; j < records; j++)
+				{
+					sum += keys[j];
+					if (d[j] != (double)keys[j] || keys[j] != count)
+						mismatches++;
+					count++;
+				}
+				Page page = file1->readPage(cscan.getPageNumber());
+				RecordId last = {cscan.getPageNumber(), records};
+				RECORD record;
+				std::string data = page.getRecord(last);
+				memcpy(&record, data.data(), sizeof(record));
+				if (record.i != keys[records - 1])
+					mismatches++;
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		checkPassFail(count, relationSize)
+		checkPassFail(mismatches, 0)
+		bool summed = sum == (long long)relationSize * (relationSize - 1) / 2;
+		checkPassFail(summed, true)
+	}
+
+	// attributes the pages do not have are refused
+	{
+		std::vector<int> attributes(1, 3);
+		ColumnScan cscan(relationName, bufMgr, attributes);
+		bool refused = false;
+		try
+		{
+			std::vector<const char*> columns;
+			cscan.scanNext(columns);
+		}
+		catch(const BadScanParamException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+	}
+
+	// records are updated in place, but not deleted
+	{
+		PageId first = file1->getFirstPageNo();
+		Page page = file1->readPage(first);
+		RecordId rid = {first, 2};
+		RECORD record;
+		std::string data = page.getRecord(rid);
+		memcpy(&record, data.data(), sizeof(record));
+		record.d = -1;
+		page.updateRecord(rid, std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+		bool updated = page.getRecord(rid) == std::string(reinterpret_cast<char*>(&record), sizeof(record));
+		checkPassFail(updated, true)
+		int records = page.getNumRecords();
+		bool refused = false;
+		try
+		{
+			page.deleteRecord(rid);
+		}
+		catch(const InvalidRecordException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+		checkPassFail((int)page.getNumRecords(), records)
+
+		// records of another length are malformed, not too big for the space left
+		const std::string shorter(sizeof(RECORD) - 1, 'x');
+		bool updateRefused = false;
+		try
+		{
+			page.updateRecord(rid, shorter);
+		}
+		catch(const InvalidRecordException &e)
+		{
+			updateRefused = true;
+		}
+		checkPassFail(updateRefused, true)
+		Page empty;
+		empty.formatPax(schema, sizeof(RECORD));
+		bool insertRefused = false;
+		try
+		{
+			empty.insertRecord(shorter);
+		}
+		catch(const InvalidRecordException &e)
+		{
+			insertRefused = true;
+		}
+		checkPassFail(insertRefused, true)
+		checkPassFail((int)empty.getNumRecords(), 0)
+	}
+
+	// the index is built over the PAX relation through FileScan like over any other
+	{
+		std::cout << "Create a B+ Tree index on the integer field of the PAX relation" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(eytzingerMismatches(index, 0, relationSize), 0)
+	}
+}
+
+void test26()
+{
+	// Scan a relation with predicates on each type of attribute and compare with filtering every record
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Filtered FileScan" << std::endl;
+	createRelationRandom(relationSize);
+	filteredScanTests();
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// filteredScanTests
+// -----------------------------------------------------------------------------
+
+/*
+	RecordIds FileScan returns for a predicate, or for none if lowVal is null.
+*/
+static std::vector<RecordId> filteredRids(int offset, Datatype type, const void* lowVal, Operator lowOp,
+	const void* highVal, Operator highOp)
+{
+	std::vector<RecordId> rids;
+	FileScan fscan(relationName, bufMgr);
+	if (lowVal != NULL)
+		fscan.setPredicate(offset, type, lowVal, lowOp, highVal, highOp);
+	try
+	{
+		RecordId scanRid;
+		while (1)
+		{
+			fscan.scanNext(scanRid);
+			rids.push_back(scanRid);
+		}
+	}
+	catch(const EndOfFileException &e)
+	{
+	}
+	return rids;
+}
+
+/*
+	RecordIds of the records of the relation whose record satisfies test, in file order.
+*/
+template <class Test>
+static std::vector<RecordId> matchingRids(Test test)
+{
+	std::vector<RecordId> rids;
+	FileScan fscan(relationName, bufMgr);
+	try
+	{
+		RecordId scanRid;
+		while (1)
+		{
+			fscan.scanNext(scanRid);
+			RECORD record;
+			std::string data = fscan.getRecord();
+			memcpy(&record, data.data(), sizeof(record));
+			if (test(record))
+				rids.push_back(scanRid);
+		}
+	}
+	catch(const EndOfFileException &e)
+	{
+	}
+	return rids;
+}
+
+void filteredScanTests()
+{
+	// the vector paths of RangeFilter select what one value at a time does, tails included
+	{
+		std::vector<int> ints(203);
+		std::vector<double> doubles(203);
+		for (size_t i = 0; i < ints.size(); i++)
+		{
+			ints[i] = (int)(random() % 100) - 50;
+			doubles[i] = ints[i] / 4.0;
+		}
+		int mismatches = 0;
+		for (int count = 0; count <= (int)ints.size(); count += 29)
+		{
+			std::vector<std::uint16_t> expected(ints.size());
+			std::vector<std::uint16_t> got(ints.size());
+			int n = RangeFilter::selectIntScalar(ints.data(), count, -10, 20, expected.data(), 0, 0);
+			if (RangeFilter::selectInt(ints.data(), count, -10, 20, got.data()) != n ||
+				!std::equal(expected.begin(), expected.begin() + n, got.begin()))
+				mismatches++;
+#ifdef BADGERDB_RANGE_FILTER_SIMD
+			if (RangeFilter::selectIntSse2(ints.data(), count, -10, 20, got.data()) != n ||
+				!std::equal(expected.begin(), expected.begin() + n, got.begin()))
+				mismatches++;
+#endif
+			n = RangeFilter::selectDoubleScalar(doubles.data(), count, -2.5, 5.25, expected.data(), 0, 0);
+			if (RangeFilter::selectDouble(doubles.data(), count, -2.5, 5.25, got.data()) != n ||
+				!std::equal(expected.begin(), expected.begin() + n, got.begin()))
+				mismatches++;
+#ifdef BADGERDB_RANGE_FILTER_SIMD
+			if (RangeFilter::selectDoubleSse2(doubles.data(), count, -2.5, 5.25, got.data()) != n ||
+				!std::equal(expected.begin(), expected.begin() + n, got.begin()))
+				mismatches++;
+#endif
+		}
+		checkPassFail(mismatches, 0)
+	}
+
+	const int intBounds[][2] = {{25, 40}, {-3, 3}, {0, 0}, {3, 4}, {4990, 6000}, {-100, -1}};
+	const Operator ops[][2] = {{GT, LT}, {GTE, LTE}, {GT, LTE}, {GTE, LT}};
+	for (size_t b = 0; b < sizeof(intBounds) / sizeof(intBounds[0]); b++)
+	{
+		for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++)
+		{
+			int low = intBounds[b][0];
+			int high = intBounds[b][1];
+			Operator lowOp = ops[o][0];
+			Operator highOp = ops[o][1];
+			std::vector<RecordId> expected = matchingRids([&](const RECORD& r) {
+				return (r.i > low || (r.i == low && lowOp == GTE)) && (r.i < high || (r.i == high && highOp == LTE));
+			});
+			bool same = filteredRids(offsetof(tuple, i), INTEGER, &low, lowOp, &high, highOp) == expected;
+			checkPassFail(same, true)
+
+			double lowD = low - 0.5;
+			double highD = high;
+			expected = matchingRids([&](const RECORD& r) {
+				return (r.d > lowD || (r.d == lowD && lowOp == GTE)) && (r.d < highD || (r.d == highD && highOp == LTE));
+			});
+			same = filteredRids(offsetof(tuple, d), DOUBLE, &lowD, lowOp, &highD, highOp) == expected;
+			checkPassFail(same, true)
+		}
+	}
+	{
+		int low = 100;
+		int high = 199;
+		int found = filteredRids(offsetof(tuple, i), INTEGER, &low, GTE, &high, LTE).size();
+		checkPassFail(found, 100)
+	}
+
+	// STRING attributes compare as the index keys them
+	{
+		const char lowS[] = "00100";
+		const char highS[] = "00200";
+		std::vector<RecordId> expected = matchingRids([&](const RECORD& r) {
+			return strncmp(r.s, lowS, 5) >= 0 && strncmp(r.s, highS, 5) < 0;
+		});
+		bool same = filteredRids(offsetof(tuple, s), STRING, lowS, GTE, highS, LT) == expected;
+		checkPassFail(same, true)
+		checkPassFail((int)expected.size(), 100)
+	}
+
+	// some records go, leaving unused slots the predicate must skip
+	{
+		PageId first = file1->getFirstPageNo();
+		Page page = file1->readPage(first);
+		int removed = 0;
+		for (PageIterator it = page.begin(); it != page.end() && removed < 5; ++it, ++removed)
+		{
+			page.deleteRecord(it.getCurrentRecord());
+		}
+		file1->writePage(first, page);
+		int low = 0;
+		int high = relationSize;
+		int remaining = filteredRids(offsetof(tuple, i), INTEGER, &low, GTE, &high, LT).size();
+		checkPassFail(remaining, relationSize - 5)
+	}
+
+	// bad operators and ranges are refused as by BTreeIndex::startScan
+	{
+		int low = 5;
+		int high = 2;
+		FileScan fscan(relationName, bufMgr);
+		bool badOps = false;
+		try
+		{
+			fscan.setPredicate(offsetof(tuple, i), INTEGER, &high, LT, &low, LTE);
+		}
+		catch(const BadOpcodesException &e)
+		{
+			badOps = true;
+		}
+		checkPassFail(badOps, true)
+		bool badRange = false;
+		try
+		{
+			fscan.setPredicate(offsetof(tuple, i), INTEGER, &low, GT, &high, LT);
+		}
+		catch(const BadScanrangeException &e)
+		{
+			badRange = true;
+		}
+		checkPassFail(badRange, true)
+	}
+}
@@ -0,0 +1,326 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "eytzinger.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Hits and misses of a NodeCache, see NodeCache::getStats.
+ */
+struct NodeCacheStats {
+  /**
+   * Number of tree levels counted. Nodes on higher levels are counted with the highest one.
+   */
+  static const int MAX_LEVELS = 8;
+
+  /**
+   * Nodes found in the cache, by node level. Leaves (level 0) are never cached.
+   */
+  std::uint64_t hits[MAX_LEVELS];
+
+  /**
+   * Nodes read through the buffer manager, by node level. Level 0 counts the leaves descents reached.
+   */
+  std::uint64_t misses[MAX_LEVELS];
+
+  /**
+   * Number of nodes in the cache.
+   */
+  int pages;
+
+  /**
+   * Largest number of nodes the cache keeps.
+   */
+  int budget;
+};
+
+/**
+ * @brief Non-leaf nodes of one index that stay pinned in the buffer pool.
+ *
+ * A B+Tree descent reads the same few upper nodes over and over. The index keeps up to a fixed budget of
+ * them pinned for good and records their frames here, so a descent finds them without going through the
+ * buffer manager and they never compete with other pages for frames. Like LatchTable, the table is kept
+ * in chunks indexed by page number, so looking up a node never takes a lock.
+ *
+ * The cache holds one pin on each of its pages; the index hands that pin over in add and takes it back
+ * in remove. Readers that use a frame found here take no pin of their own, so they must validate the node
+ * version before trusting anything read from it.
+ */
+class NodeCache {
+ public:
+  /**
+   * Number of slots allocated together.
+   */
+  static const std::uint32_t CHUNK_SIZE = 1024;
+
+  /**
+   * Number of chunks, which bounds the number of pages an index file may have.
+   */
+  static const std::uint32_t MAX_CHUNKS = 16384;
+
+  /**
+   * Constructs an empty cache that keeps no nodes until setBudget is called.
+   */
+  NodeCache()
+      : pages_(0),
+        budget_(0) {
+    for (std::uint32_t i = 0; i < MAX_CHUNKS; i++) {
+      chunks_[i].store(nullptr, std::memory_order_relaxed);
+      keyChunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    clearStats();
+  }
+
+  /**
+   * Frees all chunks. The pins of cached pages must have been taken back with removeAll.
+   */
+  ~NodeCache() {
+    for (std::uint32_t i = 0; i < MAX_CHUNKS; i++) {
+      delete [] chunks_[i].load(std::memory_order_relaxed);
+      std::atomic<EytzingerKeys*>* keyChunk = keyChunks_[i].load(std::memory_order_relaxed);
+      for (std::uint32_t j = 0; keyChunk != nullptr && j < CHUNK_SIZE; j++) {
+        delete keyChunk[j].load(std::memory_order_relaxed);
+      }
+      delete [] keyChunk;
+    }
+  }
+
+  /**
+   * Sets the largest number of nodes the cache keeps. Nodes already cached stay.
+   *
+   * @param budget  Number of pages
+   */
+  void setBudget(const int budget) {
+    budget_.store(budget, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the frame of a cached page.
+   *
+   * @param pageNo  Page number in the index file
+   * @return  Frame of the page, or nullptr if it is not cached.
+   */
+  Page* get(const PageId pageNo) const {
+    assert(pageNo / CHUNK_SIZE < MAX_CHUNKS);
+    std::atomic<Page*>* chunk = chunks_[pageNo / CHUNK_SIZE].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    return chunk[pageNo % CHUNK_SIZE].load(std::memory_order_acquire);
+  }
+
+  /**
+   * Caches a pinned page if the budget allows. On success the cache owns the caller's pin.
+   *
+   * @param pageNo  Page number in the index file
+   * @param page    Frame the page is pinned in
+   * @return  True if the page was cached, false if the cache is full or already holds the page.
+   */
+  bool add(const PageId pageNo, Page* page) {
+    if (pages_.fetch_add(1, std::memory_order_relaxed) >= budget_.load(std::memory_order_relaxed)) {
+      pages_.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+    Page* expected = nullptr;
+    if (!slot(pageNo).compare_exchange_strong(expected, page, std::memory_order_release)) {
+      pages_.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Drops a page from the cache. On success the caller owns the pin the cache held.
+   *
+   * @param pageNo  Page number in the index file
+   * @return  True if the page was cached.
+   */
+  bool remove(const PageId pageNo) {
+    if (get(pageNo) == nullptr || slot(pageNo).exchange(nullptr, std::memory_order_acq_rel) == nullptr) {
+      return false;
+    }
+    pages_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * Drops every page from the cache. The caller owns the pins the cache held.
+   *
+   * @param outPages  Page numbers of the dropped pages are appended to this
+   */
+  void removeAll(std::vector<PageId>& outPages) {
+    for (std::uint32_t i = 0; i < MAX_CHUNKS; i++) {
+      std::atomic<Page*>* chunk = chunks_[i].load(std::memory_order_acquire);
+      for (std::uint32_t j = 0; chunk != nullptr && j < CHUNK_SIZE; j++) {
+        if (chunk[j].exchange(nullptr, std::memory_order_acq_rel) != nullptr) {
+          pages_.fetch_sub(1, std::memory_order_relaxed);
+          outPages.push_back(i * CHUNK_SIZE + j);
+        }
+      }
+    }
+  }
+
+  /**
+   * Returns the Eytzinger copy of the keys of a page, making an empty one the first time. A copy stays
+   * until the cache is destroyed, also after its page left the cache, so a reader never finds it freed.
+   *
+   * @param pageNo    Page number in the index file
+   * @param capacity  Largest number of keys of the node, used when the copy is made
+   */
+  EytzingerKeys& keys(const PageId pageNo, const int capacity) {
+    assert(pageNo / CHUNK_SIZE < MAX_CHUNKS);
+    std::atomic<std::atomic<EytzingerKeys*>*>& chunkSlot = keyChunks_[pageNo / CHUNK_SIZE];
+    std::atomic<EytzingerKeys*>* chunk = chunkSlot.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      std::atomic<EytzingerKeys*>* fresh = new std::atomic<EytzingerKeys*>[CHUNK_SIZE];
+      for (std::uint32_t i = 0; i < CHUNK_SIZE; i++) {
+        fresh[i].store(nullptr, std::memory_order_relaxed);
+      }
+      if (chunkSlot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+        chunk = fresh;
+      } else {
+        delete [] fresh;
+      }
+    }
+    std::atomic<EytzingerKeys*>& keySlot = chunk[pageNo % CHUNK_SIZE];
+    EytzingerKeys* copy = keySlot.load(std::memory_order_acquire);
+    if (copy == nullptr) {
+      EytzingerKeys* fresh = new EytzingerKeys(capacity);
+      if (keySlot.compare_exchange_strong(copy, fresh, std::memory_order_acq_rel)) {
+        copy = fresh;
+      } else {
+        delete fresh;
+      }
+    }
+    return *copy;
+  }
+
+  /**
+   * Counts one node a descent went through.
+   *
+   * @param level  Level of the node, 0 for a leaf
+   * @param hit    The node was found in the cache
+   */
+  void count(const int level, const bool hit) {
+    Stripe& stripe = stripes_[stripeIndex()];
+    int i = level < NodeCacheStats::MAX_LEVELS ? level : NodeCacheStats::MAX_LEVELS - 1;
+    (hit ? stripe.hits[i] : stripe.misses[i]).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the counts since the cache was made or clearStats was last called.
+   */
+  NodeCacheStats getStats() const {
+    NodeCacheStats stats;
+    for (int i = 0; i < NodeCacheStats::MAX_LEVELS; i++) {
+      stats.hits[i] = 0;
+      stats.misses[i] = 0;
+      for (int s = 0; s < STRIPES; s++) {
+        stats.hits[i] += stripes_[s].hits[i].load(std::memory_order_relaxed);
+        stats.misses[i] += stripes_[s].misses[i].load(std::memory_order_relaxed);
+      }
+    }
+    stats.pages = pages_.load(std::memory_order_relaxed);
+    stats.budget = budget_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /**
+   * Resets all hit and miss counts to zero.
+   */
+  void clearStats() {
+    for (int s = 0; s < STRIPES; s++) {
+      for (int i = 0; i < NodeCacheStats::MAX_LEVELS; i++) {
+        stripes_[s].hits[i].store(0, std::memory_order_relaxed);
+        stripes_[s].misses[i].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  /**
+   * Number of copies of the counters. Every descent counts the root, so threads count into copies of
+   * their own instead of all bouncing the same cache line.
+   */
+  static const int STRIPES = 16;
+
+  /**
+   * One copy of the counters, aligned so that no two copies share a cache line.
+   */
+  struct alignas(64) Stripe {
+    std::atomic<std::uint64_t> hits[NodeCacheStats::MAX_LEVELS];
+    std::atomic<std::uint64_t> misses[NodeCacheStats::MAX_LEVELS];
+  };
+
+  /**
+   * Returns the copy of the counters the calling thread uses.
+   */
+  static int stripeIndex() {
+    static std::atomic<int> nextStripe(0);
+    thread_local int stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+    return stripe;
+  }
+
+  /**
+   * Returns the slot of a page, allocating its chunk if needed.
+   */
+  std::atomic<Page*>& slot(const PageId pageNo) {
+    assert(pageNo / CHUNK_SIZE < MAX_CHUNKS);
+    std::atomic<std::atomic<Page*>*>& chunkSlot = chunks_[pageNo / CHUNK_SIZE];
+    std::atomic<Page*>* chunk = chunkSlot.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      std::atomic<Page*>* fresh = new std::atomic<Page*>[CHUNK_SIZE];
+      for (std::uint32_t i = 0; i < CHUNK_SIZE; i++) {
+        fresh[i].store(nullptr, std::memory_order_relaxed);
+      }
+      if (chunkSlot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+        chunk = fresh;
+      } else {
+        // another thread allocated the chunk first, chunk now holds its pointer
+        delete [] fresh;
+      }
+    }
+    return chunk[pageNo % CHUNK_SIZE];
+  }
+
+  /**
+   * Chunks of slots, nullptr until first used. A slot holds the frame of a cached page or nullptr.
+   */
+  std::atomic<std::atomic<Page*>*> chunks_[MAX_CHUNKS];
+
+  /**
+   * Chunks of Eytzinger copies, laid out like chunks_. A slot holds the copy of a page or nullptr.
+   */
+  std::atomic<std::atomic<EytzingerKeys*>*> keyChunks_[MAX_CHUNKS];
+
+  /**
+   * Number of cached pages.
+   */
+  std::atomic<int> pages_;
+
+  /**
+   * Largest number of pages to cache.
+   */
+  std::atomic<int> budget_;
+
+  /**
+   * Hit and miss counters.
+   */
+  Stripe stripes_[STRIPES];
+};
+
+}
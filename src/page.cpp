@@ -14,6 +14,7 @@
 #include "exceptions/slot_in_use_exception.h"
 #include "page_iterator.h"
 #include "page.h"
+#include "crc32c.h"
 #include "string.h"
 
 namespace badgerdb {
@@ -29,15 +30,161 @@ void Page::initialize() {
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
+  header_.lsn = 0;
+  header_.checksum = 0;
+  header_.layout = LAYOUT_SLOTTED;
   //data_.assign(DATA_SIZE, char());
 	memset(data_, '\0', DATA_SIZE);
 }
 
+std::uint32_t Page::computeChecksum(const PageHeader& header) const {
+  // the bytes of the header as they go to disk, padding included
+  char bytes[sizeof(PageHeader)];
+  memcpy(bytes, &header, sizeof(PageHeader));
+  memset(bytes + offsetof(PageHeader, checksum), 0, sizeof(header.checksum));
+  return Crc32c::extend(Crc32c::extend(0, bytes, sizeof(bytes)), data_, DATA_SIZE);
+}
+
+void Page::formatPax(const std::vector<PaxAttribute>& attributes,
+                     const std::uint16_t record_length) {
+  const PageId page_number = header_.current_page_number;
+  const PageId next_page_number = header_.next_page_number;
+  const Lsn lsn = header_.lsn;
+  initialize();
+  header_.current_page_number = page_number;
+  header_.next_page_number = next_page_number;
+  header_.lsn = lsn;
+
+  // minipages start at multiples of 8 bytes, so values can be read in place
+  const std::size_t directory =
+      (sizeof(PaxHeader) + attributes.size() * sizeof(PaxMinipage) + 7) / 8 * 8;
+  std::size_t record_bytes = 0;
+  for (std::size_t i = 0; i < attributes.size(); ++i) {
+    assert(attributes[i].offset + attributes[i].length <= record_length);
+    record_bytes += attributes[i].length;
+  }
+  std::size_t capacity = 0;
+  if (directory < DATA_SIZE && record_bytes > 0) {
+    capacity = (DATA_SIZE - directory) / record_bytes;
+    for (;; --capacity) {
+      std::size_t end = directory;
+      for (std::size_t i = 0; i < attributes.size(); ++i) {
+        end += (capacity * attributes[i].length + 7) / 8 * 8;
+      }
+      if (end <= DATA_SIZE) {
+        break;
+      }
+    }
+  }
+  if (capacity == 0) {
+    throw InsufficientSpaceException(page_number, record_length, DATA_SIZE);
+  }
+
+  PaxHeader* pax = reinterpret_cast<PaxHeader*>(data_);
+  pax->record_length = record_length;
+  pax->num_attributes = attributes.size();
+  pax->capacity = capacity;
+  pax->record_bytes = record_bytes;
+  std::size_t offset = directory;
+  for (std::size_t i = 0; i < attributes.size(); ++i) {
+    PaxMinipage* minipage = reinterpret_cast<PaxMinipage*>(
+        data_ + sizeof(PaxHeader)) + i;
+    minipage->attribute = attributes[i];
+    minipage->offset = offset;
+    minipage->reserved = 0;
+    offset += (capacity * attributes[i].length + 7) / 8 * 8;
+  }
+  header_.layout = LAYOUT_PAX;
+  header_.free_space_lower_bound = directory;
+  header_.free_space_upper_bound = directory + capacity * record_bytes;
+}
+
+std::uint16_t Page::getNumAttributes() const {
+  return layout() == LAYOUT_PAX ? paxHeader().num_attributes : 0;
+}
+
+PaxAttribute Page::getAttribute(const int attribute) const {
+  assert(attribute >= 0 && attribute < getNumAttributes());
+  return paxMinipage(attribute).attribute;
+}
+
+const char* Page::getColumn(const int attribute) const {
+  assert(attribute >= 0 && attribute < getNumAttributes());
+  return data_ + paxMinipage(attribute).offset;
+}
+
+SlotId Page::getFieldValues(const std::uint16_t offset,
+                           const std::uint16_t length, char* values,
+                           SlotId* slots) const {
+  SlotId count = 0;
+  if (layout() == LAYOUT_PAX) {
+    const PaxHeader& pax = paxHeader();
+    if (offset + length > pax.record_length) {
+      return 0;
+    }
+    for (SlotId i = 0; i < header_.num_slots; ++i) {
+      slots[i] = i + 1;
+    }
+    // the field usually is an attribute, whose values are already together
+    for (int i = 0; i < pax.num_attributes; ++i) {
+      const PaxMinipage& minipage = paxMinipage(i);
+      const PaxAttribute& attribute = minipage.attribute;
+      if (attribute.offset <= offset &&
+          offset + length <= attribute.offset + attribute.length) {
+        const char* column = data_ + minipage.offset + (offset - attribute.offset);
+        if (attribute.length == length) {
+          memcpy(values, column, header_.num_slots * length);
+        } else {
+          for (SlotId j = 0; j < header_.num_slots; ++j) {
+            memcpy(values + j * length, column + j * attribute.length, length);
+          }
+        }
+        return header_.num_slots;
+      }
+    }
+    for (SlotId j = 0; j < header_.num_slots; ++j) {
+      const RecordId record_id = {page_number(), (SlotId)(j + 1)};
+      getRecord(record_id).copy(values + j * length, length, offset);
+    }
+    return header_.num_slots;
+  }
+  for (SlotId i = 1; i <= header_.num_slots; ++i) {
+    const PageSlot& slot = getSlot(i);
+    if (slot.used && offset + length <= slot.item_length) {
+      memcpy(values + count * length, data_ + slot.item_offset + offset, length);
+      slots[count] = i;
+      ++count;
+    }
+  }
+  return count;
+}
+
+void Page::putPaxRecord(const SlotId index, const std::string& record_data) {
+  const PaxHeader& pax = paxHeader();
+  for (int i = 0; i < pax.num_attributes; ++i) {
+    const PaxMinipage& minipage = paxMinipage(i);
+    memcpy(data_ + minipage.offset + index * minipage.attribute.length,
+           record_data.data() + minipage.attribute.offset,
+           minipage.attribute.length);
+  }
+}
+
 RecordId Page::insertRecord(const std::string& record_data) {
+  if (layout() == LAYOUT_PAX &&
+      record_data.length() != paxHeader().record_length) {
+    const RecordId record_id = {page_number(), INVALID_SLOT};
+    throw InvalidRecordException(record_id, page_number());
+  }
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
   }
+  if (layout() == LAYOUT_PAX) {
+    putPaxRecord(header_.num_slots, record_data);
+    ++header_.num_slots;
+    header_.free_space_lower_bound += paxHeader().record_bytes;
+    return {page_number(), header_.num_slots};
+  }
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
   return {page_number(), slot_number};
@@ -45,6 +192,18 @@ RecordId Page::insertRecord(const std::string& record_data) {
 
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
+  if (layout() == LAYOUT_PAX) {
+    const PaxHeader& pax = paxHeader();
+    const SlotId index = record_id.slot_number - 1;
+    std::string record(pax.record_length, '\0');
+    for (int i = 0; i < pax.num_attributes; ++i) {
+      const PaxMinipage& minipage = paxMinipage(i);
+      record.replace(minipage.attribute.offset, minipage.attribute.length,
+                     data_ + minipage.offset + index * minipage.attribute.length,
+                     minipage.attribute.length);
+    }
+    return record;
+  }
   const PageSlot& slot = getSlot(record_id.slot_number);
 	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
 
@@ -54,6 +213,13 @@ std::string Page::getRecord(const RecordId& record_id) const {
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);
+  if (layout() == LAYOUT_PAX) {
+    if (record_data.length() != paxHeader().record_length) {
+      throw InvalidRecordException(record_id, page_number());
+    }
+    putPaxRecord(record_id.slot_number - 1, record_data);
+    return;
+  }
   const PageSlot* slot = getSlot(record_id.slot_number);
   const std::size_t free_space_after_delete =
       getFreeSpace() + slot->item_length;
@@ -75,6 +241,10 @@ void Page::deleteRecord(const RecordId& record_id) {
 void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
+  if (layout() == LAYOUT_PAX) {
+    // the records of a minipage have no slots to mark unused
+    throw InvalidRecordException(record_id, page_number());
+  }
   PageSlot* slot = getSlot(record_id.slot_number);
 
 	for(int i = 0; i < slot->item_length; i++)
@@ -136,6 +306,10 @@ void Page::deleteRecord(const RecordId& record_id,
 }
 
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
+  if (layout() == LAYOUT_PAX) {
+    return record_data.length() == paxHeader().record_length &&
+        header_.num_slots < paxHeader().capacity;
+  }
   std::size_t record_size = record_data.length();
   if (header_.num_free_slots == 0) {
     record_size += sizeof(PageSlot);
@@ -202,6 +376,13 @@ void Page::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
+  if (layout() == LAYOUT_PAX) {
+    if (record_id.slot_number == INVALID_SLOT ||
+        record_id.slot_number > header_.num_slots) {
+      throw InvalidRecordException(record_id, page_number());
+    }
+    return;
+  }
   const PageSlot& slot = getSlot(record_id.slot_number);
   if (!slot.used) {
     throw InvalidRecordException(record_id, page_number());
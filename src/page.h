@@ -11,12 +11,44 @@
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 //#include <gtest/gtest.h>
 #include "types.h"
 
 namespace badgerdb {
 
+/**
+ * @brief Ways the records of a page are laid out in its data.
+ */
+enum PageLayout {
+  /**
+   * Slot array at the front, records packed at the back.
+   */
+  LAYOUT_SLOTTED = 0,
+
+  /**
+   * Fixed-length records split into one minipage per attribute.  See
+   * Page::formatPax.
+   */
+  LAYOUT_PAX = 1
+};
+
+/**
+ * @brief Attribute of the fixed schema of a PAX page.
+ */
+struct PaxAttribute {
+  /**
+   * Offset of the attribute in the record.
+   */
+  std::uint16_t offset;
+
+  /**
+   * Length of the attribute in bytes.
+   */
+  std::uint16_t length;
+};
+
 /**
  * @brief Header metadata in a page.
  *
@@ -58,6 +90,22 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * Number of the last write-ahead log record of the page, 0 if it has none. See LogMgr.
+   */
+  Lsn lsn;
+
+  /**
+   * CRC32C of the page as PageFile last wrote it, taken with this field as
+   * zero.  See PageFile::verifyChecksum.
+   */
+  std::uint32_t checksum;
+
+  /**
+   * PageLayout of the data.
+   */
+  std::uint16_t layout;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -138,6 +186,10 @@ class Page {
    *
    * @param record_data  Bytes that compose the record.
    * @return  ID of the newly inserted record.
+   * @throws  InsufficientSpaceException  Thrown if the page cannot hold the
+   *                                      record.
+   * @throws  InvalidRecordException  Thrown on a PAX page if the record does
+   *                                  not have the length of its schema.
    */
   RecordId insertRecord(const std::string& record_data);
 
@@ -158,6 +210,11 @@ class Page {
    *
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
+   * @throws  InsufficientSpaceException  Thrown if the page cannot hold the
+   *                                      new version.
+   * @throws  InvalidRecordException  Thrown if there is no such record, or on
+   *                                  a PAX page if the new version does not
+   *                                  have the length of its schema.
    */
   void updateRecord(const RecordId& record_id, const std::string& record_data);
 
@@ -167,6 +224,7 @@ class Page {
    * the slot deleted is at the end of the slot array.
    *
    * @param record_id   ID of the record to delete.
+   * @throws  InvalidRecordException  Thrown for every record of a PAX page.
    */
   void deleteRecord(const RecordId& record_id);
 
@@ -200,6 +258,100 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the number of the last write-ahead log record of this page, 0 if it has none.
+   *
+   * @return  Log sequence number.
+   */
+  Lsn lsn() const { return header_.lsn; }
+
+  /**
+   * Returns the number of records on the page.
+   *
+   * @return  Number of records.
+   */
+  SlotId getNumRecords() const {
+    return header_.num_slots - header_.num_free_slots;
+  }
+
+  /**
+   * Returns the way the records of this page are laid out.
+   *
+   * @return  Layout of the page.
+   */
+  PageLayout layout() const { return (PageLayout)header_.layout; }
+
+  /**
+   * Lays this page out as a PAX page for records of a fixed schema, dropping
+   * the records it holds.  Instead of being stored whole, each record is split
+   * into its attributes, and the values of an attribute are stored one after
+   * another in a minipage of their own, so a scan of one attribute reads only
+   * its minipage.  The bytes of a record outside every attribute, such as
+   * padding, are not stored and read back as zero.
+   *
+   * Records of a PAX page are inserted, read and updated as on any other page,
+   * and get the slot numbers 1, 2, ... in order.  They cannot be deleted.
+   * Every record must be record_length bytes long: insertRecord and
+   * updateRecord throw InvalidRecordException for one that is not, and
+   * hasSpaceForRecord returns false for it.
+   *
+   * @param attributes     Attributes of the records, each within record_length
+   * @param record_length  Length of every record in bytes
+   * @throws  InsufficientSpaceException  Thrown if not even one record fits.
+   */
+  void formatPax(const std::vector<PaxAttribute>& attributes,
+                 const std::uint16_t record_length);
+
+  /**
+   * Returns the number of attributes of the schema of a PAX page, 0 for a
+   * slotted page.
+   *
+   * @return  Number of attributes.
+   */
+  std::uint16_t getNumAttributes() const;
+
+  /**
+   * Returns the attribute with the given number of the schema of a PAX page.
+   *
+   * @param attribute  Number of the attribute, below getNumAttributes.
+   * @return  The attribute.
+   */
+  PaxAttribute getAttribute(const int attribute) const;
+
+  /**
+   * Returns the values of an attribute of a PAX page, those of the records
+   * one after another, each as long as the attribute.  The values start at a
+   * multiple of 8 bytes into the page, and stay valid as long as the page is
+   * not changed.
+   *
+   * @param attribute  Number of the attribute, below getNumAttributes.
+   * @return  Value of the attribute in the first record.
+   */
+  const char* getColumn(const int attribute) const;
+
+  /**
+   * Copies the bytes at the same offset of every record into one array, the
+   * values of a field one after another, along with the slot numbers of the
+   * records.  Records too short to hold the bytes are left out.
+   *
+   * @param offset  Offset of the bytes in a record
+   * @param length  Number of bytes
+   * @param values  Bytes returned in this, room for getNumRecords() * length
+   * @param slots   Slot numbers returned in this, room for getNumRecords()
+   * @return  Number of records copied.
+   */
+  SlotId getFieldValues(const std::uint16_t offset, const std::uint16_t length,
+                        char* values, SlotId* slots) const;
+
+  /**
+   * Returns the CRC32C of the given header followed by the data of this page,
+   * with the checksum field of the header taken as zero.
+   *
+   * @param header  Header the page is written with.
+   * @return  Checksum to store in the header.
+   */
+  std::uint32_t computeChecksum(const PageHeader& header) const;
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -321,6 +473,73 @@ class Page {
    */
   bool isUsed() const { return page_number() != INVALID_NUMBER; }
 
+  /**
+   * @brief Start of the data of a PAX page, followed by a PaxMinipage for
+   * each attribute.
+   */
+  struct PaxHeader {
+    /**
+     * Length of every record in bytes.
+     */
+    std::uint16_t record_length;
+
+    /**
+     * Number of attributes, and of minipages.
+     */
+    std::uint16_t num_attributes;
+
+    /**
+     * Number of records the page holds when full.
+     */
+    std::uint16_t capacity;
+
+    /**
+     * Sum of the lengths of the attributes.
+     */
+    std::uint16_t record_bytes;
+  };
+
+  /**
+   * @brief Entry of a PAX page for one attribute.
+   */
+  struct PaxMinipage {
+    /**
+     * Where the attribute sits in a record.
+     */
+    PaxAttribute attribute;
+
+    /**
+     * Offset in the data of the value of the first record.
+     */
+    std::uint16_t offset;
+
+    /**
+     * Unused.
+     */
+    std::uint16_t reserved;
+  };
+
+  /**
+   * Returns the header of a PAX page.
+   */
+  const PaxHeader& paxHeader() const {
+    return *reinterpret_cast<const PaxHeader*>(data_);
+  }
+
+  /**
+   * Returns the minipage of the given attribute of a PAX page.
+   */
+  const PaxMinipage& paxMinipage(const int attribute) const {
+    return reinterpret_cast<const PaxMinipage*>(
+        data_ + sizeof(PaxHeader))[attribute];
+  }
+
+  /**
+   * Copies the attributes of a record into their minipages at the given
+   * index.  Callers make sure the record has the length of the schema.
+   */
+  void putPaxRecord(const SlotId index, const std::string& record_data);
+
   /**
    * Header metadata.
    */
@@ -337,6 +556,7 @@ class Page {
   friend class PageFile;
   friend class BlobFile;
   friend class PageIterator;
+  friend class LogMgr;
 };
 
 static_assert(Page::SIZE > sizeof(PageHeader),
@@ -109,6 +109,10 @@ class PageIterator {
    * @return  Next used slot after given slot or Page::INVALID_SLOT.
    */
   SlotId getNextUsedSlot(const SlotId start) const {
+    if (page_->layout() == LAYOUT_PAX) {
+      // every record of a PAX page is in use
+      return start < page_->header_.num_slots ? start + 1 : Page::INVALID_SLOT;
+    }
     SlotId slot_number = Page::INVALID_SLOT;
     for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
       const PageSlot* slot = page_->getSlot(i);
@@ -0,0 +1,194 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define BADGERDB_RANGE_FILTER_SIMD 1
+#endif
+
+namespace badgerdb {
+
+/**
+ * @brief Selects the values of an array that lie in a range, several at a time.
+ *
+ * On x86-64 the values are compared eight ints or four doubles at a time with AVX2 when the processor has
+ * it, and four ints or two doubles at a time with SSE2 otherwise; elsewhere one at a time. Each comparison
+ * yields a mask of the values in the range, and the positions of those are written out without a branch
+ * per value, so how many match does not disturb the loop.
+ */
+class RangeFilter {
+ public:
+  /**
+   * Writes the positions of the ints that lie in [low, high] to out, in order.
+   *
+   * @param values  Values to compare
+   * @param count   Number of values
+   * @param low     Lowest value selected
+   * @param high    Highest value selected
+   * @param out     Positions returned in this, room for count
+   * @return  Number of positions written.
+   */
+  static int selectInt(const int* values, const int count, const int low, const int high, std::uint16_t* out) {
+#ifdef BADGERDB_RANGE_FILTER_SIMD
+    if (avx2Supported()) {
+      return selectIntAvx2(values, count, low, high, out);
+    }
+    return selectIntSse2(values, count, low, high, out);
+#else
+    return selectIntScalar(values, count, low, high, out, 0, 0);
+#endif
+  }
+
+  /**
+   * Writes the positions of the doubles that lie in [low, high] to out, in order. NaN lies in no range.
+   *
+   * @param values  Values to compare
+   * @param count   Number of values
+   * @param low     Lowest value selected
+   * @param high    Highest value selected
+   * @param out     Positions returned in this, room for count
+   * @return  Number of positions written.
+   */
+  static int selectDouble(const double* values, const int count, const double low, const double high,
+                          std::uint16_t* out) {
+#ifdef BADGERDB_RANGE_FILTER_SIMD
+    if (avx2Supported()) {
+      return selectDoubleAvx2(values, count, low, high, out);
+    }
+    return selectDoubleSse2(values, count, low, high, out);
+#else
+    return selectDoubleScalar(values, count, low, high, out, 0, 0);
+#endif
+  }
+
+  /**
+   * Returns true if select uses AVX2.
+   */
+  static bool avx2Supported() {
+#ifdef BADGERDB_RANGE_FILTER_SIMD
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * selectInt one value at a time, from position start on, appending to the n positions already in out.
+   */
+  static int selectIntScalar(const int* values, const int count, const int low, const int high,
+                             std::uint16_t* out, int start, int n) {
+    for (int i = start; i < count; i++) {
+      out[n] = i;
+      n += low <= values[i] && values[i] <= high;
+    }
+    return n;
+  }
+
+  /**
+   * selectDouble one value at a time, from position start on, appending to the n positions already in out.
+   */
+  static int selectDoubleScalar(const double* values, const int count, const double low, const double high,
+                                std::uint16_t* out, int start, int n) {
+    for (int i = start; i < count; i++) {
+      out[n] = i;
+      n += low <= values[i] && values[i] <= high;
+    }
+    return n;
+  }
+
+#ifdef BADGERDB_RANGE_FILTER_SIMD
+  /**
+   * selectInt four values at a time; SSE2 is part of every x86-64 processor.
+   */
+  static int selectIntSse2(const int* values, const int count, const int low, const int high,
+                           std::uint16_t* out) {
+    const __m128i lows = _mm_set1_epi32(low);
+    const __m128i highs = _mm_set1_epi32(high);
+    int n = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+      const __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(lows, v), _mm_cmpgt_epi32(v, highs));
+      n = putPositions(out, n, i, ~_mm_movemask_ps(_mm_castsi128_ps(outside)), 4);
+    }
+    return selectIntScalar(values, count, low, high, out, i, n);
+  }
+
+  /**
+   * selectDouble two values at a time.
+   */
+  static int selectDoubleSse2(const double* values, const int count, const double low, const double high,
+                              std::uint16_t* out) {
+    const __m128d lows = _mm_set1_pd(low);
+    const __m128d highs = _mm_set1_pd(high);
+    int n = 0;
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+      const __m128d v = _mm_loadu_pd(values + i);
+      const __m128d inside = _mm_and_pd(_mm_cmpge_pd(v, lows), _mm_cmple_pd(v, highs));
+      n = putPositions(out, n, i, _mm_movemask_pd(inside), 2);
+    }
+    return selectDoubleScalar(values, count, low, high, out, i, n);
+  }
+
+  /**
+   * selectInt eight values at a time; only to be called if avx2Supported.
+   */
+  __attribute__((target("avx2")))
+  static int selectIntAvx2(const int* values, const int count, const int low, const int high,
+                           std::uint16_t* out) {
+    const __m256i lows = _mm256_set1_epi32(low);
+    const __m256i highs = _mm256_set1_epi32(high);
+    int n = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+      const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(lows, v), _mm256_cmpgt_epi32(v, highs));
+      n = putPositions(out, n, i, ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)), 8);
+    }
+    return selectIntScalar(values, count, low, high, out, i, n);
+  }
+
+  /**
+   * selectDouble four values at a time; only to be called if avx2Supported.
+   */
+  __attribute__((target("avx2")))
+  static int selectDoubleAvx2(const double* values, const int count, const double low, const double high,
+                              std::uint16_t* out) {
+    const __m256d lows = _mm256_set1_pd(low);
+    const __m256d highs = _mm256_set1_pd(high);
+    int n = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+      const __m256d v = _mm256_loadu_pd(values + i);
+      const __m256d inside = _mm256_and_pd(_mm256_cmp_pd(v, lows, _CMP_GE_OQ), _mm256_cmp_pd(v, highs, _CMP_LE_OQ));
+      n = putPositions(out, n, i, _mm256_movemask_pd(inside), 4);
+    }
+    return selectDoubleScalar(values, count, low, high, out, i, n);
+  }
+#endif
+
+ private:
+  /**
+   * Appends the positions base + lane of the lanes set in mask to the n positions already in out. Every
+   * lane is written, and only those set are kept.
+   */
+  static int putPositions(std::uint16_t* out, int n, const int base, const int mask, const int lanes) {
+    for (int lane = 0; lane < lanes; lane++) {
+      out[n] = base + lane;
+      n += (mask >> lane) & 1;
+    }
+    return n;
+  }
+};
+
+}
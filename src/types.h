@@ -24,6 +24,12 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Log sequence number: position of a record in the write-ahead log. Numbers only grow, also across
+ * truncations of the log.
+ */
+typedef std::uint64_t Lsn;
+
 /**
  * @brief Identifier for a record in a page.
  */
@@ -64,4 +70,31 @@ struct RecordId {
   }
 };
 
+/**
+ * @brief Datatype enumeration type.
+ */
+enum Datatype {
+  INTEGER = 0,
+  DOUBLE = 1,
+  STRING = 2
+};
+
+/**
+ * @brief Scan operations enumeration. Passed to BTreeIndex::startScan() and
+ * FileScan::setPredicate().
+ */
+enum Operator {
+  LT,   /* Less Than */
+  LTE,  /* Less Than or Equal to */
+  GTE,  /* Greater Than or Equal to */
+  GT    /* Greater Than */
+};
+
+/**
+ * @brief Maximum length in bytes of a STRING key. Attribute values and scan
+ * bounds are cut at the first NUL or after this many bytes, and trailing
+ * blanks are dropped before they are compared.
+ */
+const int STRINGSIZE = 64;
+
 }